@@ -0,0 +1,264 @@
+#include "Script.h"
+
+#include "ATP/Library/Trace.h"
+#include "ATP/Library/Exit.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define c_readChunk     65536
+
+typedef struct ScriptJob
+{
+    unsigned int m_line;
+    int m_argc;
+    char **m_argv;
+    int m_status;
+} ScriptJob;
+
+typedef struct ScriptJobs
+{
+    ScriptJob *m_jobs;
+    unsigned int m_count;
+    unsigned int m_capacity;
+    ScriptCommand m_command;
+} ScriptJobs;
+
+// read the whole of a script into a string
+static char *readScript(const char *p_path)
+{
+    FILE *l_file = fopen(p_path, "rb");
+    char *l_text = NULL;
+    size_t l_length = 0;
+    size_t l_capacity = 0;
+    size_t l_read;
+    int l_failed;
+
+    if (l_file == NULL)
+    {
+        return NULL;
+    }
+
+    do
+    {
+        if (l_capacity - l_length < c_readChunk + 1)
+        {
+            l_capacity = (l_capacity == 0 ? c_readChunk + 1 : l_capacity * 2);
+            l_text = realloc(l_text, l_capacity);
+            if (l_text == NULL)
+            {
+                PERR();
+                exit(EX_OSERR);
+            }
+        }
+        l_read = fread(&l_text[l_length], 1, c_readChunk, l_file);
+        l_length += l_read;
+    } while (l_read > 0);
+
+    l_failed = ferror(l_file);
+    fclose(l_file);
+    if (l_failed)
+    {
+        free(l_text);
+        return NULL;
+    }
+    l_text[l_length] = '\0';
+    return l_text;
+}
+
+static int isSpace(char p_char)
+{
+    return (p_char == ' ' || p_char == '\t' || p_char == '\r');
+}
+
+// split a line into parameters in place, returning the number found, or -1 if a quote is left open; unquoting only ever
+// shortens a parameter, so each is written back over the characters it was read from
+static int splitLine(char *p_line, char **p_argv)
+{
+    char *l_in = p_line;
+    char *l_out = p_line;
+    int l_count = 0;
+
+    for (;;)
+    {
+        char l_quote = '\0';
+
+        while (isSpace(*l_in))
+        {
+            ++l_in;
+        }
+        if (*l_in == '\0')
+        {
+            return l_count;
+        }
+
+        p_argv[l_count++] = l_out;
+        while (*l_in != '\0' && (l_quote != '\0' || !isSpace(*l_in)))
+        {
+            if (l_quote == '\0' && (*l_in == '\'' || *l_in == '"'))
+            {
+                l_quote = *l_in++;
+            }
+            else if (*l_in == l_quote)
+            {
+                l_quote = '\0';
+                ++l_in;
+            }
+            else if (*l_in == '\\' && l_quote != '\'' && l_in[1] != '\0')
+            {
+                ++l_in;
+                *l_out++ = *l_in++;
+            }
+            else
+            {
+                *l_out++ = *l_in++;
+            }
+        }
+        if (l_quote != '\0')
+        {
+            return -1;
+        }
+
+        if (*l_in != '\0')
+        {
+            ++l_in;
+        }
+        *l_out++ = '\0';
+    }
+}
+
+// turn a line of the script into a job, unless it holds nothing to run
+static int addJob(ScriptJobs *p_jobs, const char *p_path, unsigned int p_line, char *p_text)
+{
+    ScriptJob *l_job;
+    char **l_argv;
+    int l_count;
+    const char *l_start = p_text;
+
+    while (isSpace(*l_start))
+    {
+        ++l_start;
+    }
+    if (*l_start == '\0' || *l_start == '#')
+    {
+        return 1;
+    }
+
+    // every parameter takes at least one character and a separator, and the list starts with the script and ends with NULL
+    l_argv = malloc((strlen(p_text) / 2 + 3) * sizeof(char *));
+    if (l_argv == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_count = splitLine(p_text, &l_argv[1]);
+    if (l_count < 0)
+    {
+        ERR("%s:%u: unterminated quote\n", p_path, p_line);
+        free(l_argv);
+        return 0;
+    }
+    else if (l_argv[1][0] != '@')
+    {
+        ERR("%s:%u: a pipeline must start with a processor, not '%s'\n", p_path, p_line, l_argv[1]);
+        free(l_argv);
+        return 0;
+    }
+    l_argv[0] = (char *) p_path;
+    l_argv[l_count + 1] = NULL;
+
+    if (p_jobs->m_count == p_jobs->m_capacity)
+    {
+        p_jobs->m_capacity = (p_jobs->m_capacity == 0 ? 16 : p_jobs->m_capacity * 2);
+        p_jobs->m_jobs = realloc(p_jobs->m_jobs, p_jobs->m_capacity * sizeof(ScriptJob));
+        if (p_jobs->m_jobs == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+    l_job = &p_jobs->m_jobs[p_jobs->m_count++];
+    l_job->m_line = p_line;
+    l_job->m_argc = l_count + 1;
+    l_job->m_argv = l_argv;
+    l_job->m_status = EX_OK;
+    return 1;
+}
+
+static void runJobs(unsigned int p_begin, unsigned int p_end, void *p_context)
+{
+    unsigned int i;
+    ScriptJobs *l_jobs = p_context;
+
+    for (i = p_begin; i < p_end; ++i)
+    {
+        ScriptJob *l_job = &l_jobs->m_jobs[i];
+
+        // pipelines are named after their first processor
+        ATP_traceBegin("pipeline", &l_job->m_argv[1][1]);
+        l_job->m_status = l_jobs->m_command(l_job->m_argc, l_job->m_argv);
+        ATP_traceEnd();
+    }
+}
+
+int scriptRun(const char *p_path, ATP_ThreadPool *p_pool, ScriptCommand p_command)
+{
+    unsigned int i;
+    unsigned int l_line = 1;
+    int l_status = EX_OK;
+    char *l_next;
+    char *l_text = readScript(p_path);
+    ScriptJobs l_jobs;
+
+    if (l_text == NULL)
+    {
+        ERR("Unable to read script '%s'\n", p_path);
+        return EX_NOINPUT;
+    }
+
+    memset(&l_jobs, 0, sizeof(l_jobs));
+    l_jobs.m_command = p_command;
+    for (l_next = l_text; l_next != NULL && l_status == EX_OK; ++l_line)
+    {
+        char *l_lineText = l_next;
+
+        l_next = strchr(l_lineText, '\n');
+        if (l_next != NULL)
+        {
+            *l_next++ = '\0';
+        }
+        if (!addJob(&l_jobs, p_path, l_line, l_lineText))
+        {
+            l_status = EX_DATAERR;
+        }
+    }
+
+    if (l_status == EX_OK)
+    {
+        DBG("Running %u pipelines on %u threads\n", l_jobs.m_count, ATP_threadPoolSize(p_pool));
+        ATP_threadPoolFor(p_pool, 0, l_jobs.m_count, 1, &runJobs, &l_jobs);
+
+        // failures are reported in the order of the script, whatever order the pipelines ran in
+        for (i = 0; i < l_jobs.m_count; ++i)
+        {
+            if (l_jobs.m_jobs[i].m_status != EX_OK)
+            {
+                ERR("%s:%u: pipeline failed\n", p_path, l_jobs.m_jobs[i].m_line);
+                if (l_status == EX_OK)
+                {
+                    l_status = l_jobs.m_jobs[i].m_status;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < l_jobs.m_count; ++i)
+    {
+        free(l_jobs.m_jobs[i].m_argv);
+    }
+    free(l_jobs.m_jobs);
+    free(l_text);
+    return l_status;
+}
@@ -0,0 +1,43 @@
+/* File: Script.h
+Running many pipelines from a script file in a single process.
+
+A script lists one pipeline per line, written as it would be on the command line after the options, starting with its first
+processor.  Parameters are separated by white space, and may be quoted with single quotes, taken as they are, or with double
+quotes, in which a backslash escapes the next character as it does outside quotes.  Blank lines and lines starting with # are
+skipped.
+
+The pipelines are independent of each other, and run in no particular order on the threads of a pool, so that processor
+libraries are only opened once and startup is paid for once for the whole script.
+*/
+#ifndef _ATP_EXECUTABLE_SCRIPT_H_
+#define _ATP_EXECUTABLE_SCRIPT_H_
+
+#include "ATP/Library/ThreadPool.h"
+
+/* Callback: ScriptCommand
+Invoked to run a pipeline read from a script, on one of the threads of the pool.
+
+Parameters:
+    argc - The number of entries in argv.
+    argv - The command line of the pipeline, with the path of the script in place of the program name.
+
+Returns:
+    The exit status of the pipeline.
+*/
+typedef int (*ScriptCommand)(int argc, char **argv);
+
+/* Function: scriptRun
+Run every pipeline in a script.
+
+Parameters:
+    p_path    - The path of the script.
+    p_pool    - The pool to run the pipelines on.
+    p_command - The function to run each pipeline with.
+
+Returns:
+    EX_OK if every pipeline succeeded, otherwise the exit status of the first pipeline in the script that failed, or
+    EX_NOINPUT or EX_DATAERR (after printing an error) if the script could not be read or parsed, in which case nothing is run.
+*/
+int scriptRun(const char *p_path, ATP_ThreadPool *p_pool, ScriptCommand p_command);
+
+#endif /* _ATP_EXECUTABLE_SCRIPT_H_ */
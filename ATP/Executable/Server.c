@@ -0,0 +1,513 @@
+#include "Server.h"
+
+#include "ATP/Library/Exit.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !_WIN32
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <stdint.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#if _WIN32
+int serverRun(const char *p_path, ServerCommand p_command)
+{
+    ERR("Serving requests is not supported on this platform\n");
+    return EX_UNAVAILABLE;
+}
+
+int clientRun(const char *p_path, int argc, char **argv)
+{
+    ERR("Serving requests is not supported on this platform\n");
+    return EX_UNAVAILABLE;
+}
+#else // NOTE: assume POSIX for now
+
+// requests start with the magic number and the argument count, followed by the working directory and the arguments, each as
+// a length and that many characters; the standard streams of the client are attached to the start of the request
+#define c_requestMagic      0x41545031
+#define c_maxArguments      4096
+#define c_maxString         65536
+#define c_streamCount       3
+
+// requests are handled one at a time, so a client that stops sending part way through one is given up on after this long
+#define c_receiveTimeout    10
+
+static volatile sig_atomic_t gs_stop = 0;
+
+static void stop(int p_signal)
+{
+    gs_stop = 1;
+}
+
+static int sendAll(int p_socket, const void *p_data, size_t p_size)
+{
+    const char *l_data = p_data;
+    while (p_size > 0)
+    {
+        ssize_t l_sent = send(p_socket, l_data, p_size, 0);
+        if (l_sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (l_sent <= 0)
+        {
+            return 0;
+        }
+
+        l_data += l_sent;
+        p_size -= (size_t) l_sent;
+    }
+
+    return 1;
+}
+
+static int receiveAll(int p_socket, void *p_data, size_t p_size)
+{
+    char *l_data = p_data;
+    while (p_size > 0)
+    {
+        ssize_t l_received = recv(p_socket, l_data, p_size, 0);
+        if (l_received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (l_received <= 0)
+        {
+            return 0;
+        }
+
+        l_data += l_received;
+        p_size -= (size_t) l_received;
+    }
+
+    return 1;
+}
+
+static int sendString(int p_socket, const char *p_string)
+{
+    uint32_t l_length = (uint32_t) strlen(p_string);
+    return sendAll(p_socket, &l_length, sizeof(l_length)) && sendAll(p_socket, p_string, l_length);
+}
+
+static char *receiveString(int p_socket)
+{
+    char *l_string;
+    uint32_t l_length;
+
+    if (!receiveAll(p_socket, &l_length, sizeof(l_length)) || l_length > c_maxString)
+    {
+        return NULL;
+    }
+
+    l_string = malloc(l_length + 1);
+    if (l_string == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    if (!receiveAll(p_socket, l_string, l_length))
+    {
+        free(l_string);
+        return NULL;
+    }
+
+    l_string[l_length] = '\0';
+    return l_string;
+}
+
+static int makeAddress(struct sockaddr_un *p_address, const char *p_path)
+{
+    if (strlen(p_path) >= sizeof(p_address->sun_path))
+    {
+        ERR("Socket path '%s' is too long\n", p_path);
+        return 0;
+    }
+
+    memset(p_address, 0, sizeof(struct sockaddr_un));
+    p_address->sun_family = AF_UNIX;
+    strncpy(p_address->sun_path, p_path, sizeof(p_address->sun_path) - 1);
+    return 1;
+}
+
+static int connectTo(const struct sockaddr_un *p_address)
+{
+    int l_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (l_socket < 0)
+    {
+        return -1;
+    }
+
+    if (connect(l_socket, (const struct sockaddr *) p_address, sizeof(struct sockaddr_un)) != 0)
+    {
+        close(l_socket);
+        return -1;
+    }
+
+    return l_socket;
+}
+
+// receive the fixed part of a request, along with the streams attached to it
+static int receiveHeader(int p_socket, uint32_t p_header[2], int p_streams[c_streamCount])
+{
+    struct msghdr l_message;
+    struct iovec l_vector;
+    struct cmsghdr *l_control;
+    union
+    {
+        struct cmsghdr m_align;
+        char m_buffer[CMSG_SPACE(sizeof(int) * c_streamCount)];
+    } l_buffer;
+    ssize_t l_received;
+    int l_accepted = 0;
+
+    memset(&l_message, 0, sizeof(l_message));
+    l_vector.iov_base = p_header;
+    l_vector.iov_len = sizeof(uint32_t) * 2;
+    l_message.msg_iov = &l_vector;
+    l_message.msg_iovlen = 1;
+    l_message.msg_control = l_buffer.m_buffer;
+    l_message.msg_controllen = sizeof(l_buffer.m_buffer);
+
+    do
+    {
+        l_received = recvmsg(p_socket, &l_message, 0);
+    }
+    while (l_received < 0 && errno == EINTR);
+    if (l_received < 0)
+    {
+        return 0;
+    }
+
+    // any descriptors that arrived are open in this process now, so those of a request that does not attach exactly the streams
+    // expected are closed rather than leaked; a truncated message may have lost some of them, and is rejected whatever it kept
+    for (l_control = CMSG_FIRSTHDR(&l_message); l_control != NULL; l_control = CMSG_NXTHDR(&l_message, l_control))
+    {
+        if (l_control->cmsg_level == SOL_SOCKET && l_control->cmsg_type == SCM_RIGHTS)
+        {
+            size_t l_count = (l_control->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            if (!l_accepted && l_received > 0 && !(l_message.msg_flags & MSG_CTRUNC) && l_count == c_streamCount)
+            {
+                memcpy(p_streams, CMSG_DATA(l_control), sizeof(int) * c_streamCount);
+                l_accepted = 1;
+            }
+            else
+            {
+                int l_stream;
+                size_t i;
+                for (i = 0; i < l_count; ++i)
+                {
+                    memcpy(&l_stream, CMSG_DATA(l_control) + i * sizeof(int), sizeof(int));
+                    close(l_stream);
+                }
+            }
+        }
+    }
+    if (!l_accepted)
+    {
+        return 0;
+    }
+
+    // the rest of the header may arrive separately
+    return receiveAll(p_socket, (char *) p_header + l_received, sizeof(uint32_t) * 2 - (size_t) l_received);
+}
+
+static int sendHeader(int p_socket, const uint32_t p_header[2])
+{
+    struct msghdr l_message;
+    struct iovec l_vector;
+    struct cmsghdr *l_control;
+    union
+    {
+        struct cmsghdr m_align;
+        char m_buffer[CMSG_SPACE(sizeof(int) * c_streamCount)];
+    } l_buffer;
+    int l_streams[c_streamCount] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    ssize_t l_sent;
+
+    memset(&l_message, 0, sizeof(l_message));
+    memset(&l_buffer, 0, sizeof(l_buffer));
+    l_vector.iov_base = (void *) p_header;
+    l_vector.iov_len = sizeof(uint32_t) * 2;
+    l_message.msg_iov = &l_vector;
+    l_message.msg_iovlen = 1;
+    l_message.msg_control = l_buffer.m_buffer;
+    l_message.msg_controllen = sizeof(l_buffer.m_buffer);
+
+    l_control = CMSG_FIRSTHDR(&l_message);
+    l_control->cmsg_level = SOL_SOCKET;
+    l_control->cmsg_type = SCM_RIGHTS;
+    l_control->cmsg_len = CMSG_LEN(sizeof(int) * c_streamCount);
+    memcpy(CMSG_DATA(l_control), l_streams, sizeof(l_streams));
+
+    do
+    {
+        l_sent = sendmsg(p_socket, &l_message, 0);
+    }
+    while (l_sent < 0 && errno == EINTR);
+
+    return (l_sent == (ssize_t) (sizeof(uint32_t) * 2));
+}
+
+static int sendRequest(int p_socket, const char *p_directory, int argc, char **argv)
+{
+    uint32_t l_header[2];
+    int i;
+
+    l_header[0] = c_requestMagic;
+    l_header[1] = (uint32_t) argc;
+    if (!sendHeader(p_socket, l_header) || !sendString(p_socket, p_directory))
+    {
+        return 0;
+    }
+    for (i = 0; i < argc; ++i)
+    {
+        if (!sendString(p_socket, argv[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// receive the arguments of a request, returning the number received in full
+static uint32_t receiveArguments(int p_client, uint32_t p_argc, char **p_argv)
+{
+    uint32_t i;
+    for (i = 0; i < p_argc; ++i)
+    {
+        p_argv[i] = receiveString(p_client);
+        if (p_argv[i] == NULL)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+// run the command line in the working directory and with the streams of the client
+static int runRequest(const char *p_directory, int p_streams[c_streamCount], int argc, char **argv, ServerCommand p_command)
+{
+    int i;
+    int l_saved[c_streamCount];
+    int l_directory = open(".", O_RDONLY);
+    int l_status;
+
+    fflush(stdout);
+    fflush(stderr);
+    for (i = 0; i < c_streamCount; ++i)
+    {
+        l_saved[i] = dup(i);
+        dup2(p_streams[i], i);
+    }
+    clearerr(stdin);
+
+    if (chdir(p_directory) != 0)
+    {
+        ERR("Unable to change to directory '%s': %s\n", p_directory, strerror(errno));
+        l_status = EX_NOINPUT;
+    }
+    else
+    {
+        l_status = p_command(argc, argv);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    clearerr(stdin);
+    for (i = 0; i < c_streamCount; ++i)
+    {
+        dup2(l_saved[i], i);
+        close(l_saved[i]);
+    }
+    if (l_directory >= 0)
+    {
+        if (fchdir(l_directory) != 0)
+        {
+            PERR();
+        }
+        close(l_directory);
+    }
+
+    return l_status;
+}
+
+static void handleClient(int p_client, ServerCommand p_command)
+{
+    uint32_t l_header[2];
+    int l_streams[c_streamCount] = { -1, -1, -1 };
+    char *l_directory = NULL;
+    char **l_argv = NULL;
+    uint32_t l_argc = 0;
+    uint32_t i;
+    char l_peek;
+
+    // connections closed without a request, such as those checking for a running server, are not errors, and neither are those
+    // that send nothing before timing out
+    if (recv(p_client, &l_peek, 1, MSG_PEEK) <= 0)
+    {
+        return;
+    }
+
+    if (receiveHeader(p_client, l_header, l_streams) && l_header[0] == c_requestMagic && l_header[1] > 0
+        && l_header[1] <= c_maxArguments && (l_directory = receiveString(p_client)) != NULL)
+    {
+        l_argv = calloc(l_header[1] + 1, sizeof(char *));
+        if (l_argv == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        l_argc = receiveArguments(p_client, l_header[1], l_argv);
+    }
+
+    if (l_argv != NULL && l_argc == l_header[1])
+    {
+        int32_t l_status = runRequest(l_directory, l_streams, (int) l_argc, l_argv, p_command);
+        if (!sendAll(p_client, &l_status, sizeof(l_status)))
+        {
+            ERR("Unable to send the result of a request\n");
+        }
+    }
+    else
+    {
+        ERR("Ignoring malformed request\n");
+    }
+
+    for (i = 0; i < c_streamCount; ++i)
+    {
+        if (l_streams[i] >= 0)
+        {
+            close(l_streams[i]);
+        }
+    }
+    for (i = 0; i < l_argc; ++i)
+    {
+        free(l_argv[i]);
+    }
+    free(l_argv);
+    free(l_directory);
+}
+
+int serverRun(const char *p_path, ServerCommand p_command)
+{
+    struct sockaddr_un l_address;
+    struct sigaction l_action;
+    struct timeval l_timeout;
+    int l_server;
+    int l_existing;
+
+    if (!makeAddress(&l_address, p_path))
+    {
+        return EX_USAGE;
+    }
+
+    // only replace the socket if no server is answering on it
+    l_existing = connectTo(&l_address);
+    if (l_existing >= 0)
+    {
+        close(l_existing);
+        ERR("A server is already listening on '%s'\n", p_path);
+        return EX_UNAVAILABLE;
+    }
+    unlink(p_path);
+
+    l_server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (l_server < 0 || bind(l_server, (struct sockaddr *) &l_address, sizeof(l_address)) != 0 || listen(l_server, 16) != 0)
+    {
+        ERR("Unable to listen on '%s': %s\n", p_path, strerror(errno));
+        if (l_server >= 0)
+        {
+            close(l_server);
+        }
+        return EX_UNAVAILABLE;
+    }
+
+    // stop accepting requests on interruption, rather than leaving the socket file behind
+    memset(&l_action, 0, sizeof(l_action));
+    l_action.sa_handler = &stop;
+    sigemptyset(&l_action.sa_mask);
+    sigaction(SIGINT, &l_action, NULL);
+    sigaction(SIGTERM, &l_action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    l_timeout.tv_sec = c_receiveTimeout;
+    l_timeout.tv_usec = 0;
+
+    LOG("Serving requests on %s\n", p_path);
+    while (!gs_stop)
+    {
+        int l_client = accept(l_server, NULL, NULL);
+        if (l_client < 0)
+        {
+            if (errno != EINTR)
+            {
+                PERR();
+                break;
+            }
+            continue;
+        }
+
+        if (setsockopt(l_client, SOL_SOCKET, SO_RCVTIMEO, &l_timeout, sizeof(l_timeout)) != 0)
+        {
+            PERR();
+        }
+        handleClient(l_client, p_command);
+        close(l_client);
+    }
+
+    LOG("Stopped serving requests on %s\n", p_path);
+    close(l_server);
+    unlink(p_path);
+    return EX_OK;
+}
+
+int clientRun(const char *p_path, int argc, char **argv)
+{
+    struct sockaddr_un l_address;
+    char l_directory[4096];
+    int32_t l_status;
+    int l_socket;
+
+    if (!makeAddress(&l_address, p_path))
+    {
+        return EX_USAGE;
+    }
+    if (getcwd(l_directory, sizeof(l_directory)) == NULL)
+    {
+        PERR();
+        return EX_OSERR;
+    }
+
+    l_socket = connectTo(&l_address);
+    if (l_socket < 0)
+    {
+        ERR("Unable to connect to '%s': %s\n", p_path, strerror(errno));
+        return EX_UNAVAILABLE;
+    }
+
+    // make sure nothing written so far ends up after the output of the server
+    fflush(stdout);
+    fflush(stderr);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!sendRequest(l_socket, l_directory, argc, argv) || !receiveAll(l_socket, &l_status, sizeof(l_status)))
+    {
+        ERR("The server on '%s' did not complete the request\n", p_path);
+        l_status = EX_UNAVAILABLE;
+    }
+
+    close(l_socket);
+    return l_status;
+}
+#endif
@@ -0,0 +1,47 @@
+/* File: Server.h
+Running pipelines on behalf of other atp processes, over a Unix domain socket.
+
+A server handles one request at a time.  The client passes its command line, its working directory and its standard streams
+to the server, which runs the command line with them in place of its own, and answers with the exit status.  Processor
+libraries, and whatever they cache, stay loaded in the server from one request to the next.
+*/
+#ifndef _ATP_EXECUTABLE_SERVER_H_
+#define _ATP_EXECUTABLE_SERVER_H_
+
+/* Callback: ServerCommand
+Invoked by the server to run a command line received from a client.
+
+Parameters:
+    argc - The number of entries in argv.
+    argv - The command line, as given to the client.
+
+Returns:
+    The exit status to return to the client.
+*/
+typedef int (*ServerCommand)(int argc, char **argv);
+
+/* Function: serverRun
+Serve requests on a socket until interrupted.  Any stale socket file left at the path is replaced.
+
+Parameters:
+    p_path    - The path of the socket to listen on.
+    p_command - The function to run each command line with.
+
+Returns:
+    The exit status for the server process.
+*/
+int serverRun(const char *p_path, ServerCommand p_command);
+/* Function: clientRun
+Have the server listening on a socket run a command line.
+
+Parameters:
+    p_path - The path of the socket the server is listening on.
+    argc   - The number of entries in argv.
+    argv   - The command line to run.
+
+Returns:
+    The exit status of the command line as run by the server, or EX_UNAVAILABLE if the server could not be reached.
+*/
+int clientRun(const char *p_path, int argc, char **argv);
+
+#endif /* _ATP_EXECUTABLE_SERVER_H_ */
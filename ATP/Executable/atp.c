@@ -1,11 +1,19 @@
 #include "ATP/Library/CommandLine.h"
 #include "ATP/Library/Processor.h"
+#include "ATP/Library/Pipeline.h"
+#include "ATP/Library/Parallel.h"
+#include "ATP/Library/Profile.h"
+#include "ATP/Library/Cache.h"
+#include "ATP/Library/Trace.h"
+#include "ATP/Library/ThreadPool.h"
+#include "ATP/Library/Watch.h"
 #include "ATP/Library/Array.h"
 #include "ATP/Library/Exit.h"
 #include "ATP/Library/Log.h"
+#include "Server.h"
+#include "Script.h"
 
-#include "ATP/ThirdParty/UT/utlist.h"
-
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -13,6 +21,10 @@
 extern int help_load(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface);
 extern int random_load(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface);
 
+// manage the index of processor libraries
+extern int ATP_processorsWriteIndex(const char *p_file);
+extern void ATP_processorsRelease(void);
+
 // static processor lookup table
 static ATP_StaticProcessor gs_staticProcessors[] =
 {
@@ -20,99 +32,525 @@ static ATP_StaticProcessor gs_staticProcessors[] =
     { "random", &random_load },
 };
 
-static void cleanupProcessors(ATP_Processor *p_processors)
+// handle the pipeline structure tokens, which do not name processors
+static int addStructure(ATP_Pipeline *p_pipeline, const char *p_name, const ATP_Array *p_parameters, int *p_handled)
 {
-    ATP_Processor *it = NULL;
-    ATP_Processor *l_tmp = NULL;
+    const char *l_source = NULL;
+    unsigned int l_length = ATP_arrayLength(p_parameters);
 
-    if (p_processors != NULL)
+    *p_handled = 1;
+    if (strcmp(p_name, "tee") == 0)
+    {
+        if (l_length != 1 || !ATP_arrayGetString(p_parameters, 0, &l_source))
+        {
+            ERR("Usage: @tee <name>\n");
+            return 0;
+        }
+        return ATP_pipelineTee(p_pipeline, l_source);
+    }
+    else if (strcmp(p_name, "from") == 0)
     {
-        LL_FOREACH_SAFE(p_processors, it, l_tmp)
+        if (l_length > 1 || (l_length == 1 && !ATP_arrayGetString(p_parameters, 0, &l_source)))
         {
-            LL_DELETE(p_processors, it);
-            ATP_processorUnload(it);
+            ERR("Usage: @from [name]\n");
+            return 0;
         }
+        return ATP_pipelineBranch(p_pipeline, l_source);
     }
+    else if (strcmp(p_name, "join") == 0)
+    {
+        if (l_length == 0)
+        {
+            ERR("Usage: @join <name> [name ...]\n");
+            return 0;
+        }
+        return ATP_pipelineJoin(p_pipeline, p_parameters);
+    }
+
+    *p_handled = 0;
+    return 1;
 }
 
-int main(int argc, char **argv)
+// parse the parameters of a parallel token, which applies to the processor following it
+static int parseParallel(const ATP_Array *p_parameters, char **p_key, unsigned int *p_threads)
 {
-    unsigned int l_count = 0;
-    char *l_name = NULL;
-    ATP_Array l_parameters;
-    ATP_Processor *l_processors = NULL;
-    ATP_Processor *it = NULL;
-    ATP_Dictionary l_input;
-    ATP_Dictionary l_output;
-    char l_pipeline[1024] = "";
+    const char *l_key = NULL;
+    const char *l_threads = NULL;
+    char *l_end = NULL;
+    unsigned long l_value = 0;
 
-    if (argc > 1)
+    if (ATP_arrayLength(p_parameters) == 2 && ATP_arrayGetString(p_parameters, 0, &l_key)
+        && ATP_arrayGetString(p_parameters, 1, &l_threads))
     {
-        LOG("Starting up...\n");
+        l_value = strtoul(l_threads, &l_end, 10);
+    }
+    if (l_end == NULL || *l_threads == '\0' || *l_end != '\0' || l_value == 0 || l_value > UINT_MAX)
+    {
+        ERR("Usage: @parallel <key> <threads> @<processor> [parameters]\n");
+        return 0;
     }
 
-    // parse command line and load processors
-    ATP_processorsSetStatic(gs_staticProcessors, ARRAYLEN(gs_staticProcessors));
+    *p_key = strdup(l_key);
+    if (*p_key == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    *p_threads = (unsigned int) l_value;
+    return 1;
+}
+
+// the global options, which come before the first processor
+typedef struct Options
+{
+    unsigned long m_threads;
+    int m_profile;
+    const char *m_profileFile;
+    const char *m_cacheDir;
+    unsigned long long m_cacheSize;
+} Options;
+
+// parse the global options, returning the exit status to stop with if any is invalid
+static int parseOptions(int argc, char **argv, unsigned long p_threads, Options *p_options)
+{
+    const char *l_option;
+
+    p_options->m_threads = p_threads;
+    p_options->m_profileFile = NULL;
+    p_options->m_cacheDir = NULL;
+    p_options->m_cacheSize = c_ATP_Cache_defaultLimit;
+
+    if (ATP_commandLineGetOption(argc, argv, "threads", &l_option))
+    {
+        char *l_end = NULL;
+        if (l_option != NULL)
+        {
+            p_options->m_threads = strtoul(l_option, &l_end, 10);
+        }
+        if (l_option == NULL || *l_option == '\0' || *l_end != '\0' || p_options->m_threads > UINT_MAX)
+        {
+            ERR("The --threads option requires a number of threads, or 0 for one per core\n");
+            return EX_USAGE;
+        }
+    }
+
+    if (ATP_commandLineGetOption(argc, argv, "cache-dir", &p_options->m_cacheDir) && p_options->m_cacheDir == NULL)
+    {
+        ERR("The --cache-dir option requires the path of the directory to cache outputs in\n");
+        return EX_USAGE;
+    }
+    if (ATP_commandLineGetOption(argc, argv, "cache-size", &l_option))
+    {
+        char *l_end = NULL;
+        if (l_option != NULL)
+        {
+            p_options->m_cacheSize = strtoull(l_option, &l_end, 10);
+        }
+        if (l_option == NULL || *l_option == '\0' || *l_end != '\0' || p_options->m_cacheSize == 0)
+        {
+            ERR("The --cache-size option requires the size limit of the cache in megabytes\n");
+            return EX_USAGE;
+        }
+    }
+
+    p_options->m_profile = ATP_commandLineGetOption(argc, argv, "profile", &p_options->m_profileFile);
+    return EX_OK;
+}
+
+// load the processors of a pipeline as described by a command line, in the current context, adding each to a watch if given
+static int loadPipeline(int argc, char **argv, ATP_Pipeline *p_pipeline, ATP_Watch *p_watch, char *p_description,
+                        size_t p_size)
+{
+    unsigned int l_token = 0;
+    unsigned int l_count = 0;
+    char *l_name = NULL;
+    char *l_parallelKey = NULL;
+    unsigned int l_parallelThreads = 0;
+    ATP_Array l_parameters;
+
     ATP_arrayInit(&l_parameters);
-    while (ATP_commandLineGet(argc, argv, l_count, &l_name, &l_parameters))
+    while (ATP_commandLineGet(argc, argv, l_token, &l_name, &l_parameters))
     {
-        ATP_Processor *l_proc;
-        strncat(l_pipeline, (l_count > 0 ? " > " : " "), sizeof(l_pipeline) - strlen(l_pipeline) - 1);
-        strncat(l_pipeline, l_name, sizeof(l_pipeline) - strlen(l_pipeline) - 1);
+        int l_handled = 0;
+        int l_ok = 1;
+        strncat(p_description, (l_token > 0 ? " > " : " "), p_size - strlen(p_description) - 1);
+        strncat(p_description, l_name, p_size - strlen(p_description) - 1);
 
-        l_proc = ATP_processorLoad(l_count, l_name, &l_parameters);
-        if (l_proc == NULL)
+        if (strcmp(l_name, "parallel") == 0)
         {
+            if (l_parallelKey != NULL)
+            {
+                ERR("@parallel must be followed by a processor\n");
+            }
+            l_ok = (l_parallelKey == NULL && parseParallel(&l_parameters, &l_parallelKey, &l_parallelThreads));
+            l_handled = 1;
+        }
+        else if (l_parallelKey == NULL)
+        {
+            l_ok = addStructure(p_pipeline, l_name, &l_parameters, &l_handled);
+        }
+        if (l_ok && !l_handled)
+        {
+            // the token following a parallel token is always taken to name the processor it runs
+            ATP_Processor *l_proc = (l_parallelKey != NULL
+                                     ? ATP_processorLoadParallel(l_count, l_parallelKey, l_parallelThreads, l_name,
+                                                                 &l_parameters)
+                                     : ATP_processorLoad(l_count, l_name, &l_parameters));
+            free(l_parallelKey);
+            l_parallelKey = NULL;
+
+            l_ok = (l_proc != NULL);
+            if (l_ok)
+            {
+                if (p_watch != NULL)
+                {
+                    l_proc = ATP_watchAdd(p_watch, l_proc);
+                }
+                ATP_pipelineAppend(p_pipeline, l_proc);
+                ++l_count;
+            }
+        }
+        if (!l_ok)
+        {
+            free(l_parallelKey);
             ATP_arrayDestroy(&l_parameters);
-            cleanupProcessors(l_processors);
             return EX_USAGE;
         }
-        LL_APPEND(l_processors, l_proc);
 
-        ++l_count;
+        ++l_token;
         ATP_arrayClear(&l_parameters);
     }
+    ATP_arrayDestroy(&l_parameters);
+    if (l_parallelKey != NULL)
+    {
+        ERR("@parallel must be followed by a processor\n");
+        free(l_parallelKey);
+        return EX_USAGE;
+    }
     if (l_count == 0)
     {
         // load help if nothing else is specified
         ATP_Processor *l_proc = ATP_processorLoad(l_count++, "help", NULL);
         if (l_proc == NULL)
         {
-            cleanupProcessors(l_processors);
             return EX_USAGE;
         }
-        LL_APPEND(l_processors, l_proc);
+        ATP_pipelineAppend(p_pipeline, l_proc);
+    }
+    return EX_OK;
+}
+
+// run a single pipeline, as described by a command line
+static int runPipeline(int argc, char **argv)
+{
+    ATP_Pipeline l_pipeline;
+    ATP_ThreadPool l_pool;
+    ATP_ProcessorContext l_context;
+    ATP_ProcessorContext *l_previous;
+    Options l_options;
+    int l_status;
+    int l_result;
+    char l_description[1024] = "";
+
+    if (argc > 1)
+    {
+        LOG("Starting up...\n");
+    }
+
+    // parse global options
+    l_status = parseOptions(argc, argv, 1, &l_options);
+    if (l_status != EX_OK)
+    {
+        return l_status;
+    }
+
+    // measure each processor as it runs, rather than only when asked for the report
+    ATP_profileSetEnabled(l_options.m_profile);
+
+    // parse command line and load processors, in a context of their own
+    ATP_processorContextInit(&l_context);
+    l_previous = ATP_processorContextSwitch(&l_context);
+    ATP_pipelineInit(&l_pipeline);
+    l_status = loadPipeline(argc, argv, &l_pipeline, NULL, l_description, sizeof(l_description));
+    if (l_status != EX_OK)
+    {
+        ATP_pipelineDestroy(&l_pipeline);
+        ATP_processorContextSwitch(l_previous);
+        return l_status;
     }
     if (argc > 1)
     {
-        LOG("Requested pipeline: %s\n", l_pipeline);
+        LOG("Requested pipeline: %s\n", l_description);
+    }
+
+    // now run the processors, which share a pool of workers sized like the pipeline for any parallel work of their own; the
+    // processor should log its own error on failure
+    if (!ATP_cacheSetDirectory(l_options.m_cacheDir, l_options.m_cacheSize))
+    {
+        ATP_pipelineDestroy(&l_pipeline);
+        ATP_processorContextSwitch(l_previous);
+        return EX_CANTCREAT;
+    }
+    ATP_threadPoolInit(&l_pool, (unsigned int) l_options.m_threads);
+    ATP_threadPoolSetShared(&l_pool);
+    l_result = ATP_pipelineExecute(&l_pipeline, (unsigned int) l_options.m_threads);
+    ATP_threadPoolSetShared(NULL);
+    ATP_threadPoolDestroy(&l_pool);
+    ATP_cacheSetDirectory(NULL, 0);
+    if (ATP_profileEnabled() && !ATP_pipelineProfile(&l_pipeline, l_options.m_profileFile))
+    {
+        l_result = 0;
+    }
+
+    // clean up and quit
+    ATP_pipelineDestroy(&l_pipeline);
+    ATP_processorContextSwitch(l_previous);
+    return (l_result ? EX_OK : EX_SOFTWARE);
+}
+
+// run a pipeline read from a script, on one of the threads running the script
+static int runScriptLine(int argc, char **argv)
+{
+    ATP_Pipeline l_pipeline;
+    ATP_ProcessorContext l_context;
+    ATP_ProcessorContext *l_previous;
+    int l_status;
+    char l_description[1024] = "";
+
+    // each pipeline gets a context of its own, so that a request for help in one does not affect the others
+    ATP_processorContextInit(&l_context);
+    l_previous = ATP_processorContextSwitch(&l_context);
+    ATP_pipelineInit(&l_pipeline);
+    l_status = loadPipeline(argc, argv, &l_pipeline, NULL, l_description, sizeof(l_description));
+    if (l_status == EX_OK)
+    {
+        DBG("Running pipeline: %s\n", l_description);
+        l_status = (ATP_pipelineExecute(&l_pipeline, 1) ? EX_OK : EX_SOFTWARE);
     }
+    ATP_pipelineDestroy(&l_pipeline);
+    ATP_processorContextSwitch(l_previous);
+    return l_status;
+}
 
-    // now run the processors in order
-    ATP_dictionaryInit(&l_input);
-    ATP_dictionaryInit(&l_output);
-    LL_FOREACH(l_processors, it)
+// run every pipeline in a script, spread over the threads of a pool that the processors share
+static int runScript(int argc, char **argv, const char *p_path)
+{
+    ATP_ThreadPool l_pool;
+    ATP_Array l_parameters;
+    Options l_options;
+    char *l_name = NULL;
+    int l_status;
+    int l_hasProcessors;
+
+    ATP_arrayInit(&l_parameters);
+    l_hasProcessors = ATP_commandLineGet(argc, argv, 0, &l_name, &l_parameters);
+    ATP_arrayDestroy(&l_parameters);
+    if (l_hasProcessors)
     {
-        int l_result = ATP_processorRun(it, l_count, &l_input, &l_output);
-        if (l_input != l_output)
+        ERR("The pipelines to run come from the script, so no processors can be given along with --script\n");
+        return EX_USAGE;
+    }
+
+    // each pipeline runs on a single thread, so there is one thread per core for them by default
+    l_status = parseOptions(argc, argv, 0, &l_options);
+    if (l_status != EX_OK)
+    {
+        return l_status;
+    }
+    else if (l_options.m_profile)
+    {
+        ERR("The --profile option cannot be combined with --script\n");
+        return EX_USAGE;
+    }
+    else if (!ATP_cacheSetDirectory(l_options.m_cacheDir, l_options.m_cacheSize))
+    {
+        return EX_CANTCREAT;
+    }
+
+    ATP_profileSetEnabled(0);
+    ATP_threadPoolInit(&l_pool, (unsigned int) l_options.m_threads);
+    ATP_threadPoolSetShared(&l_pool);
+    l_status = scriptRun(p_path, &l_pool, &runScriptLine);
+    ATP_threadPoolSetShared(NULL);
+    ATP_threadPoolDestroy(&l_pool);
+    ATP_cacheSetDirectory(NULL, 0);
+    return l_status;
+}
+
+// run a single pipeline, then again from the first processor reading a changed file every time files change, until waiting
+// fails
+static int runWatch(int argc, char **argv, const char *p_delay)
+{
+    ATP_Pipeline l_pipeline;
+    ATP_ThreadPool l_pool;
+    ATP_ProcessorContext l_context;
+    ATP_ProcessorContext *l_previous;
+    ATP_Watch l_watch;
+    Options l_options;
+    unsigned long l_delay = c_ATP_Watch_defaultDelay;
+    int l_status;
+    char l_description[1024] = "";
+
+    if (p_delay != NULL)
+    {
+        char *l_end = NULL;
+        l_delay = strtoul(p_delay, &l_end, 10);
+        if (*p_delay == '\0' || *l_end != '\0' || l_delay > INT_MAX)
+        {
+            ERR("The --watch option takes the number of milliseconds to wait for changes to settle, if anything\n");
+            return EX_USAGE;
+        }
+    }
+
+    l_status = parseOptions(argc, argv, 1, &l_options);
+    if (l_status != EX_OK)
+    {
+        return l_status;
+    }
+    else if (l_options.m_profile)
+    {
+        ERR("The --profile option cannot be combined with --watch\n");
+        return EX_USAGE;
+    }
+    ATP_profileSetEnabled(0);
+
+    ATP_processorContextInit(&l_context);
+    l_previous = ATP_processorContextSwitch(&l_context);
+    ATP_pipelineInit(&l_pipeline);
+    ATP_watchInit(&l_watch);
+    l_status = loadPipeline(argc, argv, &l_pipeline, &l_watch, l_description, sizeof(l_description));
+    if (l_status == EX_OK && ATP_watchFileCount(&l_watch) == 0)
+    {
+        ERR("None of the processors read any files to watch\n");
+        l_status = EX_USAGE;
+    }
+    else if (l_status == EX_OK && !ATP_cacheSetDirectory(l_options.m_cacheDir, l_options.m_cacheSize))
+    {
+        l_status = EX_CANTCREAT;
+    }
+    if (l_status != EX_OK)
+    {
+        ATP_watchDestroy(&l_watch);
+        ATP_pipelineDestroy(&l_pipeline);
+        ATP_processorContextSwitch(l_previous);
+        return l_status;
+    }
+    LOG("Watching %u files for pipeline: %s\n", ATP_watchFileCount(&l_watch), l_description);
+
+    // changes made while the pipeline runs are picked up by the next wait, so following starts before the first run
+    ATP_threadPoolInit(&l_pool, (unsigned int) l_options.m_threads);
+    ATP_threadPoolSetShared(&l_pool);
+    l_status = (ATP_watchStart(&l_watch) ? EX_OK : EX_IOERR);
+    while (l_status == EX_OK)
+    {
+        if (ATP_pipelineExecute(&l_pipeline, (unsigned int) l_options.m_threads))
         {
-            // input is no longer needed
-            ATP_dictionaryDestroy(&l_input);
+            LOG("Pipeline finished, waiting for changes\n");
         }
-        if (!l_result)
+        else
         {
-            // just return, since the processor should log its own error
-            ATP_dictionaryDestroy(&l_output);
-            cleanupProcessors(l_processors);
-            return EX_SOFTWARE;
+            LOG("Pipeline failed, waiting for changes\n");
         }
+        l_status = (ATP_watchWait(&l_watch, (unsigned int) l_delay) ? EX_OK : EX_IOERR);
+    }
+    ATP_threadPoolSetShared(NULL);
+    ATP_threadPoolDestroy(&l_pool);
+    ATP_cacheSetDirectory(NULL, 0);
 
-        l_input = l_output;
-        ATP_dictionaryInit(&l_output);
+    ATP_watchDestroy(&l_watch);
+    ATP_pipelineDestroy(&l_pipeline);
+    ATP_processorContextSwitch(l_previous);
+    return l_status;
+}
+
+// run a single pipeline, once or whenever its files change, or every pipeline in a script
+static int runPipelines(int argc, char **argv)
+{
+    const char *l_scriptFile;
+    const char *l_delay;
+    int l_watch = ATP_commandLineGetOption(argc, argv, "watch", &l_delay);
+
+    if (!ATP_commandLineGetOption(argc, argv, "script", &l_scriptFile))
+    {
+        return (l_watch ? runWatch(argc, argv, l_delay) : runPipeline(argc, argv));
+    }
+    else if (l_watch)
+    {
+        ERR("The --watch option cannot be combined with --script\n");
+        return EX_USAGE;
     }
+    else if (l_scriptFile == NULL)
+    {
+        ERR("The --script option requires the path of the script to run\n");
+        return EX_USAGE;
+    }
+    return runScript(argc, argv, l_scriptFile);
+}
 
-    // clean up and quit
-    ATP_dictionaryDestroy(&l_output);
-    cleanupProcessors(l_processors);
-    return EX_OK;
+// run the pipelines of a command line, tracing them if asked to
+static int runCommandLine(int argc, char **argv)
+{
+    const char *l_traceFile;
+    int l_status;
+
+    if (!ATP_commandLineGetOption(argc, argv, "trace", &l_traceFile))
+    {
+        return runPipelines(argc, argv);
+    }
+    else if (l_traceFile == NULL)
+    {
+        ERR("The --trace option requires the path of the trace file to write\n");
+        return EX_USAGE;
+    }
+
+    ATP_traceStart();
+    l_status = runPipelines(argc, argv);
+    if (!ATP_traceStop(l_traceFile) && l_status == EX_OK)
+    {
+        l_status = EX_CANTCREAT;
+    }
+    return l_status;
+}
+
+int main(int argc, char **argv)
+{
+    const char *l_option;
+    int l_status;
+
+    ATP_processorsSetStatic(gs_staticProcessors, ARRAYLEN(gs_staticProcessors));
+    if (ATP_commandLineGetOption(argc, argv, "index", &l_option))
+    {
+        if (l_option == NULL)
+        {
+            ERR("The --index option requires the path of the manifest to write\n");
+            return EX_USAGE;
+        }
+        return (ATP_processorsWriteIndex(l_option) ? EX_OK : EX_CANTCREAT);
+    }
+    else if (ATP_commandLineGetOption(argc, argv, "serve", &l_option))
+    {
+        if (l_option == NULL)
+        {
+            ERR("The --serve option requires the path of a socket to listen on\n");
+            return EX_USAGE;
+        }
+        l_status = serverRun(l_option, &runCommandLine);
+    }
+    else if (ATP_commandLineGetOption(argc, argv, "client", &l_option))
+    {
+        if (l_option == NULL)
+        {
+            ERR("The --client option requires the path of a socket to connect to\n");
+            return EX_USAGE;
+        }
+        return clientRun(l_option, argc, argv);
+    }
+    else
+    {
+        l_status = runCommandLine(argc, argv);
+    }
+
+    // every processor is unloaded by now, so their libraries can be closed
+    ATP_processorsRelease();
+    return l_status;
 }
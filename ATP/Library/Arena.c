@@ -0,0 +1,219 @@
+#include "Arena.h"
+#include "Atomic.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// all allocations are rounded up to a multiple of the alignment
+#define ALIGN(size)     (((size) + (c_ATP_Arena_alignment - 1)) & ~((size_t) c_ATP_Arena_alignment - 1))
+
+typedef struct ArenaChunk
+{
+    struct ArenaChunk *m_next;
+    char *m_data;
+    size_t m_size;
+    size_t m_used;
+    size_t m_last;
+} ArenaChunk;
+
+struct ATP_Arena
+{
+    ArenaChunk *m_chunks;
+    size_t m_chunkSize;
+    AtomicCount m_refCount;
+    AtomicCount m_lock;
+    // a block the arena was created in, which its chunk does not own
+    void *m_block;
+    size_t m_blockSize;
+    ATP_ArenaReleaseCallback m_release;
+    void *m_token;
+};
+
+// the chunk header is padded so that the first allocation in a chunk is aligned
+#define c_chunkHeader   ALIGN(sizeof(ArenaChunk))
+#define CHUNKDATA(chunk)    ((chunk)->m_data)
+
+static ArenaChunk *createChunk(size_t p_size)
+{
+    ArenaChunk *l_chunk = malloc(c_chunkHeader + p_size);
+    if (l_chunk == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    l_chunk->m_next = NULL;
+    l_chunk->m_data = ((char *) l_chunk) + c_chunkHeader;
+    l_chunk->m_size = p_size;
+    l_chunk->m_used = 0;
+    l_chunk->m_last = 0;
+    return l_chunk;
+}
+
+ATP_Arena *ATP_arenaCreate(size_t p_chunkSize)
+{
+    ATP_Arena *l_arena = malloc(sizeof(ATP_Arena));
+    if (l_arena == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    l_arena->m_chunks = NULL;
+    l_arena->m_chunkSize = ALIGN(p_chunkSize == 0 ? c_ATP_Arena_defaultChunkSize : p_chunkSize);
+    l_arena->m_refCount = 1;
+    l_arena->m_lock = 0;
+    l_arena->m_block = NULL;
+    l_arena->m_blockSize = 0;
+    l_arena->m_release = NULL;
+    l_arena->m_token = NULL;
+    return l_arena;
+}
+
+ATP_Arena *ATP_arenaCreateInBlock(void *p_block, size_t p_size, size_t p_used, ATP_ArenaReleaseCallback p_release,
+                                  void *p_token)
+{
+    ATP_Arena *l_arena = ATP_arenaCreate(0);
+
+    // the block is the first chunk, with a header of its own on the heap
+    l_arena->m_chunks = createChunk(0);
+    l_arena->m_chunks->m_data = p_block;
+    l_arena->m_chunks->m_size = p_size;
+    l_arena->m_chunks->m_used = p_used;
+    l_arena->m_chunks->m_last = p_used;
+    l_arena->m_block = p_block;
+    l_arena->m_blockSize = p_size;
+    l_arena->m_release = p_release;
+    l_arena->m_token = p_token;
+    return l_arena;
+}
+
+ATP_Arena *ATP_arenaRetain(ATP_Arena *p_arena)
+{
+    ATOMIC_INCREMENT(p_arena->m_refCount);
+    return p_arena;
+}
+
+void ATP_arenaRelease(ATP_Arena *p_arena)
+{
+    if (p_arena != NULL && ATOMIC_DECREMENT(p_arena->m_refCount) == 0)
+    {
+        ArenaChunk *l_chunk = p_arena->m_chunks;
+        while (l_chunk != NULL)
+        {
+            ArenaChunk *l_next = l_chunk->m_next;
+            free(l_chunk);
+            l_chunk = l_next;
+        }
+
+        if (p_arena->m_release != NULL)
+        {
+            p_arena->m_release(p_arena->m_block, p_arena->m_blockSize, p_arena->m_token);
+        }
+        free(p_arena);
+    }
+}
+
+static void *allocate(ATP_Arena *p_arena, size_t p_size)
+{
+    ArenaChunk *l_chunk = p_arena->m_chunks;
+    size_t l_size = ALIGN(p_size == 0 ? 1 : p_size);
+
+    if (l_chunk == NULL || l_chunk->m_size - l_chunk->m_used < l_size)
+    {
+        if (l_size > p_arena->m_chunkSize / 4 && l_chunk != NULL)
+        {
+            // large blocks get a chunk of their own, which is linked in behind the current one so that the space left
+            // in the current chunk is not wasted
+            ArenaChunk *l_large = createChunk(l_size);
+            l_large->m_used = l_size;
+            l_large->m_next = l_chunk->m_next;
+            l_chunk->m_next = l_large;
+            return CHUNKDATA(l_large);
+        }
+
+        l_chunk = createChunk(l_size > p_arena->m_chunkSize ? l_size : p_arena->m_chunkSize);
+        l_chunk->m_next = p_arena->m_chunks;
+        p_arena->m_chunks = l_chunk;
+    }
+
+    l_chunk->m_last = l_chunk->m_used;
+    l_chunk->m_used += l_size;
+    return CHUNKDATA(l_chunk) + l_chunk->m_last;
+}
+
+static void *reallocate(ATP_Arena *p_arena, void *p_block, size_t p_oldSize, size_t p_newSize)
+{
+    void *l_block;
+    ArenaChunk *l_chunk = p_arena->m_chunks;
+
+    if (p_block == NULL)
+    {
+        return allocate(p_arena, p_newSize);
+    }
+
+    if (l_chunk != NULL && (char *) p_block == CHUNKDATA(l_chunk) + l_chunk->m_last)
+    {
+        // this was the most recent allocation, so try to grow (or shrink) it in place
+        size_t l_size = ALIGN(p_newSize == 0 ? 1 : p_newSize);
+        if (l_chunk->m_size - l_chunk->m_last >= l_size)
+        {
+            l_chunk->m_used = l_chunk->m_last + l_size;
+            return p_block;
+        }
+    }
+    else if (p_newSize <= p_oldSize)
+    {
+        return p_block;
+    }
+
+    l_block = allocate(p_arena, p_newSize);
+    memcpy(l_block, p_block, (p_oldSize < p_newSize ? p_oldSize : p_newSize));
+    return l_block;
+}
+
+void *ATP_arenaAlloc(ATP_Arena *p_arena, size_t p_size)
+{
+    void *l_block;
+
+    // only one reference can exist while the count is 1, so the lock is only needed once the arena is shared
+    int l_shared = (ATOMIC_LOAD(p_arena->m_refCount) > 1);
+    if (l_shared)
+    {
+        SPIN_LOCK(p_arena->m_lock);
+    }
+    l_block = allocate(p_arena, p_size);
+    if (l_shared)
+    {
+        SPIN_UNLOCK(p_arena->m_lock);
+    }
+
+    return l_block;
+}
+
+void *ATP_arenaRealloc(ATP_Arena *p_arena, void *p_block, size_t p_oldSize, size_t p_newSize)
+{
+    void *l_block;
+    int l_shared = (ATOMIC_LOAD(p_arena->m_refCount) > 1);
+    if (l_shared)
+    {
+        SPIN_LOCK(p_arena->m_lock);
+    }
+    l_block = reallocate(p_arena, p_block, p_oldSize, p_newSize);
+    if (l_shared)
+    {
+        SPIN_UNLOCK(p_arena->m_lock);
+    }
+
+    return l_block;
+}
+
+char *ATP_arenaStrndup(ATP_Arena *p_arena, const char *p_string, size_t p_length)
+{
+    char *l_copy = ATP_arenaAlloc(p_arena, p_length + 1);
+    memcpy(l_copy, p_string, p_length);
+    l_copy[p_length] = '\0';
+    return l_copy;
+}
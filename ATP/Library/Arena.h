@@ -0,0 +1,135 @@
+/* File: Arena.h
+A bump allocator used to back whole dictionary and array trees.
+
+Important:
+    Memory obtained from an arena is only released when the last reference to the arena is released.  Allocation is only
+    serialized while more than one reference to the arena exists, so an arena with a single reference must not be used from
+    more than one thread at a time.
+*/
+#ifndef _ATP_LIBRARY_ARENA_H_
+#define _ATP_LIBRARY_ARENA_H_
+
+#include "Export.h"
+
+#include <stddef.h>
+
+// forward declaration
+struct ATP_Arena;
+
+/* Type: ATP_Arena
+Reference to an arena implementation.
+*/
+typedef struct ATP_Arena ATP_Arena;
+
+/* Constant: c_ATP_Arena_defaultChunkSize
+The size in bytes of the chunks requested from the system when no explicit size is given to <ATP_arenaCreate>.
+*/
+#define c_ATP_Arena_defaultChunkSize    (256 * 1024)
+/* Constant: c_ATP_Arena_alignment
+The alignment of every block allocated from an arena.  Each block uses up its requested size rounded up to a multiple of this.
+*/
+#define c_ATP_Arena_alignment           16
+
+/* Callback: ATP_ArenaReleaseCallback
+Invoked to give back a block of memory that an arena was created in, once the arena is destroyed.
+
+Parameters:
+    p_block - The block.
+    p_size  - The size of the block in bytes.
+    p_token - The token given along with the callback.
+*/
+typedef void (*ATP_ArenaReleaseCallback)(void *p_block, size_t p_size, void *p_token);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_arenaCreate
+Create a new, empty arena.
+
+Parameters:
+    p_chunkSize - The size of the chunks to request from the system, or 0 to use <c_ATP_Arena_defaultChunkSize>.
+
+Returns:
+    The new arena instance, holding a single reference.
+*/
+EXPORT ATP_Arena *ATP_arenaCreate(size_t p_chunkSize);
+/* Function: ATP_arenaCreateInBlock
+Create an arena that allocates from a block of memory obtained elsewhere, such as a mapping of a file or of shared memory,
+before requesting chunks of <c_ATP_Arena_defaultChunkSize> from the system once the block is full.
+
+Parameters:
+    p_block   - The block, aligned to <c_ATP_Arena_alignment>.
+    p_size    - The size of the block in bytes.
+    p_used    - The number of bytes at the start of the block that are already in use, a multiple of <c_ATP_Arena_alignment>.
+    p_release - The function to give the block back with once the arena is destroyed, or NULL if the caller keeps it.
+    p_token   - The token to pass to p_release.
+
+Returns:
+    The new arena instance, holding a single reference.
+*/
+EXPORT ATP_Arena *ATP_arenaCreateInBlock(void *p_block, size_t p_size, size_t p_used, ATP_ArenaReleaseCallback p_release,
+                                         void *p_token);
+/* Function: ATP_arenaRetain
+Add a reference to an arena.
+
+Parameters:
+    p_arena - The arena instance.
+
+Returns:
+    The arena instance.
+*/
+EXPORT ATP_Arena *ATP_arenaRetain(ATP_Arena *p_arena);
+/* Function: ATP_arenaRelease
+Release a reference to an arena.  Once the last reference is released the arena is destroyed, releasing every allocation
+made from it at once.
+
+Parameters:
+    p_arena - The arena instance.
+*/
+EXPORT void ATP_arenaRelease(ATP_Arena *p_arena);
+
+/* Function: ATP_arenaAlloc
+Allocate a block of memory from the arena.  The block is suitably aligned for any of the ATP value types.
+
+Parameters:
+    p_arena - The arena instance.
+    p_size  - The size of the block in bytes.
+
+Returns:
+    A pointer to the new block.
+*/
+EXPORT void *ATP_arenaAlloc(ATP_Arena *p_arena, size_t p_size);
+/* Function: ATP_arenaRealloc
+Resize a block previously allocated from the arena.  The block is extended in place if it was the most recent allocation
+and there is room left in its chunk, otherwise a new block is allocated and the contents are copied.
+
+Parameters:
+    p_arena   - The arena instance.
+    p_block   - The block to resize, which may be NULL.
+    p_oldSize - The current size of the block in bytes.
+    p_newSize - The requested size of the block in bytes.
+
+Returns:
+    A pointer to the resized block.
+*/
+EXPORT void *ATP_arenaRealloc(ATP_Arena *p_arena, void *p_block, size_t p_oldSize, size_t p_newSize);
+/* Function: ATP_arenaStrndup
+Copy a string into the arena.
+
+Parameters:
+    p_arena  - The arena instance.
+    p_string - The string to copy.
+    p_length - The number of characters to copy from the string.  A terminating null character is always appended.
+
+Returns:
+    The copy of the string.
+*/
+EXPORT char *ATP_arenaStrndup(ATP_Arena *p_arena, const char *p_string, size_t p_length);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_ARENA_H_ */
@@ -1,102 +1,1044 @@
 #include "Array.h"
 #include "Log.h"
+#include "Exit.h"
 #include "Value.inc"
+#include "Atomic.inc"
 
-#include "ATP/ThirdParty/UT/utarray.h"
+#include <stdlib.h>
+#include <string.h>
 
-#define CAST(array)     (*((ATP_ArrayImpl **) (array)))
-#define CCAST(array)    (*((const ATP_ArrayImpl **) (array)))
+#define c_initialCapacity   8
 
-typedef UT_array ATP_ArrayImpl;
+typedef struct ATP_ArrayImpl
+{
+    // the active member is determined by m_kind
+    union
+    {
+        void *m_raw;
+        Value *m_values;
+        unsigned long long *m_uints;
+        signed long long *m_ints;
+        double *m_doubles;
+        unsigned char *m_bools;
+    } m_data;
+    unsigned int m_length;
+    unsigned int m_capacity;
+    ATP_Arena *m_arena;
+    AtomicCount m_refCount;
+    // the type of every entry in a packed array, or e_ATP_ValueType_none if each entry is a tagged Value
+    unsigned char m_kind;
+    // frozen arrays always live in an arena and are never modified
+    unsigned char m_frozen;
+} ATP_ArrayImpl;
+
+static size_t elementSize(ATP_ValueType p_kind)
+{
+    switch (p_kind)
+    {
+        case e_ATP_ValueType_uint:
+            return sizeof(unsigned long long);
+        case e_ATP_ValueType_int:
+            return sizeof(signed long long);
+        case e_ATP_ValueType_double:
+            return sizeof(double);
+        case e_ATP_ValueType_bool:
+            return sizeof(unsigned char);
+        default:
+            return sizeof(Value);
+    }
+}
+
+#define ELEMENT(impl, index)    (((char *) (impl)->m_data.m_raw) + (size_t) (index) * elementSize((impl)->m_kind))
+
+static ATP_ArrayImpl *createImpl(ATP_Arena *p_arena)
+{
+    ATP_ArrayImpl *l_impl;
+    if (p_arena != NULL)
+    {
+        l_impl = ATP_arenaAlloc(p_arena, sizeof(ATP_ArrayImpl));
+    }
+    else
+    {
+        l_impl = malloc(sizeof(ATP_ArrayImpl));
+        if (l_impl == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+
+    l_impl->m_data.m_raw = NULL;
+    l_impl->m_length = 0;
+    l_impl->m_capacity = 0;
+    l_impl->m_arena = p_arena;
+    l_impl->m_refCount = 1;
+    l_impl->m_kind = e_ATP_ValueType_none;
+    l_impl->m_frozen = 0;
+    return l_impl;
+}
+
+static void grow(ATP_ArrayImpl *p_impl, unsigned int p_capacity)
+{
+    void *l_data;
+    size_t l_size = elementSize(p_impl->m_kind);
+    if (p_capacity <= p_impl->m_capacity)
+    {
+        return;
+    }
+
+    if (p_impl->m_arena != NULL)
+    {
+        l_data = ATP_arenaRealloc(p_impl->m_arena, p_impl->m_data.m_raw, p_impl->m_capacity * l_size, p_capacity * l_size);
+    }
+    else
+    {
+        l_data = realloc(p_impl->m_data.m_raw, p_capacity * l_size);
+        if (l_data == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+
+    p_impl->m_data.m_raw = l_data;
+    p_impl->m_capacity = p_capacity;
+}
+
+static void reserve(ATP_ArrayImpl *p_impl, unsigned int p_length)
+{
+    // grow geometrically so that repeated appends still take amortized constant time
+    if (p_length > p_impl->m_capacity)
+    {
+        grow(p_impl, (p_length > p_impl->m_capacity * 2 ? p_length : p_impl->m_capacity * 2));
+    }
+}
+
+static void freeData(ATP_ArrayImpl *p_impl)
+{
+    // arena blocks are released along with the arena
+    if (p_impl->m_arena == NULL)
+    {
+        free(p_impl->m_data.m_raw);
+    }
+    p_impl->m_data.m_raw = NULL;
+    p_impl->m_capacity = 0;
+}
+
+static void loadPacked(const ATP_ArrayImpl *p_impl, unsigned int p_index, Value *p_value)
+{
+    p_value->m_type = p_impl->m_kind;
+    switch (p_impl->m_kind)
+    {
+        case e_ATP_ValueType_uint:
+            p_value->m_value.m_uint = p_impl->m_data.m_uints[p_index];
+            break;
+        case e_ATP_ValueType_int:
+            p_value->m_value.m_int = p_impl->m_data.m_ints[p_index];
+            break;
+        case e_ATP_ValueType_double:
+            p_value->m_value.m_double = p_impl->m_data.m_doubles[p_index];
+            break;
+        case e_ATP_ValueType_bool:
+            p_value->m_value.m_bool = p_impl->m_data.m_bools[p_index];
+            break;
+        default:
+            break;
+    }
+}
+
+static void storePacked(ATP_ArrayImpl *p_impl, unsigned int p_index, const Value *p_value)
+{
+    switch (p_impl->m_kind)
+    {
+        case e_ATP_ValueType_uint:
+            p_impl->m_data.m_uints[p_index] = p_value->m_value.m_uint;
+            break;
+        case e_ATP_ValueType_int:
+            p_impl->m_data.m_ints[p_index] = p_value->m_value.m_int;
+            break;
+        case e_ATP_ValueType_double:
+            p_impl->m_data.m_doubles[p_index] = p_value->m_value.m_double;
+            break;
+        case e_ATP_ValueType_bool:
+            p_impl->m_data.m_bools[p_index] = (unsigned char) (p_value->m_value.m_bool != 0);
+            break;
+        default:
+            break;
+    }
+}
+
+static void unpack(ATP_ArrayImpl *p_impl)
+{
+    unsigned int i;
+    ATP_ArrayImpl l_packed = *p_impl;
+
+    DBG("unpacking %s array %p\n", ATP_valueTypeToString(p_impl->m_kind), p_impl);
+    p_impl->m_kind = e_ATP_ValueType_none;
+    p_impl->m_data.m_raw = NULL;
+    p_impl->m_capacity = 0;
+    grow(p_impl, l_packed.m_capacity);
+    for (i = 0; i < l_packed.m_length; ++i)
+    {
+        loadPacked(&l_packed, i, &p_impl->m_data.m_values[i]);
+    }
+
+    freeData(&l_packed);
+}
+
+static Value *getEntry(const ATP_Array *p_array, unsigned int p_index, Value *p_scratch)
+{
+    const ATP_ArrayImpl *l_impl = *p_array;
+    if (p_index >= l_impl->m_length)
+    {
+        return NULL;
+    }
+    else if (l_impl->m_kind != e_ATP_ValueType_none)
+    {
+        // packed entries are read through a temporary value, so that every getter works the same on either kind of array
+        loadPacked(l_impl, p_index, p_scratch);
+        return p_scratch;
+    }
+
+    return &l_impl->m_data.m_values[p_index];
+}
+
+const Value *Value_arrayEntry(const ATP_Array *p_array, unsigned int p_index, Value *p_scratch)
+{
+    return getEntry(p_array, p_index, p_scratch);
+}
+
+void ATP_arrayInit(ATP_Array *p_array)
+{
+    *p_array = createImpl(NULL);
+}
+
+void ATP_arrayInitInArena(ATP_Array *p_array, ATP_Arena *p_arena)
+{
+    if (p_arena == NULL)
+    {
+        // the handle holds the reference that the arena is created with
+        *p_array = createImpl(ATP_arenaCreate(0));
+    }
+    else
+    {
+        *p_array = createImpl(ATP_arenaRetain(p_arena));
+    }
+}
+
+static void retainImpl(ATP_ArrayImpl *p_impl, int p_external)
+{
+    ATOMIC_INCREMENT(p_impl->m_refCount);
+    if (p_external && p_impl->m_arena != NULL)
+    {
+        ATP_arenaRetain(p_impl->m_arena);
+    }
+}
+
+static void releaseImpl(ATP_ArrayImpl *p_impl, int p_external)
+{
+    // the array may be freed by another reference as soon as the count is decremented
+    ATP_Arena *l_arena = p_impl->m_arena;
+    if (ATOMIC_DECREMENT(p_impl->m_refCount) == 0 && l_arena == NULL)
+    {
+        unsigned int i;
+        if (p_impl->m_kind == e_ATP_ValueType_none)
+        {
+            for (i = 0; i < p_impl->m_length; ++i)
+            {
+                Value_changeType(&p_impl->m_data.m_values[i], e_ATP_ValueType_none, NULL);
+            }
+        }
+        free(p_impl->m_data.m_raw);
+        free(p_impl);
+    }
+
+    // everything in an arena is released along with it, so there is nothing to walk
+    if (p_external && l_arena != NULL)
+    {
+        ATP_arenaRelease(l_arena);
+    }
+}
+
+void ATP_arrayDestroy(ATP_Array *p_array)
+{
+    if (p_array != NULL && *p_array != NULL)
+    {
+        releaseImpl(*p_array, 1);
+        *p_array = NULL;
+    }
+}
+
+static ATP_ArrayImpl *copyImpl(const ATP_ArrayImpl *p_impl, ATP_Arena *p_arena)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_copy = createImpl(p_arena);
+
+    l_copy->m_kind = p_impl->m_kind;
+    grow(l_copy, p_impl->m_length);
+    if (p_impl->m_kind != e_ATP_ValueType_none)
+    {
+        // packed entries never refer to anything outside of the array
+        memcpy(l_copy->m_data.m_raw, p_impl->m_data.m_raw, p_impl->m_length * elementSize(p_impl->m_kind));
+    }
+    else
+    {
+        for (i = 0; i < p_impl->m_length; ++i)
+        {
+            l_copy->m_data.m_values[i].m_type = e_ATP_ValueType_none;
+            Value_copy(&l_copy->m_data.m_values[i], &p_impl->m_data.m_values[i], p_arena);
+        }
+    }
+    l_copy->m_length = p_impl->m_length;
+
+    return l_copy;
+}
+
+int Value_detachArray(ATP_Array *p_array)
+{
+    ATP_ArrayImpl *l_impl = *p_array;
+    if (l_impl->m_frozen)
+    {
+        ERR("Cannot modify a frozen array\n");
+        return 0;
+    }
+    else if (ATOMIC_LOAD(l_impl->m_refCount) > 1)
+    {
+        // the copy stays in the same storage, so whatever reference the handle held on the arena now covers the copy
+        DBG("copying shared array %p\n", l_impl);
+        *p_array = copyImpl(l_impl, l_impl->m_arena);
+        releaseImpl(l_impl, 0);
+    }
+
+    return 1;
+}
+
+void ATP_arrayClear(ATP_Array *p_array)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl = *p_array;
+
+    if (l_impl->m_frozen)
+    {
+        ERR("Cannot modify a frozen array\n");
+        return;
+    }
+    else if (ATOMIC_LOAD(l_impl->m_refCount) > 1)
+    {
+        // there is no need to copy the contents of a shared array only to throw them away
+        *p_array = createImpl(l_impl->m_arena);
+        (*p_array)->m_kind = l_impl->m_kind;
+        releaseImpl(l_impl, 0);
+        return;
+    }
+
+    if (l_impl->m_kind == e_ATP_ValueType_none)
+    {
+        for (i = 0; i < l_impl->m_length; ++i)
+        {
+            Value_changeType(&l_impl->m_data.m_values[i], e_ATP_ValueType_none, l_impl->m_arena);
+        }
+    }
+    l_impl->m_length = 0;
+}
+
+void ATP_arrayReserve(ATP_Array *p_array, unsigned int p_capacity)
+{
+    if (!Value_detachArray(p_array))
+    {
+        return;
+    }
+
+    grow(*p_array, p_capacity);
+}
+
+void ATP_arrayResize(ATP_Array *p_array, unsigned int p_length)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl;
+
+    if (!Value_detachArray(p_array))
+    {
+        return;
+    }
+
+    l_impl = *p_array;
+    if (p_length < l_impl->m_length)
+    {
+        if (l_impl->m_kind == e_ATP_ValueType_none)
+        {
+            for (i = p_length; i < l_impl->m_length; ++i)
+            {
+                Value_changeType(&l_impl->m_data.m_values[i], e_ATP_ValueType_none, l_impl->m_arena);
+            }
+        }
+    }
+    else if (p_length > l_impl->m_length)
+    {
+        grow(l_impl, p_length);
+        if (l_impl->m_kind == e_ATP_ValueType_none)
+        {
+            for (i = l_impl->m_length; i < p_length; ++i)
+            {
+                l_impl->m_data.m_values[i].m_type = e_ATP_ValueType_none;
+            }
+        }
+        else
+        {
+            memset(ELEMENT(l_impl, l_impl->m_length), 0, (p_length - l_impl->m_length) * elementSize(l_impl->m_kind));
+        }
+    }
+
+    l_impl->m_length = p_length;
+}
+
+unsigned int ATP_arrayLength(const ATP_Array *p_array)
+{
+    return (*p_array)->m_length;
+}
+
+ATP_Arena *ATP_arrayGetArena(const ATP_Array *p_array)
+{
+    return (*p_array)->m_arena;
+}
+
+int ATP_arrayErase(ATP_Array *p_array, unsigned int p_index)
+{
+    ATP_ArrayImpl *l_impl;
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_impl = *p_array;
+    if (p_index >= l_impl->m_length)
+    {
+        ERR("Index out of bounds\n");
+        return 0;
+    }
+
+    if (l_impl->m_kind == e_ATP_ValueType_none)
+    {
+        Value_changeType(&l_impl->m_data.m_values[p_index], e_ATP_ValueType_none, l_impl->m_arena);
+    }
+    memmove(ELEMENT(l_impl, p_index), ELEMENT(l_impl, p_index + 1),
+            (l_impl->m_length - p_index - 1) * elementSize(l_impl->m_kind));
+    --l_impl->m_length;
+    return 1;
+}
+
+int ATP_arraySwap(ATP_Array *p_array, unsigned int p_first, unsigned int p_second)
+{
+    ATP_ArrayImpl *l_impl;
+    size_t l_size;
+    unsigned char l_temp[sizeof(Value)];
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_impl = *p_array;
+    if (p_first >= l_impl->m_length || p_second >= l_impl->m_length)
+    {
+        ERR("Index out of bounds\n");
+        return 0;
+    }
+
+    l_size = elementSize(l_impl->m_kind);
+    memcpy(l_temp, ELEMENT(l_impl, p_first), l_size);
+    memcpy(ELEMENT(l_impl, p_first), ELEMENT(l_impl, p_second), l_size);
+    memcpy(ELEMENT(l_impl, p_second), l_temp, l_size);
+    return 1;
+}
+
+int ATP_arrayPopBack(ATP_Array *p_array, ATP_Value *p_value)
+{
+    ATP_ArrayImpl *l_impl;
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_impl = *p_array;
+    if (l_impl->m_length == 0)
+    {
+        return 0;
+    }
+
+    --l_impl->m_length;
+    if (l_impl->m_kind != e_ATP_ValueType_none)
+    {
+        Value l_value;
+        loadPacked(l_impl, l_impl->m_length, &l_value);
+        Value_take(p_value, &l_value, NULL);
+    }
+    else
+    {
+        Value_take(p_value, &l_impl->m_data.m_values[l_impl->m_length], l_impl->m_arena);
+    }
+    return 1;
+}
+
+ATP_ValueType ATP_arrayGetType(const ATP_Array *p_array, unsigned int p_index)
+{
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
+    if (l_entry == NULL)
+    {
+        ERR("Index out of bounds\n");
+        return e_ATP_ValueType_none;
+    }
+
+    return l_entry->m_type;
+}
+
+int ATP_arrayPack(ATP_Array *p_array, ATP_ValueType p_type)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl;
+    ATP_ArrayImpl l_unpacked;
+
+    if (p_type != e_ATP_ValueType_uint && p_type != e_ATP_ValueType_int && p_type != e_ATP_ValueType_double
+        && p_type != e_ATP_ValueType_bool)
+    {
+        ERR("Arrays of type %s cannot be packed\n", ATP_valueTypeToString(p_type));
+        return 0;
+    }
+    else if ((*p_array)->m_kind == p_type)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < (*p_array)->m_length; ++i)
+    {
+        if (ATP_arrayGetType(p_array, i) != p_type)
+        {
+            return 0;
+        }
+    }
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_impl = *p_array;
+    if (l_impl->m_kind != e_ATP_ValueType_none)
+    {
+        // only possible for an empty array that was packed as another type
+        freeData(l_impl);
+        l_impl->m_kind = p_type;
+        return 1;
+    }
+
+    DBG("packing array %p as %s\n", l_impl, ATP_valueTypeToString(p_type));
+    l_unpacked = *l_impl;
+    l_impl->m_kind = p_type;
+    l_impl->m_data.m_raw = NULL;
+    l_impl->m_capacity = 0;
+    grow(l_impl, l_unpacked.m_length);
+    for (i = 0; i < l_unpacked.m_length; ++i)
+    {
+        storePacked(l_impl, i, &l_unpacked.m_data.m_values[i]);
+    }
+
+    freeData(&l_unpacked);
+    return 1;
+}
+
+ATP_ValueType ATP_arrayGetPackedType(const ATP_Array *p_array)
+{
+    return (*p_array)->m_kind;
+}
+
+ATP_Array ATP_arrayDuplicate(const ATP_Array *p_array)
+{
+    return ATP_arrayDuplicateInArena(p_array, NULL);
+}
+
+ATP_Array ATP_arrayDuplicateInArena(const ATP_Array *p_array, ATP_Arena *p_arena)
+{
+    ATP_Array l_result = *p_array;
+
+    if (p_arena == NULL || l_result->m_arena == p_arena)
+    {
+        // share the array, it is only copied once it is written to through either handle
+        retainImpl(l_result, 1);
+    }
+    else
+    {
+        // nothing outside of an arena can be referenced from inside it
+        l_result = copyImpl(l_result, p_arena);
+        ATP_arenaRetain(p_arena);
+    }
+
+    return l_result;
+}
+
+ATP_Array Value_adoptArray(ATP_Array p_array, ATP_Arena *p_arena)
+{
+    ATP_Array l_copy;
+
+    if (p_array == NULL)
+    {
+        return createImpl(p_arena);
+    }
+
+    if (p_arena == NULL)
+    {
+        return p_array;
+    }
+    else if (p_array->m_arena == p_arena)
+    {
+        // the container keeps the arena alive, so the caller's reference on it is no longer needed
+        ATP_arenaRelease(p_arena);
+        return p_array;
+    }
+
+    DBG("copying array %p into arena storage\n", p_array);
+    l_copy = copyImpl(p_array, p_arena);
+    ATP_arrayDestroy(&p_array);
+    return l_copy;
+}
+
+ATP_Array Value_shareArray(ATP_Array p_array, ATP_Arena *p_arena)
+{
+    if (p_arena == NULL || p_array->m_arena == p_arena)
+    {
+        retainImpl(p_array, (p_arena == NULL));
+        return p_array;
+    }
+
+    return copyImpl(p_array, p_arena);
+}
+
+void Value_releaseArray(ATP_Array p_array, ATP_Arena *p_arena)
+{
+    releaseImpl(p_array, (p_arena == NULL));
+}
+
+size_t Value_measureArray(ATP_Array p_array)
+{
+    unsigned int i;
+    size_t l_size = ARENASIZE(sizeof(ATP_ArrayImpl));
+
+    if (p_array->m_length > 0)
+    {
+        l_size += ARENASIZE(p_array->m_length * elementSize(p_array->m_kind));
+    }
+    if (p_array->m_kind == e_ATP_ValueType_none)
+    {
+        for (i = 0; i < p_array->m_length; ++i)
+        {
+            l_size += Value_measure(&p_array->m_data.m_values[i]);
+        }
+    }
+
+    return l_size;
+}
+
+ATP_Array Value_freezeArray(ATP_Array p_array, ATP_Arena *p_arena)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl = createImpl(p_arena);
+
+    l_impl->m_kind = p_array->m_kind;
+    grow(l_impl, p_array->m_length);
+    if (p_array->m_kind != e_ATP_ValueType_none)
+    {
+        memcpy(l_impl->m_data.m_raw, p_array->m_data.m_raw, p_array->m_length * elementSize(p_array->m_kind));
+    }
+    else
+    {
+        for (i = 0; i < p_array->m_length; ++i)
+        {
+            l_impl->m_data.m_values[i].m_type = e_ATP_ValueType_none;
+            Value_freeze(&l_impl->m_data.m_values[i], &p_array->m_data.m_values[i], p_arena);
+        }
+    }
+    l_impl->m_length = p_array->m_length;
+    l_impl->m_frozen = 1;
+
+    return l_impl;
+}
+
+void Value_imageArray(ValueImage *p_image, ATP_Array p_array)
+{
+    unsigned int i;
+
+    if (p_array->m_kind == e_ATP_ValueType_none)
+    {
+        for (i = 0; i < p_array->m_length; ++i)
+        {
+            Value_image(p_image, &p_array->m_data.m_values[i]);
+        }
+    }
+    Value_imagePointer(p_image, &p_array->m_data.m_raw);
+    Value_imageArena(p_image, &p_array->m_arena);
+}
+
+int Value_checkImageArray(ValueImageCheck *p_check, size_t p_offset)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl = (ATP_ArrayImpl *) (p_check->m_base + p_offset);
+    char *l_data;
+
+    if (!Value_checkImageClaim(p_check, p_offset, sizeof(ATP_ArrayImpl), 1)
+        || !Value_checkImageArena(p_check, &l_impl->m_arena))
+    {
+        return 0;
+    }
+    switch (l_impl->m_kind)
+    {
+        case e_ATP_ValueType_none:
+        case e_ATP_ValueType_uint:
+        case e_ATP_ValueType_int:
+        case e_ATP_ValueType_double:
+        case e_ATP_ValueType_bool:
+            break;
+        default:
+            return Value_checkImageFail();
+    }
+
+    // frozen arrays are allocated exactly as long as they are, and only tagged values are read as anything but numbers
+    if (l_impl->m_frozen != 1 || l_impl->m_capacity != l_impl->m_length)
+    {
+        return Value_checkImageFail();
+    }
+    else if (!Value_checkImagePointer(p_check, &l_impl->m_data.m_raw, 0, 1, &l_data))
+    {
+        return 0;
+    }
+    else if ((l_impl->m_length == 0) != (l_data == NULL))
+    {
+        return Value_checkImageFail();
+    }
+    else if (l_impl->m_length > 0
+             && !Value_checkImageClaim(p_check, (size_t) (l_data - p_check->m_base),
+                                       (size_t) l_impl->m_length * elementSize(l_impl->m_kind),
+                                       (l_impl->m_kind == e_ATP_ValueType_none)))
+    {
+        return 0;
+    }
+
+    if (l_impl->m_kind == e_ATP_ValueType_none)
+    {
+        for (i = 0; i < l_impl->m_length; ++i)
+        {
+            if (!Value_checkImage(p_check, &((const Value *) l_data)[i]))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
 
-// forward references
-static void icdDtor(void *p_element);
-static void icdCopy(void *p_dest, const void *p_source);
+void ATP_arrayFreeze(ATP_Array *p_array)
+{
+    ATP_Arena *l_arena;
+    ATP_Array l_frozen;
 
-static const UT_icd cs_valueIcd = { sizeof(Value), NULL, &icdCopy, &icdDtor };
+    if (ATP_arrayIsFrozen(p_array))
+    {
+        return;
+    }
 
-static void icdDtor(void *p_element)
-{
-    Value_changeType((Value *) p_element, e_ATP_ValueType_none);
-}
+    // the arena is sized to hold the whole tree in a single chunk; the handle holds the reference it is created with
+    l_arena = ATP_arenaCreate(Value_measureArray(*p_array));
+    l_frozen = Value_freezeArray(*p_array, l_arena);
+    DBG("froze array %p as %p\n", *p_array, l_frozen);
 
-static void icdCopy(void *p_dest, const void *p_source)
-{
-    Value_copy((Value *) p_dest, (const Value *) p_source);
+    ATP_arrayDestroy(p_array);
+    *p_array = l_frozen;
 }
 
-void ATP_arrayInit(ATP_Array *p_array)
+int ATP_arrayIsFrozen(const ATP_Array *p_array)
 {
-    utarray_new(CAST(p_array), &cs_valueIcd);
+    return (*p_array)->m_frozen;
 }
 
-void ATP_arrayDestroy(ATP_Array *p_array)
+static Value *findOrCreateEntry(ATP_Array *p_array, unsigned int p_index)
 {
-    utarray_free(CAST(p_array));
-}
+    ATP_ArrayImpl *l_impl;
 
-void ATP_arrayClear(ATP_Array *p_array)
-{
-    utarray_clear(CAST(p_array));
+    if (!Value_detachArray(p_array))
+    {
+        return NULL;
+    }
+
+    l_impl = *p_array;
+    if (p_index > l_impl->m_length)
+    {
+        ERR("Index out of bounds\n");
+        return NULL;
+    }
+
+    if (l_impl->m_kind != e_ATP_ValueType_none)
+    {
+        // the entry is about to be given a type that the packed storage cannot hold
+        unpack(l_impl);
+    }
+
+    if (p_index == l_impl->m_length)
+    {
+        if (l_impl->m_length == l_impl->m_capacity)
+        {
+            grow(l_impl, (l_impl->m_capacity == 0 ? c_initialCapacity : l_impl->m_capacity * 2));
+        }
+
+        l_impl->m_data.m_values[l_impl->m_length].m_type = e_ATP_ValueType_none;
+        ++l_impl->m_length;
+    }
+
+    return &l_impl->m_data.m_values[p_index];
 }
 
-unsigned int ATP_arrayLength(const ATP_Array *p_array)
+static int setScalar(ATP_Array *p_array, unsigned int p_index, const Value *p_value)
 {
-    return utarray_len(CCAST(p_array));
+    ATP_ArrayImpl *l_impl;
+    Value *l_entry;
+
+    if ((*p_array)->m_kind == p_value->m_type && p_index <= (*p_array)->m_length)
+    {
+        if (!Value_detachArray(p_array))
+        {
+            return 0;
+        }
+
+        l_impl = *p_array;
+        if (p_index == l_impl->m_length)
+        {
+            if (l_impl->m_length == l_impl->m_capacity)
+            {
+                grow(l_impl, (l_impl->m_capacity == 0 ? c_initialCapacity : l_impl->m_capacity * 2));
+            }
+            ++l_impl->m_length;
+        }
+
+        storePacked(l_impl, p_index, p_value);
+        return 1;
+    }
+
+    l_entry = findOrCreateEntry(p_array, p_index);
+    if (l_entry == NULL)
+    {
+        return 0;
+    }
+
+    Value_changeType(l_entry, e_ATP_ValueType_none, (*p_array)->m_arena);
+    *l_entry = *p_value;
+    return 1;
 }
 
-int ATP_arrayErase(ATP_Array *p_array, unsigned int p_index)
+int ATP_arrayPut(ATP_Array *p_array, unsigned int p_index, ATP_Value *p_value)
 {
-    if (p_index >= utarray_len(CAST(p_array)))
+    Value *l_entry;
+
+    DBG("moving into array[%u]: <%s>\n", p_index, ATP_valueTypeToString(ATP_valueGetType(p_value)));
+    if ((*p_array)->m_kind != e_ATP_ValueType_none && (*p_array)->m_kind == VALUE(p_value)->m_type)
+    {
+        // scalars have nothing to relink, so they can go straight into the packed storage
+        if (!setScalar(p_array, p_index, VALUE(p_value)))
+        {
+            return 0;
+        }
+        ATP_valueDestroy(p_value);
+        return 1;
+    }
+
+    l_entry = findOrCreateEntry(p_array, p_index);
+    if (l_entry == NULL)
     {
-        ERR("Index out of bounds\n");
         return 0;
     }
 
-    utarray_erase(CAST(p_array), p_index, 1);
+    Value_put(l_entry, (*p_array)->m_arena, p_value);
     return 1;
 }
 
-ATP_ValueType ATP_arrayGetType(const ATP_Array *p_array, unsigned int p_index)
+static void appendScalars(ATP_Array *p_array, ATP_ValueType p_type, const void *p_values, unsigned int p_count)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
-    if (l_entry == NULL)
+    unsigned int i;
+    ATP_ArrayImpl *l_impl;
+
+    if (!Value_detachArray(p_array))
     {
-        ERR("Index out of bounds\n");
-        return e_ATP_ValueType_none;
+        return;
     }
 
-    return l_entry->m_type;
+    l_impl = *p_array;
+    if (l_impl->m_kind != e_ATP_ValueType_none && l_impl->m_kind != p_type)
+    {
+        unpack(l_impl);
+    }
+
+    reserve(l_impl, l_impl->m_length + p_count);
+    if (l_impl->m_kind == p_type && p_type != e_ATP_ValueType_bool)
+    {
+        // the caller's values are already laid out exactly as the packed storage is
+        memcpy(ELEMENT(l_impl, l_impl->m_length), p_values, p_count * elementSize(p_type));
+    }
+    else
+    {
+        for (i = 0; i < p_count; ++i)
+        {
+            Value l_value;
+            l_value.m_type = p_type;
+            switch (p_type)
+            {
+                case e_ATP_ValueType_uint:
+                    l_value.m_value.m_uint = ((const unsigned long long *) p_values)[i];
+                    break;
+                case e_ATP_ValueType_int:
+                    l_value.m_value.m_int = ((const signed long long *) p_values)[i];
+                    break;
+                case e_ATP_ValueType_double:
+                    l_value.m_value.m_double = ((const double *) p_values)[i];
+                    break;
+                case e_ATP_ValueType_bool:
+                    l_value.m_value.m_bool = (((const int *) p_values)[i] != 0);
+                    break;
+                default:
+                    break;
+            }
+
+            if (l_impl->m_kind == p_type)
+            {
+                storePacked(l_impl, l_impl->m_length + i, &l_value);
+            }
+            else
+            {
+                l_impl->m_data.m_values[l_impl->m_length + i] = l_value;
+            }
+        }
+    }
+
+    l_impl->m_length += p_count;
 }
 
-ATP_Array ATP_arrayDuplicate(const ATP_Array *p_array)
+void ATP_arrayAppendStringN(ATP_Array *p_array, const char *const *p_values, unsigned int p_count)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_impl;
+
+    if (!Value_detachArray(p_array))
+    {
+        return;
+    }
+
+    l_impl = *p_array;
+    if (l_impl->m_kind != e_ATP_ValueType_none)
+    {
+        unpack(l_impl);
+    }
+
+    reserve(l_impl, l_impl->m_length + p_count);
+    for (i = 0; i < p_count; ++i)
+    {
+        Value *l_entry = &l_impl->m_data.m_values[l_impl->m_length + i];
+        l_entry->m_type = e_ATP_ValueType_none;
+        Value_setString(l_entry, p_values[i], l_impl->m_arena);
+    }
+
+    l_impl->m_length += p_count;
+}
+
+void ATP_arrayAppendUintN(ATP_Array *p_array, const unsigned long long *p_values, unsigned int p_count)
 {
-    UT_array *l_copy;
-    utarray_new(l_copy, &cs_valueIcd);
-    utarray_concat(l_copy, CCAST(p_array));
-    return (struct ATP_ArrayImpl *) l_copy;
+    appendScalars(p_array, e_ATP_ValueType_uint, p_values, p_count);
 }
 
-static Value *findOrCreateEntry(ATP_Array *p_array, unsigned int p_index)
+void ATP_arrayAppendIntN(ATP_Array *p_array, const signed long long *p_values, unsigned int p_count)
 {
-    Value *l_entry;
-    unsigned int l_length = utarray_len(CAST(p_array));
-    if (p_index > l_length)
+    appendScalars(p_array, e_ATP_ValueType_int, p_values, p_count);
+}
+
+void ATP_arrayAppendDoubleN(ATP_Array *p_array, const double *p_values, unsigned int p_count)
+{
+    appendScalars(p_array, e_ATP_ValueType_double, p_values, p_count);
+}
+
+void ATP_arrayAppendBoolN(ATP_Array *p_array, const int *p_values, unsigned int p_count)
+{
+    appendScalars(p_array, e_ATP_ValueType_bool, p_values, p_count);
+}
+
+void ATP_arrayMoveAppend(ATP_Array *p_dest, ATP_Array *p_source)
+{
+    unsigned int i;
+    ATP_ArrayImpl *l_dest;
+    ATP_ArrayImpl *l_source;
+
+    if (p_dest == p_source)
     {
-        ERR("Index out of bounds\n");
-        return NULL;
+        return;
+    }
+
+    if (!Value_detachArray(p_source) || !Value_detachArray(p_dest))
+    {
+        return;
+    }
+
+    l_dest = *p_dest;
+    l_source = *p_source;
+    if (l_source->m_length == 0)
+    {
+        return;
     }
-    else if (p_index == l_length)
+
+    if (l_dest->m_length == 0 && l_dest->m_arena == l_source->m_arena)
+    {
+        // just trade storage, leaving the source with the destination's empty buffer
+        ATP_ArrayImpl l_temp = *l_dest;
+        l_dest->m_data = l_source->m_data;
+        l_dest->m_length = l_source->m_length;
+        l_dest->m_capacity = l_source->m_capacity;
+        l_dest->m_kind = l_source->m_kind;
+        l_source->m_data = l_temp.m_data;
+        l_source->m_length = 0;
+        l_source->m_capacity = l_temp.m_capacity;
+        l_source->m_kind = l_temp.m_kind;
+        return;
+    }
+
+    DBG("moving %u entries from array %p to %p\n", l_source->m_length, l_source, l_dest);
+    if (l_dest->m_kind != e_ATP_ValueType_none && l_dest->m_kind != l_source->m_kind)
     {
-        utarray_extend_back(CAST(p_array));
-        l_entry = (Value *) utarray_back(CAST(p_array));
+        unpack(l_dest);
+    }
+
+    reserve(l_dest, l_dest->m_length + l_source->m_length);
+    if (l_dest->m_kind == l_source->m_kind
+        && (l_dest->m_kind != e_ATP_ValueType_none || l_dest->m_arena == l_source->m_arena))
+    {
+        // nothing in either array refers to the other's storage, so the entries can just be relinked
+        memcpy(ELEMENT(l_dest, l_dest->m_length), l_source->m_data.m_raw, l_source->m_length * elementSize(l_source->m_kind));
     }
     else
     {
-        l_entry = (Value *) utarray_eltptr(CAST(p_array), p_index);
+        for (i = 0; i < l_source->m_length; ++i)
+        {
+            Value l_value;
+            Value *l_entry = &l_dest->m_data.m_values[l_dest->m_length + i];
+            if (l_source->m_kind != e_ATP_ValueType_none)
+            {
+                loadPacked(l_source, i, &l_value);
+            }
+            else
+            {
+                l_value = l_source->m_data.m_values[i];
+            }
+
+            l_entry->m_type = e_ATP_ValueType_none;
+            Value_move(l_entry, l_dest->m_arena, &l_value, l_source->m_arena);
+        }
     }
 
-    return l_entry;
+    l_dest->m_length += l_source->m_length;
+    l_source->m_length = 0;
 }
 
 int ATP_arraySetString(ATP_Array *p_array, unsigned int p_index, const char *p_value)
@@ -108,65 +1050,48 @@ int ATP_arraySetString(ATP_Array *p_array, unsigned int p_index, const char *p_v
     }
 
     DBG("setting array[%u] = '%s'\n", p_index, p_value);
-    Value_changeType(l_entry, e_ATP_ValueType_string);
-    utstring_bincpy(&l_entry->m_value.m_string, p_value, strlen(p_value));
+    Value_setString(l_entry, p_value, (*p_array)->m_arena);
     return 1;
 }
 
 int ATP_arraySetUint(ATP_Array *p_array, unsigned int p_index, unsigned long long p_value)
 {
-    Value *l_entry = findOrCreateEntry(p_array, p_index);
-    if (l_entry == NULL)
-    {
-        return 0;
-    }
+    Value l_value;
 
     DBG("setting array[%u] = %llu\n", p_index, p_value);
-    Value_changeType(l_entry, e_ATP_ValueType_uint);
-    l_entry->m_value.m_uint = p_value;
-    return 1;
+    l_value.m_type = e_ATP_ValueType_uint;
+    l_value.m_value.m_uint = p_value;
+    return setScalar(p_array, p_index, &l_value);
 }
 
 int ATP_arraySetInt(ATP_Array *p_array, unsigned int p_index, signed long long p_value)
 {
-    Value *l_entry = findOrCreateEntry(p_array, p_index);
-    if (l_entry == NULL)
-    {
-        return 0;
-    }
+    Value l_value;
 
     DBG("setting array[%u] = %lld\n", p_index, p_value);
-    Value_changeType(l_entry, e_ATP_ValueType_int);
-    l_entry->m_value.m_int = p_value;
-    return 1;
+    l_value.m_type = e_ATP_ValueType_int;
+    l_value.m_value.m_int = p_value;
+    return setScalar(p_array, p_index, &l_value);
 }
 
 int ATP_arraySetDouble(ATP_Array *p_array, unsigned int p_index, double p_value)
 {
-    Value *l_entry = findOrCreateEntry(p_array, p_index);
-    if (l_entry == NULL)
-    {
-        return 0;
-    }
+    Value l_value;
 
     DBG("setting array[%u] = %f\n", p_index, p_value);
-    Value_changeType(l_entry, e_ATP_ValueType_double);
-    l_entry->m_value.m_double = p_value;
-    return 1;
+    l_value.m_type = e_ATP_ValueType_double;
+    l_value.m_value.m_double = p_value;
+    return setScalar(p_array, p_index, &l_value);
 }
 
 int ATP_arraySetBool(ATP_Array *p_array, unsigned int p_index, int p_value)
 {
-    Value *l_entry = findOrCreateEntry(p_array, p_index);
-    if (l_entry == NULL)
-    {
-        return 0;
-    }
+    Value l_value;
 
     DBG("setting array[%u] = %s\n", p_index, (p_value ? "true" : "false"));
-    Value_changeType(l_entry, e_ATP_ValueType_bool);
-    l_entry->m_value.m_bool = (p_value != 0);
-    return 1;
+    l_value.m_type = e_ATP_ValueType_bool;
+    l_value.m_value.m_bool = (p_value != 0);
+    return setScalar(p_array, p_index, &l_value);
 }
 
 int ATP_arraySetDict(ATP_Array *p_array, unsigned int p_index, ATP_Dictionary p_value)
@@ -178,8 +1103,7 @@ int ATP_arraySetDict(ATP_Array *p_array, unsigned int p_index, ATP_Dictionary p_
     }
 
     DBG("setting array[%u] = <dictionary>\n", p_index);
-    Value_changeType(l_entry, e_ATP_ValueType_dict);
-    l_entry->m_value.m_dict = p_value;
+    Value_setDict(l_entry, p_value, (*p_array)->m_arena);
     return 1;
 }
 
@@ -192,14 +1116,14 @@ int ATP_arraySetArray(ATP_Array *p_array, unsigned int p_index, ATP_Array p_valu
     }
 
     DBG("setting array[%u] = <array>\n", p_index);
-    Value_changeType(l_entry, e_ATP_ValueType_array);
-    l_entry->m_value.m_array = p_value;
+    Value_setArray(l_entry, p_value, (*p_array)->m_arena);
     return 1;
 }
 
 int ATP_arrayGetString(const ATP_Array *p_array, unsigned int p_index, const char **p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -208,7 +1132,7 @@ int ATP_arrayGetString(const ATP_Array *p_array, unsigned int p_index, const cha
 
     if (l_entry->m_type == e_ATP_ValueType_string)
     {
-        *p_value = utstring_body(&l_entry->m_value.m_string);
+        *p_value = Value_getString(l_entry);
         return 1;
     }
     return 0;
@@ -216,7 +1140,8 @@ int ATP_arrayGetString(const ATP_Array *p_array, unsigned int p_index, const cha
 
 int ATP_arrayGetUint(const ATP_Array *p_array, unsigned int p_index, unsigned long long *p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -233,7 +1158,8 @@ int ATP_arrayGetUint(const ATP_Array *p_array, unsigned int p_index, unsigned lo
 
 int ATP_arrayGetInt(const ATP_Array *p_array, unsigned int p_index, signed long long *p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -250,7 +1176,8 @@ int ATP_arrayGetInt(const ATP_Array *p_array, unsigned int p_index, signed long
 
 int ATP_arrayGetDouble(const ATP_Array *p_array, unsigned int p_index, double *p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -267,7 +1194,8 @@ int ATP_arrayGetDouble(const ATP_Array *p_array, unsigned int p_index, double *p
 
 int ATP_arrayGetBool(const ATP_Array *p_array, unsigned int p_index, int *p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -282,9 +1210,60 @@ int ATP_arrayGetBool(const ATP_Array *p_array, unsigned int p_index, int *p_valu
     return 0;
 }
 
-int ATP_arrayGetDict(const ATP_Array *p_array, unsigned int p_index, ATP_Dictionary **p_value)
+int ATP_arrayGetDict(ATP_Array *p_array, unsigned int p_index, ATP_Dictionary **p_value)
+{
+    Value l_scratch;
+    Value *l_entry;
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_entry = getEntry(p_array, p_index, &l_scratch);
+    if (l_entry == NULL)
+    {
+        ERR("Index out of bounds\n");
+        return 0;
+    }
+
+    if (l_entry->m_type == e_ATP_ValueType_dict && Value_detachDict(&l_entry->m_value.m_dict))
+    {
+        *p_value = &l_entry->m_value.m_dict;
+        return 1;
+    }
+    return 0;
+}
+
+int ATP_arrayGetArray(ATP_Array *p_array, unsigned int p_index, ATP_Array **p_value)
+{
+    Value l_scratch;
+    Value *l_entry;
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    l_entry = getEntry(p_array, p_index, &l_scratch);
+    if (l_entry == NULL)
+    {
+        ERR("Index out of bounds\n");
+        return 0;
+    }
+
+    if (l_entry->m_type == e_ATP_ValueType_array && Value_detachArray(&l_entry->m_value.m_array))
+    {
+        *p_value = &l_entry->m_value.m_array;
+        return 1;
+    }
+    return 0;
+}
+
+int ATP_arrayGetDictConst(const ATP_Array *p_array, unsigned int p_index, const ATP_Dictionary **p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -299,9 +1278,10 @@ int ATP_arrayGetDict(const ATP_Array *p_array, unsigned int p_index, ATP_Diction
     return 0;
 }
 
-int ATP_arrayGetArray(const ATP_Array *p_array, unsigned int p_index, ATP_Array **p_value)
+int ATP_arrayGetArrayConst(const ATP_Array *p_array, unsigned int p_index, const ATP_Array **p_value)
 {
-    Value *l_entry = (Value *) utarray_eltptr(CCAST(p_array), p_index);
+    Value l_scratch;
+    Value *l_entry = getEntry(p_array, p_index, &l_scratch);
     if (l_entry == NULL)
     {
         ERR("Index out of bounds\n");
@@ -315,3 +1295,119 @@ int ATP_arrayGetArray(const ATP_Array *p_array, unsigned int p_index, ATP_Array
     }
     return 0;
 }
+
+int ATP_arrayGetUintSpan(ATP_Array *p_array, unsigned long long **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_uint)
+    {
+        return 0;
+    }
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_uints;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetUintSpanConst(const ATP_Array *p_array, const unsigned long long **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_uint)
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_uints;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetIntSpan(ATP_Array *p_array, signed long long **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_int)
+    {
+        return 0;
+    }
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_ints;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetIntSpanConst(const ATP_Array *p_array, const signed long long **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_int)
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_ints;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetDoubleSpan(ATP_Array *p_array, double **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_double)
+    {
+        return 0;
+    }
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_doubles;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetDoubleSpanConst(const ATP_Array *p_array, const double **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_double)
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_doubles;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetBoolSpan(ATP_Array *p_array, unsigned char **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_bool)
+    {
+        return 0;
+    }
+
+    if (!Value_detachArray(p_array))
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_bools;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
+
+int ATP_arrayGetBoolSpanConst(const ATP_Array *p_array, const unsigned char **p_values, unsigned int *p_length)
+{
+    if ((*p_array)->m_kind != e_ATP_ValueType_bool)
+    {
+        return 0;
+    }
+
+    *p_values = (*p_array)->m_data.m_bools;
+    *p_length = (*p_array)->m_length;
+    return 1;
+}
@@ -2,13 +2,19 @@
 The dynamic array type for ATP.
 
 Important:
-    It is not a requirement that every entry in the array be of the same type.
+    It is not a requirement that every entry in the array be of the same type.  An array whose entries are all unsigned
+    integers, signed integers, floating point values or booleans may however be packed (see <ATP_arrayPack>), which stores the
+    raw values contiguously rather than as tagged values, and allows them to be accessed in bulk (see <ATP_arrayGetDoubleSpan>).
+    Packed arrays are otherwise used exactly like any other array; storing a value of another type in one simply unpacks it.
+
+    Arrays are reference counted and copied on write, and may be frozen, in the same way as dictionaries, see <Dictionary.h>.
 */
 #ifndef _ATP_LIBRARY_ARRAY_H_
 #define _ATP_LIBRARY_ARRAY_H_
 
 #include "Export.h"
 #include "Value.h"
+#include "Arena.h"
 
 // forward declaration
 struct ATP_ArrayImpl;
@@ -38,8 +44,19 @@ Parameters:
     p_array - The array handle.
 */
 EXPORT void ATP_arrayInit(ATP_Array *p_array);
+/* Function: ATP_arrayInitInArena
+Initialize an array instance whose storage and string values are all allocated from an arena.  Nested dictionaries and arrays
+should be initialized in the same arena (see <ATP_arrayGetArena>); any that are not are copied into it when they are stored in
+the array.
+
+Parameters:
+    p_array - The array handle.
+    p_arena - The arena to allocate from.  If this is NULL, a new arena is created.  The handle holds a reference to the
+              arena, and the entire tree is released at once when the last reference to the arena is released.
+*/
+EXPORT void ATP_arrayInitInArena(ATP_Array *p_array, ATP_Arena *p_arena);
 /* Function: ATP_arrayDestroy
-Destroy an array instance.  Remove and free all entries.
+Release a reference to an array instance.  Once the last reference is released all entries are removed and freed.
 
 Parameters:
     p_array - The array handle.
@@ -47,12 +64,30 @@ Parameters:
 EXPORT void ATP_arrayDestroy(ATP_Array *p_array);
 /* Function: ATP_arrayClear
 Remove and free all entries in the list, but leave it initialized.  The state after calling this is the same as just after
-calling <ATP_arrayInit> on an uninitialized array.
+calling <ATP_arrayInit> on an uninitialized array, except that a packed array remains packed.
 
 Parameters:
     p_array - The array handle.
 */
 EXPORT void ATP_arrayClear(ATP_Array *p_array);
+/* Function: ATP_arrayReserve
+Make sure that an array has room for a given number of entries, so that appending up to that many entries does not have to
+reallocate its storage.
+
+Parameters:
+    p_array    - The array handle.
+    p_capacity - The number of entries to make room for.
+*/
+EXPORT void ATP_arrayReserve(ATP_Array *p_array, unsigned int p_capacity);
+/* Function: ATP_arrayResize
+Change the number of entries in an array.  Entries beyond the new length are removed and freed, while new entries have no type,
+or are zero in a packed array.
+
+Parameters:
+    p_array  - The array handle.
+    p_length - The new number of entries.
+*/
+EXPORT void ATP_arrayResize(ATP_Array *p_array, unsigned int p_length);
 /* Function: ATP_arrayLength
 Count the number of entries in the array.
 
@@ -63,6 +98,16 @@ Returns:
     The number of entries.
 */
 EXPORT unsigned int ATP_arrayLength(const ATP_Array *p_array);
+/* Function: ATP_arrayGetArena
+Get the arena that an array allocates from.
+
+Parameters:
+    p_array - The array handle.
+
+Returns:
+    The arena, or NULL if the array allocates from the heap.
+*/
+EXPORT ATP_Arena *ATP_arrayGetArena(const ATP_Array *p_array);
 
 /* Function: ATP_arrayErase
 Erase the array entry at the given index.
@@ -75,6 +120,97 @@ Returns:
     1 on success, 0 on failure.
 */
 EXPORT int ATP_arrayErase(ATP_Array *p_array, unsigned int p_index);
+/* Function: ATP_arraySwap
+Exchange two entries of an array.
+
+Parameters:
+    p_array  - The array handle.
+    p_first  - The index of the first entry.
+    p_second - The index of the second entry.
+
+Returns:
+    1 on success, 0 if either index is out of bounds.
+*/
+EXPORT int ATP_arraySwap(ATP_Array *p_array, unsigned int p_first, unsigned int p_second);
+/* Function: ATP_arrayPopBack
+Remove the last entry of an array, moving its value out rather than destroying it.  Nested dictionaries and arrays are
+relinked rather than copied.
+
+Parameters:
+    p_array - The array handle.
+    p_value - The initialized value instance to move the entry's value into.  Its previous contents are destroyed.
+
+Returns:
+    1 on success, 0 if the array is empty.
+*/
+EXPORT int ATP_arrayPopBack(ATP_Array *p_array, ATP_Value *p_value);
+/* Function: ATP_arrayPut
+Move a value into a given entry.  The index may be equal to the current value returned by <ATP_arrayLength>, in which case a
+new entry will be appended to the array.  If the entry does exist then the old value and type are discarded.
+
+Parameters:
+    p_array - The array handle.
+    p_index - The index of the array entry to set.
+    p_value - The value instance to move into the entry, which is left with no type.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_arrayPut(ATP_Array *p_array, unsigned int p_index, ATP_Value *p_value);
+/* Function: ATP_arrayAppendStringN
+Append copies of several character strings to the end of an array, allocating room for all of them at once.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The strings to append.
+    p_count  - The number of strings to append.
+*/
+EXPORT void ATP_arrayAppendStringN(ATP_Array *p_array, const char *const *p_values, unsigned int p_count);
+/* Function: ATP_arrayAppendUintN
+Append several unsigned integers to the end of an array.  See <ATP_arrayAppendStringN>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The values to append.
+    p_count  - The number of values to append.
+*/
+EXPORT void ATP_arrayAppendUintN(ATP_Array *p_array, const unsigned long long *p_values, unsigned int p_count);
+/* Function: ATP_arrayAppendIntN
+Append several signed integers to the end of an array.  See <ATP_arrayAppendStringN>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The values to append.
+    p_count  - The number of values to append.
+*/
+EXPORT void ATP_arrayAppendIntN(ATP_Array *p_array, const signed long long *p_values, unsigned int p_count);
+/* Function: ATP_arrayAppendDoubleN
+Append several floating point values to the end of an array.  See <ATP_arrayAppendStringN>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The values to append.
+    p_count  - The number of values to append.
+*/
+EXPORT void ATP_arrayAppendDoubleN(ATP_Array *p_array, const double *p_values, unsigned int p_count);
+/* Function: ATP_arrayAppendBoolN
+Append several boolean values to the end of an array.  See <ATP_arrayAppendStringN>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The values to append.
+    p_count  - The number of values to append.
+*/
+EXPORT void ATP_arrayAppendBoolN(ATP_Array *p_array, const int *p_values, unsigned int p_count);
+/* Function: ATP_arrayMoveAppend
+Move every entry of one array to the end of another, leaving the source array empty.  Entries are relinked rather than copied,
+unless the destination allocates from a different arena.
+
+Parameters:
+    p_dest   - The array handle to append to.
+    p_source - The array handle to move the entries from.
+*/
+EXPORT void ATP_arrayMoveAppend(ATP_Array *p_dest, ATP_Array *p_source);
 /* Function: ATP_arrayGetType
 Get the value type for the given entry.
 
@@ -87,16 +223,70 @@ Returns:
 */
 EXPORT ATP_ValueType ATP_arrayGetType(const ATP_Array *p_array, unsigned int p_index);
 
+/* Function: ATP_arrayPack
+Switch an array to packed storage, in which every entry must be of the given type.  Entries that are added later with the
+same type are stored packed, while adding an entry of any other type switches the array back to tagged storage.
+
+Parameters:
+    p_array - The array handle.
+    p_type  - The type of the entries, which must be one of <e_ATP_ValueType_uint>, <e_ATP_ValueType_int>,
+              <e_ATP_ValueType_double> or <e_ATP_ValueType_bool>.
+
+Returns:
+    1 on success, 0 if the type cannot be packed or any existing entry is of a different type.
+*/
+EXPORT int ATP_arrayPack(ATP_Array *p_array, ATP_ValueType p_type);
+/* Function: ATP_arrayGetPackedType
+Get the type of the entries of a packed array.
+
+Parameters:
+    p_array - The array handle.
+
+Returns:
+    The type of every entry in the array, or <e_ATP_ValueType_none> if the array is not packed.
+*/
+EXPORT ATP_ValueType ATP_arrayGetPackedType(const ATP_Array *p_array);
+
 /* Function: ATP_arrayDuplicate
-Duplicate an existing array.
+Duplicate an existing array.  This takes constant time, since the array is shared until either handle is used to modify it.
 
 Parameters:
     p_array - The array to duplicate.
 
 Returns:
-    The new copy of the array.
+    The new copy of the array, which must be destroyed separately.
 */
 EXPORT ATP_Array ATP_arrayDuplicate(const ATP_Array *p_array);
+/* Function: ATP_arrayDuplicateInArena
+Duplicate an existing array into an arena.  An array that already allocates from the arena is shared as with
+<ATP_arrayDuplicate>, while any other is copied into the arena in full.
+
+Parameters:
+    p_array - The array to duplicate.
+    p_arena - The arena to allocate the copy from, or NULL to share the array wherever it is allocated.
+
+Returns:
+    The new copy of the array, which must be destroyed separately.
+*/
+EXPORT ATP_Array ATP_arrayDuplicateInArena(const ATP_Array *p_array, ATP_Arena *p_arena);
+/* Function: ATP_arrayFreeze
+Replace an array with a frozen copy of it, allocated from a new arena along with everything nested in it.  Any attempt to
+modify a frozen array or its contents fails.  Freezing an array that is already frozen does nothing.
+
+Parameters:
+    p_array - The array handle.
+*/
+EXPORT void ATP_arrayFreeze(ATP_Array *p_array);
+/* Function: ATP_arrayIsFrozen
+Check whether an array is frozen, see <ATP_arrayFreeze>.
+
+Parameters:
+    p_array - The array handle.
+
+Returns:
+    1 if the array is frozen, 0 otherwise.
+*/
+EXPORT int ATP_arrayIsFrozen(const ATP_Array *p_array);
 
 /* Function: ATP_arraySetString
 Set the value of a given entry to be the provided character string.  The index may be equal to the current value returned by <ATP_arrayLength>,
@@ -265,7 +455,7 @@ Returns:
 */
 EXPORT int ATP_arrayGetBool(const ATP_Array *p_array, unsigned int p_index, int *p_value);
 /* Function: ATP_arrayGetDict
-Get the value of a given dictionary entry.
+Get the value of a given dictionary entry, for modification.  If the array or the dictionary is shared, it is copied first.
 
 Parameters:
     p_array - The array handle.
@@ -275,9 +465,9 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_arrayGetDict(const ATP_Array *p_array, unsigned int p_index, ATP_Dictionary **p_value);
+EXPORT int ATP_arrayGetDict(ATP_Array *p_array, unsigned int p_index, ATP_Dictionary **p_value);
 /* Function: ATP_arrayGetArray
-Get the value of a given sub-array entry.
+Get the value of a given sub-array entry, for modification.  If either array is shared, it is copied first.
 
 Parameters:
     p_array - The array handle.
@@ -287,7 +477,155 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_arrayGetArray(const ATP_Array *p_array, unsigned int p_index, ATP_Array **p_value);
+EXPORT int ATP_arrayGetArray(ATP_Array *p_array, unsigned int p_index, ATP_Array **p_value);
+/* Function: ATP_arrayGetDictConst
+Get the value of a given dictionary entry, for reading only.
+
+Parameters:
+    p_array - The array handle.
+    p_index - The index of the array entry to get.
+    p_value - The location to store the value from the array entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_arrayGetDictConst(const ATP_Array *p_array, unsigned int p_index, const ATP_Dictionary **p_value);
+/* Function: ATP_arrayGetArrayConst
+Get the value of a given sub-array entry, for reading only.
+
+Parameters:
+    p_array - The array handle.
+    p_index - The index of the array entry to get.
+    p_value - The location to store the value from the array entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_arrayGetArrayConst(const ATP_Array *p_array, unsigned int p_index, const ATP_Array **p_value);
+
+/* Function: ATP_arrayGetUintSpan
+Get the entries of a packed unsigned integer array, for modification.  If the array is shared, it is copied first.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.  The entries are only valid until the array is next
+               modified through any other function, duplicated or destroyed.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_uint>.
+*/
+EXPORT int ATP_arrayGetUintSpan(ATP_Array *p_array, unsigned long long **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetUintSpanConst
+Get the entries of a packed unsigned integer array, for reading only.  See <ATP_arrayGetUintSpan>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_uint>.
+*/
+EXPORT int ATP_arrayGetUintSpanConst(const ATP_Array *p_array, const unsigned long long **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetIntSpan
+Get the entries of a packed signed integer array, for modification.  If the array is shared, it is copied first.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.  The entries are only valid until the array is next
+               modified through any other function, duplicated or destroyed.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_int>.
+*/
+EXPORT int ATP_arrayGetIntSpan(ATP_Array *p_array, signed long long **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetIntSpanConst
+Get the entries of a packed signed integer array, for reading only.  See <ATP_arrayGetIntSpan>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_int>.
+*/
+EXPORT int ATP_arrayGetIntSpanConst(const ATP_Array *p_array, const signed long long **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetDoubleSpan
+Get the entries of a packed floating point array, for modification.  If the array is shared, it is copied first.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.  The entries are only valid until the array is next
+               modified through any other function, duplicated or destroyed.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_double>.
+*/
+EXPORT int ATP_arrayGetDoubleSpan(ATP_Array *p_array, double **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetDoubleSpanConst
+Get the entries of a packed floating point array, for reading only.  See <ATP_arrayGetDoubleSpan>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_double>.
+*/
+EXPORT int ATP_arrayGetDoubleSpanConst(const ATP_Array *p_array, const double **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetBoolSpan
+Get the entries of a packed boolean array, for modification.  If the array is shared, it is copied first.  Each entry is either 0 or 1.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.  The entries are only valid until the array is next
+               modified through any other function, duplicated or destroyed.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_bool>.
+*/
+EXPORT int ATP_arrayGetBoolSpan(ATP_Array *p_array, unsigned char **p_values, unsigned int *p_length);
+/* Function: ATP_arrayGetBoolSpanConst
+Get the entries of a packed boolean array, for reading only.  See <ATP_arrayGetBoolSpan>.
+
+Parameters:
+    p_array  - The array handle.
+    p_values - The location to store a pointer to the first entry in.
+    p_length - The location to store the number of entries in.
+
+Returns:
+    1 on success, 0 if the array is not packed with entries of type <e_ATP_ValueType_bool>.
+*/
+EXPORT int ATP_arrayGetBoolSpanConst(const ATP_Array *p_array, const unsigned char **p_values, unsigned int *p_length);
+
+/* Function: ATP_valueTakeArray
+Move an array out of a value, leaving the value with no type.
+
+Parameters:
+    p_value - The value instance.
+    p_array - The array handle to move the array into.  Any array it referred to before is not destroyed.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueTakeArray(ATP_Value *p_value, ATP_Array *p_array);
+/* Function: ATP_valueGetArrayConst
+Get the array held in a value, for reading only.
+
+Parameters:
+    p_value - The value instance.
+    p_array - The location to store the array handle in.  The handle is only valid while the value remains unchanged.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetArrayConst(const ATP_Value *p_value, const ATP_Array **p_array);
 
 #ifdef __cplusplus
 }   /* extern "C" */
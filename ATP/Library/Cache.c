@@ -0,0 +1,1140 @@
+#include "Cache.h"
+#include "Atomic.inc"
+#include "Thread.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !_WIN32
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+    #include <utime.h>
+#endif
+
+#define c_magic             "ATPC"
+#define c_formatVersion     1
+#define c_extension         ".atpc"
+#define c_fileChunk         65536
+
+static char *gs_dir = NULL;
+static unsigned long long gs_limit = 0;
+
+// the total size of the files in the directory, which is not known until it is first scanned
+static Mutex gs_mutex;
+static unsigned long long gs_size = 0;
+static int gs_sizeKnown = 0;
+static AtomicCount gs_tempCount = 0;
+
+typedef struct Buffer
+{
+    unsigned char *m_data;
+    size_t m_length;
+    size_t m_capacity;
+} Buffer;
+
+typedef struct Reader
+{
+    const unsigned char *m_data;
+    size_t m_length;
+    size_t m_offset;
+} Reader;
+
+typedef struct CacheFile
+{
+    char m_name[64];
+    time_t m_used;
+    unsigned long long m_size;
+} CacheFile;
+
+// forward references
+static void writeDictionary(Buffer *p_buffer, const ATP_Dictionary *p_dict);
+static int readDictionary(Reader *p_reader, ATP_Dictionary *p_dict);
+
+static unsigned long long rotate(unsigned long long p_value, unsigned int p_bits)
+{
+    return (p_value << p_bits) | (p_value >> (64 - p_bits));
+}
+
+static unsigned long long mixHash(unsigned long long p_hash)
+{
+    p_hash ^= p_hash >> 33;
+    p_hash *= 0xff51afd7ed558ccdULL;
+    p_hash ^= p_hash >> 33;
+    p_hash *= 0xc4ceb9fe1a85ec53ULL;
+    p_hash ^= p_hash >> 33;
+    return p_hash;
+}
+
+void ATP_cacheKeyInit(ATP_CacheKey *p_key)
+{
+    p_key->m_state[0] = 0x9e3779b97f4a7c15ULL;
+    p_key->m_state[1] = 0x6a09e667f3bcc909ULL;
+    p_key->m_length = 0;
+}
+
+// the two halves of the key are updated by unrelated functions, so that a collision in one is unlikely to be one in the other
+static void addWord(ATP_CacheKey *p_key, unsigned long long p_word)
+{
+    p_key->m_state[0] = rotate((p_key->m_state[0] ^ p_word) * 0x87c37b91114253d5ULL, 31);
+    p_key->m_state[1] = rotate(p_key->m_state[1] + p_word, 27) * 0x4cf5ad432745937fULL + 0x52dce729ULL;
+    p_key->m_length += 8;
+}
+
+static void addBytes(ATP_CacheKey *p_key, const void *p_bytes, size_t p_count)
+{
+    unsigned long long l_word;
+    const unsigned char *l_bytes = p_bytes;
+
+    for (; p_count >= 8; p_count -= 8, l_bytes += 8)
+    {
+        memcpy(&l_word, l_bytes, 8);
+        addWord(p_key, l_word);
+    }
+    if (p_count > 0)
+    {
+        l_word = 0;
+        memcpy(&l_word, l_bytes, p_count);
+        addWord(p_key, l_word ^ ((unsigned long long) p_count << 56));
+    }
+}
+
+static void digest(const ATP_CacheKey *p_key, unsigned long long p_digest[2])
+{
+    p_digest[0] = mixHash(p_key->m_state[0] ^ p_key->m_length);
+    p_digest[1] = mixHash(p_key->m_state[1] + p_key->m_length + p_digest[0]);
+}
+
+void ATP_cacheKeyAddString(ATP_CacheKey *p_key, const char *p_string)
+{
+    size_t l_length = strlen(p_string);
+    addWord(p_key, (unsigned long long) l_length);
+    addBytes(p_key, p_string, l_length);
+}
+
+static void addDouble(ATP_CacheKey *p_key, double p_value)
+{
+    unsigned long long l_word;
+    memcpy(&l_word, &p_value, sizeof(l_word));
+    addWord(p_key, l_word);
+}
+
+void ATP_cacheKeyAddArray(ATP_CacheKey *p_key, const ATP_Array *p_array)
+{
+    unsigned int i;
+    unsigned int l_length = ATP_arrayLength(p_array);
+    ATP_ValueType l_packed = ATP_arrayGetPackedType(p_array);
+
+    addWord(p_key, e_ATP_ValueType_array);
+    addWord(p_key, l_length);
+    addWord(p_key, l_packed);
+    if (l_packed == e_ATP_ValueType_uint)
+    {
+        const unsigned long long *l_values;
+        ATP_arrayGetUintSpanConst(p_array, &l_values, &l_length);
+        addBytes(p_key, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_int)
+    {
+        const signed long long *l_values;
+        ATP_arrayGetIntSpanConst(p_array, &l_values, &l_length);
+        addBytes(p_key, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_double)
+    {
+        const double *l_values;
+        ATP_arrayGetDoubleSpanConst(p_array, &l_values, &l_length);
+        addBytes(p_key, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_bool)
+    {
+        const unsigned char *l_values;
+        ATP_arrayGetBoolSpanConst(p_array, &l_values, &l_length);
+        addBytes(p_key, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+
+    for (i = 0; i < l_length; ++i)
+    {
+        ATP_ValueType l_type = ATP_arrayGetType(p_array, i);
+
+        addWord(p_key, l_type);
+        switch (l_type)
+        {
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = NULL;
+                    ATP_arrayGetString(p_array, i, &l_value);
+                    ATP_cacheKeyAddString(p_key, l_value);
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value = 0;
+                    ATP_arrayGetUint(p_array, i, &l_value);
+                    addWord(p_key, l_value);
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value = 0;
+                    ATP_arrayGetInt(p_array, i, &l_value);
+                    addWord(p_key, (unsigned long long) l_value);
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value = 0.0;
+                    ATP_arrayGetDouble(p_array, i, &l_value);
+                    addDouble(p_key, l_value);
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    int l_value = 0;
+                    ATP_arrayGetBool(p_array, i, &l_value);
+                    addWord(p_key, (l_value != 0));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    const ATP_Dictionary *l_value = NULL;
+                    ATP_arrayGetDictConst(p_array, i, &l_value);
+                    ATP_cacheKeyAddDictionary(p_key, l_value);
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    const ATP_Array *l_value = NULL;
+                    ATP_arrayGetArrayConst(p_array, i, &l_value);
+                    ATP_cacheKeyAddArray(p_key, l_value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static int isListed(const char *const *p_keys, const char *p_key)
+{
+    for (; *p_keys != NULL; ++p_keys)
+    {
+        if (strcmp(*p_keys, p_key) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// add the entries of a dictionary, or only those of the listed keys if there is a list
+static void addEntries(ATP_CacheKey *p_key, const ATP_Dictionary *p_dict, const char *const *p_keys)
+{
+    ATP_DictionaryIterator it;
+    unsigned long long l_sum[2] = { 0, 0 };
+    unsigned long long l_count = 0;
+
+    // each entry is hashed on its own and the results summed, so that the order of the entries makes no difference
+    for (it = ATP_dictionaryBeginConst(p_dict); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
+    {
+        ATP_CacheKey l_entry;
+        unsigned long long l_digest[2];
+        ATP_ValueType l_type = ATP_dictionaryGetType(it);
+
+        if (p_keys != NULL && !isListed(p_keys, ATP_dictionaryGetKey(it)))
+        {
+            continue;
+        }
+        ++l_count;
+        ATP_cacheKeyInit(&l_entry);
+        ATP_cacheKeyAddString(&l_entry, ATP_dictionaryGetKey(it));
+        addWord(&l_entry, l_type);
+        switch (l_type)
+        {
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = NULL;
+                    ATP_dictionaryItGetString(it, &l_value);
+                    ATP_cacheKeyAddString(&l_entry, l_value);
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value = 0;
+                    ATP_dictionaryItGetUint(it, &l_value);
+                    addWord(&l_entry, l_value);
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value = 0;
+                    ATP_dictionaryItGetInt(it, &l_value);
+                    addWord(&l_entry, (unsigned long long) l_value);
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value = 0.0;
+                    ATP_dictionaryItGetDouble(it, &l_value);
+                    addDouble(&l_entry, l_value);
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    int l_value = 0;
+                    ATP_dictionaryItGetBool(it, &l_value);
+                    addWord(&l_entry, (l_value != 0));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    const ATP_Dictionary *l_value = NULL;
+                    ATP_dictionaryItGetDictConst(it, &l_value);
+                    ATP_cacheKeyAddDictionary(&l_entry, l_value);
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    const ATP_Array *l_value = NULL;
+                    ATP_dictionaryItGetArrayConst(it, &l_value);
+                    ATP_cacheKeyAddArray(&l_entry, l_value);
+                }
+                break;
+            default:
+                break;
+        }
+
+        digest(&l_entry, l_digest);
+        l_sum[0] += l_digest[0];
+        l_sum[1] += l_digest[1];
+    }
+
+    addWord(p_key, e_ATP_ValueType_dict);
+    addWord(p_key, l_count);
+    addWord(p_key, l_sum[0]);
+    addWord(p_key, l_sum[1]);
+}
+
+void ATP_cacheKeyAddDictionary(ATP_CacheKey *p_key, const ATP_Dictionary *p_dict)
+{
+    addEntries(p_key, p_dict, NULL);
+}
+
+void ATP_cacheKeyAddDictionaryKeys(ATP_CacheKey *p_key, const ATP_Dictionary *p_dict, const char *const *p_keys)
+{
+    addEntries(p_key, p_dict, p_keys);
+}
+
+int ATP_cacheKeyAddFile(ATP_CacheKey *p_key, const char *p_path)
+{
+    size_t l_read;
+    unsigned long long l_total = 0;
+    unsigned char *l_chunk;
+    FILE *l_file = fopen(p_path, "rb");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+
+    l_chunk = malloc(c_fileChunk);
+    if (l_chunk == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // the chunks are a whole number of words, so that reading the file in pieces hashes it as if it were read at once
+    ATP_cacheKeyAddString(p_key, p_path);
+    while ((l_read = fread(l_chunk, 1, c_fileChunk, l_file)) > 0)
+    {
+        addBytes(p_key, l_chunk, l_read);
+        l_total += l_read;
+    }
+    addWord(p_key, l_total);
+
+    free(l_chunk);
+    if (ferror(l_file))
+    {
+        fclose(l_file);
+        return 0;
+    }
+    fclose(l_file);
+    return 1;
+}
+
+static void put(Buffer *p_buffer, const void *p_bytes, size_t p_count)
+{
+    if (p_buffer->m_length + p_count > p_buffer->m_capacity)
+    {
+        size_t l_capacity = (p_buffer->m_capacity > 0 ? p_buffer->m_capacity * 2 : 4096);
+        while (l_capacity < p_buffer->m_length + p_count)
+        {
+            l_capacity *= 2;
+        }
+        p_buffer->m_data = realloc(p_buffer->m_data, l_capacity);
+        if (p_buffer->m_data == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        p_buffer->m_capacity = l_capacity;
+    }
+    memcpy(p_buffer->m_data + p_buffer->m_length, p_bytes, p_count);
+    p_buffer->m_length += p_count;
+}
+
+static void putByte(Buffer *p_buffer, unsigned char p_value)
+{
+    put(p_buffer, &p_value, 1);
+}
+
+static void putCount(Buffer *p_buffer, unsigned int p_value)
+{
+    put(p_buffer, &p_value, sizeof(p_value));
+}
+
+// strings are stored with their terminator, so that they can be used where they lie once loaded
+static void putString(Buffer *p_buffer, const char *p_value)
+{
+    size_t l_length = strlen(p_value);
+    putCount(p_buffer, (unsigned int) l_length);
+    put(p_buffer, p_value, l_length + 1);
+}
+
+static void writeArray(Buffer *p_buffer, const ATP_Array *p_array)
+{
+    unsigned int i;
+    unsigned int l_length = ATP_arrayLength(p_array);
+    ATP_ValueType l_packed = ATP_arrayGetPackedType(p_array);
+
+    // packed arrays are stored as a single block of values
+    putByte(p_buffer, (unsigned char) l_packed);
+    putCount(p_buffer, l_length);
+    if (l_packed == e_ATP_ValueType_uint)
+    {
+        const unsigned long long *l_values;
+        ATP_arrayGetUintSpanConst(p_array, &l_values, &l_length);
+        put(p_buffer, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_int)
+    {
+        const signed long long *l_values;
+        ATP_arrayGetIntSpanConst(p_array, &l_values, &l_length);
+        put(p_buffer, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_double)
+    {
+        const double *l_values;
+        ATP_arrayGetDoubleSpanConst(p_array, &l_values, &l_length);
+        put(p_buffer, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+    else if (l_packed == e_ATP_ValueType_bool)
+    {
+        const unsigned char *l_values;
+        ATP_arrayGetBoolSpanConst(p_array, &l_values, &l_length);
+        put(p_buffer, l_values, l_length * sizeof(*l_values));
+        return;
+    }
+
+    for (i = 0; i < l_length; ++i)
+    {
+        ATP_ValueType l_type = ATP_arrayGetType(p_array, i);
+
+        putByte(p_buffer, (unsigned char) l_type);
+        switch (l_type)
+        {
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = NULL;
+                    ATP_arrayGetString(p_array, i, &l_value);
+                    putString(p_buffer, l_value);
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value = 0;
+                    ATP_arrayGetUint(p_array, i, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value = 0;
+                    ATP_arrayGetInt(p_array, i, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value = 0.0;
+                    ATP_arrayGetDouble(p_array, i, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    int l_value = 0;
+                    ATP_arrayGetBool(p_array, i, &l_value);
+                    putByte(p_buffer, (unsigned char) (l_value != 0));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    const ATP_Dictionary *l_value = NULL;
+                    ATP_arrayGetDictConst(p_array, i, &l_value);
+                    writeDictionary(p_buffer, l_value);
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    const ATP_Array *l_value = NULL;
+                    ATP_arrayGetArrayConst(p_array, i, &l_value);
+                    writeArray(p_buffer, l_value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void writeDictionary(Buffer *p_buffer, const ATP_Dictionary *p_dict)
+{
+    ATP_DictionaryIterator it;
+
+    putCount(p_buffer, ATP_dictionaryCount(p_dict));
+    for (it = ATP_dictionaryBeginConst(p_dict); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
+    {
+        ATP_ValueType l_type = ATP_dictionaryGetType(it);
+
+        putString(p_buffer, ATP_dictionaryGetKey(it));
+        putByte(p_buffer, (unsigned char) l_type);
+        switch (l_type)
+        {
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = NULL;
+                    ATP_dictionaryItGetString(it, &l_value);
+                    putString(p_buffer, l_value);
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value = 0;
+                    ATP_dictionaryItGetUint(it, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value = 0;
+                    ATP_dictionaryItGetInt(it, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value = 0.0;
+                    ATP_dictionaryItGetDouble(it, &l_value);
+                    put(p_buffer, &l_value, sizeof(l_value));
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    int l_value = 0;
+                    ATP_dictionaryItGetBool(it, &l_value);
+                    putByte(p_buffer, (unsigned char) (l_value != 0));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    const ATP_Dictionary *l_value = NULL;
+                    ATP_dictionaryItGetDictConst(it, &l_value);
+                    writeDictionary(p_buffer, l_value);
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    const ATP_Array *l_value = NULL;
+                    ATP_dictionaryItGetArrayConst(it, &l_value);
+                    writeArray(p_buffer, l_value);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static const void *get(Reader *p_reader, size_t p_count)
+{
+    const void *l_bytes;
+    if (p_reader->m_length - p_reader->m_offset < p_count)
+    {
+        return NULL;
+    }
+    l_bytes = p_reader->m_data + p_reader->m_offset;
+    p_reader->m_offset += p_count;
+    return l_bytes;
+}
+
+static int getByte(Reader *p_reader, unsigned char *p_value)
+{
+    const unsigned char *l_bytes = get(p_reader, 1);
+    if (l_bytes == NULL)
+    {
+        return 0;
+    }
+    *p_value = *l_bytes;
+    return 1;
+}
+
+static int getCount(Reader *p_reader, unsigned int *p_value)
+{
+    const void *l_bytes = get(p_reader, sizeof(*p_value));
+    if (l_bytes == NULL)
+    {
+        return 0;
+    }
+    memcpy(p_value, l_bytes, sizeof(*p_value));
+    return 1;
+}
+
+static int getWord(Reader *p_reader, void *p_value)
+{
+    const void *l_bytes = get(p_reader, 8);
+    if (l_bytes == NULL)
+    {
+        return 0;
+    }
+    memcpy(p_value, l_bytes, 8);
+    return 1;
+}
+
+static const char *getString(Reader *p_reader)
+{
+    unsigned int l_length;
+    const char *l_value;
+
+    if (!getCount(p_reader, &l_length) || (size_t) l_length + 1 < l_length
+        || (l_value = get(p_reader, (size_t) l_length + 1)) == NULL || l_value[l_length] != '\0')
+    {
+        return NULL;
+    }
+    return l_value;
+}
+
+static int readArray(Reader *p_reader, ATP_Array *p_array)
+{
+    unsigned int i;
+    unsigned int l_length;
+    unsigned char l_packed;
+    const void *l_block;
+
+    if (!getByte(p_reader, &l_packed) || !getCount(p_reader, &l_length))
+    {
+        return 0;
+    }
+    if (l_packed != e_ATP_ValueType_none)
+    {
+        size_t l_size = (l_packed == e_ATP_ValueType_bool ? 1 : 8);
+
+        if ((size_t) l_length > (p_reader->m_length - p_reader->m_offset) / l_size
+            || !ATP_arrayPack(p_array, (ATP_ValueType) l_packed))
+        {
+            return 0;
+        }
+        l_block = get(p_reader, l_length * l_size);
+        ATP_arrayResize(p_array, l_length);
+        if (l_packed == e_ATP_ValueType_uint)
+        {
+            unsigned long long *l_values;
+            ATP_arrayGetUintSpan(p_array, &l_values, &l_length);
+            memcpy(l_values, l_block, l_length * l_size);
+        }
+        else if (l_packed == e_ATP_ValueType_int)
+        {
+            signed long long *l_values;
+            ATP_arrayGetIntSpan(p_array, &l_values, &l_length);
+            memcpy(l_values, l_block, l_length * l_size);
+        }
+        else if (l_packed == e_ATP_ValueType_double)
+        {
+            double *l_values;
+            ATP_arrayGetDoubleSpan(p_array, &l_values, &l_length);
+            memcpy(l_values, l_block, l_length * l_size);
+        }
+        else
+        {
+            unsigned char *l_values;
+            ATP_arrayGetBoolSpan(p_array, &l_values, &l_length);
+            memcpy(l_values, l_block, l_length * l_size);
+        }
+        return 1;
+    }
+
+    for (i = 0; i < l_length; ++i)
+    {
+        unsigned char l_type;
+        int l_result = 0;
+
+        if (!getByte(p_reader, &l_type))
+        {
+            return 0;
+        }
+        switch (l_type)
+        {
+            case e_ATP_ValueType_none:
+                {
+                    ATP_Value l_value;
+                    ATP_valueInit(&l_value);
+                    l_result = ATP_arrayPut(p_array, i, &l_value);
+                }
+                break;
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = getString(p_reader);
+                    l_result = (l_value != NULL && ATP_arraySetString(p_array, i, l_value));
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_arraySetUint(p_array, i, l_value));
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_arraySetInt(p_array, i, l_value));
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_arraySetDouble(p_array, i, l_value));
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    unsigned char l_value;
+                    l_result = (getByte(p_reader, &l_value) && ATP_arraySetBool(p_array, i, l_value));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    ATP_Dictionary l_value;
+                    ATP_dictionaryInit(&l_value);
+                    l_result = readDictionary(p_reader, &l_value);
+                    if (l_result)
+                    {
+                        l_result = ATP_arraySetDict(p_array, i, l_value);
+                    }
+                    else
+                    {
+                        ATP_dictionaryDestroy(&l_value);
+                    }
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    ATP_Array l_value;
+                    ATP_arrayInit(&l_value);
+                    l_result = readArray(p_reader, &l_value);
+                    if (l_result)
+                    {
+                        l_result = ATP_arraySetArray(p_array, i, l_value);
+                    }
+                    else
+                    {
+                        ATP_arrayDestroy(&l_value);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if (!l_result)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int readDictionary(Reader *p_reader, ATP_Dictionary *p_dict)
+{
+    unsigned int i;
+    unsigned int l_count;
+
+    if (!getCount(p_reader, &l_count))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < l_count; ++i)
+    {
+        unsigned char l_type;
+        int l_result = 0;
+        const char *l_key = getString(p_reader);
+
+        if (l_key == NULL || !getByte(p_reader, &l_type))
+        {
+            return 0;
+        }
+        switch (l_type)
+        {
+            case e_ATP_ValueType_none:
+                {
+                    ATP_Value l_value;
+                    ATP_valueInit(&l_value);
+                    l_result = ATP_dictionaryPut(p_dict, l_key, &l_value);
+                }
+                break;
+            case e_ATP_ValueType_string:
+                {
+                    const char *l_value = getString(p_reader);
+                    l_result = (l_value != NULL && ATP_dictionarySetString(p_dict, l_key, l_value));
+                }
+                break;
+            case e_ATP_ValueType_uint:
+                {
+                    unsigned long long l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_dictionarySetUint(p_dict, l_key, l_value));
+                }
+                break;
+            case e_ATP_ValueType_int:
+                {
+                    signed long long l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_dictionarySetInt(p_dict, l_key, l_value));
+                }
+                break;
+            case e_ATP_ValueType_double:
+                {
+                    double l_value;
+                    l_result = (getWord(p_reader, &l_value) && ATP_dictionarySetDouble(p_dict, l_key, l_value));
+                }
+                break;
+            case e_ATP_ValueType_bool:
+                {
+                    unsigned char l_value;
+                    l_result = (getByte(p_reader, &l_value) && ATP_dictionarySetBool(p_dict, l_key, l_value));
+                }
+                break;
+            case e_ATP_ValueType_dict:
+                {
+                    ATP_Dictionary l_value;
+                    ATP_dictionaryInit(&l_value);
+                    l_result = readDictionary(p_reader, &l_value);
+                    if (l_result)
+                    {
+                        l_result = ATP_dictionarySetDict(p_dict, l_key, l_value);
+                    }
+                    else
+                    {
+                        ATP_dictionaryDestroy(&l_value);
+                    }
+                }
+                break;
+            case e_ATP_ValueType_array:
+                {
+                    ATP_Array l_value;
+                    ATP_arrayInit(&l_value);
+                    l_result = readArray(p_reader, &l_value);
+                    if (l_result)
+                    {
+                        l_result = ATP_dictionarySetArray(p_dict, l_key, l_value);
+                    }
+                    else
+                    {
+                        ATP_arrayDestroy(&l_value);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if (!l_result)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void entryPath(char *p_path, size_t p_size, const ATP_CacheKey *p_key)
+{
+    unsigned long long l_digest[2];
+    digest(p_key, l_digest);
+    snprintf(p_path, p_size, "%s/%016llx%016llx" c_extension, gs_dir, l_digest[0], l_digest[1]);
+}
+
+#if _WIN32
+int ATP_cacheSetDirectory(const char *p_dir, unsigned long long p_limit)
+{
+    // TODO: Windows implementation
+    (void) p_limit;
+    if (p_dir != NULL)
+    {
+        ERR("Caching outputs is not supported on this platform\n");
+        return 0;
+    }
+    return 1;
+}
+
+static void markUsed(const char *p_path)
+{
+    (void) p_path;
+}
+
+static void removeLeastRecentlyUsed(void)
+{
+}
+#else // NOTE: assume POSIX for now
+int ATP_cacheSetDirectory(const char *p_dir, unsigned long long p_limit)
+{
+    if (gs_dir != NULL)
+    {
+        Mutex_destroy(&gs_mutex);
+        free(gs_dir);
+        gs_dir = NULL;
+    }
+    if (p_dir == NULL)
+    {
+        return 1;
+    }
+
+    if (mkdir(p_dir, 0777) != 0 && errno != EEXIST)
+    {
+        ERR("Unable to create cache directory '%s': %s\n", p_dir, strerror(errno));
+        return 0;
+    }
+    gs_dir = strdup(p_dir);
+    if (gs_dir == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    gs_limit = p_limit * 1024 * 1024;
+    gs_size = 0;
+    gs_sizeKnown = 0;
+    Mutex_init(&gs_mutex);
+    return 1;
+}
+
+static void markUsed(const char *p_path)
+{
+    utime(p_path, NULL);
+}
+
+static int compareUse(const void *p_first, const void *p_second)
+{
+    const CacheFile *l_first = p_first;
+    const CacheFile *l_second = p_second;
+    return (l_first->m_used < l_second->m_used ? -1 : (l_first->m_used > l_second->m_used ? 1 : 0));
+}
+
+// measure the files in the directory, removing the least recently used while they take up more than the limit; called with
+// the mutex held
+static void removeLeastRecentlyUsed(void)
+{
+    unsigned int i;
+    unsigned int l_count = 0;
+    unsigned int l_capacity = 0;
+    CacheFile *l_files = NULL;
+    struct dirent *l_entry;
+    char l_path[2048];
+    DIR *l_dir = opendir(gs_dir);
+    if (l_dir == NULL)
+    {
+        return;
+    }
+
+    gs_size = 0;
+    while ((l_entry = readdir(l_dir)) != NULL)
+    {
+        struct stat l_stat;
+        size_t l_length = strlen(l_entry->d_name);
+        if (l_length <= strlen(c_extension) || l_length >= sizeof(l_files->m_name)
+            || strcmp(l_entry->d_name + l_length - strlen(c_extension), c_extension) != 0)
+        {
+            continue;
+        }
+
+        snprintf(l_path, sizeof(l_path), "%s/%s", gs_dir, l_entry->d_name);
+        if (stat(l_path, &l_stat) != 0)
+        {
+            continue;
+        }
+        if (l_count == l_capacity)
+        {
+            l_capacity = (l_capacity > 0 ? l_capacity * 2 : 64);
+            l_files = realloc(l_files, l_capacity * sizeof(CacheFile));
+            if (l_files == NULL)
+            {
+                PERR();
+                exit(EX_OSERR);
+            }
+        }
+        strcpy(l_files[l_count].m_name, l_entry->d_name);
+        l_files[l_count].m_used = l_stat.st_mtime;
+        l_files[l_count].m_size = (unsigned long long) l_stat.st_size;
+        gs_size += l_files[l_count].m_size;
+        ++l_count;
+    }
+    closedir(l_dir);
+    gs_sizeKnown = 1;
+
+    if (gs_size > gs_limit)
+    {
+        qsort(l_files, l_count, sizeof(CacheFile), &compareUse);
+        for (i = 0; i < l_count && gs_size > gs_limit; ++i)
+        {
+            snprintf(l_path, sizeof(l_path), "%s/%s", gs_dir, l_files[i].m_name);
+            if (unlink(l_path) == 0)
+            {
+                DBG("evicted %s from the cache\n", l_files[i].m_name);
+                gs_size -= l_files[i].m_size;
+            }
+        }
+    }
+    free(l_files);
+}
+#endif
+
+int ATP_cacheEnabled(void)
+{
+    return (gs_dir != NULL);
+}
+
+int ATP_cacheLoad(const ATP_CacheKey *p_key, ATP_Dictionary *p_output)
+{
+    char l_path[2048];
+    unsigned char *l_data;
+    long l_length;
+    unsigned char l_frozen;
+    Reader l_reader;
+    int l_result;
+    FILE *l_file;
+
+    entryPath(l_path, sizeof(l_path), p_key);
+    l_file = fopen(l_path, "rb");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+
+    // read the whole file at once, and decode it from memory
+    if (fseek(l_file, 0, SEEK_END) != 0 || (l_length = ftell(l_file)) < 0 || fseek(l_file, 0, SEEK_SET) != 0)
+    {
+        fclose(l_file);
+        return 0;
+    }
+    l_data = malloc(l_length > 0 ? (size_t) l_length : 1);
+    if (l_data == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_result = (fread(l_data, 1, (size_t) l_length, l_file) == (size_t) l_length);
+    fclose(l_file);
+
+    l_reader.m_data = l_data;
+    l_reader.m_length = (size_t) l_length;
+    l_reader.m_offset = 0;
+    if (l_result)
+    {
+        const void *l_magic = get(&l_reader, 4);
+        unsigned int l_version;
+
+        l_result = (l_magic != NULL && memcmp(l_magic, c_magic, 4) == 0 && getCount(&l_reader, &l_version)
+                    && l_version == c_formatVersion && getByte(&l_reader, &l_frozen) && readDictionary(&l_reader, p_output)
+                    && l_reader.m_offset == l_reader.m_length);
+    }
+    free(l_data);
+
+    if (!l_result)
+    {
+        // a damaged entry would otherwise be found again by every run
+        DBG("discarding damaged cache entry %s\n", l_path);
+        remove(l_path);
+        ATP_dictionaryDestroy(p_output);
+        ATP_dictionaryInit(p_output);
+        return 0;
+    }
+
+    if (l_frozen)
+    {
+        ATP_dictionaryFreeze(p_output);
+    }
+    markUsed(l_path);
+    return 1;
+}
+
+void ATP_cacheStore(const ATP_CacheKey *p_key, const ATP_Dictionary *p_output)
+{
+    char l_path[2048];
+    char l_temp[2048];
+    unsigned int l_version = c_formatVersion;
+    Buffer l_buffer = { NULL, 0, 0 };
+    FILE *l_file;
+    int l_result;
+    int l_length;
+
+    put(&l_buffer, c_magic, 4);
+    putCount(&l_buffer, l_version);
+    putByte(&l_buffer, (unsigned char) ATP_dictionaryIsFrozen(p_output));
+    writeDictionary(&l_buffer, p_output);
+
+    // write to a file of its own first, so that no other run can see the entry before it is complete
+    entryPath(l_path, sizeof(l_path), p_key);
+#if _WIN32
+    l_length = snprintf(l_temp, sizeof(l_temp), "%s.%lu.%ld.tmp", l_path, (unsigned long) GetCurrentProcessId(),
+                        (long) ATOMIC_INCREMENT(gs_tempCount));
+#else // NOTE: assume POSIX for now
+    l_length = snprintf(l_temp, sizeof(l_temp), "%s.%ld.%ld.tmp", l_path, (long) getpid(),
+                        (long) ATOMIC_INCREMENT(gs_tempCount));
+#endif
+    // a name cut short could be renamed over some other file, so the output is just not cached
+    if (l_length < 0 || (size_t) l_length >= sizeof(l_temp))
+    {
+        DBG("cache directory path too long to store %s\n", l_path);
+        free(l_buffer.m_data);
+        return;
+    }
+    l_file = fopen(l_temp, "wb");
+    if (l_file == NULL)
+    {
+        free(l_buffer.m_data);
+        return;
+    }
+    l_result = (fwrite(l_buffer.m_data, 1, l_buffer.m_length, l_file) == l_buffer.m_length);
+    l_result = (fclose(l_file) == 0) && l_result;
+    free(l_buffer.m_data);
+    if (!l_result || rename(l_temp, l_path) != 0)
+    {
+        remove(l_temp);
+        return;
+    }
+
+    Mutex_lock(&gs_mutex);
+    gs_size += l_buffer.m_length;
+    if (!gs_sizeKnown || gs_size > gs_limit)
+    {
+        removeLeastRecentlyUsed();
+    }
+    Mutex_unlock(&gs_mutex);
+}
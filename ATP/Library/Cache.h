@@ -0,0 +1,144 @@
+/* File: Cache.h
+A cache of processor outputs on disk, addressed by the content of everything that went into producing them.
+
+While a cache directory is set, a processor that declares <c_ATP_ProcessorFlag_cacheable> or <c_ATP_ProcessorFlag_pure> is
+not run if an earlier run stored its output for the same inputs.  Each output is stored under a 128 bit key hashing the name
+of the processor, its parameters, its input dictionary (or only the entries listed in <ATP_ProcessorInterface.m_reads>), and
+the contents of the files it lists through <ATP_ProcessorInterface.files>.  Outputs are written in a compact binary form that
+loads without any parsing beyond a single pass over the file, with packed arrays copied in one piece.
+
+Once the files in the directory take up more than the size limit, the least recently used are removed, using the modification
+time of each file, which is updated whenever it is loaded, to judge when it was last used.  Several processes may share a
+directory, since each output is written to a file of its own and renamed into place once complete.
+*/
+#ifndef _ATP_LIBRARY_CACHE_H_
+#define _ATP_LIBRARY_CACHE_H_
+
+#include "Export.h"
+#include "Dictionary.h"
+#include "Array.h"
+
+/* Constant: c_ATP_Cache_defaultLimit
+The size limit of a cache directory in megabytes when none is given.
+*/
+#define c_ATP_Cache_defaultLimit    256
+
+/* Structure: ATP_CacheKey
+The key of a cached output, built up by the ATP_cacheKeyAdd functions.
+*/
+typedef struct ATP_CacheKey
+{
+    /* Variable: m_state
+    The state of the two independent hashes making up the key.
+    */
+    unsigned long long m_state[2];
+    /* Variable: m_length
+    The number of bytes hashed so far.
+    */
+    unsigned long long m_length;
+} ATP_CacheKey;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_cacheSetDirectory
+Set the directory to cache outputs in, creating it if necessary, and the size it may grow to.
+
+Parameters:
+    p_dir   - The path of the directory, or NULL to stop caching.
+    p_limit - The size limit in megabytes.
+
+Returns:
+    1 on success, 0 (after printing an error) if the directory could not be created, in which case nothing is cached.
+*/
+EXPORT int ATP_cacheSetDirectory(const char *p_dir, unsigned long long p_limit);
+/* Function: ATP_cacheEnabled
+Determine whether outputs are being cached.
+
+Returns:
+    1 if a cache directory is set, 0 if it is not.
+*/
+EXPORT int ATP_cacheEnabled(void);
+
+/* Function: ATP_cacheKeyInit
+Initialize an empty key.
+
+Parameters:
+    p_key - The key.
+*/
+EXPORT void ATP_cacheKeyInit(ATP_CacheKey *p_key);
+/* Function: ATP_cacheKeyAddString
+Add a string to a key.  Strings added one after another are kept apart, so that "ab" followed by "c" differs from "a" followed
+by "bc".
+
+Parameters:
+    p_key    - The key.
+    p_string - The string.
+*/
+EXPORT void ATP_cacheKeyAddString(ATP_CacheKey *p_key, const char *p_string);
+/* Function: ATP_cacheKeyAddArray
+Add an array and everything nested in it to a key.
+
+Parameters:
+    p_key   - The key.
+    p_array - The array handle.
+*/
+EXPORT void ATP_cacheKeyAddArray(ATP_CacheKey *p_key, const ATP_Array *p_array);
+/* Function: ATP_cacheKeyAddDictionary
+Add a dictionary and everything nested in it to a key.  The order of the entries of a dictionary does not affect the key.
+
+Parameters:
+    p_key  - The key.
+    p_dict - The dictionary handle.
+*/
+EXPORT void ATP_cacheKeyAddDictionary(ATP_CacheKey *p_key, const ATP_Dictionary *p_dict);
+/* Function: ATP_cacheKeyAddDictionaryKeys
+Add only the listed entries of a dictionary, and everything nested in them, to a key.  Listed keys that the dictionary does
+not have are skipped, so the key reflects their absence.
+
+Parameters:
+    p_key  - The key.
+    p_dict - The dictionary handle.
+    p_keys - The keys of the entries to add, as a list ending in NULL.
+*/
+EXPORT void ATP_cacheKeyAddDictionaryKeys(ATP_CacheKey *p_key, const ATP_Dictionary *p_dict, const char *const *p_keys);
+/* Function: ATP_cacheKeyAddFile
+Add the path and contents of a file to a key.
+
+Parameters:
+    p_key  - The key.
+    p_path - The path of the file.
+
+Returns:
+    1 on success, 0 if the file could not be read, in which case nothing should be cached under the key.
+*/
+EXPORT int ATP_cacheKeyAddFile(ATP_CacheKey *p_key, const char *p_path);
+
+/* Function: ATP_cacheLoad
+Load the output stored under a key.
+
+Parameters:
+    p_key    - The key.
+    p_output - An empty dictionary to load the output into.
+
+Returns:
+    1 if an output was found and loaded, 0 if there is none, in which case the dictionary is left empty.
+*/
+EXPORT int ATP_cacheLoad(const ATP_CacheKey *p_key, ATP_Dictionary *p_output);
+/* Function: ATP_cacheStore
+Store an output under a key, removing the least recently used outputs if the cache grows beyond its size limit.  Failing to
+store an output is not an error, so nothing is reported.
+
+Parameters:
+    p_key    - The key.
+    p_output - The output dictionary.
+*/
+EXPORT void ATP_cacheStore(const ATP_CacheKey *p_key, const ATP_Dictionary *p_output);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_CACHE_H_ */
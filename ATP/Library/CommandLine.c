@@ -3,8 +3,10 @@
 #include "Log.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #define c_procDelimiter '@'
+#define c_optionPrefix  "--"
 
 int ATP_commandLineGet(int argc, char **argv, unsigned int p_proc, char **p_name, ATP_Array *p_parameters)
 {
@@ -44,3 +46,38 @@ int ATP_commandLineGet(int argc, char **argv, unsigned int p_proc, char **p_name
 
     return 0;
 }
+
+int ATP_commandLineGetOption(int argc, char **argv, const char *p_name, const char **p_value)
+{
+    int i;
+    size_t l_length = strlen(p_name);
+
+    for (i = 1; i < argc && argv[i][0] != c_procDelimiter; ++i)
+    {
+        const char *l_arg = argv[i];
+        if (strncmp(l_arg, c_optionPrefix, sizeof(c_optionPrefix) - 1) != 0)
+        {
+            continue;
+        }
+
+        l_arg += sizeof(c_optionPrefix) - 1;
+        if (strncmp(l_arg, p_name, l_length) == 0)
+        {
+            if (l_arg[l_length] == '=')
+            {
+                *p_value = &l_arg[l_length + 1];
+                return 1;
+            }
+            else if (l_arg[l_length] == '\0')
+            {
+                // the value may follow as a separate parameter, as long as it is not another option or a processor
+                int l_hasValue = (i + 1 < argc && argv[i + 1][0] != c_procDelimiter
+                                  && strncmp(argv[i + 1], c_optionPrefix, sizeof(c_optionPrefix) - 1) != 0);
+                *p_value = (l_hasValue ? argv[i + 1] : NULL);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
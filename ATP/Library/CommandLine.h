@@ -26,6 +26,20 @@ Returns:
     1 if parsing was successful, 0 if it was not.
 */
 EXPORT int ATP_commandLineGet(int argc, char **argv, unsigned int p_proc, char **p_name, ATP_Array *p_parameters);
+/* Function: ATP_commandLineGetOption
+Get the value of a global option.  Global options are only recognized before the first processor, and are given either as
+--name=value or as --name followed by the value in the next parameter.
+
+Parameters:
+    argc    - The number of entries in argv.
+    argv    - The array of command line parameters.
+    p_name  - The name of the option, without the leading dashes.
+    p_value - A pointer to set to the value of the option, or to NULL if the option was given without a value.
+
+Returns:
+    1 if the option was given, 0 if it was not.
+*/
+EXPORT int ATP_commandLineGetOption(int argc, char **argv, const char *p_name, const char **p_value);
 
 #ifdef __cplusplus
 }   /* extern "C" */
@@ -2,125 +2,1453 @@
 #include "Log.h"
 #include "Exit.h"
 #include "Value.inc"
+#include "Atomic.inc"
 
-#include "ATP/ThirdParty/UT/uthash.h"
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long long mixHash(unsigned long long p_hash)
+{
+    p_hash ^= p_hash >> 33;
+    p_hash *= 0xff51afd7ed558ccdULL;
+    p_hash ^= p_hash >> 33;
+    p_hash *= 0xc4ceb9fe1a85ec53ULL;
+    p_hash ^= p_hash >> 33;
+    return p_hash;
+}
+
+// every engine indexes keys by this hash, so that a key hashed once up front (see <Value_hashKey>) can be looked up in any
+// dictionary
+static unsigned long long hashKey(const char *p_key, size_t *p_length)
+{
+    // 64 bit FNV-1a, determining the length of the key on the same pass, then avalanched since both the low and high bits are
+    // used
+    const unsigned char *l_char = (const unsigned char *) p_key;
+    unsigned long long l_hash = 14695981039346656037ULL;
+    while (*l_char != '\0')
+    {
+        l_hash ^= *l_char++;
+        l_hash *= 1099511628211ULL;
+    }
+    *p_length = l_char - (const unsigned char *) p_key;
+    return mixHash(l_hash);
+}
+
+#ifdef ATTR_FLAT_DICTIONARY
+
+/*
+The flat engine indexes entries with an open addressing table in the style of a Swiss table: a control byte per slot holds 7 bits
+of the key's hash (or marks the slot empty or deleted), and the control bytes are scanned a group of 16 at a time.  Entries are
+additionally kept on a doubly linked list, which preserves insertion order for iteration.
+*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define USE_SSE2
+#endif
+
+#define c_groupSize     16
+#define c_ctrlEmpty     ((signed char) -128)
+#define c_ctrlDeleted   ((signed char) -2)
+
+// entries are allocated with exactly enough room after the header for their key
+typedef struct ATP_DictionaryEntry
+{
+    Value m_value;
+    struct ATP_DictionaryImpl *m_owner;
+    struct ATP_DictionaryEntry *m_next;
+    struct ATP_DictionaryEntry *m_prev;
+    unsigned int m_hash;
+    unsigned int m_keyLength;
+    char m_key[];
+} ATP_DictionaryEntry;
 
 typedef struct ATP_DictionaryImpl
 {
-    char m_key[c_ATP_Dictionary_keySize + 1];
+    ATP_DictionaryEntry *m_first;
+    ATP_DictionaryEntry *m_last;
+    unsigned int m_count;
+    unsigned int m_used;
+    unsigned int m_capacity;
+    signed char *m_ctrl;
+    ATP_DictionaryEntry **m_slots;
+    const struct FrozenIndex *m_frozen;
+    ATP_Arena *m_arena;
+    AtomicCount m_refCount;
+} ATP_DictionaryImpl;
+
+#define FIRST(impl)     ((impl)->m_first)
+#define NEXT(entry)     ((entry)->m_next)
+
+static unsigned int groupMatch(const signed char *p_group, signed char p_ctrl)
+{
+#ifdef USE_SSE2
+    __m128i l_group = _mm_loadu_si128((const __m128i *) p_group);
+    return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(p_ctrl), l_group));
+#else
+    unsigned int i;
+    unsigned int l_mask = 0;
+    for (i = 0; i < c_groupSize; ++i)
+    {
+        if (p_group[i] == p_ctrl)
+        {
+            l_mask |= (1u << i);
+        }
+    }
+    return l_mask;
+#endif
+}
+
+static unsigned int groupMatchFree(const signed char *p_group)
+{
+    // empty and deleted slots are the only ones with the high bit set
+#ifdef USE_SSE2
+    return (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) p_group));
+#else
+    unsigned int i;
+    unsigned int l_mask = 0;
+    for (i = 0; i < c_groupSize; ++i)
+    {
+        if (p_group[i] < 0)
+        {
+            l_mask |= (1u << i);
+        }
+    }
+    return l_mask;
+#endif
+}
+
+static unsigned int lowestBit(unsigned int p_mask)
+{
+#ifdef __GNUC__
+    return (unsigned int) __builtin_ctz(p_mask);
+#else
+    unsigned int l_bit = 0;
+    while ((p_mask & 1) == 0)
+    {
+        p_mask >>= 1;
+        ++l_bit;
+    }
+    return l_bit;
+#endif
+}
+
+static ATP_DictionaryEntry *findHashed(const ATP_DictionaryImpl *p_impl, const char *p_key, size_t p_length, unsigned int p_hash)
+{
+    unsigned int l_mask;
+    unsigned int l_group;
+    unsigned int l_step = 0;
+
+    if (p_impl->m_capacity == 0)
+    {
+        return NULL;
+    }
+
+    l_mask = p_impl->m_capacity / c_groupSize - 1;
+    l_group = (p_hash >> 7) & l_mask;
+    for (;;)
+    {
+        const signed char *l_ctrl = p_impl->m_ctrl + l_group * c_groupSize;
+        unsigned int l_matches = groupMatch(l_ctrl, (signed char) (p_hash & 0x7f));
+        while (l_matches != 0)
+        {
+            ATP_DictionaryEntry *l_entry = p_impl->m_slots[l_group * c_groupSize + lowestBit(l_matches)];
+            if (l_entry->m_hash == p_hash && l_entry->m_keyLength == p_length && memcmp(l_entry->m_key, p_key, p_length) == 0)
+            {
+                return l_entry;
+            }
+            l_matches &= l_matches - 1;
+        }
+
+        if (groupMatch(l_ctrl, c_ctrlEmpty) != 0)
+        {
+            return NULL;
+        }
+        l_group = (l_group + ++l_step) & l_mask;
+    }
+}
+
+static void tableInsert(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    unsigned int l_mask = p_impl->m_capacity / c_groupSize - 1;
+    unsigned int l_group = (p_entry->m_hash >> 7) & l_mask;
+    unsigned int l_step = 0;
+    for (;;)
+    {
+        signed char *l_ctrl = p_impl->m_ctrl + l_group * c_groupSize;
+        unsigned int l_free = groupMatchFree(l_ctrl);
+        if (l_free != 0)
+        {
+            unsigned int l_slot = lowestBit(l_free);
+            if (l_ctrl[l_slot] == c_ctrlEmpty)
+            {
+                ++p_impl->m_used;
+            }
+            l_ctrl[l_slot] = (signed char) (p_entry->m_hash & 0x7f);
+            p_impl->m_slots[l_group * c_groupSize + l_slot] = p_entry;
+            return;
+        }
+        l_group = (l_group + ++l_step) & l_mask;
+    }
+}
+
+static void rehash(ATP_DictionaryImpl *p_impl)
+{
+    ATP_DictionaryEntry *it;
+    void *l_old = p_impl->m_ctrl;
+    unsigned int l_capacity = c_groupSize;
+    size_t l_size;
+
+    // size the table so that it is under half full afterwards
+    while ((p_impl->m_count + 1) * 16 > l_capacity * 7)
+    {
+        l_capacity *= 2;
+    }
+
+    // the control bytes and slots share a single block
+    l_size = l_capacity * (sizeof(signed char) + sizeof(ATP_DictionaryEntry *));
+    if (p_impl->m_arena != NULL)
+    {
+        p_impl->m_ctrl = ATP_arenaAlloc(p_impl->m_arena, l_size);
+    }
+    else
+    {
+        p_impl->m_ctrl = malloc(l_size);
+        if (p_impl->m_ctrl == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+    memset(p_impl->m_ctrl, c_ctrlEmpty, l_capacity);
+    p_impl->m_slots = (ATP_DictionaryEntry **) (p_impl->m_ctrl + l_capacity);
+    p_impl->m_capacity = l_capacity;
+    p_impl->m_used = 0;
+
+    for (it = p_impl->m_first; it != NULL; it = it->m_next)
+    {
+        tableInsert(p_impl, it);
+    }
+
+    if (p_impl->m_arena == NULL)
+    {
+        free(l_old);
+    }
+}
+
+static ATP_DictionaryEntry *indexFind(const ATP_DictionaryImpl *p_impl, const ValueKey *p_key)
+{
+    // the low bits of the hash select the control byte and the next ones the group
+    return findHashed(p_impl, p_key->m_key, p_key->m_length, (unsigned int) p_key->m_hash);
+}
+
+static void indexInsert(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    size_t l_length;
+    p_entry->m_hash = (unsigned int) hashKey(p_entry->m_key, &l_length);
+
+    p_entry->m_next = NULL;
+    p_entry->m_prev = p_impl->m_last;
+    if (p_impl->m_last != NULL)
+    {
+        p_impl->m_last->m_next = p_entry;
+    }
+    else
+    {
+        p_impl->m_first = p_entry;
+    }
+    p_impl->m_last = p_entry;
+    ++p_impl->m_count;
+
+    // keep at least one eighth of the slots empty, so that probing always terminates quickly
+    if ((p_impl->m_used + 1) * 8 > p_impl->m_capacity * 7)
+    {
+        rehash(p_impl);
+    }
+    else
+    {
+        tableInsert(p_impl, p_entry);
+    }
+}
+
+static void indexRemove(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    unsigned int l_mask = p_impl->m_capacity / c_groupSize - 1;
+    unsigned int l_group = (p_entry->m_hash >> 7) & l_mask;
+    unsigned int l_step = 0;
+    signed char *l_ctrl = NULL;
+    unsigned int l_slot = 0;
+
+    while (l_ctrl == NULL)
+    {
+        unsigned int l_matches = groupMatch(p_impl->m_ctrl + l_group * c_groupSize, (signed char) (p_entry->m_hash & 0x7f));
+        while (l_matches != 0)
+        {
+            l_slot = lowestBit(l_matches);
+            if (p_impl->m_slots[l_group * c_groupSize + l_slot] == p_entry)
+            {
+                l_ctrl = p_impl->m_ctrl + l_group * c_groupSize;
+                break;
+            }
+            l_matches &= l_matches - 1;
+        }
+        l_group = (l_group + ++l_step) & l_mask;
+    }
+
+    // a probe for any key stops at a group with an empty slot, so the slot can be emptied outright if there is one in this
+    // group; otherwise it has to be left as a tombstone
+    if (groupMatch(l_ctrl, c_ctrlEmpty) != 0)
+    {
+        l_ctrl[l_slot] = c_ctrlEmpty;
+        --p_impl->m_used;
+    }
+    else
+    {
+        l_ctrl[l_slot] = c_ctrlDeleted;
+    }
+
+    if (p_entry->m_prev != NULL)
+    {
+        p_entry->m_prev->m_next = p_entry->m_next;
+    }
+    else
+    {
+        p_impl->m_first = p_entry->m_next;
+    }
+    if (p_entry->m_next != NULL)
+    {
+        p_entry->m_next->m_prev = p_entry->m_prev;
+    }
+    else
+    {
+        p_impl->m_last = p_entry->m_prev;
+    }
+    --p_impl->m_count;
+}
+
+static void indexClear(ATP_DictionaryImpl *p_impl)
+{
+    if (p_impl->m_arena == NULL)
+    {
+        free(p_impl->m_ctrl);
+    }
+
+    p_impl->m_first = NULL;
+    p_impl->m_last = NULL;
+    p_impl->m_count = 0;
+    p_impl->m_used = 0;
+    p_impl->m_capacity = 0;
+    p_impl->m_ctrl = NULL;
+    p_impl->m_slots = NULL;
+}
+
+static unsigned int indexCount(const ATP_DictionaryImpl *p_impl)
+{
+    return p_impl->m_count;
+}
+
+static void indexLinkFrozen(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_prev, ATP_DictionaryEntry *p_entry)
+{
+    p_entry->m_hash = 0;
+    p_entry->m_next = NULL;
+    p_entry->m_prev = p_prev;
+    if (p_prev != NULL)
+    {
+        p_prev->m_next = p_entry;
+    }
+    else
+    {
+        p_impl->m_first = p_entry;
+    }
+    p_impl->m_last = p_entry;
+    ++p_impl->m_count;
+}
+
+static void indexImageFrozen(ValueImage *p_image, ATP_DictionaryImpl *p_impl)
+{
+    ATP_DictionaryEntry *it = p_impl->m_first;
+    while (it != NULL)
+    {
+        ATP_DictionaryEntry *l_next = it->m_next;
+        Value_imagePointer(p_image, &it->m_next);
+        Value_imagePointer(p_image, &it->m_prev);
+        it = l_next;
+    }
+    Value_imagePointer(p_image, &p_impl->m_first);
+    Value_imagePointer(p_image, &p_impl->m_last);
+}
+
+// forward reference
+static int checkImageEntry(ValueImageCheck *p_check, const void *p_link, size_t p_owner, ATP_DictionaryEntry **p_entry);
+
+static int indexCheckFrozen(ValueImageCheck *p_check, const ATP_DictionaryImpl *p_impl, size_t p_offset, unsigned int *p_count)
+{
+    ATP_DictionaryEntry *it;
+    ATP_DictionaryEntry *l_prev = NULL;
+    ATP_DictionaryEntry *l_link;
+    const void *l_field = &p_impl->m_first;
+
+    // the table is never used by a frozen dictionary, which must not have one
+    if (p_impl->m_used != 0 || p_impl->m_capacity != 0 || p_impl->m_ctrl != NULL || p_impl->m_slots != NULL)
+    {
+        return Value_checkImageFail();
+    }
+
+    for (*p_count = 0; ; ++*p_count)
+    {
+        if (!checkImageEntry(p_check, l_field, p_offset, &it))
+        {
+            return 0;
+        }
+        else if (it == NULL)
+        {
+            break;
+        }
+        else if (!Value_checkImagePointer(p_check, &it->m_prev, 0, 1, &l_link))
+        {
+            return 0;
+        }
+        else if (l_link != l_prev)
+        {
+            return Value_checkImageFail();
+        }
+        l_prev = it;
+        l_field = &it->m_next;
+    }
+
+    if (!Value_checkImagePointer(p_check, &p_impl->m_last, 0, 1, &l_link))
+    {
+        return 0;
+    }
+    return ((l_link == l_prev && p_impl->m_count == *p_count) ? 1 : Value_checkImageFail());
+}
+
+#else
+
+// uthash allocates its bucket tables through these hooks, so every use of the HASH_ADD/HASH_DEL macros below must have an
+// l_hashArena variable in scope naming the arena of the dictionary being modified (or NULL for the heap)
+#define uthash_malloc(sz)       (l_hashArena != NULL ? ATP_arenaAlloc(l_hashArena, (sz)) : malloc(sz))
+#define uthash_free(ptr, sz)    do { if (l_hashArena == NULL) { free(ptr); } } while (0)
+
+// uthash buckets by the same hash as the other engines; every key handed to it is null terminated, so the length is not needed
+#define HASH_FUNCTION(key, keylen, num_bkts, hashv, bkt) \
+    do { size_t l_hashLength; (hashv) = (unsigned) hashKey((const char *) (key), &l_hashLength); \
+         HASH_TO_BKT(hashv, num_bkts, bkt); } while (0)
+
+#include "ATP/ThirdParty/UT/uthash.h"
+
+// entries are allocated with exactly enough room after the header for their key
+typedef struct ATP_DictionaryEntry
+{
     Value m_value;
+    struct ATP_DictionaryImpl *m_owner;
     UT_hash_handle hh;
+    unsigned int m_keyLength;
+    char m_key[];
+} ATP_DictionaryEntry;
+
+typedef struct ATP_DictionaryImpl
+{
+    ATP_DictionaryEntry *m_entries;
+    const struct FrozenIndex *m_frozen;
+    ATP_Arena *m_arena;
+    AtomicCount m_refCount;
 } ATP_DictionaryImpl;
 
-void ATP_dictionaryInit(ATP_Dictionary *p_dict)
+#define FIRST(impl)     ((impl)->m_entries)
+#define NEXT(entry)     ((ATP_DictionaryEntry *) (entry)->hh.next)
+
+static ATP_DictionaryEntry *indexFind(const ATP_DictionaryImpl *p_impl, const ValueKey *p_key)
+{
+    // this is HASH_FIND without hashing the key again
+    unsigned int l_bucket;
+    ATP_DictionaryEntry *l_entry = NULL;
+    if (p_impl->m_entries != NULL)
+    {
+        UT_hash_table *l_table = p_impl->m_entries->hh.tbl;
+        HASH_TO_BKT((unsigned) p_key->m_hash, l_table->num_buckets, l_bucket);
+        HASH_FIND_IN_BKT(l_table, hh, l_table->buckets[l_bucket], p_key->m_key, p_key->m_length, l_entry);
+    }
+    return l_entry;
+}
+
+static void indexInsert(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    ATP_Arena *l_hashArena = p_impl->m_arena;
+    HASH_ADD_KEYPTR(hh, p_impl->m_entries, p_entry->m_key, p_entry->m_keyLength, p_entry);
+}
+
+static void indexRemove(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    ATP_Arena *l_hashArena = p_impl->m_arena;
+    HASH_DEL(p_impl->m_entries, p_entry);
+}
+
+static void indexClear(ATP_DictionaryImpl *p_impl)
+{
+    ATP_Arena *l_hashArena = p_impl->m_arena;
+    HASH_CLEAR(hh, p_impl->m_entries);
+}
+
+static unsigned int indexCount(const ATP_DictionaryImpl *p_impl)
+{
+    return HASH_COUNT(p_impl->m_entries);
+}
+
+static void indexLinkFrozen(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_prev, ATP_DictionaryEntry *p_entry)
+{
+    // frozen dictionaries are never handed to uthash, which only needs the links in order to iterate
+    memset(&p_entry->hh, 0, sizeof(UT_hash_handle));
+    p_entry->hh.prev = p_prev;
+    if (p_prev != NULL)
+    {
+        p_prev->hh.next = p_entry;
+    }
+    else
+    {
+        p_impl->m_entries = p_entry;
+    }
+}
+
+static void indexImageFrozen(ValueImage *p_image, ATP_DictionaryImpl *p_impl)
+{
+    ATP_DictionaryEntry *it = p_impl->m_entries;
+    while (it != NULL)
+    {
+        ATP_DictionaryEntry *l_next = NEXT(it);
+        Value_imagePointer(p_image, &it->hh.next);
+        Value_imagePointer(p_image, &it->hh.prev);
+        it = l_next;
+    }
+    Value_imagePointer(p_image, &p_impl->m_entries);
+}
+
+// forward reference
+static int checkImageEntry(ValueImageCheck *p_check, const void *p_link, size_t p_owner, ATP_DictionaryEntry **p_entry);
+
+static int indexCheckFrozen(ValueImageCheck *p_check, const ATP_DictionaryImpl *p_impl, size_t p_offset, unsigned int *p_count)
+{
+    ATP_DictionaryEntry *it;
+    ATP_DictionaryEntry *l_prev = NULL;
+    ATP_DictionaryEntry *l_link;
+    const void *l_field = &p_impl->m_entries;
+
+    for (*p_count = 0; ; ++*p_count)
+    {
+        if (!checkImageEntry(p_check, l_field, p_offset, &it))
+        {
+            return 0;
+        }
+        else if (it == NULL)
+        {
+            return 1;
+        }
+        else if (!Value_checkImagePointer(p_check, &it->hh.prev, 0, 1, &l_link))
+        {
+            return 0;
+        }
+
+        // only the links are set, since frozen dictionaries are never handed to uthash
+        if (l_link != l_prev || it->hh.tbl != NULL || it->hh.hh_prev != NULL || it->hh.hh_next != NULL || it->hh.key != NULL
+            || it->hh.keylen != 0 || it->hh.hashv != 0)
+        {
+            return Value_checkImageFail();
+        }
+        l_prev = it;
+        l_field = &it->hh.next;
+    }
+}
+
+#endif
+
+/*
+Frozen dictionaries are indexed with a minimal perfect hash built by hashing and displacing: each key's hash selects a bucket,
+and each bucket has a seed chosen so that the seeded hashes of all of its keys land on distinct, unused slots.  A bucket with a
+single key just records the slot directly.  A lookup then always examines exactly one entry.
+*/
+#define c_frozenDirect      0x80000000u
+#define c_frozenMaxSeed     0x100000u
+
+typedef struct FrozenIndex
+{
+    unsigned int m_count;
+    // if this is 0 then no perfect hash could be found, and the slots are searched in order
+    unsigned int m_buckets;
+    unsigned int *m_seeds;
+    ATP_DictionaryEntry **m_slots;
+} FrozenIndex;
+
+// entries of a frozen dictionary are packed together, each padded for the alignment of the next
+#define FROZENENTRYSIZE(keyLength)  ((sizeof(ATP_DictionaryEntry) + (keyLength) + 1 + 7) & ~(size_t) 7)
+#define FROZENINDEXSIZE(count)      (sizeof(FrozenIndex) + (count) * sizeof(ATP_DictionaryEntry *) \
+                                     + ((count) + 1) / 2 * sizeof(unsigned int))
+
+static unsigned int frozenBucket(unsigned long long p_hash, unsigned int p_buckets)
+{
+    return (unsigned int) ((p_hash >> 32) % p_buckets);
+}
+
+static unsigned int frozenSlot(unsigned long long p_hash, unsigned int p_seed, unsigned int p_count)
+{
+    if (p_seed & c_frozenDirect)
+    {
+        return p_seed & ~c_frozenDirect;
+    }
+
+    return (unsigned int) (mixHash(p_hash + p_seed * 0x9e3779b97f4a7c15ULL) % p_count);
+}
+
+static ATP_DictionaryEntry *frozenFind(const FrozenIndex *p_index, const ValueKey *p_key)
+{
+    ATP_DictionaryEntry *l_entry;
+
+    if (p_index->m_count == 0)
+    {
+        return NULL;
+    }
+
+    if (p_index->m_buckets == 0)
+    {
+        unsigned int i;
+        for (i = 0; i < p_index->m_count; ++i)
+        {
+            l_entry = p_index->m_slots[i];
+            if (l_entry->m_keyLength == p_key->m_length && memcmp(l_entry->m_key, p_key->m_key, p_key->m_length) == 0)
+            {
+                return l_entry;
+            }
+        }
+        return NULL;
+    }
+
+    l_entry = p_index->m_slots[frozenSlot(p_key->m_hash, p_index->m_seeds[frozenBucket(p_key->m_hash, p_index->m_buckets)],
+                                          p_index->m_count)];
+    if (l_entry->m_keyLength == p_key->m_length && memcmp(l_entry->m_key, p_key->m_key, p_key->m_length) == 0)
+    {
+        return l_entry;
+    }
+    return NULL;
+}
+
+static int placeBucket(const FrozenIndex *p_index, const unsigned long long *p_hashes, const unsigned int *p_members,
+                       unsigned int p_size, unsigned char *p_used, unsigned int *p_free, unsigned int *p_slots,
+                       unsigned int *p_seed)
+{
+    unsigned int l_seed;
+    unsigned int i;
+    unsigned int j;
+
+    if (p_size == 1)
+    {
+        // any free slot will do for a lone key, so one is recorded directly; lone keys are placed last, so the slots before
+        // the search position stay used
+        while (p_used[*p_free])
+        {
+            ++*p_free;
+        }
+        p_slots[0] = *p_free;
+        p_used[*p_free] = 1;
+        *p_seed = *p_free | c_frozenDirect;
+        return 1;
+    }
+
+    for (l_seed = 0; l_seed < c_frozenMaxSeed; ++l_seed)
+    {
+        for (i = 0; i < p_size; ++i)
+        {
+            p_slots[i] = frozenSlot(p_hashes[p_members[i]], l_seed, p_index->m_count);
+            if (p_used[p_slots[i]])
+            {
+                break;
+            }
+            for (j = 0; j < i && p_slots[j] != p_slots[i]; ++j)
+            {
+            }
+            if (j < i)
+            {
+                break;
+            }
+        }
+
+        if (i == p_size)
+        {
+            for (i = 0; i < p_size; ++i)
+            {
+                p_used[p_slots[i]] = 1;
+            }
+            *p_seed = l_seed;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void buildFrozenIndex(FrozenIndex *p_index, ATP_DictionaryEntry *p_first, unsigned int p_count)
+{
+    ATP_DictionaryEntry *it;
+    unsigned int i;
+    unsigned int l_size;
+    unsigned int l_largest = 0;
+    unsigned int l_free = 0;
+    unsigned long long *l_hashes;
+    unsigned int *l_starts;
+    unsigned int *l_members;
+    unsigned int *l_slots;
+    unsigned char *l_used;
+    ATP_DictionaryEntry **l_entries;
+
+    p_index->m_count = p_count;
+    p_index->m_buckets = (p_count + 1) / 2;
+    if (p_count == 0)
+    {
+        return;
+    }
+
+    l_hashes = malloc(p_count * sizeof(unsigned long long));
+    l_starts = calloc(p_index->m_buckets + 1, sizeof(unsigned int));
+    l_members = malloc(p_count * sizeof(unsigned int));
+    l_slots = malloc(p_count * sizeof(unsigned int));
+    l_used = calloc(p_count, sizeof(unsigned char));
+    l_entries = malloc(p_count * sizeof(ATP_DictionaryEntry *));
+    if (l_hashes == NULL || l_starts == NULL || l_members == NULL || l_slots == NULL || l_used == NULL || l_entries == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // buckets that end up empty still have to lead a failed lookup to a valid slot
+    memset(p_index->m_seeds, 0, p_index->m_buckets * sizeof(unsigned int));
+
+    // group the keys by bucket
+    for (it = p_first, i = 0; it != NULL; it = NEXT(it), ++i)
+    {
+        size_t l_length;
+        l_entries[i] = it;
+        l_hashes[i] = hashKey(it->m_key, &l_length);
+        ++l_starts[frozenBucket(l_hashes[i], p_index->m_buckets) + 1];
+    }
+    for (i = 0; i < p_index->m_buckets; ++i)
+    {
+        if (l_starts[i + 1] > l_largest)
+        {
+            l_largest = l_starts[i + 1];
+        }
+        l_starts[i + 1] += l_starts[i];
+    }
+    for (i = 0; i < p_count; ++i)
+    {
+        unsigned int l_bucket = frozenBucket(l_hashes[i], p_index->m_buckets);
+        unsigned int l_offset;
+        for (l_offset = l_starts[l_bucket]; l_used[l_offset]; ++l_offset)
+        {
+        }
+        l_members[l_offset] = i;
+        l_used[l_offset] = 1;
+    }
+    memset(l_used, 0, p_count);
+
+    // place the largest buckets first, while there is the most room left
+    for (l_size = l_largest; l_size > 0 && p_index->m_buckets != 0; --l_size)
+    {
+        for (i = 0; i < p_index->m_buckets; ++i)
+        {
+            unsigned int j;
+            unsigned int l_start = l_starts[i];
+            if (l_starts[i + 1] - l_start != l_size)
+            {
+                continue;
+            }
+
+            if (!placeBucket(p_index, l_hashes, &l_members[l_start], l_size, l_used, &l_free, l_slots, &p_index->m_seeds[i]))
+            {
+                DBG("no perfect hash found for %u keys, falling back to a linear search\n", p_count);
+                p_index->m_buckets = 0;
+                memcpy(p_index->m_slots, l_entries, p_count * sizeof(ATP_DictionaryEntry *));
+                break;
+            }
+
+            for (j = 0; j < l_size; ++j)
+            {
+                p_index->m_slots[l_slots[j]] = l_entries[l_members[l_start + j]];
+            }
+        }
+    }
+
+    free(l_hashes);
+    free(l_starts);
+    free(l_members);
+    free(l_slots);
+    free(l_used);
+    free(l_entries);
+}
+
+static ATP_DictionaryImpl *createImpl(ATP_Arena *p_arena)
+{
+    ATP_DictionaryImpl *l_impl;
+    if (p_arena != NULL)
+    {
+        l_impl = ATP_arenaAlloc(p_arena, sizeof(ATP_DictionaryImpl));
+    }
+    else
+    {
+        l_impl = malloc(sizeof(ATP_DictionaryImpl));
+        if (l_impl == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+
+    memset(l_impl, 0, sizeof(ATP_DictionaryImpl));
+    l_impl->m_arena = p_arena;
+    l_impl->m_refCount = 1;
+    return l_impl;
+}
+
+void ATP_dictionaryInit(ATP_Dictionary *p_dict)
+{
+    // heap dictionaries are only allocated once the first entry is added
+    *p_dict = NULL;
+}
+
+void ATP_dictionaryInitInArena(ATP_Dictionary *p_dict, ATP_Arena *p_arena)
+{
+    if (p_arena == NULL)
+    {
+        // the handle holds the reference that the arena is created with
+        *p_dict = createImpl(ATP_arenaCreate(0));
+    }
+    else
+    {
+        *p_dict = createImpl(ATP_arenaRetain(p_arena));
+    }
+}
+
+static void destroyEntry(ATP_DictionaryImpl *p_impl, ATP_DictionaryEntry *p_entry)
+{
+    indexRemove(p_impl, p_entry);
+    Value_changeType(&p_entry->m_value, e_ATP_ValueType_none, p_impl->m_arena);
+    if (p_impl->m_arena == NULL)
+    {
+        free(p_entry);
+    }
+}
+
+static void retainImpl(ATP_DictionaryImpl *p_impl, int p_external)
+{
+    ATOMIC_INCREMENT(p_impl->m_refCount);
+    if (p_external && p_impl->m_arena != NULL)
+    {
+        ATP_arenaRetain(p_impl->m_arena);
+    }
+}
+
+static void releaseImpl(ATP_DictionaryImpl *p_impl, int p_external)
+{
+    // the dictionary may be freed by another reference as soon as the count is decremented
+    ATP_Arena *l_arena = p_impl->m_arena;
+    if (ATOMIC_DECREMENT(p_impl->m_refCount) == 0 && l_arena == NULL)
+    {
+        ATP_DictionaryEntry *it = FIRST(p_impl);
+
+        // the index is no longer needed once the first entry is known, since the entries stay linked together
+        indexClear(p_impl);
+        while (it != NULL)
+        {
+            ATP_DictionaryEntry *l_next = NEXT(it);
+            Value_changeType(&it->m_value, e_ATP_ValueType_none, NULL);
+            free(it);
+            it = l_next;
+        }
+        free(p_impl);
+    }
+
+    // everything in an arena is released along with it, so there is nothing to walk
+    if (p_external && l_arena != NULL)
+    {
+        ATP_arenaRelease(l_arena);
+    }
+}
+
+void ATP_dictionaryDestroy(ATP_Dictionary *p_dict)
+{
+    if (p_dict != NULL && *p_dict != NULL)
+    {
+        releaseImpl(*p_dict, 1);
+        *p_dict = NULL;
+    }
+}
+
+void Value_hashKey(ValueKey *p_key, const char *p_string)
+{
+    p_key->m_key = p_string;
+    p_key->m_hash = hashKey(p_string, &p_key->m_length);
+}
+
+static ATP_DictionaryEntry *findHashedEntry(const ATP_Dictionary *p_dict, const ValueKey *p_key)
+{
+    if (*p_dict == NULL)
+    {
+        return NULL;
+    }
+    else if ((*p_dict)->m_frozen != NULL)
+    {
+        return frozenFind((*p_dict)->m_frozen, p_key);
+    }
+
+    return indexFind(*p_dict, p_key);
+}
+
+static ATP_DictionaryEntry *findEntry(const ATP_Dictionary *p_dict, const char *p_key)
+{
+    ValueKey l_key;
+    Value_hashKey(&l_key, p_key);
+    return findHashedEntry(p_dict, &l_key);
+}
+
+static ATP_DictionaryEntry *createEntry(ATP_DictionaryImpl *p_impl, const char *p_key, size_t p_keyLength);
+
+static ATP_DictionaryImpl *copyImpl(const ATP_DictionaryImpl *p_impl, ATP_Arena *p_arena)
+{
+    ATP_DictionaryEntry *it;
+    ATP_DictionaryImpl *l_copy = createImpl(p_arena);
+
+    for (it = FIRST(p_impl); it != NULL; it = NEXT(it))
+    {
+        ATP_DictionaryEntry *l_entry = createEntry(l_copy, it->m_key, it->m_keyLength);
+        Value_copy(&l_entry->m_value, &it->m_value, p_arena);
+    }
+
+    return l_copy;
+}
+
+int Value_detachDict(ATP_Dictionary *p_dict)
+{
+    ATP_DictionaryImpl *l_impl = *p_dict;
+    if (l_impl == NULL)
+    {
+        return 1;
+    }
+    else if (l_impl->m_frozen != NULL)
+    {
+        ERR("Cannot modify a frozen dictionary\n");
+        return 0;
+    }
+    else if (ATOMIC_LOAD(l_impl->m_refCount) > 1)
+    {
+        // the copy stays in the same storage, so whatever reference the handle held on the arena now covers the copy
+        DBG("copying shared dictionary %p\n", l_impl);
+        *p_dict = copyImpl(l_impl, l_impl->m_arena);
+        releaseImpl(l_impl, 0);
+    }
+
+    return 1;
+}
+
+static int checkWritable(ATP_DictionaryIterator p_iterator)
+{
+    if (p_iterator->m_owner->m_frozen != NULL)
+    {
+        ERR("Cannot modify a frozen dictionary\n");
+        return 0;
+    }
+    else if (ATOMIC_LOAD(p_iterator->m_owner->m_refCount) > 1)
+    {
+        ERR("Cannot modify a shared dictionary through an iterator, use ATP_dictionaryBegin to obtain a writable one\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+void ATP_dictionaryRemove(ATP_Dictionary *p_dict, const char *p_key)
+{
+    ATP_DictionaryEntry *l_entry;
+
+    if (!Value_detachDict(p_dict))
+    {
+        return;
+    }
+
+    l_entry = findEntry(p_dict, p_key);
+    if (l_entry != NULL)
+    {
+        // remove existing entry
+        ATP_dictionaryErase(p_dict, l_entry);
+    }
+}
+
+int ATP_dictionaryTake(ATP_Dictionary *p_dict, const char *p_key, ATP_Value *p_value)
+{
+    ATP_DictionaryEntry *l_entry;
+
+    if (!Value_detachDict(p_dict))
+    {
+        return 0;
+    }
+
+    l_entry = findEntry(p_dict, p_key);
+    if (l_entry == NULL)
+    {
+        return 0;
+    }
+
+    Value_take(p_value, &l_entry->m_value, (*p_dict)->m_arena);
+    destroyEntry(*p_dict, l_entry);
+    return 1;
+}
+
+unsigned int ATP_dictionaryCount(const ATP_Dictionary *p_dict)
+{
+    if (*p_dict == NULL)
+    {
+        return 0;
+    }
+    else if ((*p_dict)->m_frozen != NULL)
+    {
+        return (*p_dict)->m_frozen->m_count;
+    }
+
+    return indexCount(*p_dict);
+}
+
+ATP_Arena *ATP_dictionaryGetArena(const ATP_Dictionary *p_dict)
+{
+    if (*p_dict == NULL)
+    {
+        return NULL;
+    }
+
+    return (*p_dict)->m_arena;
+}
+
+static ATP_DictionaryEntry *createEntry(ATP_DictionaryImpl *p_impl, const char *p_key, size_t p_keyLength)
+{
+    ATP_DictionaryEntry *l_entry;
+    size_t l_size = sizeof(ATP_DictionaryEntry) + p_keyLength + 1;
+
+    if (p_impl->m_arena != NULL)
+    {
+        l_entry = ATP_arenaAlloc(p_impl->m_arena, l_size);
+    }
+    else
+    {
+        l_entry = malloc(l_size);
+        if (l_entry == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+
+    memcpy(l_entry->m_key, p_key, p_keyLength);
+    l_entry->m_key[p_keyLength] = '\0';
+    l_entry->m_keyLength = p_keyLength;
+    l_entry->m_value.m_type = e_ATP_ValueType_none;
+    l_entry->m_owner = p_impl;
+    indexInsert(p_impl, l_entry);
+    return l_entry;
+}
+
+ATP_Dictionary ATP_dictionaryDuplicate(const ATP_Dictionary *p_dict)
 {
-    *p_dict = NULL;
+    return ATP_dictionaryDuplicateInArena(p_dict, NULL);
 }
 
-void ATP_dictionaryDestroy(ATP_Dictionary *p_dict)
+ATP_Dictionary ATP_dictionaryDuplicateInArena(const ATP_Dictionary *p_dict, ATP_Arena *p_arena)
 {
-    if (p_dict != NULL)
+    ATP_Dictionary l_result = NULL;
+
+    if (p_dict == NULL)
     {
-        ATP_DictionaryImpl *it;
-        ATP_DictionaryImpl *l_tmp;
+        return NULL;
+    }
 
-        HASH_ITER(hh, *p_dict, it, l_tmp)
+    if (*p_dict == NULL)
+    {
+        if (p_arena != NULL)
         {
-            HASH_DEL(*p_dict, it);
-            Value_changeType(&it->m_value, e_ATP_ValueType_none);
-            free(it);
+            ATP_dictionaryInitInArena(&l_result, p_arena);
         }
+    }
+    else if (p_arena == NULL || (*p_dict)->m_arena == p_arena)
+    {
+        // share the dictionary, it is only copied once it is written to through either handle
+        l_result = *p_dict;
+        retainImpl(l_result, 1);
+    }
+    else
+    {
+        // nothing outside of an arena can be referenced from inside it
+        l_result = copyImpl(*p_dict, p_arena);
+        ATP_arenaRetain(p_arena);
+    }
 
-        *p_dict = NULL;
+    return l_result;
+}
+
+ATP_Dictionary Value_adoptDict(ATP_Dictionary p_dict, ATP_Arena *p_arena)
+{
+    ATP_Dictionary l_copy;
+
+    if (p_dict == NULL)
+    {
+        // allocate the empty dictionary now, otherwise it would end up on the heap once it is filled in
+        return (p_arena != NULL ? createImpl(p_arena) : NULL);
+    }
+
+    if (p_arena == NULL)
+    {
+        return p_dict;
+    }
+    else if (p_dict->m_arena == p_arena)
+    {
+        // the container keeps the arena alive, so the caller's reference on it is no longer needed
+        ATP_arenaRelease(p_arena);
+        return p_dict;
     }
+
+    DBG("copying dictionary %p into arena storage\n", p_dict);
+    l_copy = copyImpl(p_dict, p_arena);
+    ATP_dictionaryDestroy(&p_dict);
+    return l_copy;
 }
 
-void ATP_dictionaryRemove(ATP_Dictionary *p_dict, const char *p_key)
+ATP_Dictionary Value_shareDict(ATP_Dictionary p_dict, ATP_Arena *p_arena)
 {
-    ATP_DictionaryImpl *l_entry = NULL;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
-    if (l_entry != NULL)
+    if (p_dict == NULL)
     {
-        // remove existing entry
-        ATP_dictionaryErase(p_dict, l_entry);
+        return Value_adoptDict(NULL, p_arena);
+    }
+
+    if (p_arena == NULL || p_dict->m_arena == p_arena)
+    {
+        retainImpl(p_dict, (p_arena == NULL));
+        return p_dict;
+    }
+
+    return copyImpl(p_dict, p_arena);
+}
+
+void Value_releaseDict(ATP_Dictionary p_dict, ATP_Arena *p_arena)
+{
+    if (p_dict != NULL)
+    {
+        releaseImpl(p_dict, (p_arena == NULL));
     }
 }
 
-unsigned int ATP_dictionaryCount(ATP_Dictionary *p_dict)
+size_t Value_measureDict(ATP_Dictionary p_dict)
 {
-    return HASH_COUNT(*p_dict);
+    ATP_DictionaryEntry *it;
+    size_t l_entries = 0;
+    size_t l_size = ARENASIZE(sizeof(ATP_DictionaryImpl)) + ARENASIZE(FROZENINDEXSIZE(ATP_dictionaryCount(&p_dict)));
+
+    for (it = (p_dict != NULL ? FIRST(p_dict) : NULL); it != NULL; it = NEXT(it))
+    {
+        l_entries += FROZENENTRYSIZE(it->m_keyLength);
+        l_size += Value_measure(&it->m_value);
+    }
+
+    return l_size + (l_entries > 0 ? ARENASIZE(l_entries) : 0);
 }
 
-static ATP_DictionaryImpl *createEntry(const char *p_key)
+ATP_Dictionary Value_freezeDict(ATP_Dictionary p_dict, ATP_Arena *p_arena)
 {
-    ATP_DictionaryImpl *l_entry;
-    if (strlen(p_key) > c_ATP_Dictionary_keySize)
+    ATP_DictionaryEntry *it;
+    ATP_DictionaryEntry *l_prev = NULL;
+    char *l_entries = NULL;
+    size_t l_size = 0;
+    unsigned int l_count = ATP_dictionaryCount(&p_dict);
+    ATP_DictionaryImpl *l_impl = createImpl(p_arena);
+    FrozenIndex *l_index = ATP_arenaAlloc(p_arena, FROZENINDEXSIZE(l_count));
+
+    l_index->m_slots = (ATP_DictionaryEntry **) (l_index + 1);
+    l_index->m_seeds = (unsigned int *) (l_index->m_slots + l_count);
+
+    // all of the entries are allocated as a single block, in iteration order
+    for (it = (p_dict != NULL ? FIRST(p_dict) : NULL); it != NULL; it = NEXT(it))
     {
-        ERR("Key '%s' is too long (max. %u characters)\n", p_key, c_ATP_Dictionary_keySize);
-        return NULL;
+        l_size += FROZENENTRYSIZE(it->m_keyLength);
     }
+    if (l_size > 0)
+    {
+        l_entries = ATP_arenaAlloc(p_arena, l_size);
+    }
+
+    l_size = 0;
+    for (it = (p_dict != NULL ? FIRST(p_dict) : NULL); it != NULL; it = NEXT(it))
+    {
+        ATP_DictionaryEntry *l_entry = (ATP_DictionaryEntry *) (l_entries + l_size);
+        l_size += FROZENENTRYSIZE(it->m_keyLength);
+
+        memcpy(l_entry->m_key, it->m_key, it->m_keyLength + 1);
+        l_entry->m_keyLength = it->m_keyLength;
+        l_entry->m_owner = l_impl;
+        l_entry->m_value.m_type = e_ATP_ValueType_none;
+        Value_freeze(&l_entry->m_value, &it->m_value, p_arena);
+        indexLinkFrozen(l_impl, l_prev, l_entry);
+        l_prev = l_entry;
+    }
+
+    buildFrozenIndex(l_index, FIRST(l_impl), l_count);
+    l_impl->m_frozen = l_index;
+    return l_impl;
+}
+
+void Value_imageDict(ValueImage *p_image, ATP_Dictionary p_dict)
+{
+    unsigned int i;
+    ATP_DictionaryEntry *it;
+    FrozenIndex *l_index = (FrozenIndex *) p_dict->m_frozen;
+
+    // the entries are found through the links between them, so those are replaced last
+    for (it = FIRST(p_dict); it != NULL; it = NEXT(it))
+    {
+        Value_image(p_image, &it->m_value);
+        Value_imagePointer(p_image, &it->m_owner);
+    }
+    for (i = 0; i < l_index->m_count; ++i)
+    {
+        Value_imagePointer(p_image, &l_index->m_slots[i]);
+    }
+    Value_imagePointer(p_image, &l_index->m_slots);
+    Value_imagePointer(p_image, &l_index->m_seeds);
+    indexImageFrozen(p_image, p_dict);
+    Value_imagePointer(p_image, &p_dict->m_frozen);
+    Value_imageArena(p_image, &p_dict->m_arena);
+}
+
+// check the entry a link of a frozen dictionary leads to, if any, which must belong to the dictionary at the given offset
+static int checkImageEntry(ValueImageCheck *p_check, const void *p_link, size_t p_owner, ATP_DictionaryEntry **p_entry)
+{
+    ATP_DictionaryEntry *l_entry;
+    ATP_DictionaryImpl *l_owner;
+    size_t l_offset;
 
-    l_entry = malloc(sizeof(ATP_DictionaryImpl));
+    // the size of an entry depends on its key, so the rest of it is only claimed once the header is
+    if (!Value_checkImagePointer(p_check, p_link, sizeof(ATP_DictionaryEntry), 1, &l_entry))
+    {
+        return 0;
+    }
+    *p_entry = l_entry;
     if (l_entry == NULL)
     {
-        PERR();
-        exit(EX_OSERR);
+        return 1;
     }
 
-    strncpy(l_entry->m_key, p_key, c_ATP_Dictionary_keySize + 1);
-    l_entry->m_value.m_type = e_ATP_ValueType_none;
-    return l_entry;
+    l_offset = (size_t) ((char *) l_entry - p_check->m_base);
+    if (l_entry->m_keyLength >= p_check->m_size)
+    {
+        return Value_checkImageFail();
+    }
+    else if (!Value_checkImageClaim(p_check, l_offset + sizeof(ATP_DictionaryEntry),
+                                    FROZENENTRYSIZE(l_entry->m_keyLength) - sizeof(ATP_DictionaryEntry), 1)
+             || !Value_checkImagePointer(p_check, &l_entry->m_owner, 0, 0, &l_owner))
+    {
+        return 0;
+    }
+    else if ((size_t) ((char *) l_owner - p_check->m_base) != p_owner || l_entry->m_key[l_entry->m_keyLength] != '\0'
+             || memchr(l_entry->m_key, '\0', l_entry->m_keyLength) != NULL)
+    {
+        return Value_checkImageFail();
+    }
+
+    // the slots of the index may only lead to the starts of entries
+    SETIMAGEBIT(p_check->m_entries, l_offset);
+    return Value_checkImage(p_check, &l_entry->m_value);
 }
 
-ATP_Dictionary ATP_dictionaryDuplicate(const ATP_Dictionary *p_dict)
+int Value_checkImageDict(ValueImageCheck *p_check, size_t p_offset)
 {
-    if (p_dict != NULL)
+    unsigned int i;
+    unsigned int l_count = 0;
+    ATP_DictionaryImpl *l_impl = (ATP_DictionaryImpl *) (p_check->m_base + p_offset);
+    FrozenIndex *l_index;
+    ATP_DictionaryEntry **l_slots;
+    unsigned int *l_seeds;
+
+    if (!Value_checkImageClaim(p_check, p_offset, sizeof(ATP_DictionaryImpl), 1)
+        || !Value_checkImageArena(p_check, &l_impl->m_arena)
+        || !Value_checkImagePointer(p_check, &l_impl->m_frozen, sizeof(FrozenIndex), 0, &l_index)
+        || !indexCheckFrozen(p_check, l_impl, p_offset, &l_count))
     {
-        ATP_DictionaryImpl *it;
-        ATP_DictionaryImpl *l_tmp;
-        ATP_Dictionary l_result;
+        return 0;
+    }
 
-        ATP_dictionaryInit(&l_result);
-        HASH_ITER(hh, *p_dict, it, l_tmp)
-        {
-            ATP_DictionaryImpl *l_copy = createEntry(it->m_key);
-            if (l_copy == NULL)
-            {
-                ATP_dictionaryDestroy(&l_result);
-                return NULL;
-            }
+    // the slots and seeds follow the index, as laid out by Value_freezeDict
+    if (l_index->m_count != l_count || (l_index->m_buckets != 0 && l_index->m_buckets != (l_count + 1) / 2))
+    {
+        return Value_checkImageFail();
+    }
+    else if ((l_count > 0 && !Value_checkImageClaim(p_check, (size_t) ((char *) (l_index + 1) - p_check->m_base),
+                                                    FROZENINDEXSIZE(l_count) - sizeof(FrozenIndex), 1))
+             || !Value_checkImagePointer(p_check, &l_index->m_slots, 0, 0, &l_slots)
+             || !Value_checkImagePointer(p_check, &l_index->m_seeds, 0, 0, &l_seeds))
+    {
+        return 0;
+    }
+    else if (l_slots != (ATP_DictionaryEntry **) (l_index + 1) || l_seeds != (unsigned int *) (l_slots + l_count))
+    {
+        return Value_checkImageFail();
+    }
+
+    for (i = 0; i < l_count; ++i)
+    {
+        ATP_DictionaryEntry *l_entry;
+        size_t l_entryOffset;
+        size_t l_owner;
 
-            Value_copy(&l_copy->m_value, &it->m_value);
-            HASH_ADD_STR(l_result, m_key, l_copy);
+        if (!Value_checkImagePointer(p_check, &l_slots[i], 0, 0, &l_entry))
+        {
+            return 0;
+        }
+        l_entryOffset = (size_t) ((char *) l_entry - p_check->m_base);
+        if (l_entryOffset % sizeof(char *) != 0 || !IMAGEBIT(p_check->m_entries, l_entryOffset))
+        {
+            return Value_checkImageFail();
+        }
+        memcpy(&l_owner, &l_entry->m_owner, sizeof(size_t));
+        if (l_owner != p_offset)
+        {
+            return Value_checkImageFail();
+        }
+    }
+    for (i = 0; i < l_index->m_buckets; ++i)
+    {
+        // a slot recorded directly is used as it is
+        if ((l_seeds[i] & c_frozenDirect) && (l_seeds[i] & ~c_frozenDirect) >= l_count)
+        {
+            return Value_checkImageFail();
         }
+    }
+
+    return 1;
+}
+
+void ATP_dictionaryFreeze(ATP_Dictionary *p_dict)
+{
+    ATP_Arena *l_arena;
+    ATP_Dictionary l_frozen;
 
-        return l_result;
+    if (ATP_dictionaryIsFrozen(p_dict))
+    {
+        return;
     }
 
-    return NULL;
+    // the arena is sized to hold the whole tree in a single chunk; the handle holds the reference it is created with
+    l_arena = ATP_arenaCreate(Value_measureDict(*p_dict));
+    l_frozen = Value_freezeDict(*p_dict, l_arena);
+    DBG("froze dictionary %p as %p\n", *p_dict, l_frozen);
+
+    ATP_dictionaryDestroy(p_dict);
+    *p_dict = l_frozen;
+}
+
+int ATP_dictionaryIsFrozen(const ATP_Dictionary *p_dict)
+{
+    return (*p_dict != NULL && (*p_dict)->m_frozen != NULL);
+}
+
+ATP_DictionaryIterator Value_findHashed(const ATP_Dictionary *p_dict, const ValueKey *p_key)
+{
+    return findHashedEntry(p_dict, p_key);
 }
 
-static ATP_DictionaryImpl *findOrCreateEntry(ATP_Dictionary *p_dict, const char *p_key)
+ATP_DictionaryIterator Value_findOrCreateHashed(ATP_Dictionary *p_dict, const ValueKey *p_key)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry;
+
+    if (!Value_detachDict(p_dict))
+    {
+        return NULL;
+    }
+
+    l_entry = findHashedEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
-        l_entry = createEntry(p_key);
-        if (l_entry == NULL)
+        if (*p_dict == NULL)
         {
-            return NULL;
+            *p_dict = createImpl(NULL);
         }
 
-        HASH_ADD_STR(*p_dict, m_key, l_entry);
+        l_entry = createEntry(*p_dict, p_key->m_key, p_key->m_length);
     }
 
     return l_entry;
 }
 
+const Value *Value_iteratorValue(ATP_DictionaryIterator p_iterator)
+{
+    return &p_iterator->m_value;
+}
+
+static ATP_DictionaryEntry *findOrCreateEntry(ATP_Dictionary *p_dict, const char *p_key)
+{
+    ValueKey l_key;
+    Value_hashKey(&l_key, p_key);
+    return Value_findOrCreateHashed(p_dict, &l_key);
+}
+
+int ATP_dictionaryPut(ATP_Dictionary *p_dict, const char *p_key, ATP_Value *p_value)
+{
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
+    if (l_entry == NULL)
+    {
+        return 0;
+    }
+
+    DBG("moving into '%s': <%s>\n", p_key, ATP_valueTypeToString(ATP_valueGetType(p_value)));
+    Value_put(&l_entry->m_value, (*p_dict)->m_arena, p_value);
+    return 1;
+}
+
+int ATP_dictionaryMoveEntry(ATP_Dictionary *p_source, ATP_Dictionary *p_dest, const char *p_key)
+{
+    ATP_DictionaryEntry *l_source;
+    ATP_DictionaryEntry *l_dest;
+
+    if (p_source == p_dest)
+    {
+        return (findEntry(p_source, p_key) != NULL);
+    }
+
+    if (!Value_detachDict(p_source))
+    {
+        return 0;
+    }
+
+    l_source = findEntry(p_source, p_key);
+    if (l_source == NULL)
+    {
+        return 0;
+    }
+
+    l_dest = findOrCreateEntry(p_dest, p_key);
+    if (l_dest == NULL)
+    {
+        return 0;
+    }
+
+    DBG("moving '%s' from %p to %p\n", p_key, *p_source, *p_dest);
+    Value_move(&l_dest->m_value, (*p_dest)->m_arena, &l_source->m_value, (*p_source)->m_arena);
+    destroyEntry(*p_source, l_source);
+    return 1;
+}
+
+void ATP_dictionaryMove(ATP_Dictionary *p_dest, ATP_Dictionary *p_source)
+{
+    if (p_dest != p_source)
+    {
+        ATP_dictionaryDestroy(p_dest);
+        *p_dest = *p_source;
+        ATP_dictionaryInit(p_source);
+    }
+}
+
 int ATP_dictionarySetString(ATP_Dictionary *p_dict, const char *p_key, const char *p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -131,7 +1459,7 @@ int ATP_dictionarySetString(ATP_Dictionary *p_dict, const char *p_key, const cha
 
 int ATP_dictionarySetUint(ATP_Dictionary *p_dict, const char *p_key, unsigned long long p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -142,7 +1470,7 @@ int ATP_dictionarySetUint(ATP_Dictionary *p_dict, const char *p_key, unsigned lo
 
 int ATP_dictionarySetInt(ATP_Dictionary *p_dict, const char *p_key, signed long long p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -153,7 +1481,7 @@ int ATP_dictionarySetInt(ATP_Dictionary *p_dict, const char *p_key, signed long
 
 int ATP_dictionarySetDouble(ATP_Dictionary *p_dict, const char *p_key, double p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -164,7 +1492,7 @@ int ATP_dictionarySetDouble(ATP_Dictionary *p_dict, const char *p_key, double p_
 
 int ATP_dictionarySetBool(ATP_Dictionary *p_dict, const char *p_key, int p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -175,7 +1503,7 @@ int ATP_dictionarySetBool(ATP_Dictionary *p_dict, const char *p_key, int p_value
 
 int ATP_dictionarySetDict(ATP_Dictionary *p_dict, const char *p_key, ATP_Dictionary p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -186,7 +1514,7 @@ int ATP_dictionarySetDict(ATP_Dictionary *p_dict, const char *p_key, ATP_Diction
 
 int ATP_dictionarySetArray(ATP_Dictionary *p_dict, const char *p_key, ATP_Array p_value)
 {
-    ATP_DictionaryImpl *l_entry = findOrCreateEntry(p_dict, p_key);
+    ATP_DictionaryEntry *l_entry = findOrCreateEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -195,10 +1523,9 @@ int ATP_dictionarySetArray(ATP_Dictionary *p_dict, const char *p_key, ATP_Array
     return ATP_dictionaryItSetArray(l_entry, p_value);
 }
 
-int ATP_dictionaryGetString(ATP_Dictionary *p_dict, const char *p_key, const char **p_value)
+int ATP_dictionaryGetString(const ATP_Dictionary *p_dict, const char *p_key, const char **p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -207,10 +1534,9 @@ int ATP_dictionaryGetString(ATP_Dictionary *p_dict, const char *p_key, const cha
     return ATP_dictionaryItGetString(l_entry, p_value);
 }
 
-int ATP_dictionaryGetUint(ATP_Dictionary *p_dict, const char *p_key, unsigned long long *p_value)
+int ATP_dictionaryGetUint(const ATP_Dictionary *p_dict, const char *p_key, unsigned long long *p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -219,10 +1545,9 @@ int ATP_dictionaryGetUint(ATP_Dictionary *p_dict, const char *p_key, unsigned lo
     return ATP_dictionaryItGetUint(l_entry, p_value);
 }
 
-int ATP_dictionaryGetInt(ATP_Dictionary *p_dict, const char *p_key, signed long long *p_value)
+int ATP_dictionaryGetInt(const ATP_Dictionary *p_dict, const char *p_key, signed long long *p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -231,10 +1556,9 @@ int ATP_dictionaryGetInt(ATP_Dictionary *p_dict, const char *p_key, signed long
     return ATP_dictionaryItGetInt(l_entry, p_value);
 }
 
-int ATP_dictionaryGetDouble(ATP_Dictionary *p_dict, const char *p_key, double *p_value)
+int ATP_dictionaryGetDouble(const ATP_Dictionary *p_dict, const char *p_key, double *p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -243,10 +1567,9 @@ int ATP_dictionaryGetDouble(ATP_Dictionary *p_dict, const char *p_key, double *p
     return ATP_dictionaryItGetDouble(l_entry, p_value);
 }
 
-int ATP_dictionaryGetBool(ATP_Dictionary *p_dict, const char *p_key, int *p_value)
+int ATP_dictionaryGetBool(const ATP_Dictionary *p_dict, const char *p_key, int *p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -257,8 +1580,14 @@ int ATP_dictionaryGetBool(ATP_Dictionary *p_dict, const char *p_key, int *p_valu
 
 int ATP_dictionaryGetDict(ATP_Dictionary *p_dict, const char *p_key, ATP_Dictionary **p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry;
+
+    if (!Value_detachDict(p_dict))
+    {
+        return 0;
+    }
+
+    l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -269,8 +1598,14 @@ int ATP_dictionaryGetDict(ATP_Dictionary *p_dict, const char *p_key, ATP_Diction
 
 int ATP_dictionaryGetArray(ATP_Dictionary *p_dict, const char *p_key, ATP_Array **p_value)
 {
-    ATP_DictionaryImpl *l_entry;
-    HASH_FIND_STR(*p_dict, p_key, l_entry);
+    ATP_DictionaryEntry *l_entry;
+
+    if (!Value_detachDict(p_dict))
+    {
+        return 0;
+    }
+
+    l_entry = findEntry(p_dict, p_key);
     if (l_entry == NULL)
     {
         return 0;
@@ -279,9 +1614,46 @@ int ATP_dictionaryGetArray(ATP_Dictionary *p_dict, const char *p_key, ATP_Array
     return ATP_dictionaryItGetArray(l_entry, p_value);
 }
 
+int ATP_dictionaryGetDictConst(const ATP_Dictionary *p_dict, const char *p_key, const ATP_Dictionary **p_value)
+{
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
+    if (l_entry == NULL)
+    {
+        return 0;
+    }
+
+    return ATP_dictionaryItGetDictConst(l_entry, p_value);
+}
+
+int ATP_dictionaryGetArrayConst(const ATP_Dictionary *p_dict, const char *p_key, const ATP_Array **p_value)
+{
+    ATP_DictionaryEntry *l_entry = findEntry(p_dict, p_key);
+    if (l_entry == NULL)
+    {
+        return 0;
+    }
+
+    return ATP_dictionaryItGetArrayConst(l_entry, p_value);
+}
+
 ATP_DictionaryIterator ATP_dictionaryBegin(ATP_Dictionary *p_dict)
 {
-    return *p_dict;
+    // a frozen dictionary can still be iterated, it is only writing through the iterator that fails
+    if (!ATP_dictionaryIsFrozen(p_dict))
+    {
+        Value_detachDict(p_dict);
+    }
+    return ATP_dictionaryBeginConst(p_dict);
+}
+
+ATP_DictionaryIterator ATP_dictionaryBeginConst(const ATP_Dictionary *p_dict)
+{
+    if (*p_dict == NULL)
+    {
+        return NULL;
+    }
+
+    return FIRST(*p_dict);
 }
 
 int ATP_dictionaryHasNext(ATP_DictionaryIterator p_iterator)
@@ -291,17 +1663,17 @@ int ATP_dictionaryHasNext(ATP_DictionaryIterator p_iterator)
 
 ATP_DictionaryIterator ATP_dictionaryNext(ATP_DictionaryIterator p_iterator)
 {
-    return p_iterator->hh.next;
+    return NEXT(p_iterator);
 }
 
 ATP_DictionaryIterator ATP_dictionaryErase(ATP_Dictionary *p_dict, ATP_DictionaryIterator p_iterator)
 {
-    ATP_DictionaryIterator l_next = p_iterator->hh.next;
-
-    HASH_DEL(*p_dict, p_iterator);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_none);
-    free(p_iterator);
+    ATP_DictionaryIterator l_next = NEXT(p_iterator);
 
+    if (checkWritable(p_iterator))
+    {
+        destroyEntry(*p_dict, p_iterator);
+    }
     return l_next;
 }
 
@@ -317,57 +1689,89 @@ ATP_ValueType ATP_dictionaryGetType(ATP_DictionaryIterator p_iterator)
 
 int ATP_dictionaryItSetString(ATP_DictionaryIterator p_iterator, const char *p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': '%s'\n", p_iterator->m_key, p_value);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_string);
-    utstring_bincpy(&p_iterator->m_value.m_value.m_string, p_value, strlen(p_value));
+    Value_setString(&p_iterator->m_value, p_value, p_iterator->m_owner->m_arena);
     return 1;
 }
 
 int ATP_dictionaryItSetUint(ATP_DictionaryIterator p_iterator, unsigned long long p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': %llu\n", p_iterator->m_key, p_value);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_uint);
+    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_uint, p_iterator->m_owner->m_arena);
     p_iterator->m_value.m_value.m_uint = p_value;
     return 1;
 }
 
 int ATP_dictionaryItSetInt(ATP_DictionaryIterator p_iterator, signed long long p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': %lld\n", p_iterator->m_key, p_value);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_int);
+    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_int, p_iterator->m_owner->m_arena);
     p_iterator->m_value.m_value.m_int = p_value;
     return 1;
 }
 
 int ATP_dictionaryItSetDouble(ATP_DictionaryIterator p_iterator, double p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': %f\n", p_iterator->m_key, p_value);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_double);
+    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_double, p_iterator->m_owner->m_arena);
     p_iterator->m_value.m_value.m_double = p_value;
     return 1;
 }
 
 int ATP_dictionaryItSetBool(ATP_DictionaryIterator p_iterator, int p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': %s\n", p_iterator->m_key, (p_value ? "true" : "false"));
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_bool);
+    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_bool, p_iterator->m_owner->m_arena);
     p_iterator->m_value.m_value.m_bool = (p_value != 0);
     return 1;
 }
 
 int ATP_dictionaryItSetDict(ATP_DictionaryIterator p_iterator, ATP_Dictionary p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': <dictionary>\n", p_iterator->m_key);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_dict);
-    p_iterator->m_value.m_value.m_dict = p_value;
+    Value_setDict(&p_iterator->m_value, p_value, p_iterator->m_owner->m_arena);
     return 1;
 }
 
 int ATP_dictionaryItSetArray(ATP_DictionaryIterator p_iterator, ATP_Array p_value)
 {
+    if (!checkWritable(p_iterator))
+    {
+        return 0;
+    }
+
     DBG("setting '%s': <array>\n", p_iterator->m_key);
-    Value_changeType(&p_iterator->m_value, e_ATP_ValueType_array);
-    p_iterator->m_value.m_value.m_array = p_value;
+    Value_setArray(&p_iterator->m_value, p_value, p_iterator->m_owner->m_arena);
     return 1;
 }
 
@@ -375,7 +1779,7 @@ int ATP_dictionaryItGetString(ATP_DictionaryIterator p_iterator, const char **p_
 {
     if (p_iterator->m_value.m_type == e_ATP_ValueType_string)
     {
-        *p_value = utstring_body(&p_iterator->m_value.m_value.m_string);
+        *p_value = Value_getString(&p_iterator->m_value);
         return 1;
     }
 
@@ -428,7 +1832,8 @@ int ATP_dictionaryItGetBool(ATP_DictionaryIterator p_iterator, int *p_value)
 
 int ATP_dictionaryItGetDict(ATP_DictionaryIterator p_iterator, ATP_Dictionary **p_value)
 {
-    if (p_iterator->m_value.m_type == e_ATP_ValueType_dict)
+    if (p_iterator->m_value.m_type == e_ATP_ValueType_dict && checkWritable(p_iterator)
+        && Value_detachDict(&p_iterator->m_value.m_value.m_dict))
     {
         *p_value = &p_iterator->m_value.m_value.m_dict;
         DBG("dictionary member is %p\n", p_iterator->m_value.m_value.m_dict);
@@ -440,7 +1845,8 @@ int ATP_dictionaryItGetDict(ATP_DictionaryIterator p_iterator, ATP_Dictionary **
 
 int ATP_dictionaryItGetArray(ATP_DictionaryIterator p_iterator, ATP_Array **p_value)
 {
-    if (p_iterator->m_value.m_type == e_ATP_ValueType_array)
+    if (p_iterator->m_value.m_type == e_ATP_ValueType_array && checkWritable(p_iterator)
+        && Value_detachArray(&p_iterator->m_value.m_value.m_array))
     {
         *p_value = &p_iterator->m_value.m_value.m_array;
         DBG("array member is %p\n", p_iterator->m_value.m_value.m_array);
@@ -449,3 +1855,25 @@ int ATP_dictionaryItGetArray(ATP_DictionaryIterator p_iterator, ATP_Array **p_va
 
     return 0;
 }
+
+int ATP_dictionaryItGetDictConst(ATP_DictionaryIterator p_iterator, const ATP_Dictionary **p_value)
+{
+    if (p_iterator->m_value.m_type == e_ATP_ValueType_dict)
+    {
+        *p_value = &p_iterator->m_value.m_value.m_dict;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_dictionaryItGetArrayConst(ATP_DictionaryIterator p_iterator, const ATP_Array **p_value)
+{
+    if (p_iterator->m_value.m_type == e_ATP_ValueType_array)
+    {
+        *p_value = &p_iterator->m_value.m_value.m_array;
+        return 1;
+    }
+
+    return 0;
+}
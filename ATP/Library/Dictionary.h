@@ -1,14 +1,25 @@
 /* File: Dictionary.h
 The dictionary type for ATP.
+
+Dictionaries are reference counted and copied on write: duplicating one only adds a reference to it, and a dictionary with
+more than one reference is copied the first time it is modified through any of them.  Copies are shallow, so nested
+dictionaries and arrays remain shared until they are modified in turn.  Functions taking a constant handle never copy
+anything, and are the ones to use when only reading from a dictionary that may be shared.
+
+A dictionary that is only read once it has been built may be frozen (see <ATP_dictionaryFreeze>), which packs the whole tree
+into an arena of its own and indexes it for faster lookups.  Frozen dictionaries cannot be modified, but may be read from any
+number of threads at once; duplicating one into another arena gives a copy that can be modified again.
 */
 #ifndef _ATP_LIBRARY_DICTIONARY_H_
 #define _ATP_LIBRARY_DICTIONARY_H_
 
 #include "Export.h"
 #include "Value.h"
+#include "Arena.h"
 
-// forward declaration
+// forward declarations
 struct ATP_DictionaryImpl;
+struct ATP_DictionaryEntry;
 
 /* Type: ATP_Dictionary
 Reference to a dictionary implementation.
@@ -18,15 +29,10 @@ typedef struct ATP_DictionaryImpl *ATP_Dictionary;
 // include this after declaring ATP_Dictionary
 #include "Array.h"
 
-/* Constant: c_ATP_Dictionary_keySize
-The maximum string length of a dictionary key.
-*/
-#define c_ATP_Dictionary_keySize    127
-
 /* Type: ATP_DictionaryIterator
 Iterator type for traversing a dictionary's entries.
 */
-typedef struct ATP_DictionaryImpl *ATP_DictionaryIterator;
+typedef struct ATP_DictionaryEntry *ATP_DictionaryIterator;
 
 #ifdef __cplusplus
 extern "C"
@@ -40,8 +46,19 @@ Parameters:
     p_dict - The dictionary handle.
 */
 EXPORT void ATP_dictionaryInit(ATP_Dictionary *p_dict);
+/* Function: ATP_dictionaryInitInArena
+Initialize a dictionary instance whose entries, keys and string values are all allocated from an arena.  Nested dictionaries
+and arrays should be initialized in the same arena (see <ATP_dictionaryGetArena>); any that are not are copied into it when
+they are stored in the dictionary.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_arena - The arena to allocate from.  If this is NULL, a new arena is created.  The handle holds a reference to the
+              arena, and the entire tree is released at once when the last reference to the arena is released.
+*/
+EXPORT void ATP_dictionaryInitInArena(ATP_Dictionary *p_dict, ATP_Arena *p_arena);
 /* Function: ATP_dictionaryDestroy
-Destroy a dictionary instance.  Remove and free all entries.
+Release a reference to a dictionary instance.  Once the last reference is released all entries are removed and freed.
 
 Parameters:
     p_dict - The dictionary handle.
@@ -56,18 +73,60 @@ Parameters:
 Returns:
     The number of entries.
 */
-EXPORT unsigned int ATP_dictionaryCount(ATP_Dictionary *p_dict);
+EXPORT unsigned int ATP_dictionaryCount(const ATP_Dictionary *p_dict);
+/* Function: ATP_dictionaryGetArena
+Get the arena that a dictionary allocates from.
+
+Parameters:
+    p_dict - The dictionary handle.
+
+Returns:
+    The arena, or NULL if the dictionary allocates from the heap.
+*/
+EXPORT ATP_Arena *ATP_dictionaryGetArena(const ATP_Dictionary *p_dict);
 
 /* Function: ATP_dictionaryDuplicate
-Duplicate an existing dictionary.
+Duplicate an existing dictionary.  This takes constant time, since the dictionary is shared until either handle is used to
+modify it.
 
 Parameters:
     p_dict - The dictionary to duplicate.
 
 Returns:
-    The new copy of the dictionary.
+    The new copy of the dictionary, which must be destroyed separately.
 */
 EXPORT ATP_Dictionary ATP_dictionaryDuplicate(const ATP_Dictionary *p_dict);
+/* Function: ATP_dictionaryDuplicateInArena
+Duplicate an existing dictionary into an arena.  A dictionary that already allocates from the arena is shared as with
+<ATP_dictionaryDuplicate>, while any other is copied into the arena in full.
+
+Parameters:
+    p_dict  - The dictionary to duplicate.
+    p_arena - The arena to allocate the copy from, or NULL to share the dictionary wherever it is allocated.
+
+Returns:
+    The new copy of the dictionary, which must be destroyed separately.
+*/
+EXPORT ATP_Dictionary ATP_dictionaryDuplicateInArena(const ATP_Dictionary *p_dict, ATP_Arena *p_arena);
+/* Function: ATP_dictionaryFreeze
+Replace a dictionary with a frozen copy of it.  The copy, including every dictionary and array nested in it, is allocated from
+a new arena sized to hold it exactly, and its keys are indexed with a perfect hash so that a lookup examines at most one entry.
+Any attempt to modify a frozen dictionary or its contents fails.  Freezing a dictionary that is already frozen does nothing.
+
+Parameters:
+    p_dict - The dictionary handle.
+*/
+EXPORT void ATP_dictionaryFreeze(ATP_Dictionary *p_dict);
+/* Function: ATP_dictionaryIsFrozen
+Check whether a dictionary is frozen, see <ATP_dictionaryFreeze>.
+
+Parameters:
+    p_dict - The dictionary handle.
+
+Returns:
+    1 if the dictionary is frozen, 0 otherwise.
+*/
+EXPORT int ATP_dictionaryIsFrozen(const ATP_Dictionary *p_dict);
 
 /* Function: ATP_dictionaryRemove
 Remove an entry from the dictionary.
@@ -77,6 +136,54 @@ Parameters:
     p_key  - The key of the dictionary entry to remove.
 */
 EXPORT void ATP_dictionaryRemove(ATP_Dictionary *p_dict, const char *p_key);
+/* Function: ATP_dictionaryTake
+Remove an entry from the dictionary, moving its value out rather than destroying it.  Nested dictionaries and arrays are
+relinked rather than copied.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_key   - The key of the dictionary entry to take.
+    p_value - The initialized value instance to move the entry's value into.  Its previous contents are destroyed.
+
+Returns:
+    1 on success, 0 if the entry does not exist.
+*/
+EXPORT int ATP_dictionaryTake(ATP_Dictionary *p_dict, const char *p_key, ATP_Value *p_value);
+/* Function: ATP_dictionaryPut
+Move a value into a given entry, which is created if it does not exist.  If it does exist then the old value and type are
+discarded.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_key   - The key of the dictionary entry to set.
+    p_value - The value instance to move into the entry, which is left with no type.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_dictionaryPut(ATP_Dictionary *p_dict, const char *p_key, ATP_Value *p_value);
+/* Function: ATP_dictionaryMoveEntry
+Move an entry from one dictionary to another, replacing any entry with the same key in the destination.  Nested dictionaries
+and arrays are relinked rather than copied, unless the destination allocates from a different arena.
+
+Parameters:
+    p_source - The dictionary to remove the entry from.
+    p_dest   - The dictionary to move the entry into.
+    p_key    - The key of the entry to move.
+
+Returns:
+    1 on success, 0 if the entry does not exist in the source dictionary.
+*/
+EXPORT int ATP_dictionaryMoveEntry(ATP_Dictionary *p_source, ATP_Dictionary *p_dest, const char *p_key);
+/* Function: ATP_dictionaryMove
+Transfer a dictionary from one handle to another.  Any dictionary previously referred to by the destination handle is
+destroyed, and the source handle is left referring to an empty dictionary.
+
+Parameters:
+    p_dest   - The dictionary handle to move into.
+    p_source - The dictionary handle to move from.
+*/
+EXPORT void ATP_dictionaryMove(ATP_Dictionary *p_dest, ATP_Dictionary *p_source);
 
 /* Function: ATP_dictionarySetString
 Set the value of a given entry to be the provided character string.  The entry is created if it does not exist.
@@ -188,7 +295,7 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_dictionaryGetString(ATP_Dictionary *p_dict, const char *p_key, const char **p_value);
+EXPORT int ATP_dictionaryGetString(const ATP_Dictionary *p_dict, const char *p_key, const char **p_value);
 /* Function: ATP_dictionaryGetUint
 Get the value of a given unsigned integer entry.
 
@@ -200,7 +307,7 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_dictionaryGetUint(ATP_Dictionary *p_dict, const char *p_key, unsigned long long *p_value);
+EXPORT int ATP_dictionaryGetUint(const ATP_Dictionary *p_dict, const char *p_key, unsigned long long *p_value);
 /* Function: ATP_dictionaryGetInt
 Get the value of a given signed integer entry.
 
@@ -212,7 +319,7 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_dictionaryGetInt(ATP_Dictionary *p_dict, const char *p_key, signed long long *p_value);
+EXPORT int ATP_dictionaryGetInt(const ATP_Dictionary *p_dict, const char *p_key, signed long long *p_value);
 /* Function: ATP_dictionaryGetDouble
 Get the value of a given floating point entry.
 
@@ -224,7 +331,7 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_dictionaryGetDouble(ATP_Dictionary *p_dict, const char *p_key, double *p_value);
+EXPORT int ATP_dictionaryGetDouble(const ATP_Dictionary *p_dict, const char *p_key, double *p_value);
 /* Function: ATP_dictionaryGetBool
 Get the value of a given boolean entry.
 
@@ -236,9 +343,9 @@ Parameters:
 Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
-EXPORT int ATP_dictionaryGetBool(ATP_Dictionary *p_dict, const char *p_key, int *p_value);
+EXPORT int ATP_dictionaryGetBool(const ATP_Dictionary *p_dict, const char *p_key, int *p_value);
 /* Function: ATP_dictionaryGetDict
-Get the value of a given dictionary entry.
+Get the value of a given dictionary entry, for modification.  If either dictionary is shared, it is copied first.
 
 Parameters:
     p_dict  - The dictionary handle.
@@ -250,7 +357,7 @@ Returns:
 */
 EXPORT int ATP_dictionaryGetDict(ATP_Dictionary *p_dict, const char *p_key, ATP_Dictionary **p_value);
 /* Function: ATP_dictionaryGetArray
-Get the value of a given array entry.
+Get the value of a given array entry, for modification.  If the dictionary or the array is shared, it is copied first.
 
 Parameters:
     p_dict  - The dictionary handle.
@@ -261,9 +368,34 @@ Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
 EXPORT int ATP_dictionaryGetArray(ATP_Dictionary *p_dict, const char *p_key, ATP_Array **p_value);
+/* Function: ATP_dictionaryGetDictConst
+Get the value of a given dictionary entry, for reading only.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_key   - The key of the dictionary entry to get.
+    p_value - The location to store the value from the dictionary entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_dictionaryGetDictConst(const ATP_Dictionary *p_dict, const char *p_key, const ATP_Dictionary **p_value);
+/* Function: ATP_dictionaryGetArrayConst
+Get the value of a given array entry, for reading only.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_key   - The key of the dictionary entry to get.
+    p_value - The location to store the value from the dictionary entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_dictionaryGetArrayConst(const ATP_Dictionary *p_dict, const char *p_key, const ATP_Array **p_value);
 
 /* Function: ATP_dictionaryBegin
-Create an iterator pointing to the beginning of a dictionary.
+Create an iterator pointing to the beginning of a dictionary, through which the dictionary may be modified.  If the
+dictionary is shared, it is copied first.
 
 Parameters:
     p_dict - The dictionary to iterate over.
@@ -272,6 +404,17 @@ Returns:
     An iterator instance.
 */
 EXPORT ATP_DictionaryIterator ATP_dictionaryBegin(ATP_Dictionary *p_dict);
+/* Function: ATP_dictionaryBeginConst
+Create an iterator pointing to the beginning of a dictionary, for reading only.  Setting values through the iterator fails if
+the dictionary is shared.
+
+Parameters:
+    p_dict - The dictionary to iterate over.
+
+Returns:
+    An iterator instance.
+*/
+EXPORT ATP_DictionaryIterator ATP_dictionaryBeginConst(const ATP_Dictionary *p_dict);
 /* Function: ATP_dictionaryHasNext
 Determine if there is another dictionary entry that the iterator can advance to.
 
@@ -472,7 +615,7 @@ Returns:
 */
 EXPORT int ATP_dictionaryItGetBool(ATP_DictionaryIterator p_iterator, int *p_value);
 /* Function: ATP_dictionaryItGetDict
-Get the value of a given dictionary entry.
+Get the value of a given dictionary entry, for modification.  If the nested dictionary is shared, it is copied first.
 
 Parameters:
     p_iterator - The iterator pointing to the entry.
@@ -484,7 +627,7 @@ Returns:
 EXPORT int ATP_dictionaryItGetDict(ATP_DictionaryIterator p_iterator, ATP_Dictionary **p_value);
 
 /* Function: ATP_dictionaryItGetArray
-Get the value of a given array entry.
+Get the value of a given array entry, for modification.  If the array is shared, it is copied first.
 
 Parameters:
     p_iterator - The iterator pointing to the entry.
@@ -494,6 +637,51 @@ Returns:
     1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
 */
 EXPORT int ATP_dictionaryItGetArray(ATP_DictionaryIterator p_iterator, ATP_Array **p_value);
+/* Function: ATP_dictionaryItGetDictConst
+Get the value of a given dictionary entry, for reading only.
+
+Parameters:
+    p_iterator - The iterator pointing to the entry.
+    p_value    - The location to store the value from the dictionary entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_dictionaryItGetDictConst(ATP_DictionaryIterator p_iterator, const ATP_Dictionary **p_value);
+/* Function: ATP_dictionaryItGetArrayConst
+Get the value of a given array entry, for reading only.
+
+Parameters:
+    p_iterator - The iterator pointing to the entry.
+    p_value    - The location to store the value from the dictionary entry in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if the entry does not exist or is of the wrong type then 0 will be returned.
+*/
+EXPORT int ATP_dictionaryItGetArrayConst(ATP_DictionaryIterator p_iterator, const ATP_Array **p_value);
+
+/* Function: ATP_valueTakeDict
+Move a dictionary out of a value, leaving the value with no type.
+
+Parameters:
+    p_value - The value instance.
+    p_dict  - The dictionary handle to move the dictionary into.  Any dictionary it referred to before is not destroyed.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueTakeDict(ATP_Value *p_value, ATP_Dictionary *p_dict);
+/* Function: ATP_valueGetDictConst
+Get the dictionary held in a value, for reading only.
+
+Parameters:
+    p_value - The value instance.
+    p_dict  - The location to store the dictionary handle in.  The handle is only valid while the value remains unchanged.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetDictConst(const ATP_Value *p_value, const ATP_Dictionary **p_dict);
 
 #ifdef __cplusplus
 }   /* extern "C" */
@@ -0,0 +1,205 @@
+#include "Image.h"
+#include "Value.inc"
+#include "Log.h"
+#include "Exit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define c_imageVersion  1
+
+#ifdef ATTR_FLAT_DICTIONARY
+    #define c_imageEngine   1
+#else
+    #define c_imageEngine   0
+#endif
+
+// offsets replace pointers in place, so they must be the same size
+typedef char ImagePointerCheck[(sizeof(size_t) == sizeof(char *)) ? 1 : -1];
+
+static const char c_imageMagic[8] = { 'A', 'T', 'P', 'I', 'M', 'A', 'G', 'E' };
+
+typedef struct ImageHeader
+{
+    char m_magic[8];
+    unsigned int m_version;
+    // written as a fixed pattern, to tell images from machines with the other byte order apart
+    unsigned int m_byteOrder;
+    unsigned char m_pointerSize;
+    unsigned char m_engine;
+    // the size of the header and the tree, which is followed by the bitmap of pointers
+    unsigned long long m_size;
+    unsigned long long m_root;
+} ImageHeader;
+
+// the tree starts at the first aligned offset after the header, so no pointer into it is ever 0
+#define c_imageHeader       ARENASIZE(sizeof(ImageHeader))
+#define BITMAPSIZE(size)    (((size) / sizeof(char *) + 7) / 8)
+
+size_t ATP_imageSize(const ATP_Dictionary *p_dict)
+{
+    size_t l_size = c_imageHeader + Value_measureDict(*p_dict);
+    return l_size + BITMAPSIZE(l_size);
+}
+
+void ATP_imageWrite(const ATP_Dictionary *p_dict, void *p_block)
+{
+    ImageHeader l_header;
+    ValueImage l_image;
+    ATP_Arena *l_arena;
+    ATP_Dictionary l_root;
+    size_t l_size = c_imageHeader + Value_measureDict(*p_dict);
+
+    l_image.m_base = p_block;
+    l_image.m_pointers = (unsigned char *) p_block + l_size;
+    memset(l_image.m_pointers, 0, BITMAPSIZE(l_size));
+
+    // the tree is measured exactly, so freezing it fills the block after the header without spilling onto the heap
+    l_arena = ATP_arenaCreateInBlock(p_block, l_size, c_imageHeader, NULL, NULL);
+    l_root = Value_freezeDict(*p_dict, l_arena);
+    Value_imageDict(&l_image, l_root);
+    ATP_arenaRelease(l_arena);
+
+    memset(&l_header, 0, sizeof(l_header));
+    memcpy(l_header.m_magic, c_imageMagic, sizeof(c_imageMagic));
+    l_header.m_version = c_imageVersion;
+    l_header.m_byteOrder = 0x01020304;
+    l_header.m_pointerSize = (unsigned char) sizeof(char *);
+    l_header.m_engine = c_imageEngine;
+    l_header.m_size = l_size;
+    l_header.m_root = (unsigned long long) ((char *) l_root - (char *) p_block);
+    memcpy(p_block, &l_header, sizeof(l_header));
+}
+
+static int checkHeader(const ImageHeader *p_header, size_t p_size)
+{
+    if (p_size < sizeof(ImageHeader) || memcmp(p_header->m_magic, c_imageMagic, sizeof(c_imageMagic)) != 0)
+    {
+        ERR("Not a dictionary image, or one that has not been written completely\n");
+        return 0;
+    }
+    else if (p_header->m_version != c_imageVersion || p_header->m_byteOrder != 0x01020304
+             || p_header->m_pointerSize != sizeof(char *) || p_header->m_engine != c_imageEngine)
+    {
+        ERR("The dictionary image was written by an incompatible build\n");
+        return 0;
+    }
+    else if (p_header->m_size < c_imageHeader || p_header->m_size % c_ATP_Arena_alignment != 0
+             || p_header->m_size > p_size || p_size - p_header->m_size < BITMAPSIZE(p_header->m_size)
+             || p_header->m_root < c_imageHeader || p_header->m_root >= p_header->m_size)
+    {
+        ERR("The dictionary image is truncated or corrupt\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+// replace every pointer marked in a bitmap, which holds an offset from the start of the image, with the pointer it stands for
+static void relocate(char *p_base, size_t p_size, const unsigned char *p_pointers, ATP_Arena *p_arena)
+{
+    size_t i;
+
+    for (i = 0; i < BITMAPSIZE(p_size); ++i)
+    {
+        unsigned int b;
+
+        // most words hold something other than a pointer
+        if (p_pointers[i] == 0)
+        {
+            continue;
+        }
+
+        for (b = 0; b < 8; ++b)
+        {
+            char *l_field = p_base + (i * 8 + b) * sizeof(char *);
+            size_t l_offset;
+
+            if ((p_pointers[i] & (1u << b)) == 0)
+            {
+                continue;
+            }
+
+            memcpy(&l_offset, l_field, sizeof(size_t));
+            if (l_offset == 0)
+            {
+                memcpy(l_field, &p_arena, sizeof(ATP_Arena *));
+            }
+            else
+            {
+                char *l_target = p_base + l_offset;
+                memcpy(l_field, &l_target, sizeof(char *));
+            }
+        }
+    }
+}
+
+// check the tree of an image, finding every pointer in it, which must be exactly those marked by the image
+static int check(char *p_base, size_t p_size, size_t p_root, unsigned char *p_pointers)
+{
+    ValueImageCheck l_check;
+    int l_result;
+
+    l_check.m_base = p_base;
+    l_check.m_size = p_size;
+    l_check.m_pointers = p_pointers;
+    l_check.m_claimed = calloc(BITMAPSIZE(p_size), 1);
+    l_check.m_entries = calloc(BITMAPSIZE(p_size), 1);
+    l_check.m_depth = 0;
+    if (l_check.m_claimed == NULL || l_check.m_entries == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    l_result = (Value_checkImageClaim(&l_check, 0, c_imageHeader, 0) && Value_checkImageDict(&l_check, p_root));
+    if (l_result && memcmp(p_pointers, p_base + p_size, BITMAPSIZE(p_size)) != 0)
+    {
+        l_result = Value_checkImageFail();
+    }
+
+    free(l_check.m_claimed);
+    free(l_check.m_entries);
+    return l_result;
+}
+
+int ATP_imageOpen(void *p_block, size_t p_size, ATP_ArenaReleaseCallback p_release, void *p_token,
+                  ATP_Dictionary *p_dict)
+{
+    ImageHeader l_header;
+    ATP_Arena *l_arena;
+    unsigned char *l_pointers;
+    size_t l_size;
+
+    if (p_size >= sizeof(l_header))
+    {
+        memcpy(&l_header, p_block, sizeof(l_header));
+    }
+    if (!checkHeader(&l_header, p_size))
+    {
+        return 0;
+    }
+    l_size = (size_t) l_header.m_size;
+
+    // everything is checked before anything is changed, so that a bad image is left as it was; the pointers are then found
+    // from the bitmap built by the check, since the one in the image could be changed by another process in the meantime
+    l_pointers = calloc(BITMAPSIZE(l_size), 1);
+    if (l_pointers == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    if (!check(p_block, l_size, (size_t) l_header.m_root, l_pointers))
+    {
+        free(l_pointers);
+        return 0;
+    }
+
+    // the arena owns the whole block, and the handle holds the reference it is created with
+    l_arena = ATP_arenaCreateInBlock(p_block, p_size, p_size - p_size % c_ATP_Arena_alignment, p_release, p_token);
+    relocate(p_block, l_size, l_pointers, l_arena);
+    free(l_pointers);
+    *p_dict = (ATP_Dictionary) ((char *) p_block + l_header.m_root);
+    DBG("opened dictionary image of %lu bytes at %p\n", (unsigned long) p_size, p_block);
+    return 1;
+}
@@ -0,0 +1,71 @@
+/* File: Image.h
+Relocatable images of frozen dictionaries, for handing a dictionary to another process through shared memory or a file.
+
+An image is a single block of memory holding a frozen copy of a dictionary (see <ATP_dictionaryFreeze>) in which every
+pointer is stored as an offset from the start of the block, followed by a bitmap marking the words that hold those offsets.
+Opening an image turns the offsets back into pointers where the block lies, without allocating or parsing anything, and the
+dictionary then reads the block in place through the usual functions.  Long strings and the contents of packed arrays are never
+written to, so when the block is a private mapping they stay shared with whatever was mapped.
+
+Images depend on the layout of dictionaries in memory, so they can only be opened by a build of the library like the one that
+wrote them, which is checked when they are opened.  An image may come from a process that is not trusted, so before anything in
+it is changed the whole tree is checked: the type of every value, every length, count and index, that every pointer leads to an
+object of the right kind within the image without any two objects overlapping, and that the bitmap marks exactly the words
+holding pointers.  Dictionaries and arrays may be nested at most 1024 deep.  Every page that is read as anything other than the
+characters of a string or the contents of a packed array is written to while it is checked, so that when the block is a private
+mapping the process gets a copy of its own, which the writer can no longer change.
+*/
+#ifndef _ATP_LIBRARY_IMAGE_H_
+#define _ATP_LIBRARY_IMAGE_H_
+
+#include "Export.h"
+#include "Dictionary.h"
+#include "Arena.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_imageSize
+Get the size of the image of a dictionary.
+
+Parameters:
+    p_dict - The dictionary handle.
+
+Returns:
+    The number of bytes needed to hold the image.
+*/
+EXPORT size_t ATP_imageSize(const ATP_Dictionary *p_dict);
+/* Function: ATP_imageWrite
+Write the image of a dictionary into a block of memory.
+
+Parameters:
+    p_dict  - The dictionary handle.
+    p_block - The block to write to, aligned to <c_ATP_Arena_alignment> and at least <ATP_imageSize> bytes long.
+*/
+EXPORT void ATP_imageWrite(const ATP_Dictionary *p_dict, void *p_block);
+/* Function: ATP_imageOpen
+Open an image in place, as a frozen dictionary that uses the block as its arena.  The block must be writable, since every
+dictionary and array in it has its pointers updated.
+
+Parameters:
+    p_block   - The block holding the image, aligned to <c_ATP_Arena_alignment>.
+    p_size    - The size of the block in bytes.
+    p_release - The function to give the block back with once the dictionary and everything taken from it are destroyed, or
+                NULL if the caller keeps the block for longer.
+    p_token   - The token to pass to p_release.
+    p_dict    - The dictionary handle to initialize.
+
+Returns:
+    1 on success, 0 (after printing an error) if the block does not hold a complete and valid image written by a compatible
+    build, in which case the block is left to the caller, unchanged.
+*/
+EXPORT int ATP_imageOpen(void *p_block, size_t p_size, ATP_ArenaReleaseCallback p_release, void *p_token,
+                         ATP_Dictionary *p_dict);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_IMAGE_H_ */
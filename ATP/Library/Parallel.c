@@ -0,0 +1,255 @@
+#include "Parallel.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ParallelSettings
+{
+    char *m_key;
+    // the only key read and written, as a list
+    const char *m_keys[2];
+    // one instance of the wrapped processor for each chunk of the array, or a single one if it is not thread-safe
+    ATP_Processor **m_instances;
+    unsigned int m_instanceCount;
+} ParallelSettings;
+
+typedef struct ParallelRun
+{
+    const ParallelSettings *m_settings;
+    unsigned int m_count;
+    // the number of chunks the array is split into, which is no more than the instances or the threads of the shared pool
+    unsigned int m_chunks;
+    const ATP_Array *m_entries;
+    ATP_Dictionary *m_outputs;
+    // whether each chunk ran successfully
+    int *m_results;
+} ParallelRun;
+
+static void runChunks(unsigned int p_begin, unsigned int p_end, void *p_context)
+{
+    unsigned int c;
+    ParallelRun *l_run = p_context;
+    unsigned int l_length = ATP_arrayLength(l_run->m_entries);
+    unsigned int l_chunks = l_run->m_chunks;
+
+    for (c = p_begin; c < p_end; ++c)
+    {
+        unsigned int i;
+        ATP_Processor *l_proc = l_run->m_settings->m_instances[c];
+
+        ATP_traceBegin("chunk", l_proc->m_interface.m_name);
+        l_run->m_results[c] = 1;
+        for (i = (unsigned int) ((unsigned long long) l_length * c / l_chunks);
+             i < (unsigned int) ((unsigned long long) l_length * (c + 1) / l_chunks); ++i)
+        {
+            const ATP_Dictionary *l_entry;
+            ATP_Dictionary l_input;
+
+            ATP_arrayGetDictConst(l_run->m_entries, i, &l_entry);
+            l_input = ATP_dictionaryDuplicate(l_entry);
+            l_run->m_results[c] = ATP_processorRun(l_proc, l_run->m_count, &l_input, &l_run->m_outputs[i]);
+            ATP_dictionaryDestroy(&l_input);
+            if (!l_run->m_results[c])
+            {
+                break;
+            }
+        }
+        ATP_traceEnd();
+    }
+}
+
+static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    unsigned int i;
+    unsigned int l_length;
+    int l_result = 1;
+    const ATP_Array *l_entries;
+    ATP_Array l_outputs;
+    ParallelRun l_run;
+    ParallelSettings *l_settings = p_token;
+
+    if (ATP_processorHelpRequested())
+    {
+        // let the wrapped processor describe itself
+        return ATP_processorRun(l_settings->m_instances[0], p_count, p_input, p_output);
+    }
+
+    if (!ATP_dictionaryGetArrayConst(p_input, l_settings->m_key, &l_entries))
+    {
+        ERR("parallel: no array found under '%s'\n", l_settings->m_key);
+        return 0;
+    }
+    l_length = ATP_arrayLength(l_entries);
+    for (i = 0; i < l_length; ++i)
+    {
+        const ATP_Dictionary *l_entry;
+        if (!ATP_arrayGetDictConst(l_entries, i, &l_entry))
+        {
+            ERR("parallel: entry %u of '%s' is not a dictionary\n", i, l_settings->m_key);
+            return 0;
+        }
+    }
+
+    l_run.m_settings = l_settings;
+    l_run.m_count = p_count;
+    l_run.m_chunks = ATP_threadPoolSize(ATP_threadPoolShared());
+    if (l_run.m_chunks > l_settings->m_instanceCount)
+    {
+        l_run.m_chunks = l_settings->m_instanceCount;
+    }
+    l_run.m_entries = l_entries;
+    l_run.m_outputs = malloc((l_length > 0 ? l_length : 1) * sizeof(ATP_Dictionary));
+    l_run.m_results = malloc(l_settings->m_instanceCount * sizeof(int));
+    if (l_run.m_outputs == NULL || l_run.m_results == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    for (i = 0; i < l_length; ++i)
+    {
+        ATP_dictionaryInit(&l_run.m_outputs[i]);
+    }
+
+    // each chunk is a single task on the pool shared with the rest of the run, so that no two tasks share an instance and no
+    // more threads are started than the run was given
+    ATP_threadPoolFor(ATP_threadPoolShared(), 0, l_run.m_chunks, 1, &runChunks, &l_run);
+    for (i = 0; i < l_run.m_chunks; ++i)
+    {
+        l_result = l_result && l_run.m_results[i];
+    }
+
+    // put the outputs back together in order, in place of the array
+    ATP_arrayInit(&l_outputs);
+    if (l_result)
+    {
+        ATP_arrayReserve(&l_outputs, l_length);
+        for (i = 0; i < l_length; ++i)
+        {
+            ATP_arraySetDict(&l_outputs, i, l_run.m_outputs[i]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < l_length; ++i)
+        {
+            ATP_dictionaryDestroy(&l_run.m_outputs[i]);
+        }
+    }
+    free(l_run.m_outputs);
+    free(l_run.m_results);
+
+    if (!l_result)
+    {
+        ATP_arrayDestroy(&l_outputs);
+        return 0;
+    }
+    ATP_processorForward(p_input, p_output);
+    ATP_dictionarySetArray(p_output, l_settings->m_key, l_outputs);
+    return 1;
+}
+
+static void files(ATP_Array *p_files, void *p_token)
+{
+    ParallelSettings *l_settings = p_token;
+
+    // every instance is loaded with the same parameters, and so reads the same files
+    ATP_processorFiles(l_settings->m_instances[0], p_files);
+}
+
+static void unload(void *p_token)
+{
+    unsigned int i;
+    ParallelSettings *l_settings = p_token;
+
+    for (i = 0; i < l_settings->m_instanceCount; ++i)
+    {
+        ATP_processorUnload(l_settings->m_instances[i]);
+    }
+    free(l_settings->m_instances);
+    free(l_settings->m_key);
+    free(l_settings);
+}
+
+ATP_Processor *ATP_processorLoadParallel(unsigned int p_index, const char *p_key, unsigned int p_threads,
+                                         const char *p_name, const ATP_Array *p_parameters)
+{
+    unsigned int i;
+    ATP_Processor *l_first;
+    ATP_Processor *l_proc;
+    ParallelSettings *l_settings;
+
+    l_first = ATP_processorLoad(p_index, p_name, p_parameters);
+    if (l_first == NULL)
+    {
+        return NULL;
+    }
+    else if (ATP_processorIsStreaming(l_first))
+    {
+        ERR("parallel: '%s' streams records, and cannot be run on the entries of an array\n", p_name);
+        ATP_processorUnload(l_first);
+        return NULL;
+    }
+    else if (p_threads > 1 && !ATP_processorIsThreadSafe(l_first))
+    {
+        LOG("'%s' is not thread-safe, so @parallel will run it on one entry at a time\n", p_name);
+        p_threads = 1;
+    }
+    else if (p_threads == 0)
+    {
+        p_threads = 1;
+    }
+
+    l_settings = malloc(sizeof(ParallelSettings));
+    l_proc = malloc(sizeof(ATP_Processor));
+    if (l_settings == NULL || l_proc == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_settings->m_key = strdup(p_key);
+    l_settings->m_keys[0] = l_settings->m_key;
+    l_settings->m_keys[1] = NULL;
+    l_settings->m_instances = malloc(p_threads * sizeof(ATP_Processor *));
+    if (l_settings->m_key == NULL || l_settings->m_instances == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // the instances are all loaded up front, as loading is not thread-safe
+    l_settings->m_instances[0] = l_first;
+    for (i = 1; i < p_threads; ++i)
+    {
+        l_settings->m_instances[i] = ATP_processorLoad(p_index, p_name, p_parameters);
+        if (l_settings->m_instances[i] == NULL)
+        {
+            break;
+        }
+    }
+    l_settings->m_instanceCount = i;
+    if (l_settings->m_instanceCount < p_threads)
+    {
+        unload(l_settings);
+        free(l_proc);
+        return NULL;
+    }
+
+    memset(l_proc, 0, sizeof(ATP_Processor));
+    ATP_arrayInit(&l_proc->m_parameters);
+    l_proc->m_context = ATP_processorContextCurrent();
+    l_proc->m_interface.m_version = c_ATP_ProcessorInterface_version;
+    snprintf(l_proc->m_interface.m_name, sizeof(l_proc->m_interface.m_name), "parallel %s", p_name);
+    l_proc->m_interface.m_token = l_settings;
+    l_proc->m_interface.run = &run;
+    l_proc->m_interface.unload = &unload;
+    l_proc->m_interface.files = &files;
+    l_proc->m_interface.m_flags = (ATP_processorIsThreadSafe(l_first) ? c_ATP_ProcessorFlag_threadSafe : 0);
+    l_proc->m_interface.m_reads = l_settings->m_keys;
+    l_proc->m_interface.m_writes = l_settings->m_keys;
+    return l_proc;
+}
@@ -0,0 +1,47 @@
+/* File: Parallel.h
+Running a processor over every entry of an array at once.
+
+A parallel processor wraps another, whole dictionary processor.  When it runs it finds an array of dictionaries under a key of
+its input, runs the wrapped processor on each dictionary in the array as the whole input of that processor, and replaces the
+array with the outputs, in the same order.  The rest of its input is passed through unchanged.
+
+The array is split into as many contiguous chunks as the parallel processor has threads, but no more than the threads of the
+pool shared by the run (see <ATP_threadPoolShared>), which runs them.  Each chunk is run by an instance of the wrapped processor
+of its own, so that the instances never share state.  A processor that does not declare
+<c_ATP_ProcessorFlag_threadSafe> may still keep state shared between its instances, so a single instance of it is loaded
+instead, and runs every entry in turn on the calling thread.
+*/
+#ifndef _ATP_LIBRARY_PARALLEL_H_
+#define _ATP_LIBRARY_PARALLEL_H_
+
+#include "Export.h"
+#include "Processor.h"
+#include "Array.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_processorLoadParallel
+Load a processor that runs another processor over an array, see above.
+
+Parameters:
+    p_index      - The index number indicating the position of this processor in the pipeline.
+    p_key        - The key of the array in the input of the processor.
+    p_threads    - The number of instances of the wrapped processor to load, and so the most threads it runs on, at least 1.
+    p_name       - The name of the wrapped processor.
+    p_parameters - The command line parameters for the wrapped processor.
+
+Returns:
+    A new processor instance, or NULL (after printing an error) if the wrapped processor could not be loaded or does not run on
+    whole dictionaries.
+*/
+EXPORT ATP_Processor *ATP_processorLoadParallel(unsigned int p_index, const char *p_key, unsigned int p_threads,
+                                                const char *p_name, const ATP_Array *p_parameters);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_PARALLEL_H_ */
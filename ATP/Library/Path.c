@@ -0,0 +1,684 @@
+#include "Path.h"
+#include "Log.h"
+#include "Exit.h"
+#include "Value.inc"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+typedef enum PathSegmentType
+{
+    e_PathSegmentType_key = 0,
+    e_PathSegmentType_index,
+    e_PathSegmentType_anyKey,
+    e_PathSegmentType_anyIndex
+} PathSegmentType;
+
+typedef struct PathSegment
+{
+    PathSegmentType m_type;
+    unsigned int m_index;
+    ValueKey m_key;
+} PathSegment;
+
+// the segments are followed in the same block by their keys, each null terminated
+typedef struct ATP_PathImpl
+{
+    unsigned int m_count;
+    int m_wildcard;
+    PathSegment m_segments[];
+} ATP_PathImpl;
+
+// a container found while walking a path, only one member of which is set
+typedef struct PathTarget
+{
+    ATP_Dictionary *m_dict;
+    ATP_Array *m_array;
+} PathTarget;
+
+/*
+Parse a path expression.  This is done twice, first without a path to count the segments and the characters needed for their
+keys and report any errors, and then again to fill in the path allocated for them.
+*/
+static int parse(const char *p_expression, ATP_PathImpl *p_path, unsigned int *p_count, size_t *p_keySize)
+{
+    const char *l_cursor = p_expression;
+    char *l_keys = (p_path != NULL ? (char *) &p_path->m_segments[p_path->m_count] : NULL);
+    unsigned int l_count = 0;
+    size_t l_keySize = 0;
+
+    do
+    {
+        PathSegment l_segment;
+        memset(&l_segment, 0, sizeof(PathSegment));
+
+        if (*l_cursor == '[' && l_count > 0)
+        {
+            ++l_cursor;
+            if (l_cursor[0] == '*' && l_cursor[1] == ']')
+            {
+                l_segment.m_type = e_PathSegmentType_anyIndex;
+                l_cursor += 2;
+            }
+            else
+            {
+                unsigned long l_index = 0;
+                if (*l_cursor < '0' || *l_cursor > '9')
+                {
+                    ERR("Invalid path '%s': expected an index at offset %u\n",
+                        p_expression, (unsigned int) (l_cursor - p_expression));
+                    return 0;
+                }
+                while (*l_cursor >= '0' && *l_cursor <= '9')
+                {
+                    l_index = l_index * 10 + (*l_cursor++ - '0');
+                    if (l_index > UINT_MAX)
+                    {
+                        ERR("Invalid path '%s': index out of range\n", p_expression);
+                        return 0;
+                    }
+                }
+                if (*l_cursor++ != ']')
+                {
+                    ERR("Invalid path '%s': expected ']' at offset %u\n",
+                        p_expression, (unsigned int) (l_cursor - 1 - p_expression));
+                    return 0;
+                }
+
+                l_segment.m_type = e_PathSegmentType_index;
+                l_segment.m_index = (unsigned int) l_index;
+            }
+        }
+        else if (l_count > 0 && *l_cursor++ != '.')
+        {
+            ERR("Invalid path '%s': expected '.' or '[' at offset %u\n",
+                p_expression, (unsigned int) (l_cursor - 1 - p_expression));
+            return 0;
+        }
+        else if (l_cursor[0] == '*' && (l_cursor[1] == '\0' || l_cursor[1] == '.' || l_cursor[1] == '['))
+        {
+            l_segment.m_type = e_PathSegmentType_anyKey;
+            ++l_cursor;
+        }
+        else
+        {
+            char *l_key = (l_keys != NULL ? l_keys + l_keySize : NULL);
+            size_t l_length = 0;
+
+            while (*l_cursor != '\0' && *l_cursor != '.' && *l_cursor != '[')
+            {
+                if (*l_cursor == ']')
+                {
+                    ERR("Invalid path '%s': unexpected ']' at offset %u\n",
+                        p_expression, (unsigned int) (l_cursor - p_expression));
+                    return 0;
+                }
+                else if (*l_cursor == '\\' && *++l_cursor == '\0')
+                {
+                    ERR("Invalid path '%s': nothing to escape at the end\n", p_expression);
+                    return 0;
+                }
+
+                if (l_key != NULL)
+                {
+                    l_key[l_length] = *l_cursor;
+                }
+                ++l_length;
+                ++l_cursor;
+            }
+
+            if (l_length == 0)
+            {
+                ERR("Invalid path '%s': empty key at offset %u\n", p_expression, (unsigned int) (l_cursor - p_expression));
+                return 0;
+            }
+            if (l_key != NULL)
+            {
+                l_key[l_length] = '\0';
+                Value_hashKey(&l_segment.m_key, l_key);
+            }
+
+            l_segment.m_type = e_PathSegmentType_key;
+            l_keySize += l_length + 1;
+        }
+
+        if (p_path != NULL)
+        {
+            p_path->m_segments[l_count] = l_segment;
+            if (l_segment.m_type == e_PathSegmentType_anyKey || l_segment.m_type == e_PathSegmentType_anyIndex)
+            {
+                p_path->m_wildcard = 1;
+            }
+        }
+        ++l_count;
+    } while (*l_cursor != '\0');
+
+    *p_count = l_count;
+    *p_keySize = l_keySize;
+    return 1;
+}
+
+int ATP_pathCompile(ATP_Path *p_path, const char *p_expression)
+{
+    unsigned int l_count;
+    size_t l_keySize;
+    ATP_PathImpl *l_path;
+
+    if (!parse(p_expression, NULL, &l_count, &l_keySize))
+    {
+        return 0;
+    }
+
+    l_path = malloc(sizeof(ATP_PathImpl) + l_count * sizeof(PathSegment) + l_keySize);
+    if (l_path == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_path->m_count = l_count;
+    l_path->m_wildcard = 0;
+    parse(p_expression, l_path, &l_count, &l_keySize);
+
+    DBG("compiled path '%s' into %u segments\n", p_expression, l_count);
+    *p_path = l_path;
+    return 1;
+}
+
+void ATP_pathDestroy(ATP_Path *p_path)
+{
+    if (p_path != NULL)
+    {
+        free(*p_path);
+        *p_path = NULL;
+    }
+}
+
+int ATP_pathIsWildcard(const ATP_Path *p_path)
+{
+    return (*p_path)->m_wildcard;
+}
+
+static const Value *step(const Value *p_value, const PathSegment *p_segment, Value *p_scratch)
+{
+    if (p_segment->m_type == e_PathSegmentType_key && p_value->m_type == e_ATP_ValueType_dict)
+    {
+        ATP_DictionaryIterator l_entry = Value_findHashed(&p_value->m_value.m_dict, &p_segment->m_key);
+        return (l_entry != NULL ? Value_iteratorValue(l_entry) : NULL);
+    }
+    else if (p_segment->m_type == e_PathSegmentType_index && p_value->m_type == e_ATP_ValueType_array)
+    {
+        return Value_arrayEntry(&p_value->m_value.m_array, p_segment->m_index, p_scratch);
+    }
+
+    return NULL;
+}
+
+static const Value *resolve(const ATP_Path *p_path, const ATP_Dictionary *p_root, Value *p_scratch)
+{
+    unsigned int i;
+    Value l_root;
+    const Value *l_value = &l_root;
+    const ATP_PathImpl *l_path = *p_path;
+
+    if (l_path->m_wildcard)
+    {
+        ERR("Paths with wildcards can only be evaluated with ATP_pathForEach\n");
+        return NULL;
+    }
+    else if (l_path->m_count == 0)
+    {
+        // compiling rejects empty paths, and the root is not a value that can be handed out
+        return NULL;
+    }
+
+    // only packed array entries are ever read into the scratch value, and they cannot be stepped into, so one is enough
+    l_root.m_type = e_ATP_ValueType_dict;
+    l_root.m_value.m_dict = *p_root;
+    for (i = 0; i < l_path->m_count && l_value != NULL; ++i)
+    {
+        l_value = step(l_value, &l_path->m_segments[i], p_scratch);
+    }
+
+    return l_value;
+}
+
+ATP_ValueType ATP_pathGetType(const ATP_Path *p_path, const ATP_Dictionary *p_root)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    return (l_value != NULL ? l_value->m_type : e_ATP_ValueType_none);
+}
+
+int ATP_pathGetString(const ATP_Path *p_path, const ATP_Dictionary *p_root, const char **p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_string)
+    {
+        *p_value = Value_getString(l_value);
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetUint(const ATP_Path *p_path, const ATP_Dictionary *p_root, unsigned long long *p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_uint)
+    {
+        *p_value = l_value->m_value.m_uint;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetInt(const ATP_Path *p_path, const ATP_Dictionary *p_root, signed long long *p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_int)
+    {
+        *p_value = l_value->m_value.m_int;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetDouble(const ATP_Path *p_path, const ATP_Dictionary *p_root, double *p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_double)
+    {
+        *p_value = l_value->m_value.m_double;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetBool(const ATP_Path *p_path, const ATP_Dictionary *p_root, int *p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_bool)
+    {
+        *p_value = l_value->m_value.m_bool;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetDictConst(const ATP_Path *p_path, const ATP_Dictionary *p_root, const ATP_Dictionary **p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_dict)
+    {
+        *p_value = &l_value->m_value.m_dict;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_pathGetArrayConst(const ATP_Path *p_path, const ATP_Dictionary *p_root, const ATP_Array **p_value)
+{
+    Value l_scratch;
+    const Value *l_value = resolve(p_path, p_root, &l_scratch);
+    if (l_value != NULL && l_value->m_type == e_ATP_ValueType_array)
+    {
+        *p_value = &l_value->m_value.m_array;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+Check, without changing anything, that setting a path would succeed, so that a set that fails does not leave behind the
+containers created for it.  Every container missing along the path would be created empty, so the only index that can follow
+one is 0.
+*/
+static int canSet(const ATP_Path *p_path, const ATP_Dictionary *p_root)
+{
+    unsigned int i;
+    Value l_root;
+    Value l_scratch;
+    const Value *l_value = &l_root;
+    const ATP_PathImpl *l_path = *p_path;
+
+    // l_value is the existing value the current segment steps into, or NULL once the rest of the path would be created
+    l_root.m_type = e_ATP_ValueType_dict;
+    l_root.m_value.m_dict = *p_root;
+    for (i = 0; i < l_path->m_count; ++i)
+    {
+        const PathSegment *l_segment = &l_path->m_segments[i];
+        if (l_value == NULL)
+        {
+            if (l_segment->m_type == e_PathSegmentType_index && l_segment->m_index != 0)
+            {
+                ERR("Index out of bounds\n");
+                return 0;
+            }
+            continue;
+        }
+        else if (l_segment->m_type == e_PathSegmentType_key ? l_value->m_type != e_ATP_ValueType_dict
+                                                            : l_value->m_type != e_ATP_ValueType_array)
+        {
+            return 0;
+        }
+        else if (l_segment->m_type == e_PathSegmentType_index
+                 && l_segment->m_index > ATP_arrayLength(&l_value->m_value.m_array))
+        {
+            ERR("Index out of bounds\n");
+            return 0;
+        }
+
+        l_value = step(l_value, l_segment, &l_scratch);
+        if (l_value != NULL && l_value->m_type == e_ATP_ValueType_none)
+        {
+            l_value = NULL;
+        }
+    }
+
+    return 1;
+}
+
+/*
+Walk a path for modification, as far as the container holding its last segment.  Every container along the way is detached,
+and if p_create is set then those that are missing are created, as dictionaries or arrays according to the segment that
+follows them.
+*/
+static int resolveParent(const ATP_Path *p_path, ATP_Dictionary *p_root, int p_create, PathTarget *p_target)
+{
+    unsigned int i;
+    const ATP_PathImpl *l_path = *p_path;
+
+    if (l_path->m_wildcard)
+    {
+        ERR("Paths with wildcards can only be evaluated with ATP_pathForEach\n");
+        return 0;
+    }
+
+    p_target->m_dict = p_root;
+    p_target->m_array = NULL;
+    for (i = 0; i + 1 < l_path->m_count; ++i)
+    {
+        const PathSegment *l_segment = &l_path->m_segments[i];
+        int l_wantDict = (l_path->m_segments[i + 1].m_type == e_PathSegmentType_key);
+
+        if (l_segment->m_type == e_PathSegmentType_key)
+        {
+            ATP_DictionaryIterator l_entry;
+            if (p_create)
+            {
+                l_entry = Value_findOrCreateHashed(p_target->m_dict, &l_segment->m_key);
+                if (l_entry != NULL && ATP_dictionaryGetType(l_entry) == e_ATP_ValueType_none)
+                {
+                    if (l_wantDict ? !ATP_dictionaryItSetDict(l_entry, NULL) : !ATP_dictionaryItSetArray(l_entry, NULL))
+                    {
+                        return 0;
+                    }
+                }
+            }
+            else
+            {
+                l_entry = (Value_detachDict(p_target->m_dict) ? Value_findHashed(p_target->m_dict, &l_segment->m_key) : NULL);
+            }
+
+            if (l_entry == NULL || (l_wantDict ? !ATP_dictionaryItGetDict(l_entry, &p_target->m_dict)
+                                               : !ATP_dictionaryItGetArray(l_entry, &p_target->m_array)))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            ATP_Array *l_array = p_target->m_array;
+            unsigned int l_length = ATP_arrayLength(l_array);
+            if (p_create && (l_segment->m_index >= l_length
+                             || ATP_arrayGetType(l_array, l_segment->m_index) == e_ATP_ValueType_none))
+            {
+                if (l_wantDict ? !ATP_arraySetDict(l_array, l_segment->m_index, NULL)
+                               : !ATP_arraySetArray(l_array, l_segment->m_index, NULL))
+                {
+                    return 0;
+                }
+            }
+            else if (l_segment->m_index >= l_length)
+            {
+                return 0;
+            }
+
+            if (l_wantDict ? !ATP_arrayGetDict(l_array, l_segment->m_index, &p_target->m_dict)
+                           : !ATP_arrayGetArray(l_array, l_segment->m_index, &p_target->m_array))
+            {
+                return 0;
+            }
+        }
+
+        if (l_wantDict)
+        {
+            p_target->m_array = NULL;
+        }
+        else
+        {
+            p_target->m_dict = NULL;
+        }
+    }
+
+    return 1;
+}
+
+static ATP_DictionaryIterator createLast(const ATP_Path *p_path, ATP_Dictionary *p_root, PathTarget *p_target)
+{
+    // arrays are dealt with by the array setters themselves, so this only finds the entry for a last segment that is a key
+    if (((*p_path)->m_wildcard == 0 && !canSet(p_path, p_root)) || !resolveParent(p_path, p_root, 1, p_target))
+    {
+        p_target->m_array = NULL;
+        return NULL;
+    }
+    else if (p_target->m_dict == NULL)
+    {
+        return NULL;
+    }
+
+    return Value_findOrCreateHashed(p_target->m_dict, &(*p_path)->m_segments[(*p_path)->m_count - 1].m_key);
+}
+
+#define LASTINDEX(path) ((*(path))->m_segments[(*(path))->m_count - 1].m_index)
+
+int ATP_pathGetDict(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Dictionary **p_value)
+{
+    PathTarget l_target;
+    if (!resolveParent(p_path, p_root, 0, &l_target))
+    {
+        return 0;
+    }
+    else if (l_target.m_array != NULL)
+    {
+        return (LASTINDEX(p_path) < ATP_arrayLength(l_target.m_array)
+                && ATP_arrayGetDict(l_target.m_array, LASTINDEX(p_path), p_value));
+    }
+    else
+    {
+        ATP_DictionaryIterator l_entry = NULL;
+        if (Value_detachDict(l_target.m_dict))
+        {
+            l_entry = Value_findHashed(l_target.m_dict, &(*p_path)->m_segments[(*p_path)->m_count - 1].m_key);
+        }
+        return (l_entry != NULL && ATP_dictionaryItGetDict(l_entry, p_value));
+    }
+}
+
+int ATP_pathGetArray(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Array **p_value)
+{
+    PathTarget l_target;
+    if (!resolveParent(p_path, p_root, 0, &l_target))
+    {
+        return 0;
+    }
+    else if (l_target.m_array != NULL)
+    {
+        return (LASTINDEX(p_path) < ATP_arrayLength(l_target.m_array)
+                && ATP_arrayGetArray(l_target.m_array, LASTINDEX(p_path), p_value));
+    }
+    else
+    {
+        ATP_DictionaryIterator l_entry = NULL;
+        if (Value_detachDict(l_target.m_dict))
+        {
+            l_entry = Value_findHashed(l_target.m_dict, &(*p_path)->m_segments[(*p_path)->m_count - 1].m_key);
+        }
+        return (l_entry != NULL && ATP_dictionaryItGetArray(l_entry, p_value));
+    }
+}
+
+int ATP_pathSetString(const ATP_Path *p_path, ATP_Dictionary *p_root, const char *p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetString(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetString(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetUint(const ATP_Path *p_path, ATP_Dictionary *p_root, unsigned long long p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetUint(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetUint(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetInt(const ATP_Path *p_path, ATP_Dictionary *p_root, signed long long p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetInt(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetInt(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetDouble(const ATP_Path *p_path, ATP_Dictionary *p_root, double p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetDouble(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetDouble(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetBool(const ATP_Path *p_path, ATP_Dictionary *p_root, int p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetBool(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetBool(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetDict(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Dictionary p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetDict(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetDict(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+int ATP_pathSetArray(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Array p_value)
+{
+    PathTarget l_target;
+    ATP_DictionaryIterator l_entry = createLast(p_path, p_root, &l_target);
+    if (l_entry != NULL)
+    {
+        return ATP_dictionaryItSetArray(l_entry, p_value);
+    }
+
+    return (l_target.m_array != NULL && ATP_arraySetArray(l_target.m_array, LASTINDEX(p_path), p_value));
+}
+
+static unsigned int visit(const ATP_PathImpl *p_path, unsigned int p_segment, const Value *p_value, ATP_PathVisitor p_visitor,
+                          void *p_context, int *p_stop)
+{
+    unsigned int l_visited = 0;
+    const PathSegment *l_segment = &p_path->m_segments[p_segment];
+    Value l_scratch;
+
+    if (p_segment == p_path->m_count)
+    {
+        // the visitor is handed a borrowed view of the value, which holds no reference of its own
+        ATP_Value l_view;
+        memcpy(&l_view.m_data, p_value, sizeof(Value));
+        l_view.m_arena = NULL;
+        *p_stop = !p_visitor(&l_view, p_context);
+        return 1;
+    }
+
+    if (l_segment->m_type == e_PathSegmentType_anyKey && p_value->m_type == e_ATP_ValueType_dict)
+    {
+        ATP_DictionaryIterator it;
+        for (it = ATP_dictionaryBeginConst(&p_value->m_value.m_dict); ATP_dictionaryHasNext(it) && !*p_stop;
+             it = ATP_dictionaryNext(it))
+        {
+            l_visited += visit(p_path, p_segment + 1, Value_iteratorValue(it), p_visitor, p_context, p_stop);
+        }
+    }
+    else if (l_segment->m_type == e_PathSegmentType_anyIndex && p_value->m_type == e_ATP_ValueType_array)
+    {
+        unsigned int i;
+        unsigned int l_length = ATP_arrayLength(&p_value->m_value.m_array);
+        for (i = 0; i < l_length && !*p_stop; ++i)
+        {
+            l_visited += visit(p_path, p_segment + 1, Value_arrayEntry(&p_value->m_value.m_array, i, &l_scratch), p_visitor,
+                               p_context, p_stop);
+        }
+    }
+    else
+    {
+        const Value *l_next = step(p_value, l_segment, &l_scratch);
+        if (l_next != NULL)
+        {
+            l_visited = visit(p_path, p_segment + 1, l_next, p_visitor, p_context, p_stop);
+        }
+    }
+
+    return l_visited;
+}
+
+unsigned int ATP_pathForEach(const ATP_Path *p_path, const ATP_Dictionary *p_root, ATP_PathVisitor p_visitor, void *p_context)
+{
+    int l_stop = 0;
+    Value l_root;
+
+    l_root.m_type = e_ATP_ValueType_dict;
+    l_root.m_value.m_dict = *p_root;
+    return visit(*p_path, 0, &l_root, p_visitor, p_context, &l_stop);
+}
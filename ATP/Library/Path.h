@@ -0,0 +1,316 @@
+/* File: Path.h
+Compiled path expressions, for reaching values nested in a dictionary in a single call.
+
+A path is a sequence of dictionary keys and array indices, written as in
+
+    a.b[3].c
+
+Keys are separated by periods and indices are enclosed in square brackets.  A backslash includes the character following it in
+a key as is, so that keys containing periods, brackets or backslashes can be named.  A key of * on its own matches every entry
+of a dictionary, and an index of [*] matches every entry of an array; paths containing either of these can only be evaluated
+with <ATP_pathForEach>.
+
+Compiling a path parses it and hashes its keys once, so that a path evaluated against many dictionaries should be compiled once
+up front and reused.  A compiled path is never modified, and may be used from any number of threads at once.
+*/
+#ifndef _ATP_LIBRARY_PATH_H_
+#define _ATP_LIBRARY_PATH_H_
+
+#include "Export.h"
+#include "Value.h"
+#include "Dictionary.h"
+#include "Array.h"
+
+// forward declaration
+struct ATP_PathImpl;
+
+/* Type: ATP_Path
+Reference to a compiled path.
+*/
+typedef struct ATP_PathImpl *ATP_Path;
+
+/* Type: ATP_PathVisitor
+Function called by <ATP_pathForEach> for each value matching a path.
+
+Parameters:
+    p_value   - The matching value, which is only valid for the duration of the call and must not be destroyed or taken from.
+    p_context - The context pointer given to <ATP_pathForEach>.
+
+Returns:
+    1 to continue with the next match, 0 to stop.
+*/
+typedef int (*ATP_PathVisitor)(const ATP_Value *p_value, void *p_context);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_pathCompile
+Compile a path expression.
+
+Parameters:
+    p_path       - The path handle to initialize.
+    p_expression - The path expression.
+
+Returns:
+    1 on success, 0 (after printing an error) if the expression is not a valid path.
+*/
+EXPORT int ATP_pathCompile(ATP_Path *p_path, const char *p_expression);
+/* Function: ATP_pathDestroy
+Destroy a compiled path.
+
+Parameters:
+    p_path - The path handle.
+*/
+EXPORT void ATP_pathDestroy(ATP_Path *p_path);
+/* Function: ATP_pathIsWildcard
+Check whether a path contains a wildcard.
+
+Parameters:
+    p_path - The path handle.
+
+Returns:
+    1 if the path can only be evaluated with <ATP_pathForEach>, 0 otherwise.
+*/
+EXPORT int ATP_pathIsWildcard(const ATP_Path *p_path);
+
+/* Function: ATP_pathGetType
+Get the type of the value at a path.
+
+Parameters:
+    p_path - The path handle.
+    p_root - The dictionary to evaluate the path against.
+
+Returns:
+    The type of the value, or <e_ATP_ValueType_none> if there is no value at the path.
+*/
+EXPORT ATP_ValueType ATP_pathGetType(const ATP_Path *p_path, const ATP_Dictionary *p_root);
+/* Function: ATP_pathGetString
+Get the string at a path.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the string in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetString(const ATP_Path *p_path, const ATP_Dictionary *p_root, const char **p_value);
+/* Function: ATP_pathGetUint
+Get the unsigned integer at a path.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the integer in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetUint(const ATP_Path *p_path, const ATP_Dictionary *p_root, unsigned long long *p_value);
+/* Function: ATP_pathGetInt
+Get the signed integer at a path.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the integer in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetInt(const ATP_Path *p_path, const ATP_Dictionary *p_root, signed long long *p_value);
+/* Function: ATP_pathGetDouble
+Get the floating point value at a path.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the number in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetDouble(const ATP_Path *p_path, const ATP_Dictionary *p_root, double *p_value);
+/* Function: ATP_pathGetBool
+Get the boolean value at a path.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the boolean in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetBool(const ATP_Path *p_path, const ATP_Dictionary *p_root, int *p_value);
+/* Function: ATP_pathGetDictConst
+Get the dictionary at a path, for reading only.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the dictionary handle in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetDictConst(const ATP_Path *p_path, const ATP_Dictionary *p_root, const ATP_Dictionary **p_value);
+/* Function: ATP_pathGetArrayConst
+Get the array at a path, for reading only.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the array handle in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetArrayConst(const ATP_Path *p_path, const ATP_Dictionary *p_root, const ATP_Array **p_value);
+/* Function: ATP_pathGetDict
+Get the dictionary at a path, for modification.  Every dictionary and array along the path is copied first if it is shared.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the dictionary handle in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetDict(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Dictionary **p_value);
+/* Function: ATP_pathGetArray
+Get the array at a path, for modification.  Every dictionary and array along the path is copied first if it is shared.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The location to store the array handle in.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if there is no value at the path or it is of the wrong type then 0 will be
+    returned.
+*/
+EXPORT int ATP_pathGetArray(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Array **p_value);
+
+/* Function: ATP_pathSetString
+Set the value at a path to a copy of a string.  Dictionaries and arrays missing along the path are created, and every one along
+the path is copied first if it is shared.  An index may be at most the length of its array, as with <ATP_arraySetString>, so an
+index into an array that is created must be 0.  The whole path is checked before anything is created, so a set that fails
+leaves the dictionary unchanged.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The string to store.
+
+Returns:
+    1 on success, 0 on failure.  In particular, if a value along the path is neither missing nor of the type the path requires
+    then 0 will be returned.
+*/
+EXPORT int ATP_pathSetString(const ATP_Path *p_path, ATP_Dictionary *p_root, const char *p_value);
+/* Function: ATP_pathSetUint
+Set the value at a path to an unsigned integer.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The integer to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetUint(const ATP_Path *p_path, ATP_Dictionary *p_root, unsigned long long p_value);
+/* Function: ATP_pathSetInt
+Set the value at a path to a signed integer.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The integer to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetInt(const ATP_Path *p_path, ATP_Dictionary *p_root, signed long long p_value);
+/* Function: ATP_pathSetDouble
+Set the value at a path to a floating point value.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The number to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetDouble(const ATP_Path *p_path, ATP_Dictionary *p_root, double p_value);
+/* Function: ATP_pathSetBool
+Set the value at a path to a boolean value.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The boolean to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetBool(const ATP_Path *p_path, ATP_Dictionary *p_root, int p_value);
+/* Function: ATP_pathSetDict
+Set the value at a path to a dictionary, taking over ownership of it as with <ATP_dictionarySetDict>.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The dictionary to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetDict(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Dictionary p_value);
+/* Function: ATP_pathSetArray
+Set the value at a path to an array, taking over ownership of it as with <ATP_dictionarySetArray>.  See <ATP_pathSetString>.
+
+Parameters:
+    p_path  - The path handle.
+    p_root  - The dictionary to evaluate the path against.
+    p_value - The array to store.
+
+Returns:
+    1 on success, 0 on failure.
+*/
+EXPORT int ATP_pathSetArray(const ATP_Path *p_path, ATP_Dictionary *p_root, ATP_Array p_value);
+
+/* Function: ATP_pathForEach
+Call a function for each value matching a path, which may contain wildcards.  Matches are visited in the iteration order of the
+dictionaries and arrays they are found in.
+
+Parameters:
+    p_path    - The path handle.
+    p_root    - The dictionary to evaluate the path against.
+    p_visitor - The function to call for each match.
+    p_context - A pointer to pass on to the function.
+
+Returns:
+    The number of matches visited.
+*/
+EXPORT unsigned int ATP_pathForEach(const ATP_Path *p_path, const ATP_Dictionary *p_root, ATP_PathVisitor p_visitor,
+                                    void *p_context);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_PATH_H_ */
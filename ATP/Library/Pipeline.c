@@ -0,0 +1,1095 @@
+#include "Pipeline.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Atomic.inc"
+#include "Queue.inc"
+#include "Thread.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include "ATP/ThirdParty/UT/utlist.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PipelineBatch
+{
+    unsigned int m_count;
+    ATP_Dictionary m_records[c_ATP_Pipeline_batchSize];
+} PipelineBatch;
+
+typedef enum TeeState
+{
+    e_TeeState_pending = 0,
+    e_TeeState_ready,
+    e_TeeState_failed
+} TeeState;
+
+typedef struct PipelineTee
+{
+    char *m_name;
+    // copies of the records passing the tee, and whether they came from a streaming processor
+    ATP_Array m_records;
+    int m_streamed;
+    // the number of branches yet to start from the records
+    AtomicCount m_users;
+    unsigned int m_userCount;
+    TeeState m_state;
+    Mutex m_mutex;
+    Condition m_condition;
+    struct PipelineTee *next;
+} PipelineTee;
+
+// forward references
+struct PipelineStage;
+struct PipelineSegment;
+
+struct ATP_ProcessorSink
+{
+    // the stage the records are passed to, or NULL if they leave the segment
+    struct PipelineStage *m_target;
+    struct PipelineSegment *m_segment;
+    // the measurements of a streaming processor, when profiling, which the records it emits are counted in
+    ATP_ProfileStats *m_profile;
+    // the handle of the record being consumed, which is cleared if the processor emits the record itself
+    ATP_Dictionary *m_consumed;
+};
+
+typedef struct PipelineStage
+{
+    // exactly one of these is set
+    ATP_Processor *m_processor;
+    PipelineTee *m_tee;
+    int m_streaming;
+    // a whole dictionary processor following a streaming one gathers the records it receives, otherwise the single record
+    // it receives is its input
+    int m_gather;
+    ATP_Dictionary m_input;
+    ATP_Array m_records;
+    ATP_ProcessorSink m_sink;
+    // the result of a pass-through processor run on the shared pool
+    int m_effectResult;
+} PipelineStage;
+
+typedef struct PipelineSegment
+{
+    PipelineStage *m_stages;
+    unsigned int m_length;
+    unsigned int m_count;
+    // the first segment starts from the source records, every other one from the queue
+    const ATP_Array *m_source;
+    Queue *m_input;
+    Queue *m_output;
+    PipelineBatch *m_batch;
+    AtomicCount *m_failed;
+    // the pass-through stage still running on the shared pool, if any
+    PipelineStage *m_effect;
+    ATP_TaskGroup m_effects;
+    // the context of the thread executing the pipeline, which the thread of the segment takes on
+    ATP_ProcessorContext *m_context;
+    Thread m_thread;
+} PipelineSegment;
+
+typedef struct PipelineBranch
+{
+    PipelineStage *m_stages;
+    unsigned int m_length;
+    unsigned int m_capacity;
+    // whether the records currently leaving the end of the branch come from a streaming processor
+    int m_streams;
+    // a branch starts from no records, from the records of a single tee, or from a dictionary joining several tees
+    PipelineTee **m_sources;
+    unsigned int m_sourceCount;
+    int m_join;
+    unsigned int m_count;
+    unsigned int m_threads;
+    int m_result;
+    ATP_ProcessorContext *m_context;
+    Thread m_thread;
+    struct PipelineBranch *next;
+} PipelineBranch;
+
+struct ATP_PipelineImpl
+{
+    PipelineBranch *m_branches;
+    PipelineBranch *m_last;
+    PipelineTee *m_tees;
+    unsigned int m_count;
+};
+
+static void destroyBatch(PipelineBatch *p_batch)
+{
+    unsigned int i;
+    for (i = 0; i < p_batch->m_count; ++i)
+    {
+        ATP_dictionaryDestroy(&p_batch->m_records[i]);
+    }
+    free(p_batch);
+}
+
+// pass on the records collected so far to the next segment
+static int segmentSend(PipelineSegment *p_segment)
+{
+    PipelineBatch *l_batch = p_segment->m_batch;
+    if (l_batch == NULL)
+    {
+        return 1;
+    }
+
+    p_segment->m_batch = NULL;
+    if (!Queue_push(p_segment->m_output, l_batch))
+    {
+        // a later segment has stopped
+        destroyBatch(l_batch);
+        return 0;
+    }
+    return 1;
+}
+
+static int segmentEmit(PipelineSegment *p_segment, ATP_Dictionary p_record)
+{
+    if (p_segment->m_output == NULL)
+    {
+        // the output of the last processor is discarded
+        ATP_dictionaryDestroy(&p_record);
+        return 1;
+    }
+
+    if (p_segment->m_batch == NULL)
+    {
+        p_segment->m_batch = malloc(sizeof(PipelineBatch));
+        if (p_segment->m_batch == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        p_segment->m_batch->m_count = 0;
+    }
+
+    p_segment->m_batch->m_records[p_segment->m_batch->m_count++] = p_record;
+    return (p_segment->m_batch->m_count < c_ATP_Pipeline_batchSize ? 1 : segmentSend(p_segment));
+}
+
+static void teeSettle(PipelineTee *p_tee, TeeState p_state)
+{
+    Mutex_lock(&p_tee->m_mutex);
+    if (p_tee->m_state == e_TeeState_pending)
+    {
+        p_tee->m_state = p_state;
+    }
+    Condition_broadcast(&p_tee->m_condition);
+    Mutex_unlock(&p_tee->m_mutex);
+}
+
+static TeeState teeWait(PipelineTee *p_tee)
+{
+    TeeState l_state;
+
+    Mutex_lock(&p_tee->m_mutex);
+    while (p_tee->m_state == e_TeeState_pending)
+    {
+        Condition_wait(&p_tee->m_condition, &p_tee->m_mutex);
+    }
+    l_state = p_tee->m_state;
+    Mutex_unlock(&p_tee->m_mutex);
+
+    return l_state;
+}
+
+static void teeRelease(PipelineTee *p_tee)
+{
+    if (ATOMIC_DECREMENT(p_tee->m_users) == 0)
+    {
+        // every branch using the records has its own reference to them by now
+        ATP_arrayDestroy(&p_tee->m_records);
+        ATP_arrayInit(&p_tee->m_records);
+    }
+}
+
+// the records of a tee, as they would be given to a whole dictionary processor
+static ATP_Dictionary teeResult(const PipelineTee *p_tee)
+{
+    ATP_Dictionary l_result;
+    const ATP_Dictionary *l_record;
+
+    if (p_tee->m_streamed)
+    {
+        ATP_dictionaryInit(&l_result);
+        ATP_dictionarySetArray(&l_result, c_ATP_Processor_recordsKey, ATP_arrayDuplicate(&p_tee->m_records));
+        return l_result;
+    }
+    else if (ATP_arrayGetDictConst(&p_tee->m_records, 0, &l_record))
+    {
+        return ATP_dictionaryDuplicate(l_record);
+    }
+
+    ATP_dictionaryInit(&l_result);
+    return l_result;
+}
+
+// measure a call into a streaming processor, if profiling, and trace it unless it is one of the many calls for each record
+static void stageStart(PipelineStage *p_stage, ATP_ProfileSample *p_sample, const char *p_call)
+{
+    if (p_call != NULL)
+    {
+        ATP_traceBegin(p_call, p_stage->m_processor->m_interface.m_name);
+    }
+    if (p_stage->m_sink.m_profile != NULL)
+    {
+        ATP_profileStart(p_sample);
+    }
+}
+
+static int stageStop(PipelineStage *p_stage, const ATP_ProfileSample *p_sample, const char *p_call, int p_result)
+{
+    if (p_stage->m_sink.m_profile != NULL)
+    {
+        ATP_profileStop(p_stage->m_sink.m_profile, p_sample);
+    }
+    if (p_call != NULL)
+    {
+        ATP_traceEnd();
+    }
+    return p_result;
+}
+
+static void runEffect(void *p_stage)
+{
+    PipelineStage *l_stage = p_stage;
+    ATP_Dictionary l_output;
+
+    // the output is the input passed on, which the rest of the pipeline already has
+    ATP_dictionaryInit(&l_output);
+    l_stage->m_effectResult = ATP_processorRun(l_stage->m_processor, l_stage->m_sink.m_segment->m_count, &l_stage->m_input,
+                                               &l_output);
+    ATP_dictionaryDestroy(&l_stage->m_input);
+    ATP_dictionaryDestroy(&l_output);
+}
+
+// wait for the pass-through stage of a segment still running, if any, returning whether it succeeded
+static int segmentSettle(PipelineSegment *p_segment)
+{
+    int l_result = 1;
+
+    if (p_segment->m_effect != NULL)
+    {
+        ATP_taskGroupDestroy(&p_segment->m_effects);
+        l_result = p_segment->m_effect->m_effectResult;
+        p_segment->m_effect = NULL;
+    }
+    return l_result;
+}
+
+// wait for the pass-through stage still running before the given stage, unless the given stage cannot depend on its effects,
+// returning whether it succeeded
+static int stageSettle(PipelineStage *p_stage)
+{
+    // a pure processor depends on nothing but its input, while the records of a tee may be handed to other branches
+    if (p_stage->m_processor != NULL && (ATP_processorFlags(p_stage->m_processor) & c_ATP_ProcessorFlag_pure) != 0)
+    {
+        return 1;
+    }
+    return segmentSettle(p_stage->m_sink.m_segment);
+}
+
+static int stageBegin(PipelineStage *p_stage)
+{
+    if (p_stage->m_streaming && p_stage->m_processor->m_interface.begin != NULL)
+    {
+        ATP_ProcessorInterface *l_interface = &p_stage->m_processor->m_interface;
+        ATP_ProfileSample l_sample;
+
+        stageStart(p_stage, &l_sample, "begin");
+        return stageStop(p_stage, &l_sample, "begin", l_interface->begin(p_stage->m_sink.m_segment->m_count, l_interface->m_token));
+    }
+    return 1;
+}
+
+// takes over ownership of the record
+static int stageConsume(PipelineStage *p_stage, ATP_Dictionary *p_record)
+{
+    if (p_stage->m_tee != NULL)
+    {
+        if (p_stage->m_tee->m_userCount > 0)
+        {
+            ATP_Array *l_records = &p_stage->m_tee->m_records;
+            ATP_arraySetDict(l_records, ATP_arrayLength(l_records), ATP_dictionaryDuplicate(p_record));
+        }
+        return ATP_processorEmit(&p_stage->m_sink, *p_record);
+    }
+    else if (p_stage->m_streaming)
+    {
+        ATP_ProcessorInterface *l_interface = &p_stage->m_processor->m_interface;
+        ATP_ProfileSample l_sample;
+        int l_result;
+
+        if (!stageSettle(p_stage))
+        {
+            ATP_dictionaryDestroy(p_record);
+            return 0;
+        }
+        if (p_stage->m_sink.m_profile != NULL)
+        {
+            ATP_profileCountInput(p_stage->m_sink.m_profile, p_record);
+        }
+        stageStart(p_stage, &l_sample, NULL);
+        p_stage->m_sink.m_consumed = p_record;
+        l_result = stageStop(p_stage, &l_sample, NULL, l_interface->consume(p_record, &p_stage->m_sink, l_interface->m_token));
+        p_stage->m_sink.m_consumed = NULL;
+        ATP_dictionaryDestroy(p_record);
+        return l_result;
+    }
+    else if (p_stage->m_gather)
+    {
+        return ATP_arraySetDict(&p_stage->m_records, ATP_arrayLength(&p_stage->m_records), *p_record);
+    }
+
+    ATP_dictionaryDestroy(&p_stage->m_input);
+    p_stage->m_input = *p_record;
+    return 1;
+}
+
+static int stageFlush(PipelineStage *p_stage)
+{
+    if (p_stage->m_streaming && p_stage->m_processor->m_interface.flush != NULL)
+    {
+        ATP_ProcessorInterface *l_interface = &p_stage->m_processor->m_interface;
+        ATP_ProfileSample l_sample;
+
+        if (!stageSettle(p_stage))
+        {
+            return 0;
+        }
+        stageStart(p_stage, &l_sample, "flush");
+        return stageStop(p_stage, &l_sample, "flush", l_interface->flush(&p_stage->m_sink, l_interface->m_token));
+    }
+    return 1;
+}
+
+// determine whether a stage can pass its input on at once and run its processor alongside the stages after it
+static int stageOverlaps(const PipelineStage *p_stage)
+{
+    return ((ATP_processorFlags(p_stage->m_processor) & c_ATP_ProcessorFlag_passThrough) != 0
+            && !ATP_processorHelpRequested() && ATP_threadPoolSize(ATP_threadPoolShared()) > 1);
+}
+
+static int stageEnd(PipelineStage *p_stage)
+{
+    ATP_Dictionary l_output;
+    int l_result;
+
+    if (p_stage->m_tee != NULL)
+    {
+        // the branches starting from the tee may depend on the effects of the processors before it
+        l_result = stageSettle(p_stage);
+        teeSettle(p_stage->m_tee, (l_result ? e_TeeState_ready : e_TeeState_failed));
+        return l_result;
+    }
+    else if (p_stage->m_streaming)
+    {
+        ATP_ProcessorInterface *l_interface = &p_stage->m_processor->m_interface;
+        ATP_ProfileSample l_sample;
+
+        if (l_interface->end == NULL)
+        {
+            return 1;
+        }
+        else if (!stageSettle(p_stage))
+        {
+            return 0;
+        }
+        stageStart(p_stage, &l_sample, "end");
+        return stageStop(p_stage, &l_sample, "end", l_interface->end(&p_stage->m_sink, l_interface->m_token));
+    }
+
+    if (p_stage->m_gather)
+    {
+        ATP_dictionarySetArray(&p_stage->m_input, c_ATP_Processor_recordsKey, p_stage->m_records);
+        ATP_arrayInit(&p_stage->m_records);
+    }
+
+    if (stageOverlaps(p_stage))
+    {
+        PipelineSegment *l_segment = p_stage->m_sink.m_segment;
+
+        // the effects of pass-through processors happen in order, so only one runs at a time
+        if (!segmentSettle(l_segment))
+        {
+            return 0;
+        }
+        l_output = ATP_dictionaryDuplicate(&p_stage->m_input);
+        l_segment->m_effect = p_stage;
+        ATP_taskGroupInit(&l_segment->m_effects, ATP_threadPoolShared());
+        ATP_taskGroupRun(&l_segment->m_effects, &runEffect, p_stage);
+        return ATP_processorEmit(&p_stage->m_sink, l_output);
+    }
+
+    // only pure processors carry on while a pass-through processor before them is still running, as any other may read what
+    // it writes
+    if (!stageSettle(p_stage))
+    {
+        return 0;
+    }
+
+    // whatever the processor left of its input is no longer needed
+    ATP_dictionaryInit(&l_output);
+    l_result = ATP_processorRun(p_stage->m_processor, p_stage->m_sink.m_segment->m_count, &p_stage->m_input, &l_output);
+    ATP_dictionaryDestroy(&p_stage->m_input);
+    if (!l_result)
+    {
+        // the processor should log its own error
+        ATP_dictionaryDestroy(&l_output);
+        return 0;
+    }
+
+    return ATP_processorEmit(&p_stage->m_sink, l_output);
+}
+
+static int sinkForward(ATP_ProcessorSink *p_sink, ATP_Dictionary p_record)
+{
+    if (p_sink->m_target != NULL)
+    {
+        return stageConsume(p_sink->m_target, &p_record);
+    }
+    return segmentEmit(p_sink->m_segment, p_record);
+}
+
+int ATP_processorEmit(ATP_ProcessorSink *p_sink, ATP_Dictionary p_record)
+{
+    ATP_ProfileSample l_sample;
+    int l_result;
+
+    // a record passed on as it was received now belongs to the rest of the pipeline, so it must not be destroyed as well
+    if (p_sink->m_consumed != NULL && p_record != NULL && *p_sink->m_consumed == p_record)
+    {
+        ATP_dictionaryInit(p_sink->m_consumed);
+    }
+
+    if (p_sink->m_profile == NULL)
+    {
+        return sinkForward(p_sink, p_record);
+    }
+
+    // the later processors and any wait for the next thread are not part of the emitting processor's measurements
+    ATP_profileCountOutput(p_sink->m_profile, &p_record);
+    ATP_profileStart(&l_sample);
+    l_result = sinkForward(p_sink, p_record);
+    ATP_profileExclude(p_sink->m_profile, &l_sample);
+    return l_result;
+}
+
+int ATP_processorForwardRecord(ATP_ProcessorSink *p_sink, ATP_Dictionary *p_record)
+{
+    ATP_Dictionary l_record = *p_record;
+    ATP_dictionaryInit(p_record);
+    return ATP_processorEmit(p_sink, l_record);
+}
+
+static int flushSegment(PipelineSegment *p_segment)
+{
+    unsigned int i;
+    for (i = 0; i < p_segment->m_length; ++i)
+    {
+        if (!stageFlush(&p_segment->m_stages[i]))
+        {
+            return 0;
+        }
+    }
+    return segmentSend(p_segment);
+}
+
+static void runSegment(void *p_segment)
+{
+    PipelineSegment *l_segment = p_segment;
+    PipelineStage *l_stages = l_segment->m_stages;
+    unsigned int i;
+    int l_result = 1;
+    ATP_ProcessorContext *l_previous = ATP_processorContextSwitch(l_segment->m_context);
+
+    // segments are named after their first processor, unless that is a tee
+    ATP_traceBegin("segment", (l_stages[0].m_processor != NULL ? l_stages[0].m_processor->m_interface.m_name : NULL));
+    for (i = 0; l_result && i < l_segment->m_length; ++i)
+    {
+        l_result = stageBegin(&l_stages[i]);
+    }
+
+    if (l_segment->m_source != NULL)
+    {
+        unsigned int l_length = ATP_arrayLength(l_segment->m_source);
+        for (i = 0; l_result && i < l_length; ++i)
+        {
+            const ATP_Dictionary *l_record;
+            ATP_Dictionary l_copy;
+
+            ATP_arrayGetDictConst(l_segment->m_source, i, &l_record);
+            l_copy = ATP_dictionaryDuplicate(l_record);
+            l_result = stageConsume(&l_stages[0], &l_copy);
+        }
+        l_result = l_result && flushSegment(l_segment);
+    }
+    else if (l_segment->m_input != NULL)
+    {
+        void *l_item;
+        while (l_result && Queue_pop(l_segment->m_input, &l_item))
+        {
+            PipelineBatch *l_batch = l_item;
+            ATP_traceBegin("batch", NULL);
+            for (i = 0; i < l_batch->m_count; ++i)
+            {
+                if (l_result)
+                {
+                    l_result = stageConsume(&l_stages[0], &l_batch->m_records[i]);
+                }
+                else
+                {
+                    ATP_dictionaryDestroy(&l_batch->m_records[i]);
+                }
+            }
+            free(l_batch);
+
+            l_result = l_result && flushSegment(l_segment);
+            ATP_traceEnd();
+        }
+    }
+
+    // the records seen so far are incomplete if an earlier segment failed, so nothing is ended in that case
+    if (l_result && !ATOMIC_LOAD(*l_segment->m_failed))
+    {
+        for (i = 0; l_result && i < l_segment->m_length; ++i)
+        {
+            l_result = stageEnd(&l_stages[i]);
+        }
+        // the processors of the next segment may depend on the effects of a pass-through stage still running, so the last
+        // records are only sent once it has finished
+        l_result = l_result && segmentSettle(l_segment) && segmentSend(l_segment);
+    }
+    l_result = segmentSettle(l_segment) && l_result;
+    if (!l_result)
+    {
+        ATOMIC_STORE(*l_segment->m_failed, 1);
+    }
+    if (l_segment->m_batch != NULL)
+    {
+        destroyBatch(l_segment->m_batch);
+        l_segment->m_batch = NULL;
+    }
+
+    // stop the segments on either side; anything still queued is released once every thread is done
+    if (l_segment->m_input != NULL)
+    {
+        Queue_close(l_segment->m_input);
+    }
+    if (l_segment->m_output != NULL)
+    {
+        Queue_close(l_segment->m_output);
+    }
+    ATP_traceEnd();
+    ATP_processorContextSwitch(l_previous);
+}
+
+// run a chain of stages, divided between up to the given number of threads, starting from the source records if any
+static int runChain(PipelineStage *p_stages, unsigned int p_length, unsigned int p_count, unsigned int p_threads,
+                    const ATP_Array *p_source)
+{
+    unsigned int i;
+    unsigned int l_segments;
+    PipelineSegment *l_segment;
+    Queue *l_queues = NULL;
+    AtomicCount l_failed = 0;
+
+    if (p_length == 0)
+    {
+        return 1;
+    }
+
+    l_segments = (p_threads == 0 ? Thread_cpuCount() : p_threads);
+    if (l_segments > p_length)
+    {
+        l_segments = p_length;
+    }
+
+    l_segment = malloc(l_segments * sizeof(PipelineSegment));
+    if (l_segments > 1)
+    {
+        l_queues = malloc((l_segments - 1) * sizeof(Queue));
+    }
+    if (l_segment == NULL || (l_segments > 1 && l_queues == NULL))
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // divide the stages as evenly as possible between the segments, keeping their order
+    for (i = 0; i < l_segments; ++i)
+    {
+        unsigned int j;
+        unsigned int l_first = i * p_length / l_segments;
+
+        l_segment[i].m_stages = &p_stages[l_first];
+        l_segment[i].m_length = (i + 1) * p_length / l_segments - l_first;
+        l_segment[i].m_count = p_count;
+        l_segment[i].m_source = (i == 0 ? p_source : NULL);
+        l_segment[i].m_input = (i > 0 ? &l_queues[i - 1] : NULL);
+        l_segment[i].m_output = (i + 1 < l_segments ? &l_queues[i] : NULL);
+        l_segment[i].m_batch = NULL;
+        l_segment[i].m_failed = &l_failed;
+        l_segment[i].m_effect = NULL;
+        l_segment[i].m_context = ATP_processorContextCurrent();
+
+        for (j = 0; j < l_segment[i].m_length; ++j)
+        {
+            PipelineStage *l_stage = &l_segment[i].m_stages[j];
+            ATP_dictionaryInit(&l_stage->m_input);
+            ATP_arrayInit(&l_stage->m_records);
+            l_stage->m_sink.m_target = (j + 1 < l_segment[i].m_length ? l_stage + 1 : NULL);
+            l_stage->m_sink.m_segment = &l_segment[i];
+            l_stage->m_sink.m_profile = (l_stage->m_streaming && ATP_profileEnabled() ? &l_stage->m_processor->m_profile : NULL);
+            l_stage->m_sink.m_consumed = NULL;
+        }
+
+        if (i + 1 < l_segments)
+        {
+            Queue_init(&l_queues[i], c_ATP_Pipeline_queueCapacity);
+        }
+    }
+    DBG("Running %u stages on %u threads\n", p_length, l_segments);
+
+    // the last segment runs on the calling thread
+    for (i = 0; i + 1 < l_segments; ++i)
+    {
+        Thread_start(&l_segment[i].m_thread, &runSegment, &l_segment[i]);
+    }
+    runSegment(&l_segment[l_segments - 1]);
+    for (i = 0; i + 1 < l_segments; ++i)
+    {
+        Thread_join(&l_segment[i].m_thread);
+    }
+
+    for (i = 0; i + 1 < l_segments; ++i)
+    {
+        void *l_item;
+        while (Queue_pop(&l_queues[i], &l_item))
+        {
+            destroyBatch(l_item);
+        }
+        Queue_destroy(&l_queues[i]);
+    }
+    for (i = 0; i < p_length; ++i)
+    {
+        ATP_dictionaryDestroy(&p_stages[i].m_input);
+        ATP_arrayDestroy(&p_stages[i].m_records);
+    }
+    free(l_queues);
+    free(l_segment);
+
+    return !l_failed;
+}
+
+int ATP_pipelineRun(ATP_Processor *p_processors, unsigned int p_threads)
+{
+    unsigned int l_count = 0;
+    PipelineStage *l_stages;
+    ATP_Processor *it;
+    int l_result;
+
+    for (it = p_processors; it != NULL; it = it->next)
+    {
+        ++l_count;
+    }
+    if (l_count == 0)
+    {
+        return 1;
+    }
+
+    l_stages = malloc(l_count * sizeof(PipelineStage));
+    if (l_stages == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    l_count = 0;
+    for (it = p_processors; it != NULL; it = it->next, ++l_count)
+    {
+        l_stages[l_count].m_processor = it;
+        l_stages[l_count].m_tee = NULL;
+        l_stages[l_count].m_streaming = ATP_processorIsStreaming(it);
+        l_stages[l_count].m_gather = (l_count > 0 && l_stages[l_count - 1].m_streaming);
+    }
+
+    l_result = runChain(l_stages, l_count, l_count, p_threads, NULL);
+    free(l_stages);
+    return l_result;
+}
+
+static PipelineStage *addStage(PipelineBranch *p_branch)
+{
+    PipelineStage *l_stage;
+
+    if (p_branch->m_length == p_branch->m_capacity)
+    {
+        unsigned int l_capacity = (p_branch->m_capacity == 0 ? 4 : p_branch->m_capacity * 2);
+        PipelineStage *l_stages = realloc(p_branch->m_stages, l_capacity * sizeof(PipelineStage));
+        if (l_stages == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        p_branch->m_stages = l_stages;
+        p_branch->m_capacity = l_capacity;
+    }
+
+    l_stage = &p_branch->m_stages[p_branch->m_length++];
+    l_stage->m_processor = NULL;
+    l_stage->m_tee = NULL;
+    l_stage->m_streaming = 0;
+    l_stage->m_gather = 0;
+    return l_stage;
+}
+
+static PipelineBranch *addBranch(ATP_Pipeline *p_pipeline, unsigned int p_sourceCount)
+{
+    PipelineBranch *l_branch = calloc(1, sizeof(PipelineBranch));
+    if (l_branch == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    if (p_sourceCount > 0)
+    {
+        l_branch->m_sources = malloc(p_sourceCount * sizeof(PipelineTee *));
+        if (l_branch->m_sources == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+
+    LL_APPEND((*p_pipeline)->m_branches, l_branch);
+    (*p_pipeline)->m_last = l_branch;
+    return l_branch;
+}
+
+static PipelineTee *findTee(const ATP_Pipeline *p_pipeline, const char *p_name)
+{
+    PipelineTee *it;
+    LL_FOREACH((*p_pipeline)->m_tees, it)
+    {
+        if (strcmp(it->m_name, p_name) == 0)
+        {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+void ATP_pipelineInit(ATP_Pipeline *p_pipeline)
+{
+    *p_pipeline = calloc(1, sizeof(struct ATP_PipelineImpl));
+    if (*p_pipeline == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // the first branch starts from no records
+    addBranch(p_pipeline, 0);
+}
+
+void ATP_pipelineDestroy(ATP_Pipeline *p_pipeline)
+{
+    PipelineBranch *l_branch;
+    PipelineBranch *l_nextBranch;
+    PipelineTee *l_tee;
+    PipelineTee *l_nextTee;
+
+    if (*p_pipeline == NULL)
+    {
+        return;
+    }
+
+    LL_FOREACH_SAFE((*p_pipeline)->m_branches, l_branch, l_nextBranch)
+    {
+        unsigned int i;
+        for (i = 0; i < l_branch->m_length; ++i)
+        {
+            if (l_branch->m_stages[i].m_processor != NULL)
+            {
+                ATP_processorUnload(l_branch->m_stages[i].m_processor);
+            }
+        }
+        free(l_branch->m_stages);
+        free(l_branch->m_sources);
+        free(l_branch);
+    }
+    LL_FOREACH_SAFE((*p_pipeline)->m_tees, l_tee, l_nextTee)
+    {
+        ATP_arrayDestroy(&l_tee->m_records);
+        Condition_destroy(&l_tee->m_condition);
+        Mutex_destroy(&l_tee->m_mutex);
+        free(l_tee->m_name);
+        free(l_tee);
+    }
+
+    free(*p_pipeline);
+    *p_pipeline = NULL;
+}
+
+void ATP_pipelineAppend(ATP_Pipeline *p_pipeline, ATP_Processor *p_processor)
+{
+    PipelineBranch *l_branch = (*p_pipeline)->m_last;
+    PipelineStage *l_stage = addStage(l_branch);
+
+    l_stage->m_processor = p_processor;
+    l_stage->m_streaming = ATP_processorIsStreaming(p_processor);
+    l_stage->m_gather = l_branch->m_streams;
+    l_branch->m_streams = l_stage->m_streaming;
+    ++(*p_pipeline)->m_count;
+}
+
+int ATP_pipelineTee(ATP_Pipeline *p_pipeline, const char *p_name)
+{
+    PipelineBranch *l_branch = (*p_pipeline)->m_last;
+    PipelineTee *l_tee;
+
+    if (findTee(p_pipeline, p_name) != NULL)
+    {
+        ERR("A tee named '%s' already exists\n", p_name);
+        return 0;
+    }
+
+    l_tee = calloc(1, sizeof(PipelineTee));
+    if (l_tee == NULL || (l_tee->m_name = strdup(p_name)) == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    ATP_arrayInit(&l_tee->m_records);
+    l_tee->m_streamed = l_branch->m_streams;
+    Mutex_init(&l_tee->m_mutex);
+    Condition_init(&l_tee->m_condition);
+    LL_APPEND((*p_pipeline)->m_tees, l_tee);
+
+    addStage(l_branch)->m_tee = l_tee;
+    return 1;
+}
+
+int ATP_pipelineBranch(ATP_Pipeline *p_pipeline, const char *p_source)
+{
+    PipelineBranch *l_branch;
+    PipelineTee *l_tee = NULL;
+
+    if (p_source != NULL)
+    {
+        l_tee = findTee(p_pipeline, p_source);
+        if (l_tee == NULL)
+        {
+            ERR("No tee named '%s' precedes the branch\n", p_source);
+            return 0;
+        }
+    }
+
+    l_branch = addBranch(p_pipeline, (l_tee != NULL ? 1 : 0));
+    if (l_tee != NULL)
+    {
+        l_branch->m_sources[l_branch->m_sourceCount++] = l_tee;
+        l_branch->m_streams = l_tee->m_streamed;
+        ++l_tee->m_userCount;
+    }
+    return 1;
+}
+
+int ATP_pipelineJoin(ATP_Pipeline *p_pipeline, const ATP_Array *p_sources)
+{
+    unsigned int i;
+    unsigned int l_length = ATP_arrayLength(p_sources);
+    PipelineBranch *l_branch;
+
+    for (i = 0; i < l_length; ++i)
+    {
+        const char *l_name = NULL;
+        const char *l_other;
+        unsigned int j;
+
+        if (!ATP_arrayGetString(p_sources, i, &l_name) || findTee(p_pipeline, l_name) == NULL)
+        {
+            ERR("No tee named '%s' precedes the join\n", (l_name != NULL ? l_name : ""));
+            return 0;
+        }
+
+        // each tee becomes an entry of the joined dictionary, so a name given twice would replace its own records
+        for (j = 0; j < i; ++j)
+        {
+            if (ATP_arrayGetString(p_sources, j, &l_other) && strcmp(l_other, l_name) == 0)
+            {
+                ERR("The tee named '%s' is joined more than once\n", l_name);
+                return 0;
+            }
+        }
+    }
+
+    l_branch = addBranch(p_pipeline, l_length);
+    l_branch->m_join = 1;
+    for (i = 0; i < l_length; ++i)
+    {
+        const char *l_name;
+        ATP_arrayGetString(p_sources, i, &l_name);
+        l_branch->m_sources[l_branch->m_sourceCount] = findTee(p_pipeline, l_name);
+        ++l_branch->m_sources[l_branch->m_sourceCount++]->m_userCount;
+    }
+    return 1;
+}
+
+static void runBranch(void *p_branch)
+{
+    PipelineBranch *l_branch = p_branch;
+    ATP_Array l_source;
+    unsigned int i;
+    int l_ready = 1;
+    ATP_ProcessorContext *l_previous = ATP_processorContextSwitch(l_branch->m_context);
+
+    // wait for every tee the branch starts from to be passed
+    for (i = 0; i < l_branch->m_sourceCount; ++i)
+    {
+        if (teeWait(l_branch->m_sources[i]) != e_TeeState_ready)
+        {
+            l_ready = 0;
+        }
+    }
+
+    ATP_arrayInit(&l_source);
+    if (l_ready && l_branch->m_join)
+    {
+        ATP_Dictionary l_joined;
+        ATP_dictionaryInit(&l_joined);
+        for (i = 0; i < l_branch->m_sourceCount; ++i)
+        {
+            ATP_dictionarySetDict(&l_joined, l_branch->m_sources[i]->m_name, teeResult(l_branch->m_sources[i]));
+        }
+        ATP_arraySetDict(&l_source, 0, l_joined);
+    }
+    else if (l_ready && l_branch->m_sourceCount > 0)
+    {
+        ATP_arrayDestroy(&l_source);
+        l_source = ATP_arrayDuplicate(&l_branch->m_sources[0]->m_records);
+    }
+    for (i = 0; i < l_branch->m_sourceCount; ++i)
+    {
+        teeRelease(l_branch->m_sources[i]);
+    }
+
+    l_branch->m_result = l_ready && runChain(l_branch->m_stages, l_branch->m_length, l_branch->m_count, l_branch->m_threads,
+                                             (l_branch->m_sourceCount > 0 ? &l_source : NULL));
+    ATP_arrayDestroy(&l_source);
+
+    // release the branches waiting on tees that were never passed
+    for (i = 0; i < l_branch->m_length; ++i)
+    {
+        if (l_branch->m_stages[i].m_tee != NULL)
+        {
+            teeSettle(l_branch->m_stages[i].m_tee, e_TeeState_failed);
+        }
+    }
+    ATP_processorContextSwitch(l_previous);
+}
+
+int ATP_pipelineExecute(ATP_Pipeline *p_pipeline, unsigned int p_threads)
+{
+    PipelineBranch *it;
+    PipelineTee *l_tee;
+    unsigned int l_branches = 0;
+    unsigned int l_threads = (p_threads == 0 ? Thread_cpuCount() : p_threads);
+    int l_result = 1;
+
+    LL_FOREACH((*p_pipeline)->m_tees, l_tee)
+    {
+        ATP_arrayClear(&l_tee->m_records);
+        l_tee->m_users = l_tee->m_userCount;
+        l_tee->m_state = e_TeeState_pending;
+    }
+    LL_FOREACH((*p_pipeline)->m_branches, it)
+    {
+        ++l_branches;
+    }
+
+    LL_FOREACH((*p_pipeline)->m_branches, it)
+    {
+        // the processor count is only known once every branch is in place
+        it->m_count = (*p_pipeline)->m_count;
+        it->m_threads = (l_branches == 1 ? p_threads : (l_threads / l_branches > 1 ? l_threads / l_branches : 1));
+        it->m_context = ATP_processorContextCurrent();
+    }
+
+    if (l_branches == 1 || l_threads <= 1)
+    {
+        // every branch only starts from tees in branches before it, so running them in order never waits
+        LL_FOREACH((*p_pipeline)->m_branches, it)
+        {
+            runBranch(it);
+        }
+    }
+    else
+    {
+        // every branch gets a thread of its own, with the last one running on the calling thread
+        LL_FOREACH((*p_pipeline)->m_branches, it)
+        {
+            if (it->next != NULL)
+            {
+                Thread_start(&it->m_thread, &runBranch, it);
+            }
+        }
+        runBranch((*p_pipeline)->m_last);
+        LL_FOREACH((*p_pipeline)->m_branches, it)
+        {
+            if (it->next != NULL)
+            {
+                Thread_join(&it->m_thread);
+            }
+        }
+    }
+
+    LL_FOREACH((*p_pipeline)->m_branches, it)
+    {
+        l_result = l_result && it->m_result;
+    }
+    return l_result;
+}
+
+int ATP_pipelineProfile(const ATP_Pipeline *p_pipeline, const char *p_file)
+{
+    const char **l_names;
+    const ATP_ProfileStats **l_stats;
+    unsigned int l_count = 0;
+    PipelineBranch *it;
+    int l_result;
+
+    l_names = malloc(((*p_pipeline)->m_count + 1) * sizeof(const char *));
+    l_stats = malloc(((*p_pipeline)->m_count + 1) * sizeof(const ATP_ProfileStats *));
+    if (l_names == NULL || l_stats == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // processors are reported in the order they were added, which is their order on the command line
+    LL_FOREACH((*p_pipeline)->m_branches, it)
+    {
+        unsigned int i;
+        for (i = 0; i < it->m_length; ++i)
+        {
+            ATP_Processor *l_processor = it->m_stages[i].m_processor;
+            if (l_processor != NULL)
+            {
+                l_names[l_count] = l_processor->m_interface.m_name;
+                l_stats[l_count++] = &l_processor->m_profile;
+            }
+        }
+    }
+
+    l_result = ATP_profileReport(l_names, l_stats, l_count, p_file);
+    free(l_names);
+    free(l_stats);
+    return l_result;
+}
@@ -0,0 +1,158 @@
+/* File: Pipeline.h
+Execution of a chain of loaded processors, each feeding its output to the next.
+
+Processors pass each other sequences of records, see <ATP_ProcessorInterface> for how whole dictionary processors take part.
+The processors can be run one after another on the calling thread, or divided between several threads.  In the latter case
+each thread runs a contiguous group of processors, and the records passed between groups are handed over in batches through
+bounded queues, so that a group blocks once the group after it falls too far behind.  Streaming processors in different groups
+then work on different batches at the same time, and at most a fixed number of records is held between any two groups.
+
+A pipeline may also branch.  A tee placed between two processors passes every record on unchanged, and keeps a copy of them
+under a name.  Further branches can then start from the records kept by a tee, or from a join of several tees, and each branch
+runs its own chain of processors.  Branches are given threads of their own, so that branches that do not depend on each other
+run at the same time.
+
+A whole dictionary processor declaring <c_ATP_ProcessorFlag_passThrough> passes its input on before it runs, sharing it until
+either side modifies it, and runs on the shared thread pool while the pure processors after it (see
+<c_ATP_ProcessorFlag_pure>) carry on.  Any other processor after it, or a tee, waits for it to finish first, and fails if it
+failed.  When processors are divided between threads, its group only hands the records it ends with to the next group once it
+has finished.
+*/
+#ifndef _ATP_LIBRARY_PIPELINE_H_
+#define _ATP_LIBRARY_PIPELINE_H_
+
+#include "Export.h"
+#include "Processor.h"
+#include "Array.h"
+
+/* Constant: c_ATP_Pipeline_batchSize
+The largest number of records handed from one thread of a pipeline to the next at once.  Streaming processors are flushed
+after each batch they receive.
+*/
+#define c_ATP_Pipeline_batchSize        64
+/* Constant: c_ATP_Pipeline_queueCapacity
+The number of batches of records that may be waiting between two threads of a pipeline before the earlier thread blocks.
+*/
+#define c_ATP_Pipeline_queueCapacity    16
+
+// forward declaration
+struct ATP_PipelineImpl;
+
+/* Type: ATP_Pipeline
+Reference to a branching pipeline.
+*/
+typedef struct ATP_PipelineImpl *ATP_Pipeline;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_pipelineRun
+Run a chain of processors, passing the output of each to the next.  The output of the last processor is discarded.
+
+Parameters:
+    p_processors - The first processor in the chain, linked to the rest through their next members.
+    p_threads    - The number of threads to divide the processors between.  1 runs every processor in turn on the calling
+                   thread, 0 uses one thread per processor core, and no more threads than processors are ever used.
+
+Returns:
+    1 if every processor ran successfully, 0 if any failed.  Once a processor fails no more records are passed to any of the
+    processors, and no processor is ended.
+*/
+EXPORT int ATP_pipelineRun(ATP_Processor *p_processors, unsigned int p_threads);
+
+/* Function: ATP_pipelineInit
+Initialize an empty branching pipeline, whose first branch starts from no records.
+
+Parameters:
+    p_pipeline - The pipeline handle to initialize.
+*/
+EXPORT void ATP_pipelineInit(ATP_Pipeline *p_pipeline);
+/* Function: ATP_pipelineDestroy
+Destroy a branching pipeline, unloading every processor added to it.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+*/
+EXPORT void ATP_pipelineDestroy(ATP_Pipeline *p_pipeline);
+/* Function: ATP_pipelineAppend
+Add a processor to the end of the last branch of a pipeline.
+
+Note:
+    The pipeline takes over ownership of the processor.
+
+Parameters:
+    p_pipeline  - The pipeline handle.
+    p_processor - The processor to add.
+*/
+EXPORT void ATP_pipelineAppend(ATP_Pipeline *p_pipeline, ATP_Processor *p_processor);
+/* Function: ATP_pipelineTee
+Add a tee to the end of the last branch of a pipeline, which keeps the records passing it for later branches.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+    p_name     - The name of the tee, which must not be used by any other tee in the pipeline.
+
+Returns:
+    1 on success, 0 (after printing an error) if the name is already in use.
+*/
+EXPORT int ATP_pipelineTee(ATP_Pipeline *p_pipeline, const char *p_name);
+/* Function: ATP_pipelineBranch
+Start a new branch at the end of a pipeline.  The first processor of the branch receives the same records as the processor
+following the tee it starts from, each record being shared with the other branches until it is modified.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+    p_source   - The name of a tee added earlier, or NULL to start from no records as the first branch does.
+
+Returns:
+    1 on success, 0 (after printing an error) if no tee of that name has been added.
+*/
+EXPORT int ATP_pipelineBranch(ATP_Pipeline *p_pipeline, const char *p_source);
+/* Function: ATP_pipelineJoin
+Start a new branch at the end of a pipeline, merging the records kept by several tees.  The first processor of the branch
+receives a single dictionary holding, under the name of each tee, the records it kept as a whole dictionary processor following
+it would have received them.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+    p_sources  - An array of the names of tees added earlier, each given only once.
+
+Returns:
+    1 on success, 0 (after printing an error) if any of the tees has not been added or is named more than once.
+*/
+EXPORT int ATP_pipelineJoin(ATP_Pipeline *p_pipeline, const ATP_Array *p_sources);
+/* Function: ATP_pipelineExecute
+Run every branch of a pipeline.  A branch waits for the tees it starts from to be passed, and does not run at all if any of
+them is never passed because a processor before it failed.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+    p_threads  - The number of threads to use, as for <ATP_pipelineRun>.  When there is more than one branch and more than one
+                 thread, each branch gets a thread of its own and the threads are otherwise shared evenly between the
+                 branches.
+
+Returns:
+    1 if every processor in every branch ran successfully, 0 otherwise.
+*/
+EXPORT int ATP_pipelineExecute(ATP_Pipeline *p_pipeline, unsigned int p_threads);
+
+/* Function: ATP_pipelineProfile
+Report the measurements collected for every processor in a pipeline, which must have been executed with profiling enabled.  See
+<ATP_profileReport>.
+
+Parameters:
+    p_pipeline - The pipeline handle.
+    p_file     - The path of the JSON file to write, or NULL to only print the table.
+
+Returns:
+    1 on success, 0 if the file could not be written.
+*/
+EXPORT int ATP_pipelineProfile(const ATP_Pipeline *p_pipeline, const char *p_file);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_PIPELINE_H_ */
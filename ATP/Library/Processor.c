@@ -1,6 +1,10 @@
 #include "Processor.h"
 
 #include "SharedLib.h"
+#include "Cache.h"
+#include "Trace.h"
+#include "Atomic.inc"
+#include "Thread.inc"
 #include "Exit.h"
 #include "Log.h"
 
@@ -32,7 +36,39 @@ typedef struct ProcessorPath
     struct ProcessorPath *next;
 } ProcessorPath;
 
-static int gs_helpRequested = 0;
+// a processor library found on the search path; its handle and load function are kept once opened, so that loading the same
+// processor again does not search for or open the library again
+typedef struct ProcessorEntry
+{
+    char m_name[128];
+    char m_dir[1024];
+    char m_path[1024];
+    void *m_lib;
+    ATP_ProcessorLoadCallback m_load;
+    struct ProcessorEntry *next;
+} ProcessorEntry;
+
+// every instance of a processor that is not thread-safe holds the lock of that processor while it runs
+struct ATP_ProcessorLock
+{
+    char m_name[128];
+    Mutex m_mutex;
+    struct ATP_ProcessorLock *next;
+};
+
+// the context of a thread that has not switched to one of its own
+static ATP_ProcessorContext gs_defaultContext = { 0 };
+static THREAD_LOCAL ATP_ProcessorContext *gs_context = NULL;
+
+// loading is serialized, as neither the registry nor the load callbacks of processors are thread-safe; the mutex is created
+// on first use, guarded by a spin lock that is only held for that long
+static AtomicCount gs_loadGuard = 0;
+static int gs_loadMutexReady = 0;
+static Mutex gs_loadMutex;
+static struct ATP_ProcessorLock *gs_locks = NULL;
+
+static ProcessorEntry *gs_registry = NULL;
+static int gs_registryLoaded = 0;
 
 static ATP_StaticProcessor *gs_staticProcessors = NULL;
 static unsigned int gs_staticProcessorCount = 0;
@@ -127,64 +163,370 @@ void cleanupPaths(ProcessorPath *p_paths)
     }
 }
 
-void ATP_processorsSetStatic(ATP_StaticProcessor p_table[], unsigned int p_count)
+static void addEntry(ProcessorEntry **p_registry, const char *p_name, const char *p_dir, const char *p_path)
 {
-    gs_staticProcessors = p_table;
-    gs_staticProcessorCount = p_count;
+    ProcessorEntry *it = NULL;
+    ProcessorEntry *l_entry;
+
+    // earlier directories on the search path take precedence
+    LL_FOREACH(*p_registry, it)
+    {
+        if (strcmp(it->m_name, p_name) == 0)
+        {
+            return;
+        }
+    }
+
+    l_entry = calloc(1, sizeof(ProcessorEntry));
+    if (l_entry == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    strncpy(l_entry->m_name, p_name, sizeof(l_entry->m_name) - 1);
+    strncpy(l_entry->m_dir, p_dir, sizeof(l_entry->m_dir) - 1);
+    strncpy(l_entry->m_path, p_path, sizeof(l_entry->m_path) - 1);
+
+    DBG("processor %s: %s\n", l_entry->m_name, l_entry->m_path);
+    LL_APPEND(*p_registry, l_entry);
 }
 
-ATP_Processor *ATP_processorLoad(unsigned int p_index, const char *p_name, const ATP_Array *p_parameters)
+static void cleanupEntries(ProcessorEntry *p_registry)
+{
+    ProcessorEntry *it = NULL;
+    ProcessorEntry *l_tmp = NULL;
+
+    LL_FOREACH_SAFE(p_registry, it, l_tmp)
+    {
+        LL_DELETE(p_registry, it);
+        if (it->m_lib != NULL)
+        {
+            ATP_sharedLibUnload(it->m_lib);
+        }
+        free(it);
+    }
+}
+
+static void scanDirectory(ProcessorEntry **p_registry, const char *p_dir)
 {
+    char l_pattern[1024];
+#ifdef _WIN32
+    WIN32_FIND_DATA l_data;
+    HANDLE l_find;
+
+    snprintf(l_pattern, sizeof(l_pattern), "%s" DIRSEP "*." PROC_EXT, p_dir);
+    l_find = FindFirstFile(l_pattern, &l_data);
+    if (l_find == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    do
+    {
+        char l_name[_MAX_FNAME + 1];
+        char l_path[1024];
+        _splitpath(l_data.cFileName, NULL, NULL, l_name, NULL);
+        snprintf(l_path, sizeof(l_path), "%s" DIRSEP "%s", p_dir, l_data.cFileName);
+        addEntry(p_registry, l_name, p_dir, l_path);
+    }
+    while (FindNextFile(l_find, &l_data) != 0);
+
+    FindClose(l_find);
+#else // NOTE: assume POSIX for now
     unsigned int i;
+    glob_t l_glob;
 
-    // first try to find a shared library containing the processor
+    snprintf(l_pattern, sizeof(l_pattern), "%s" DIRSEP "*." PROC_EXT, p_dir);
+    if (glob(l_pattern, 0, NULL, &l_glob) != 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < l_glob.gl_pathc; ++i)
+    {
+        char *l_dot;
+        char l_name[1024];
+        char *l_file = basename(l_glob.gl_pathv[i]);
+        strncpy(l_name, l_file, sizeof(l_name));
+        l_name[sizeof(l_name) - 1] = '\0';
+
+        l_dot = strrchr(l_name, '.');
+        if (l_dot != NULL)
+        {
+            int l_length;
+
+            *l_dot = '\0';
+            l_length = snprintf(l_pattern, sizeof(l_pattern), "%s" DIRSEP "%s." PROC_EXT, p_dir, l_name);
+            if (l_length < 0 || (size_t) l_length >= sizeof(l_pattern))
+            {
+                // a path cut short could name some other manifest
+                LOG("Skipping processor %s, as its path is too long\n", l_name);
+                continue;
+            }
+            addEntry(p_registry, l_name, p_dir, l_pattern);
+        }
+    }
+
+    globfree(&l_glob);
+#endif
+}
+
+static ProcessorEntry *scanPaths(void)
+{
+    ProcessorEntry *l_registry = NULL;
     ProcessorPath *it = NULL;
     ProcessorPath *l_paths = processorPaths();
 
     LL_FOREACH(l_paths, it)
     {
-        char l_libPath[1024];
-        void *l_lib;
+        scanDirectory(&l_registry, it->m_path);
+    }
+    cleanupPaths(l_paths);
+
+    return l_registry;
+}
+
+// read an index written by ATP_processorsWriteIndex, with one processor per line given as its name and path separated by a tab
+static int readManifest(ProcessorEntry **p_registry, const char *p_file)
+{
+    char l_line[2048];
+    FILE *l_manifest = fopen(p_file, "r");
+    if (l_manifest == NULL)
+    {
+        return 0;
+    }
 
-        snprintf(l_libPath, sizeof(l_libPath), "%s" DIRSEP "%s." PROC_EXT, it->m_path, p_name);
-        l_lib = ATP_sharedLibLoad(l_libPath);
-        if (l_lib != NULL)
+    while (fgets(l_line, sizeof(l_line), l_manifest) != NULL)
+    {
+        char l_dir[1024];
+        char *l_sep;
+        char *l_path = strchr(l_line, '\t');
+        char *l_end = strpbrk(l_line, "\r\n");
+        if (l_end != NULL)
         {
-            // try to load the "load" function
-            ATP_ProcessorLoadCallback load = ATP_sharedLibSymbol(l_lib, "load");
-            if (load != NULL)
-            {
-                ATP_Processor *l_proc = malloc(sizeof(ATP_Processor));
-                if (l_proc == NULL)
-                {
-                    PERR();
-                    exit(EX_OSERR);
-                }
+            *l_end = '\0';
+        }
+        if (l_path == NULL || l_path == l_line || l_path[1] == '\0')
+        {
+            continue;
+        }
+        *l_path++ = '\0';
 
-                strncpy(l_proc->m_interface.m_name, p_name, sizeof(l_proc->m_interface.m_name));
-                l_proc->m_interface.m_name[sizeof(l_proc->m_interface.m_name) - 1] = '\0';
-                if (!load(p_index, p_parameters, &l_proc->m_interface))
-                {
-                    ATP_sharedLibUnload(l_lib);
-                    cleanupPaths(l_paths);
-                    free(l_proc);
-                    return NULL;
-                }
+        // the directory is only needed for listing
+        strncpy(l_dir, l_path, sizeof(l_dir));
+        l_dir[sizeof(l_dir) - 1] = '\0';
+        l_sep = strrchr(l_dir, DIRSEP[0]);
+        if (l_sep != NULL)
+        {
+            *l_sep = '\0';
+        }
+        else
+        {
+            strcpy(l_dir, ".");
+        }
+        addEntry(p_registry, l_line, l_dir, l_path);
+    }
+
+    fclose(l_manifest);
+    return 1;
+}
 
-                cleanupPaths(l_paths);
-                return l_proc;
+// find a processor library, building the registry from the manifest or the search path on first use
+static ProcessorEntry *findEntry(const char *p_name)
+{
+    ProcessorEntry *it = NULL;
+
+    if (!gs_registryLoaded)
+    {
+        const char *l_manifest = getenv("ATP_PROCESSOR_MANIFEST");
+        if (l_manifest == NULL || !readManifest(&gs_registry, l_manifest))
+        {
+            if (l_manifest != NULL)
+            {
+                ERR("Unable to read processor manifest '%s', searching for processors instead\n", l_manifest);
             }
-            else
+            gs_registry = scanPaths();
+        }
+        gs_registryLoaded = 1;
+    }
+
+    LL_FOREACH(gs_registry, it)
+    {
+        if (p_name == NULL || strcmp(it->m_name, p_name) == 0)
+        {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+/* Function: ATP_processorsWriteIndex
+Search the processor path and write the processors found to a manifest, for the ATP_PROCESSOR_MANIFEST environment variable.
+*/
+int ATP_processorsWriteIndex(const char *p_file)
+{
+    ProcessorEntry *it = NULL;
+    ProcessorEntry *l_registry = scanPaths();
+    FILE *l_manifest = fopen(p_file, "w");
+    int l_result;
+
+    if (l_manifest == NULL)
+    {
+        ERR("Unable to write processor manifest '%s'\n", p_file);
+        cleanupEntries(l_registry);
+        return 0;
+    }
+
+    LL_FOREACH(l_registry, it)
+    {
+        fprintf(l_manifest, "%s\t%s\n", it->m_name, it->m_path);
+    }
+    l_result = (fclose(l_manifest) == 0);
+    if (!l_result)
+    {
+        ERR("Unable to write processor manifest '%s'\n", p_file);
+    }
+
+    cleanupEntries(l_registry);
+    return l_result;
+}
+
+/* Function: ATP_processorsRelease
+Forget the processors found so far and close their libraries.  May only be called once every processor is unloaded.
+*/
+void ATP_processorsRelease(void)
+{
+    struct ATP_ProcessorLock *it;
+    struct ATP_ProcessorLock *l_temp;
+
+    cleanupEntries(gs_registry);
+    gs_registry = NULL;
+    gs_registryLoaded = 0;
+
+    LL_FOREACH_SAFE(gs_locks, it, l_temp)
+    {
+        LL_DELETE(gs_locks, it);
+        Mutex_destroy(&it->m_mutex);
+        free(it);
+    }
+}
+
+void ATP_processorsSetStatic(ATP_StaticProcessor p_table[], unsigned int p_count)
+{
+    gs_staticProcessors = p_table;
+    gs_staticProcessorCount = p_count;
+}
+
+static void initInterface(ATP_ProcessorInterface *p_interface, const char *p_name)
+{
+    // processors built against an earlier version of the interface leave the members they do not know about empty
+    memset(p_interface, 0, sizeof(ATP_ProcessorInterface));
+    p_interface->m_version = c_ATP_ProcessorInterface_version;
+
+    strncpy(p_interface->m_name, p_name, sizeof(p_interface->m_name));
+    p_interface->m_name[sizeof(p_interface->m_name) - 1] = '\0';
+}
+
+// the parameters are part of the key of any output cached for the instance
+static void keepParameters(ATP_Processor *p_proc, const ATP_Array *p_parameters)
+{
+    if (p_parameters != NULL)
+    {
+        p_proc->m_parameters = ATP_arrayDuplicate(p_parameters);
+    }
+    else
+    {
+        ATP_arrayInit(&p_proc->m_parameters);
+    }
+}
+
+static void lockLoading(void)
+{
+    SPIN_LOCK(gs_loadGuard);
+    if (!gs_loadMutexReady)
+    {
+        Mutex_init(&gs_loadMutex);
+        gs_loadMutexReady = 1;
+    }
+    SPIN_UNLOCK(gs_loadGuard);
+    Mutex_lock(&gs_loadMutex);
+}
+
+// find the lock shared by the instances of a processor, creating it for the first instance; the loading lock must be held
+static struct ATP_ProcessorLock *findLock(const char *p_name)
+{
+    struct ATP_ProcessorLock *it;
+
+    LL_FOREACH(gs_locks, it)
+    {
+        if (strcmp(it->m_name, p_name) == 0)
+        {
+            return it;
+        }
+    }
+
+    it = malloc(sizeof(struct ATP_ProcessorLock));
+    if (it == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    strncpy(it->m_name, p_name, sizeof(it->m_name));
+    it->m_name[sizeof(it->m_name) - 1] = '\0';
+    Mutex_init(&it->m_mutex);
+    LL_PREPEND(gs_locks, it);
+    return it;
+}
+
+static ATP_Processor *loadProcessor(unsigned int p_index, const char *p_name, const ATP_Array *p_parameters)
+{
+    unsigned int i;
+    int l_loaded;
+
+    // first try to find a shared library containing the processor
+    ProcessorEntry *l_entry = findEntry(p_name);
+    if (l_entry != NULL && l_entry->m_lib == NULL)
+    {
+        ATP_traceBegin("dlopen", p_name);
+        l_entry->m_lib = ATP_sharedLibLoad(l_entry->m_path);
+        ATP_traceEnd();
+        if (l_entry->m_lib != NULL)
+        {
+            // try to load the "load" function
+            l_entry->m_load = ATP_sharedLibSymbol(l_entry->m_lib, "load");
+            if (l_entry->m_load == NULL)
             {
-                DBG("No load() in %s\n", l_libPath);
+                DBG("No load() in %s\n", l_entry->m_path);
             }
         }
         else
         {
-            DBG("Could not open %s\n", l_libPath);
+            DBG("Could not open %s\n", l_entry->m_path);
         }
     }
-    cleanupPaths(l_paths);
+    if (l_entry != NULL && l_entry->m_load != NULL)
+    {
+        ATP_Processor *l_proc = malloc(sizeof(ATP_Processor));
+        if (l_proc == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+
+        initInterface(&l_proc->m_interface, p_name);
+        memset(&l_proc->m_profile, 0, sizeof(ATP_ProfileStats));
+        ATP_traceBegin("load", p_name);
+        l_loaded = l_entry->m_load(p_index, p_parameters, &l_proc->m_interface);
+        ATP_traceEnd();
+        if (!l_loaded)
+        {
+            free(l_proc);
+            return NULL;
+        }
+        keepParameters(l_proc, p_parameters);
+        return l_proc;
+    }
 
     // search for it in the statically linked processors
     for (i = 0; i < gs_staticProcessorCount; ++i)
@@ -198,13 +540,17 @@ ATP_Processor *ATP_processorLoad(unsigned int p_index, const char *p_name, const
                 exit(EX_OSERR);
             }
 
-            strncpy(l_proc->m_interface.m_name, p_name, sizeof(l_proc->m_interface.m_name));
-            l_proc->m_interface.m_name[sizeof(l_proc->m_interface.m_name) - 1] = '\0';
-            if (!gs_staticProcessors[i].load(p_index, p_parameters, &l_proc->m_interface))
+            initInterface(&l_proc->m_interface, p_name);
+            memset(&l_proc->m_profile, 0, sizeof(ATP_ProfileStats));
+            ATP_traceBegin("load", p_name);
+            l_loaded = gs_staticProcessors[i].load(p_index, p_parameters, &l_proc->m_interface);
+            ATP_traceEnd();
+            if (!l_loaded)
             {
                 free(l_proc);
                 return NULL;
             }
+            keepParameters(l_proc, p_parameters);
             return l_proc;
         }
     }
@@ -213,86 +559,229 @@ ATP_Processor *ATP_processorLoad(unsigned int p_index, const char *p_name, const
     return NULL;
 }
 
+ATP_Processor *ATP_processorLoad(unsigned int p_index, const char *p_name, const ATP_Array *p_parameters)
+{
+    ATP_Processor *l_proc;
+
+    lockLoading();
+    l_proc = loadProcessor(p_index, p_name, p_parameters);
+    if (l_proc != NULL)
+    {
+        l_proc->m_context = ATP_processorContextCurrent();
+        // streaming processors are left alone, since a record they emit may reach another instance of the same processor
+        // while the first is still consuming
+        l_proc->m_lock = (!ATP_processorIsThreadSafe(l_proc) && !ATP_processorIsStreaming(l_proc) ? findLock(p_name) : NULL);
+        l_proc->next = NULL;
+    }
+    Mutex_unlock(&gs_loadMutex);
+    return l_proc;
+}
+
+// build the key of the output of a run, failing if a file the processor reads cannot be read
+static int cacheKey(const ATP_Processor *p_proc, const ATP_Dictionary *p_input, ATP_CacheKey *p_key)
+{
+    unsigned int i;
+    int l_result = 1;
+    ATP_Array l_files;
+
+    ATP_cacheKeyInit(p_key);
+    ATP_cacheKeyAddString(p_key, p_proc->m_interface.m_name);
+    ATP_cacheKeyAddArray(p_key, &p_proc->m_parameters);
+    if (ATP_processorReads(p_proc) != NULL)
+    {
+        // entries the processor does not read make no difference to its output
+        ATP_cacheKeyAddDictionaryKeys(p_key, p_input, ATP_processorReads(p_proc));
+    }
+    else
+    {
+        ATP_cacheKeyAddDictionary(p_key, p_input);
+    }
+
+    ATP_arrayInit(&l_files);
+    ATP_processorFiles(p_proc, &l_files);
+    for (i = 0; i < ATP_arrayLength(&l_files) && l_result; ++i)
+    {
+        const char *l_path = NULL;
+        l_result = (ATP_arrayGetString(&l_files, i, &l_path) && ATP_cacheKeyAddFile(p_key, l_path));
+    }
+    ATP_arrayDestroy(&l_files);
+    return l_result;
+}
+
+static int runProcessor(ATP_Processor *p_proc, unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output)
+{
+    int l_result;
+    ATP_ProcessorContext *l_previous = NULL;
+
+    // the processor sees the context it was loaded in, whichever thread runs it
+    if (p_proc->m_context != NULL)
+    {
+        l_previous = ATP_processorContextSwitch(p_proc->m_context);
+    }
+    if (p_proc->m_lock != NULL)
+    {
+        Mutex_lock(&p_proc->m_lock->m_mutex);
+    }
+    l_result = p_proc->m_interface.run(p_count, p_input, p_output, p_proc->m_interface.m_token);
+    if (p_proc->m_lock != NULL)
+    {
+        Mutex_unlock(&p_proc->m_lock->m_mutex);
+    }
+    if (p_proc->m_context != NULL)
+    {
+        ATP_processorContextSwitch(l_previous);
+    }
+
+    // a processor that aliased its input as its output rather than forwarding it has handed it over all the same, so that
+    // callers can always destroy what is left of the input
+    if (*p_output != NULL && *p_output == *p_input)
+    {
+        DBG("%s passed its input on without ATP_processorForward()\n", p_proc->m_interface.m_name);
+        ATP_dictionaryInit(p_input);
+    }
+    return l_result;
+}
+
+static int runCached(ATP_Processor *p_proc, unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output)
+{
+    ATP_CacheKey l_key;
+    int l_result;
+
+    // the key is built before running, as the processor may take over its input
+    if (!ATP_cacheEnabled() || (p_proc->m_context != NULL ? p_proc->m_context : ATP_processorContextCurrent())->m_helpRequested
+        || (ATP_processorFlags(p_proc) & (c_ATP_ProcessorFlag_cacheable | c_ATP_ProcessorFlag_pure)) == 0
+        || !cacheKey(p_proc, p_input, &l_key))
+    {
+        return runProcessor(p_proc, p_count, p_input, p_output);
+    }
+
+    ATP_traceBegin("cache load", p_proc->m_interface.m_name);
+    l_result = ATP_cacheLoad(&l_key, p_output);
+    ATP_traceEnd();
+    if (l_result)
+    {
+        DBG("reused the cached output of %s\n", p_proc->m_interface.m_name);
+        return 1;
+    }
+
+    l_result = runProcessor(p_proc, p_count, p_input, p_output);
+    if (l_result)
+    {
+        ATP_traceBegin("cache store", p_proc->m_interface.m_name);
+        ATP_cacheStore(&l_key, p_output);
+        ATP_traceEnd();
+    }
+    return l_result;
+}
+
 int ATP_processorRun(ATP_Processor *p_proc, unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output)
 {
     if (p_proc != NULL)
     {
+        ATP_ProfileSample l_sample;
+        int l_result;
+
         DBG("running %s...\n", p_proc->m_interface.m_name);
-        return p_proc->m_interface.run(p_count, p_input, p_output, p_proc->m_interface.m_token);
+        ATP_traceBegin("run", p_proc->m_interface.m_name);
+        if (!ATP_profileEnabled())
+        {
+            l_result = runCached(p_proc, p_count, p_input, p_output);
+            ATP_traceEnd();
+            return l_result;
+        }
+
+        ATP_profileCountInput(&p_proc->m_profile, p_input);
+        ATP_profileStart(&l_sample);
+        l_result = runCached(p_proc, p_count, p_input, p_output);
+        ATP_profileStop(&p_proc->m_profile, &l_sample);
+        ATP_traceEnd();
+        if (l_result)
+        {
+            ATP_profileCountOutput(&p_proc->m_profile, p_output);
+        }
+        return l_result;
     }
 
     ERR("Invalid processor.\n");
     return 0;
 }
 
+int ATP_processorIsStreaming(const ATP_Processor *p_proc)
+{
+    return (p_proc->m_interface.m_version >= 1 && p_proc->m_interface.consume != NULL);
+}
+
+int ATP_processorIsThreadSafe(const ATP_Processor *p_proc)
+{
+    return ((ATP_processorFlags(p_proc) & c_ATP_ProcessorFlag_threadSafe) != 0);
+}
+
+unsigned int ATP_processorFlags(const ATP_Processor *p_proc)
+{
+    return (p_proc->m_interface.m_version >= 2 ? p_proc->m_interface.m_flags : 0);
+}
+
+const char *const *ATP_processorReads(const ATP_Processor *p_proc)
+{
+    return (p_proc->m_interface.m_version >= 4 ? p_proc->m_interface.m_reads : NULL);
+}
+
+const char *const *ATP_processorWrites(const ATP_Processor *p_proc)
+{
+    return (p_proc->m_interface.m_version >= 4 ? p_proc->m_interface.m_writes : NULL);
+}
+
+void ATP_processorForward(ATP_Dictionary *p_input, ATP_Dictionary *p_output)
+{
+    ATP_dictionaryMove(p_output, p_input);
+}
+
+void ATP_processorFiles(const ATP_Processor *p_proc, ATP_Array *p_files)
+{
+    if (p_proc->m_interface.m_version >= 3 && p_proc->m_interface.files != NULL)
+    {
+        p_proc->m_interface.files(p_files, p_proc->m_interface.m_token);
+    }
+}
+
 void ATP_processorUnload(ATP_Processor *p_proc)
 {
     if (p_proc != NULL)
     {
         p_proc->m_interface.unload(p_proc->m_interface.m_token);
+        ATP_arrayDestroy(&p_proc->m_parameters);
         free(p_proc);
     }
 }
 
 /* Function: ATP_processorsSetHelpFlag
-Set the flag indicating that processors should provide help rather than processing data.
+Set the flag indicating that processors should provide help rather than processing data, in the current context.
 */
 void ATP_processorsSetHelpFlag(void)
 {
-    gs_helpRequested = 1;
+    ATP_processorContextCurrent()->m_helpRequested = 1;
 }
 
 int ATP_processorHelpRequested(void)
 {
-    return gs_helpRequested;
+    return ATP_processorContextCurrent()->m_helpRequested;
 }
 
-static void listExternalProcessors(const char *p_dir, const char *p_pattern)
+void ATP_processorContextInit(ATP_ProcessorContext *p_context)
 {
-#ifdef _WIN32
-    WIN32_FIND_DATA l_data;
-    HANDLE l_find = FindFirstFile(p_pattern, &l_data);
-    if (l_find == INVALID_HANDLE_VALUE)
-    {
-        return;
-    }
-
-    do
-    {
-        char l_name[_MAX_FNAME + 1];
-        _splitpath(l_data.cFileName, NULL, NULL, l_name, NULL);
-        LOG("        %s\n", l_name);
-    }
-    while (FindNextFile(l_find, &l_data) != 0);
-
-    FindClose(l_find);
-#else // NOTE: assume POSIX for now
-    unsigned int i;
-    glob_t l_glob;
-    if (glob(p_pattern, 0, NULL, &l_glob) != 0)
-    {
-        return;
-    }
-
-    LOG("    %s:\n", p_dir);
-    for (i = 0; i < l_glob.gl_pathc; ++i)
-    {
-        char *l_dot;
-        char l_name[1024];
-        char *l_file = basename(l_glob.gl_pathv[i]);
-        strncpy(l_name, l_file, sizeof(l_name));
-        l_name[sizeof(l_name) - 1] = '\0';
+    memset(p_context, 0, sizeof(ATP_ProcessorContext));
+}
 
-        l_dot = strrchr(l_name, '.');
-        if (l_dot != NULL)
-        {
-            *l_dot = '\0';
-            LOG("        %s\n", l_name);
-        }
-    }
+ATP_ProcessorContext *ATP_processorContextCurrent(void)
+{
+    return (gs_context != NULL ? gs_context : &gs_defaultContext);
+}
 
-    globfree(&l_glob);
-#endif
+ATP_ProcessorContext *ATP_processorContextSwitch(ATP_ProcessorContext *p_context)
+{
+    ATP_ProcessorContext *l_previous = gs_context;
+    gs_context = p_context;
+    return l_previous;
 }
 
 /* Function: ATP_processorsList
@@ -301,17 +790,23 @@ List the available processors.
 void ATP_processorsList(void)
 {
     unsigned int i;
-    ProcessorPath *it = NULL;
-    ProcessorPath *l_paths = processorPaths();
+    const char *l_dir = NULL;
+    ProcessorEntry *it = NULL;
 
+    // the registry may be growing as another pipeline loads processors
+    lockLoading();
     LOG("External Processors:\n");
-    LL_FOREACH(l_paths, it)
+    LL_FOREACH(findEntry(NULL), it)
     {
-        char l_libPath[1024];
-        snprintf(l_libPath, sizeof(l_libPath), "%s" DIRSEP "*." PROC_EXT, it->m_path);
-        listExternalProcessors(it->m_path, l_libPath);
+        // entries are kept in search order, so those from the same directory are together
+        if (l_dir == NULL || strcmp(l_dir, it->m_dir) != 0)
+        {
+            l_dir = it->m_dir;
+            LOG("    %s:\n", l_dir);
+        }
+        LOG("        %s\n", it->m_name);
     }
-    cleanupPaths(l_paths);
+    Mutex_unlock(&gs_loadMutex);
 
     LOG("Built-in Processors:\n");
     for (i = 0; i < gs_staticProcessorCount; ++i)
@@ -7,9 +7,48 @@ Definition of the template processor interface.
 #include "CommandLine.h"
 #include "Export.h"
 #include "Dictionary.h"
+#include "Profile.h"
 
-// forward reference
+// forward references
 struct ATP_ProcessorInterface;
+struct ATP_ProcessorSink;
+
+/* Type: ATP_ProcessorSink
+Destination for the records produced by a streaming processor, see <ATP_processorEmit>.
+*/
+typedef struct ATP_ProcessorSink ATP_ProcessorSink;
+
+/* Constant: c_ATP_ProcessorInterface_version
+The latest version of <ATP_ProcessorInterface>.  Version 1 adds the streaming callbacks, version 2 adds <m_flags>, version 3
+adds <files>, and version 4 adds <m_reads> and <m_writes>.
+*/
+#define c_ATP_ProcessorInterface_version    4
+
+/* Constant: c_ATP_ProcessorFlag_threadSafe
+Set in <ATP_ProcessorInterface.m_flags> by a processor of which separate instances may run at the same time on different
+threads, which <ATP_processorLoadParallel> relies on.
+*/
+#define c_ATP_ProcessorFlag_threadSafe      0x1
+/* Constant: c_ATP_ProcessorFlag_cacheable
+Set in <ATP_ProcessorInterface.m_flags> by a whole dictionary processor whose output is determined by its parameters, its
+input and the contents of the files it lists through <ATP_ProcessorInterface.files>, and which has no other effect when it
+runs, so that its output may be reused from an earlier run instead (see <Cache.h>).
+*/
+#define c_ATP_ProcessorFlag_cacheable       0x2
+/* Constant: c_ATP_ProcessorFlag_pure
+Set in <ATP_ProcessorInterface.m_flags> by a whole dictionary processor whose output is determined by its parameters and input
+alone, and which has no other effect when it runs.  It is cached like a processor declaring <c_ATP_ProcessorFlag_cacheable>
+that reads no files.
+*/
+#define c_ATP_ProcessorFlag_pure            0x4
+/* Constant: c_ATP_ProcessorFlag_passThrough
+Set in <ATP_ProcessorInterface.m_flags> by a whole dictionary processor that passes its input on unchanged as its output, and
+runs only for effects that the processors after it do not depend on, such as writing to standard output.  Its input is then
+passed on to the next processor as soon as it is complete, and the processor runs on the shared thread pool (see
+<ATP_threadPoolShared>) at the same time as the processors after it that declare <c_ATP_ProcessorFlag_pure>.  Any other
+processor after it waits for it to finish first, as it may read what it writes, and so do other pass-through processors.
+*/
+#define c_ATP_ProcessorFlag_passThrough     0x8
 
 /* Callback: ATP_ProcessorLoadCallback
 Invoked to initialize the processor.
@@ -28,10 +67,15 @@ Invoked to run the processor.  The processor takes in a dictionary (which may be
 (which may also be empty).  The processor may also use the command line parameters passed to it in <ATP_ProcessorLoadCallback>, and data loaded
 from external sources (such as files) to perform its task.  The processor may also generate data to external sinks (such as files).
 
+The processor owns its input for the duration of the call.  It may modify it, move entries out of it into its output, or pass
+the whole of it on as its output with <ATP_processorForward> and then add, replace or remove entries, none of which copies
+anything.  Whatever is left of the input when the call returns is destroyed, while the output is passed on, or destroyed if
+the call fails.
+
 Parameters:
     p_count  - The total number of processors loaded.
     p_input  - The dictionary of input data for the processor.  This may be empty.
-    p_output - The dictionary of output data from the processor.  This may be left empty.
+    p_output - The dictionary of output data from the processor, which starts out empty.  This may be left empty.
     p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
 
 Returns:
@@ -45,6 +89,62 @@ Parameters:
     p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
 */
 typedef void (*ATP_ProcessorUnloadCallback)(void *p_token);
+/* Callback: ATP_ProcessorBeginCallback
+Invoked before the first record is passed to a streaming processor.
+
+Parameters:
+    p_count  - The total number of processors loaded.
+    p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
+
+Returns:
+    1 if the processor is ready to receive records, 0 if it is not.
+*/
+typedef int (*ATP_ProcessorBeginCallback)(unsigned int p_count, void *p_token);
+/* Callback: ATP_ProcessorConsumeCallback
+Invoked to pass a single record to a streaming processor.  The processor may emit any number of records in response, including
+the record it was given.
+
+Parameters:
+    p_record - The record, which the processor may modify, take entries from, or pass on with <ATP_processorForwardRecord>.
+               Whatever is left of it is destroyed after the call.
+    p_sink   - The destination for the records the processor produces, to be passed to <ATP_processorEmit>.
+    p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
+
+Returns:
+    1 if the record was handled successfully, 0 if it was not.
+*/
+typedef int (*ATP_ProcessorConsumeCallback)(ATP_Dictionary *p_record, ATP_ProcessorSink *p_sink, void *p_token);
+/* Callback: ATP_ProcessorFlushCallback
+Invoked between batches of records to have a streaming processor emit any records it is holding back that it is able to.  More
+records may follow.
+
+Parameters:
+    p_sink   - The destination for the records the processor produces, to be passed to <ATP_processorEmit>.
+    p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
+
+Returns:
+    1 if the processor flushed successfully, 0 if it did not.
+*/
+typedef int (*ATP_ProcessorFlushCallback)(ATP_ProcessorSink *p_sink, void *p_token);
+/* Callback: ATP_ProcessorEndCallback
+Invoked after the last record has been passed to a streaming processor, to have it emit any records it is still holding back.
+
+Parameters:
+    p_sink   - The destination for the records the processor produces, to be passed to <ATP_processorEmit>.
+    p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
+
+Returns:
+    1 if the processor finished successfully, 0 if it did not.
+*/
+typedef int (*ATP_ProcessorEndCallback)(ATP_ProcessorSink *p_sink, void *p_token);
+/* Callback: ATP_ProcessorFilesCallback
+Invoked to list the files that the processor reads when it runs.
+
+Parameters:
+    p_files  - An array to append the path of each file to, as a string.
+    p_token  - The value of <ATP_ProcessorInterface.m_token> as set by the processor in the load callback.
+*/
+typedef void (*ATP_ProcessorFilesCallback)(ATP_Array *p_files, void *p_token);
 
 typedef struct ATP_StaticProcessor
 {
@@ -54,6 +154,20 @@ typedef struct ATP_StaticProcessor
 
 /* Structure: ATP_ProcessorInterface
 The interface for interacting with a loaded processor.
+
+A processor either runs once on a whole dictionary, through <run>, or streams, receiving a sequence of record dictionaries one at
+a time through <consume> and emitting its own sequence of records.  The structure is cleared and <m_version> set to
+<c_ATP_ProcessorInterface_version> before the load callback is invoked.  A processor that finds a version of at least 1 there
+may stream by setting <consume>, in which case <run> is not used, one that finds at least 2 may describe itself through
+<m_flags>, one that finds at least 3 may list the files it reads through <files>, and one that finds at least 4 may list the
+keys it reads and writes through <m_reads> and <m_writes>; members it does not set are left empty.  Whatever a processor leaves
+empty is taken to be the conservative choice: it may read and write any key, and has effects that must not overlap with
+other processors.
+
+Streaming and whole dictionary processors can be mixed in a pipeline.  The output dictionary of a whole dictionary processor is
+passed on to a streaming processor as a single record, and the records emitted by a streaming processor are passed on to a whole
+dictionary processor gathered in order into an array under the key <c_ATP_Processor_recordsKey>.  The first processor in a
+pipeline receives an empty dictionary if it runs on a whole dictionary, or no records if it streams.
 */
 typedef struct ATP_ProcessorInterface
 {
@@ -73,8 +187,66 @@ typedef struct ATP_ProcessorInterface
     See <ATP_ProcessorUnloadCallback>.
     */
     ATP_ProcessorUnloadCallback unload;
+    /* Variable: m_version
+    The version of the interface offered by the host.  A processor may lower it to the version it implements.
+    */
+    unsigned int m_version;
+    /* Callback: begin
+    See <ATP_ProcessorBeginCallback>.  Optional.
+    */
+    ATP_ProcessorBeginCallback begin;
+    /* Callback: consume
+    See <ATP_ProcessorConsumeCallback>.  Set only by streaming processors.
+    */
+    ATP_ProcessorConsumeCallback consume;
+    /* Callback: flush
+    See <ATP_ProcessorFlushCallback>.  Optional.
+    */
+    ATP_ProcessorFlushCallback flush;
+    /* Callback: end
+    See <ATP_ProcessorEndCallback>.  Optional.
+    */
+    ATP_ProcessorEndCallback end;
+    /* Variable: m_flags
+    A combination of the c_ATP_ProcessorFlag constants describing the processor.  Left empty by processors that do not
+    declare any.
+    */
+    unsigned int m_flags;
+    /* Callback: files
+    See <ATP_ProcessorFilesCallback>.  Optional.
+    */
+    ATP_ProcessorFilesCallback files;
+    /* Variable: m_reads
+    The keys of its input that a whole dictionary processor reads, as a list ending in NULL, or NULL if it may read any of
+    them.  The list belongs to the processor and must stay unchanged until it is unloaded.
+    */
+    const char *const *m_reads;
+    /* Variable: m_writes
+    The keys that a whole dictionary processor sets in its output, other than those it passes on from its input, as a list
+    ending in NULL, or NULL if it may set any.  The list belongs to the processor and must stay unchanged until it is unloaded.
+    */
+    const char *const *m_writes;
 } ATP_ProcessorInterface;
 
+/* Constant: c_ATP_Processor_recordsKey
+The key of the array of records gathered for a whole dictionary processor following a streaming processor.
+*/
+#define c_ATP_Processor_recordsKey  "records"
+
+/* Structure: ATP_ProcessorContext
+The state shared by the processors of a single run of a pipeline, so that several pipelines can run in the same process at
+once.  Each thread has a current context, which is a default shared by the whole process until the thread switches to another
+with <ATP_processorContextSwitch>.  A processor belongs to the context current on the thread that loads it, which is made
+current again whenever it runs, and the threads of a pipeline take on the context of the thread executing it.
+*/
+typedef struct ATP_ProcessorContext
+{
+    /* Variable: m_helpRequested
+    Whether processors should provide help rather than processing data, see <ATP_processorHelpRequested>.
+    */
+    int m_helpRequested;
+} ATP_ProcessorContext;
+
 /* Structure: ATP_Processor
 Representation of a loaded template processor.
 */
@@ -84,6 +256,23 @@ typedef struct ATP_Processor
     The processor interface for this instance.
     */
     ATP_ProcessorInterface m_interface;
+    /* Variable: m_profile
+    The measurements of this instance, collected while profiling is enabled.  See <ATP_profileSetEnabled>.
+    */
+    ATP_ProfileStats m_profile;
+    /* Variable: m_parameters
+    The command line parameters the instance was loaded with.
+    */
+    ATP_Array m_parameters;
+    /* Variable: m_context
+    The context the instance was loaded in, or NULL to run in whichever context is current.
+    */
+    ATP_ProcessorContext *m_context;
+    /* Variable: m_lock
+    The lock shared by every instance of a whole dictionary processor that is not thread-safe, held while any of them runs so
+    that no two of them run at once, or NULL.
+    */
+    struct ATP_ProcessorLock *m_lock;
     /* Variable: next
     The next processor in the pipeline.
     */
@@ -105,7 +294,8 @@ Parameters:
 EXPORT void ATP_processorsSetStatic(ATP_StaticProcessor p_table[], unsigned int p_count);
 
 /* Function: ATP_processorLoad
-Load a template processor and provide it with any available command line arguments.
+Load a template processor and provide it with any available command line arguments.  Processors may be loaded from several
+threads, but only one is loaded at a time.
 
 Parameters:
     p_index      - The index number indicating the position of this processor in the pipeline.
@@ -117,7 +307,9 @@ Returns:
 */
 EXPORT ATP_Processor *ATP_processorLoad(unsigned int p_index, const char *p_name, const ATP_Array *p_parameters);
 /* Function: ATP_processorRun
-Run the processor, handling the given input and producing output.
+Run the processor, handling the given input and producing output.  While outputs are being cached (see <Cache.h>), the output
+of a processor declaring <c_ATP_ProcessorFlag_cacheable> or <c_ATP_ProcessorFlag_pure> is loaded from the cache instead if it
+is found there.
 
 Parameters:
     p_proc   - The processor instance.
@@ -129,6 +321,100 @@ Returns:
     1 if the processor ran successfully, 0 if it did not.
 */
 EXPORT int ATP_processorRun(ATP_Processor *p_proc, unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output);
+/* Function: ATP_processorIsStreaming
+Determine whether a processor streams records rather than running on a whole dictionary.
+
+Parameters:
+    p_proc   - The processor instance.
+
+Returns:
+    1 if the processor streams, 0 if it does not.
+*/
+EXPORT int ATP_processorIsStreaming(const ATP_Processor *p_proc);
+/* Function: ATP_processorIsThreadSafe
+Determine whether separate instances of a processor may run at the same time on different threads.
+
+Parameters:
+    p_proc   - The processor instance.
+
+Returns:
+    1 if the processor declares <c_ATP_ProcessorFlag_threadSafe>, 0 if it does not.
+*/
+EXPORT int ATP_processorIsThreadSafe(const ATP_Processor *p_proc);
+/* Function: ATP_processorFlags
+Get the combination of c_ATP_ProcessorFlag constants that a processor declares.
+
+Parameters:
+    p_proc   - The processor instance.
+
+Returns:
+    The flags of the processor, which are empty for a processor implementing a version of <ATP_ProcessorInterface> before 2.
+*/
+EXPORT unsigned int ATP_processorFlags(const ATP_Processor *p_proc);
+/* Function: ATP_processorReads
+Get the keys of its input that a processor reads, see <ATP_ProcessorInterface.m_reads>.
+
+Parameters:
+    p_proc   - The processor instance.
+
+Returns:
+    The list of keys ending in NULL, or NULL if the processor may read any key.
+*/
+EXPORT const char *const *ATP_processorReads(const ATP_Processor *p_proc);
+/* Function: ATP_processorWrites
+Get the keys that a processor sets in its output, see <ATP_ProcessorInterface.m_writes>.
+
+Parameters:
+    p_proc   - The processor instance.
+
+Returns:
+    The list of keys ending in NULL, or NULL if the processor may set any key.
+*/
+EXPORT const char *const *ATP_processorWrites(const ATP_Processor *p_proc);
+/* Function: ATP_processorFiles
+List the files that a processor reads when it runs, see <ATP_ProcessorFilesCallback>.
+
+Parameters:
+    p_proc   - The processor instance.
+    p_files  - An array to append the path of each file to, as a string.
+*/
+EXPORT void ATP_processorFiles(const ATP_Processor *p_proc, ATP_Array *p_files);
+/* Function: ATP_processorEmit
+Pass a record produced by a streaming processor on to the rest of the pipeline.  May only be called from the callback that
+was given the sink.
+
+Note:
+    The pipeline takes over ownership of the record.
+
+Parameters:
+    p_sink   - The sink passed to the processor callback.
+    p_record - The record to emit.
+
+Returns:
+    1 on success, 0 if the rest of the pipeline failed, in which case the processor should stop and return 0 itself.
+*/
+EXPORT int ATP_processorEmit(ATP_ProcessorSink *p_sink, ATP_Dictionary p_record);
+/* Function: ATP_processorForwardRecord
+Pass the record given to a streaming processor on to the rest of the pipeline, leaving the processor's handle to it empty.
+May only be called from the consume callback that was given the record and the sink.
+
+Parameters:
+    p_sink   - The sink passed to the processor callback.
+    p_record - The record passed to the processor callback.
+
+Returns:
+    1 on success, 0 if the rest of the pipeline failed, in which case the processor should stop and return 0 itself.
+*/
+EXPORT int ATP_processorForwardRecord(ATP_ProcessorSink *p_sink, ATP_Dictionary *p_record);
+/* Function: ATP_processorForward
+Pass the input of a whole dictionary processor on as its output, without copying it, so that the processor can go on to
+annotate it or replace parts of it.  The input is left empty.
+
+Parameters:
+    p_input  - The input passed to the processor's run callback.
+    p_output - The output passed to the processor's run callback.
+*/
+EXPORT void ATP_processorForward(ATP_Dictionary *p_input, ATP_Dictionary *p_output);
 /* Function: ATP_processorUnload
 Unload the processor, freeing resources as necessary and deleting the processor instance structure.
 
@@ -139,13 +425,38 @@ EXPORT void ATP_processorUnload(ATP_Processor *p_proc);
 
 /* Function: ATP_processorHelpRequested
 Determine if help rather than actual data processing is request.  Processors should check this flag when they run to determine if they
-should display help rather than process incoming data.
+should display help rather than process incoming data.  The flag belongs to the current <ATP_ProcessorContext>.
 
 Returns:
     1 if help is requested, 0 if it is not.
 */
 EXPORT int ATP_processorHelpRequested(void);
 
+/* Function: ATP_processorContextInit
+Initialize a context for a new run of a pipeline, see <ATP_ProcessorContext>.
+
+Parameters:
+    p_context - The context.
+*/
+EXPORT void ATP_processorContextInit(ATP_ProcessorContext *p_context);
+/* Function: ATP_processorContextCurrent
+Get the context current on the calling thread.
+
+Returns:
+    The context, which is never NULL.
+*/
+EXPORT ATP_ProcessorContext *ATP_processorContextCurrent(void);
+/* Function: ATP_processorContextSwitch
+Make a context current on the calling thread.
+
+Parameters:
+    p_context - The context, or NULL for the default context of the process.
+
+Returns:
+    The context that was current before, to be switched back to once done.
+*/
+EXPORT ATP_ProcessorContext *ATP_processorContextSwitch(ATP_ProcessorContext *p_context);
+
 #ifdef __cplusplus
 }   /* extern "C" */
 #endif
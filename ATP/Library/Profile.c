@@ -0,0 +1,270 @@
+#include "Profile.h"
+#include "Array.h"
+#include "Log.h"
+
+#include <stdio.h>
+#if _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <psapi.h>
+    #undef WIN32_LEAN_AND_MEAN
+#else // NOTE: assume POSIX for now
+    #include <sys/resource.h>
+    #include <time.h>
+#endif
+#if defined(__GLIBC__)
+    #include <malloc.h>
+#endif
+
+static int gs_enabled = 0;
+
+void ATP_profileSetEnabled(int p_enabled)
+{
+    gs_enabled = p_enabled;
+}
+
+int ATP_profileEnabled(void)
+{
+    return gs_enabled;
+}
+
+static long long heapUsed(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 l_info = mallinfo2();
+    return (long long) (l_info.uordblks + l_info.hblkhd);
+#elif defined(__GLIBC__)
+    struct mallinfo l_info = mallinfo();
+    return (long long) l_info.uordblks + (long long) l_info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+void ATP_profileStart(ATP_ProfileSample *p_sample)
+{
+#if _WIN32
+    LARGE_INTEGER l_counter;
+    LARGE_INTEGER l_frequency;
+    FILETIME l_creation, l_exit, l_kernel, l_user;
+    PROCESS_MEMORY_COUNTERS l_memory;
+
+    QueryPerformanceCounter(&l_counter);
+    QueryPerformanceFrequency(&l_frequency);
+    p_sample->m_wallTime = (double) l_counter.QuadPart / (double) l_frequency.QuadPart;
+
+    // thread times are in units of 100ns
+    GetThreadTimes(GetCurrentThread(), &l_creation, &l_exit, &l_kernel, &l_user);
+    p_sample->m_cpuTime = ((double) (((unsigned long long) l_kernel.dwHighDateTime << 32) | l_kernel.dwLowDateTime)
+                           + (double) (((unsigned long long) l_user.dwHighDateTime << 32) | l_user.dwLowDateTime)) / 1e7;
+
+    p_sample->m_peakRss = 0;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &l_memory, sizeof(l_memory)))
+    {
+        p_sample->m_peakRss = (long long) (l_memory.PeakWorkingSetSize / 1024);
+    }
+#else // NOTE: assume POSIX for now
+    struct timespec l_time;
+    struct rusage l_usage;
+
+    clock_gettime(CLOCK_MONOTONIC, &l_time);
+    p_sample->m_wallTime = (double) l_time.tv_sec + (double) l_time.tv_nsec / 1e9;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &l_time);
+    p_sample->m_cpuTime = (double) l_time.tv_sec + (double) l_time.tv_nsec / 1e9;
+
+    // ru_maxrss is in kilobytes on Linux, but in bytes on OS X
+    getrusage(RUSAGE_SELF, &l_usage);
+#if defined(__APPLE__)
+    p_sample->m_peakRss = (long long) l_usage.ru_maxrss / 1024;
+#else
+    p_sample->m_peakRss = (long long) l_usage.ru_maxrss;
+#endif
+#endif
+    p_sample->m_heapUsed = heapUsed();
+}
+
+static void accumulate(ATP_ProfileStats *p_stats, const ATP_ProfileSample *p_sample, int p_sign)
+{
+    ATP_ProfileSample l_now;
+    ATP_profileStart(&l_now);
+
+    p_stats->m_wallTime += p_sign * (l_now.m_wallTime - p_sample->m_wallTime);
+    p_stats->m_cpuTime += p_sign * (l_now.m_cpuTime - p_sample->m_cpuTime);
+    p_stats->m_peakGrowth += p_sign * (l_now.m_peakRss - p_sample->m_peakRss);
+    p_stats->m_heapGrowth += p_sign * (l_now.m_heapUsed - p_sample->m_heapUsed);
+}
+
+void ATP_profileStop(ATP_ProfileStats *p_stats, const ATP_ProfileSample *p_sample)
+{
+    accumulate(p_stats, p_sample, 1);
+    ++p_stats->m_calls;
+}
+
+void ATP_profileExclude(ATP_ProfileStats *p_stats, const ATP_ProfileSample *p_sample)
+{
+    accumulate(p_stats, p_sample, -1);
+}
+
+// forward reference
+static unsigned int measureDict(const ATP_Dictionary *p_dict, unsigned long long *p_entries);
+
+static unsigned int measureArray(const ATP_Array *p_array, unsigned long long *p_entries)
+{
+    unsigned int i;
+    unsigned int l_depth = 0;
+    unsigned int l_length = ATP_arrayLength(p_array);
+
+    *p_entries += l_length;
+    for (i = 0; i < l_length; ++i)
+    {
+        unsigned int l_nested = 0;
+        const ATP_Dictionary *l_dict;
+        const ATP_Array *l_array;
+
+        if (ATP_arrayGetDictConst(p_array, i, &l_dict))
+        {
+            l_nested = measureDict(l_dict, p_entries);
+        }
+        else if (ATP_arrayGetArrayConst(p_array, i, &l_array))
+        {
+            l_nested = measureArray(l_array, p_entries);
+        }
+        if (l_nested > l_depth)
+        {
+            l_depth = l_nested;
+        }
+    }
+
+    return l_depth + 1;
+}
+
+// count the entries of a dictionary and everything nested in it, returning how deeply it nests
+static unsigned int measureDict(const ATP_Dictionary *p_dict, unsigned long long *p_entries)
+{
+    unsigned int l_depth = 0;
+    ATP_DictionaryIterator it;
+
+    for (it = ATP_dictionaryBeginConst(p_dict); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
+    {
+        unsigned int l_nested = 0;
+        const ATP_Dictionary *l_dict;
+        const ATP_Array *l_array;
+
+        ++*p_entries;
+        if (ATP_dictionaryItGetDictConst(it, &l_dict))
+        {
+            l_nested = measureDict(l_dict, p_entries);
+        }
+        else if (ATP_dictionaryItGetArrayConst(it, &l_array))
+        {
+            l_nested = measureArray(l_array, p_entries);
+        }
+        if (l_nested > l_depth)
+        {
+            l_depth = l_nested;
+        }
+    }
+
+    return l_depth + 1;
+}
+
+void ATP_profileCountInput(ATP_ProfileStats *p_stats, const ATP_Dictionary *p_record)
+{
+    unsigned int l_depth = measureDict(p_record, &p_stats->m_inputEntries);
+    if (l_depth > p_stats->m_inputDepth)
+    {
+        p_stats->m_inputDepth = l_depth;
+    }
+    ++p_stats->m_inputRecords;
+}
+
+void ATP_profileCountOutput(ATP_ProfileStats *p_stats, const ATP_Dictionary *p_record)
+{
+    unsigned int l_depth = measureDict(p_record, &p_stats->m_outputEntries);
+    if (l_depth > p_stats->m_outputDepth)
+    {
+        p_stats->m_outputDepth = l_depth;
+    }
+    ++p_stats->m_outputRecords;
+}
+
+static void writeJsonString(FILE *p_file, const char *p_string)
+{
+    fputc('"', p_file);
+    for (; *p_string != '\0'; ++p_string)
+    {
+        if (*p_string == '"' || *p_string == '\\')
+        {
+            fputc('\\', p_file);
+            fputc(*p_string, p_file);
+        }
+        else if ((unsigned char) *p_string < 0x20)
+        {
+            fprintf(p_file, "\\u%04x", (unsigned int) (unsigned char) *p_string);
+        }
+        else
+        {
+            fputc(*p_string, p_file);
+        }
+    }
+    fputc('"', p_file);
+}
+
+static int writeJson(const char *const *p_names, const ATP_ProfileStats *const *p_stats, unsigned int p_count,
+                     const char *p_file)
+{
+    unsigned int i;
+    FILE *l_file = fopen(p_file, "w");
+    if (l_file == NULL)
+    {
+        ERR("Unable to write profile to '%s': %s\n", p_file, strerror(errno));
+        return 0;
+    }
+
+    fprintf(l_file, "[\n");
+    for (i = 0; i < p_count; ++i)
+    {
+        const ATP_ProfileStats *l_stats = p_stats[i];
+
+        fprintf(l_file, "    { \"stage\": %u, \"processor\": ", i);
+        writeJsonString(l_file, p_names[i]);
+        fprintf(l_file, ", \"calls\": %llu, \"wallTime\": %.6f, \"cpuTime\": %.6f, \"peakRssGrowthKB\": %lld, "
+                        "\"heapGrowthBytes\": %lld,\n", l_stats->m_calls, l_stats->m_wallTime, l_stats->m_cpuTime,
+                l_stats->m_peakGrowth, l_stats->m_heapGrowth);
+        fprintf(l_file, "      \"input\": { \"records\": %llu, \"entries\": %llu, \"depth\": %u }, "
+                        "\"output\": { \"records\": %llu, \"entries\": %llu, \"depth\": %u } }%s\n",
+                l_stats->m_inputRecords, l_stats->m_inputEntries, l_stats->m_inputDepth, l_stats->m_outputRecords,
+                l_stats->m_outputEntries, l_stats->m_outputDepth, (i + 1 < p_count ? "," : ""));
+    }
+    fprintf(l_file, "]\n");
+
+    if (fclose(l_file) != 0)
+    {
+        ERR("Unable to write profile to '%s': %s\n", p_file, strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+int ATP_profileReport(const char *const *p_names, const ATP_ProfileStats *const *p_stats, unsigned int p_count,
+                      const char *p_file)
+{
+    unsigned int i;
+
+    LOG("Profile:\n");
+    LOG("    %-3s %-16s %10s %10s %10s %12s %14s %14s\n", "#", "processor", "calls", "wall (s)", "cpu (s)", "peak rss KB",
+        "heap bytes", "in/out records");
+    for (i = 0; i < p_count; ++i)
+    {
+        const ATP_ProfileStats *l_stats = p_stats[i];
+        char l_records[64];
+
+        snprintf(l_records, sizeof(l_records), "%llu/%llu", l_stats->m_inputRecords, l_stats->m_outputRecords);
+        LOG("    %-3u %-16s %10llu %10.4f %10.4f %12lld %14lld %14s\n", i, p_names[i], l_stats->m_calls, l_stats->m_wallTime,
+            l_stats->m_cpuTime, l_stats->m_peakGrowth, l_stats->m_heapGrowth, l_records);
+        LOG("        input: %llu entries, depth %u; output: %llu entries, depth %u\n", l_stats->m_inputEntries,
+            l_stats->m_inputDepth, l_stats->m_outputEntries, l_stats->m_outputDepth);
+    }
+
+    return (p_file == NULL || writeJson(p_names, p_stats, p_count, p_file));
+}
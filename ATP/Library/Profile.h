@@ -0,0 +1,160 @@
+/* File: Profile.h
+Measurement of the time and memory used by each processor in a pipeline.
+
+Profiling is off by default.  Once enabled, every call into a processor is measured: <ATP_processorRun> for whole dictionary
+processors, and each of the begin, consume, flush and end callbacks for streaming processors.  Time spent passing emitted records
+on to later processors on the same thread is not counted against the emitting processor.
+
+CPU time is measured for the calling thread only, but the peak resident set size and the heap usage are process wide, so they
+are only attributed accurately to individual processors when the pipeline runs on a single thread.
+*/
+#ifndef _ATP_LIBRARY_PROFILE_H_
+#define _ATP_LIBRARY_PROFILE_H_
+
+#include "Export.h"
+#include "Dictionary.h"
+
+/* Structure: ATP_ProfileStats
+The measurements collected for a single processor.
+*/
+typedef struct ATP_ProfileStats
+{
+    /* Variable: m_calls
+    The number of calls measured.
+    */
+    unsigned long long m_calls;
+    /* Variable: m_wallTime
+    The elapsed time spent in the processor, in seconds.
+    */
+    double m_wallTime;
+    /* Variable: m_cpuTime
+    The CPU time used by the processor, in seconds.
+    */
+    double m_cpuTime;
+    /* Variable: m_peakGrowth
+    The growth of the peak resident set size of the process while in the processor, in kilobytes.
+    */
+    long long m_peakGrowth;
+    /* Variable: m_heapGrowth
+    The number of bytes allocated on the heap by the processor and not freed again, which is negative if it freed more than it
+    allocated.  Only available with the GNU C library, and 0 elsewhere.
+    */
+    long long m_heapGrowth;
+    /* Variable: m_inputRecords
+    The number of dictionaries received.
+    */
+    unsigned long long m_inputRecords;
+    /* Variable: m_inputEntries
+    The total number of entries in the dictionaries received, counting the entries of nested dictionaries and arrays.
+    */
+    unsigned long long m_inputEntries;
+    /* Variable: m_inputDepth
+    The deepest nesting of dictionaries and arrays in any dictionary received, with 1 for a dictionary holding no others.
+    */
+    unsigned int m_inputDepth;
+    /* Variable: m_outputRecords
+    The number of dictionaries produced.
+    */
+    unsigned long long m_outputRecords;
+    /* Variable: m_outputEntries
+    The total number of entries in the dictionaries produced, as for <m_inputEntries>.
+    */
+    unsigned long long m_outputEntries;
+    /* Variable: m_outputDepth
+    The deepest nesting in any dictionary produced, as for <m_inputDepth>.
+    */
+    unsigned int m_outputDepth;
+} ATP_ProfileStats;
+
+/* Structure: ATP_ProfileSample
+The state of the process at the start of a measurement.  Only meaningful to <ATP_profileStop> and <ATP_profileExclude>.
+*/
+typedef struct ATP_ProfileSample
+{
+    double m_wallTime;
+    double m_cpuTime;
+    long long m_peakRss;
+    long long m_heapUsed;
+} ATP_ProfileSample;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_profileSetEnabled
+Turn profiling on or off for the processors run from now on.
+
+Parameters:
+    p_enabled - 1 to profile, 0 not to.
+*/
+EXPORT void ATP_profileSetEnabled(int p_enabled);
+/* Function: ATP_profileEnabled
+Determine whether profiling is turned on.
+
+Returns:
+    1 if processors are profiled, 0 if they are not.
+*/
+EXPORT int ATP_profileEnabled(void);
+
+/* Function: ATP_profileStart
+Take a sample of the state of the process at the start of a measurement.
+
+Parameters:
+    p_sample - The sample to fill.
+*/
+EXPORT void ATP_profileStart(ATP_ProfileSample *p_sample);
+/* Function: ATP_profileStop
+Add the resources used since a sample was taken to a set of measurements, as one call.
+
+Parameters:
+    p_stats  - The measurements to add to.
+    p_sample - The sample taken at the start of the call.
+*/
+EXPORT void ATP_profileStop(ATP_ProfileStats *p_stats, const ATP_ProfileSample *p_sample);
+/* Function: ATP_profileExclude
+Remove the resources used since a sample was taken from a set of measurements, for work done on behalf of something else in the
+middle of a call.
+
+Parameters:
+    p_stats  - The measurements to remove from.
+    p_sample - The sample taken at the start of the work to exclude.
+*/
+EXPORT void ATP_profileExclude(ATP_ProfileStats *p_stats, const ATP_ProfileSample *p_sample);
+/* Function: ATP_profileCountInput
+Count a dictionary received by a processor.
+
+Parameters:
+    p_stats  - The measurements of the processor.
+    p_record - The dictionary received.
+*/
+EXPORT void ATP_profileCountInput(ATP_ProfileStats *p_stats, const ATP_Dictionary *p_record);
+/* Function: ATP_profileCountOutput
+Count a dictionary produced by a processor.
+
+Parameters:
+    p_stats  - The measurements of the processor.
+    p_record - The dictionary produced.
+*/
+EXPORT void ATP_profileCountOutput(ATP_ProfileStats *p_stats, const ATP_Dictionary *p_record);
+
+/* Function: ATP_profileReport
+Print a table of the measurements of a number of processors, and optionally write them to a file as JSON.
+
+Parameters:
+    p_names - The names of the processors.
+    p_stats - The measurements of each processor.
+    p_count - The number of processors.
+    p_file  - The path of the JSON file to write, or NULL to only print the table.
+
+Returns:
+    1 on success, 0 if the file could not be written.
+*/
+EXPORT int ATP_profileReport(const char *const *p_names, const ATP_ProfileStats *const *p_stats, unsigned int p_count,
+                             const char *p_file);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_PROFILE_H_ */
@@ -0,0 +1,123 @@
+#include "Queue.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdlib.h>
+
+// number of times to check a queue before going to sleep on it
+#define c_spinCount     64
+
+void Queue_init(Queue *p_queue, unsigned int p_capacity)
+{
+    unsigned long l_capacity = 1;
+    while (l_capacity < p_capacity)
+    {
+        l_capacity <<= 1;
+    }
+
+    p_queue->m_slots = malloc(l_capacity * sizeof(void *));
+    if (p_queue->m_slots == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    p_queue->m_mask = l_capacity - 1;
+    p_queue->m_head = 0;
+    p_queue->m_tail = 0;
+    p_queue->m_closed = 0;
+    p_queue->m_waiters = 0;
+    Mutex_init(&p_queue->m_mutex);
+    Condition_init(&p_queue->m_condition);
+}
+
+void Queue_destroy(Queue *p_queue)
+{
+    Condition_destroy(&p_queue->m_condition);
+    Mutex_destroy(&p_queue->m_mutex);
+    free(p_queue->m_slots);
+    p_queue->m_slots = NULL;
+}
+
+// the head and tail only ever increase, so their difference is the number of items in the queue even once they wrap
+static int canPush(Queue *p_queue)
+{
+    return ATOMIC_LOAD(p_queue->m_closed)
+        || (unsigned long) p_queue->m_tail - (unsigned long) ATOMIC_LOAD(p_queue->m_head) <= p_queue->m_mask;
+}
+
+static int canPop(Queue *p_queue)
+{
+    return ATOMIC_LOAD(p_queue->m_closed) || ATOMIC_LOAD(p_queue->m_tail) != p_queue->m_head;
+}
+
+static void waitUntil(Queue *p_queue, int (*p_ready)(Queue *))
+{
+    unsigned int i;
+    for (i = 0; i < c_spinCount; ++i)
+    {
+        if (p_ready(p_queue))
+        {
+            return;
+        }
+        CPU_RELAX();
+    }
+
+    // the waiter count is raised before the final check, and the other thread publishes its change before checking the
+    // count, so at least one of the two is guaranteed to see the other
+    Mutex_lock(&p_queue->m_mutex);
+    ATOMIC_INCREMENT(p_queue->m_waiters);
+    while (!p_ready(p_queue))
+    {
+        Condition_wait(&p_queue->m_condition, &p_queue->m_mutex);
+    }
+    ATOMIC_DECREMENT(p_queue->m_waiters);
+    Mutex_unlock(&p_queue->m_mutex);
+}
+
+static void wake(Queue *p_queue)
+{
+    if (ATOMIC_LOAD(p_queue->m_waiters) > 0)
+    {
+        Mutex_lock(&p_queue->m_mutex);
+        Condition_broadcast(&p_queue->m_condition);
+        Mutex_unlock(&p_queue->m_mutex);
+    }
+}
+
+int Queue_push(Queue *p_queue, void *p_item)
+{
+    waitUntil(p_queue, &canPush);
+    if (ATOMIC_LOAD(p_queue->m_closed))
+    {
+        return 0;
+    }
+
+    p_queue->m_slots[(unsigned long) p_queue->m_tail & p_queue->m_mask] = p_item;
+    ATOMIC_INCREMENT(p_queue->m_tail);
+    wake(p_queue);
+    return 1;
+}
+
+int Queue_pop(Queue *p_queue, void **p_item)
+{
+    waitUntil(p_queue, &canPop);
+    if (ATOMIC_LOAD(p_queue->m_tail) == p_queue->m_head)
+    {
+        // closed and drained
+        return 0;
+    }
+
+    *p_item = p_queue->m_slots[(unsigned long) p_queue->m_head & p_queue->m_mask];
+    ATOMIC_INCREMENT(p_queue->m_head);
+    wake(p_queue);
+    return 1;
+}
+
+void Queue_close(Queue *p_queue)
+{
+    ATOMIC_STORE(p_queue->m_closed, 1);
+
+    Mutex_lock(&p_queue->m_mutex);
+    Condition_broadcast(&p_queue->m_condition);
+    Mutex_unlock(&p_queue->m_mutex);
+}
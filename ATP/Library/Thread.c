@@ -0,0 +1,152 @@
+#include "Thread.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdlib.h>
+#if !_WIN32
+    #include <unistd.h>
+#endif
+
+typedef struct ThreadStart
+{
+    ThreadMain m_main;
+    void *m_context;
+} ThreadStart;
+
+#if _WIN32
+static DWORD WINAPI trampoline(LPVOID p_start)
+#else // NOTE: assume POSIX for now
+static void *trampoline(void *p_start)
+#endif
+{
+    ThreadStart l_start = *(ThreadStart *) p_start;
+    free(p_start);
+
+    l_start.m_main(l_start.m_context);
+    return 0;
+}
+
+void Thread_start(Thread *p_thread, ThreadMain p_main, void *p_context)
+{
+    ThreadStart *l_start = malloc(sizeof(ThreadStart));
+    if (l_start == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_start->m_main = p_main;
+    l_start->m_context = p_context;
+
+#if _WIN32
+    *p_thread = CreateThread(NULL, 0, &trampoline, l_start, 0, NULL);
+    if (*p_thread == NULL)
+    {
+        ERR("Unable to create thread (error %lu)\n", (unsigned long) GetLastError());
+        exit(EX_OSERR);
+    }
+#else // NOTE: assume POSIX for now
+    {
+        int l_error = pthread_create(p_thread, NULL, &trampoline, l_start);
+        if (l_error != 0)
+        {
+            ERR("Unable to create thread (error %d)\n", l_error);
+            exit(EX_OSERR);
+        }
+    }
+#endif
+}
+
+void Thread_join(Thread *p_thread)
+{
+#if _WIN32
+    WaitForSingleObject(*p_thread, INFINITE);
+    CloseHandle(*p_thread);
+#else // NOTE: assume POSIX for now
+    pthread_join(*p_thread, NULL);
+#endif
+}
+
+unsigned int Thread_cpuCount(void)
+{
+#if _WIN32
+    SYSTEM_INFO l_info;
+    GetSystemInfo(&l_info);
+    return (l_info.dwNumberOfProcessors > 0 ? (unsigned int) l_info.dwNumberOfProcessors : 1);
+#else // NOTE: assume POSIX for now
+    long l_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (l_count > 0 ? (unsigned int) l_count : 1);
+#endif
+}
+
+void Mutex_init(Mutex *p_mutex)
+{
+#if _WIN32
+    InitializeCriticalSection(p_mutex);
+#else // NOTE: assume POSIX for now
+    pthread_mutex_init(p_mutex, NULL);
+#endif
+}
+
+void Mutex_destroy(Mutex *p_mutex)
+{
+#if _WIN32
+    DeleteCriticalSection(p_mutex);
+#else // NOTE: assume POSIX for now
+    pthread_mutex_destroy(p_mutex);
+#endif
+}
+
+void Mutex_lock(Mutex *p_mutex)
+{
+#if _WIN32
+    EnterCriticalSection(p_mutex);
+#else // NOTE: assume POSIX for now
+    pthread_mutex_lock(p_mutex);
+#endif
+}
+
+void Mutex_unlock(Mutex *p_mutex)
+{
+#if _WIN32
+    LeaveCriticalSection(p_mutex);
+#else // NOTE: assume POSIX for now
+    pthread_mutex_unlock(p_mutex);
+#endif
+}
+
+void Condition_init(Condition *p_condition)
+{
+#if _WIN32
+    InitializeConditionVariable(p_condition);
+#else // NOTE: assume POSIX for now
+    pthread_cond_init(p_condition, NULL);
+#endif
+}
+
+void Condition_destroy(Condition *p_condition)
+{
+#if _WIN32
+    // nothing to release
+    (void) p_condition;
+#else // NOTE: assume POSIX for now
+    pthread_cond_destroy(p_condition);
+#endif
+}
+
+void Condition_wait(Condition *p_condition, Mutex *p_mutex)
+{
+#if _WIN32
+    SleepConditionVariableCS(p_condition, p_mutex, INFINITE);
+#else // NOTE: assume POSIX for now
+    pthread_cond_wait(p_condition, p_mutex);
+#endif
+}
+
+void Condition_broadcast(Condition *p_condition)
+{
+#if _WIN32
+    WakeAllConditionVariable(p_condition);
+#else // NOTE: assume POSIX for now
+    pthread_cond_broadcast(p_condition);
+#endif
+}
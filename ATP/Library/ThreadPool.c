@@ -0,0 +1,430 @@
+#include "ThreadPool.h"
+#include "Atomic.inc"
+#include "Thread.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define c_initialCapacity   64
+// parts of a parallel for loop given to each thread when no grain size is given, to balance parts that take longer than others
+#define c_partsPerThread    4
+
+typedef struct PoolTask
+{
+    // exactly one of these is set
+    ATP_ThreadPoolTask m_task;
+    ATP_ThreadPoolRange m_range;
+    void *m_context;
+    unsigned int m_begin;
+    unsigned int m_end;
+    struct ATP_TaskGroupImpl *m_group;
+} PoolTask;
+
+// the tasks queued by one worker, oldest at the head; the owner works at the tail, and other threads steal from the head
+typedef struct PoolDeque
+{
+    AtomicCount m_lock;
+    PoolTask *m_tasks;
+    unsigned long m_mask;
+    unsigned long m_head;
+    unsigned long m_tail;
+} PoolDeque;
+
+typedef struct PoolWorker
+{
+    struct ATP_ThreadPoolImpl *m_pool;
+    unsigned int m_index;
+    Thread m_thread;
+} PoolWorker;
+
+struct ATP_TaskGroupImpl
+{
+    struct ATP_ThreadPoolImpl *m_pool;
+    AtomicCount m_pending;
+};
+
+struct ATP_ThreadPoolImpl
+{
+    unsigned int m_workerCount;
+    PoolWorker *m_workers;
+    PoolDeque *m_deques;
+    // the number of tasks in every deque together, and the deque the next task from outside the pool goes to
+    AtomicCount m_queued;
+    AtomicCount m_next;
+    // threads sleeping until a task is queued or a group finishes
+    AtomicCount m_sleepers;
+    AtomicCount m_stop;
+    struct ATP_TaskGroupImpl m_submitted;
+    Mutex m_mutex;
+    Condition m_condition;
+};
+
+static THREAD_LOCAL PoolWorker *gs_worker = NULL;
+static ATP_ThreadPool gs_shared = NULL;
+
+static void dequePush(PoolDeque *p_deque, const PoolTask *p_task)
+{
+    SPIN_LOCK(p_deque->m_lock);
+    if (p_deque->m_tail - p_deque->m_head > p_deque->m_mask)
+    {
+        // double the ring, keeping the tasks in order from the start of it
+        unsigned long i;
+        unsigned long l_capacity = (p_deque->m_mask + 1) * 2;
+        PoolTask *l_tasks = malloc(l_capacity * sizeof(PoolTask));
+        if (l_tasks == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        for (i = p_deque->m_head; i != p_deque->m_tail; ++i)
+        {
+            l_tasks[i - p_deque->m_head] = p_deque->m_tasks[i & p_deque->m_mask];
+        }
+        free(p_deque->m_tasks);
+
+        p_deque->m_tasks = l_tasks;
+        p_deque->m_tail -= p_deque->m_head;
+        p_deque->m_head = 0;
+        p_deque->m_mask = l_capacity - 1;
+    }
+    p_deque->m_tasks[p_deque->m_tail++ & p_deque->m_mask] = *p_task;
+    SPIN_UNLOCK(p_deque->m_lock);
+}
+
+static int dequeTake(PoolDeque *p_deque, PoolTask *p_task, int p_newest)
+{
+    int l_taken = 0;
+
+    SPIN_LOCK(p_deque->m_lock);
+    if (p_deque->m_tail != p_deque->m_head)
+    {
+        *p_task = p_deque->m_tasks[(p_newest ? --p_deque->m_tail : p_deque->m_head++) & p_deque->m_mask];
+        l_taken = 1;
+    }
+    SPIN_UNLOCK(p_deque->m_lock);
+
+    return l_taken;
+}
+
+static void wake(struct ATP_ThreadPoolImpl *p_pool)
+{
+    Mutex_lock(&p_pool->m_mutex);
+    Condition_broadcast(&p_pool->m_condition);
+    Mutex_unlock(&p_pool->m_mutex);
+}
+
+static void runTask(const PoolTask *p_task)
+{
+    struct ATP_TaskGroupImpl *l_group = p_task->m_group;
+    struct ATP_ThreadPoolImpl *l_pool = l_group->m_pool;
+
+    if (p_task->m_range != NULL)
+    {
+        p_task->m_range(p_task->m_begin, p_task->m_end, p_task->m_context);
+    }
+    else
+    {
+        p_task->m_task(p_task->m_context);
+    }
+
+    // the group may be gone as soon as its count reaches zero, but the pool is still there
+    if (l_pool != NULL && ATOMIC_DECREMENT(l_group->m_pending) == 0)
+    {
+        wake(l_pool);
+    }
+}
+
+static void enqueue(struct ATP_ThreadPoolImpl *p_pool, struct ATP_TaskGroupImpl *p_group, const PoolTask *p_task)
+{
+    unsigned int l_deque;
+
+    if (p_pool != NULL)
+    {
+        ATOMIC_INCREMENT(p_group->m_pending);
+    }
+    if (p_pool == NULL || p_pool->m_workerCount == 0)
+    {
+        runTask(p_task);
+        return;
+    }
+
+    // workers queue their own tasks, while tasks from outside the pool are dealt out in turn
+    if (gs_worker != NULL && gs_worker->m_pool == p_pool)
+    {
+        l_deque = gs_worker->m_index;
+    }
+    else
+    {
+        l_deque = (unsigned int) ((unsigned long) ATOMIC_INCREMENT(p_pool->m_next) % p_pool->m_workerCount);
+    }
+
+    dequePush(&p_pool->m_deques[l_deque], p_task);
+    ATOMIC_INCREMENT(p_pool->m_queued);
+
+    // pairs with the sleeping thread counting itself before checking for tasks, so that one of the two sees the other
+    if (ATOMIC_LOAD(p_pool->m_sleepers) > 0)
+    {
+        wake(p_pool);
+    }
+}
+
+static int takeTask(struct ATP_ThreadPoolImpl *p_pool, PoolTask *p_task)
+{
+    unsigned int i;
+    unsigned int l_first = 0;
+
+    if (ATOMIC_LOAD(p_pool->m_queued) == 0)
+    {
+        return 0;
+    }
+
+    // a worker takes its own newest task first, since its data is the most likely to still be in the cache
+    if (gs_worker != NULL && gs_worker->m_pool == p_pool)
+    {
+        l_first = gs_worker->m_index;
+        if (dequeTake(&p_pool->m_deques[l_first], p_task, 1))
+        {
+            ATOMIC_DECREMENT(p_pool->m_queued);
+            return 1;
+        }
+    }
+
+    for (i = 1; i <= p_pool->m_workerCount; ++i)
+    {
+        if (dequeTake(&p_pool->m_deques[(l_first + i) % p_pool->m_workerCount], p_task, 0))
+        {
+            ATOMIC_DECREMENT(p_pool->m_queued);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// run queued tasks until the group finishes, or until the pool stops if there is no group
+static void work(struct ATP_ThreadPoolImpl *p_pool, struct ATP_TaskGroupImpl *p_group)
+{
+    for (;;)
+    {
+        PoolTask l_task;
+
+        if (p_group != NULL ? ATOMIC_LOAD(p_group->m_pending) == 0 : ATOMIC_LOAD(p_pool->m_stop) != 0)
+        {
+            return;
+        }
+        if (takeTask(p_pool, &l_task))
+        {
+            runTask(&l_task);
+            continue;
+        }
+
+        ATOMIC_INCREMENT(p_pool->m_sleepers);
+        Mutex_lock(&p_pool->m_mutex);
+        while (ATOMIC_LOAD(p_pool->m_queued) == 0
+               && (p_group != NULL ? ATOMIC_LOAD(p_group->m_pending) != 0 : ATOMIC_LOAD(p_pool->m_stop) == 0))
+        {
+            Condition_wait(&p_pool->m_condition, &p_pool->m_mutex);
+        }
+        Mutex_unlock(&p_pool->m_mutex);
+        ATOMIC_DECREMENT(p_pool->m_sleepers);
+    }
+}
+
+static void workerMain(void *p_worker)
+{
+    gs_worker = p_worker;
+    work(gs_worker->m_pool, NULL);
+}
+
+void ATP_threadPoolInit(ATP_ThreadPool *p_pool, unsigned int p_threads)
+{
+    unsigned int i;
+    struct ATP_ThreadPoolImpl *l_pool = calloc(1, sizeof(struct ATP_ThreadPoolImpl));
+    if (l_pool == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+
+    // the thread waiting for tasks runs them too
+    l_pool->m_workerCount = (p_threads == 0 ? Thread_cpuCount() : p_threads) - 1;
+    l_pool->m_submitted.m_pool = l_pool;
+    Mutex_init(&l_pool->m_mutex);
+    Condition_init(&l_pool->m_condition);
+
+    if (l_pool->m_workerCount > 0)
+    {
+        l_pool->m_workers = malloc(l_pool->m_workerCount * sizeof(PoolWorker));
+        l_pool->m_deques = calloc(l_pool->m_workerCount, sizeof(PoolDeque));
+        if (l_pool->m_workers == NULL || l_pool->m_deques == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+    }
+    for (i = 0; i < l_pool->m_workerCount; ++i)
+    {
+        l_pool->m_deques[i].m_tasks = malloc(c_initialCapacity * sizeof(PoolTask));
+        if (l_pool->m_deques[i].m_tasks == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        l_pool->m_deques[i].m_mask = c_initialCapacity - 1;
+    }
+
+    // every deque is in place before any worker can steal from it
+    for (i = 0; i < l_pool->m_workerCount; ++i)
+    {
+        l_pool->m_workers[i].m_pool = l_pool;
+        l_pool->m_workers[i].m_index = i;
+        Thread_start(&l_pool->m_workers[i].m_thread, &workerMain, &l_pool->m_workers[i]);
+    }
+
+    *p_pool = l_pool;
+}
+
+void ATP_threadPoolDestroy(ATP_ThreadPool *p_pool)
+{
+    unsigned int i;
+    struct ATP_ThreadPoolImpl *l_pool = *p_pool;
+
+    if (l_pool == NULL)
+    {
+        return;
+    }
+
+    work(l_pool, &l_pool->m_submitted);
+    ATOMIC_STORE(l_pool->m_stop, 1);
+    wake(l_pool);
+    for (i = 0; i < l_pool->m_workerCount; ++i)
+    {
+        Thread_join(&l_pool->m_workers[i].m_thread);
+        free(l_pool->m_deques[i].m_tasks);
+    }
+
+    Condition_destroy(&l_pool->m_condition);
+    Mutex_destroy(&l_pool->m_mutex);
+    free(l_pool->m_workers);
+    free(l_pool->m_deques);
+    free(l_pool);
+    *p_pool = NULL;
+}
+
+unsigned int ATP_threadPoolSize(const ATP_ThreadPool *p_pool)
+{
+    return (p_pool != NULL && *p_pool != NULL ? (*p_pool)->m_workerCount + 1 : 1);
+}
+
+void ATP_threadPoolSetShared(const ATP_ThreadPool *p_pool)
+{
+    gs_shared = (p_pool != NULL ? *p_pool : NULL);
+}
+
+ATP_ThreadPool *ATP_threadPoolShared(void)
+{
+    return &gs_shared;
+}
+
+void ATP_threadPoolSubmit(ATP_ThreadPool *p_pool, ATP_ThreadPoolTask p_task, void *p_context)
+{
+    struct ATP_ThreadPoolImpl *l_pool = (p_pool != NULL ? *p_pool : NULL);
+    PoolTask l_task;
+
+    if (l_pool == NULL)
+    {
+        p_task(p_context);
+        return;
+    }
+
+    memset(&l_task, 0, sizeof(l_task));
+    l_task.m_task = p_task;
+    l_task.m_context = p_context;
+    l_task.m_group = &l_pool->m_submitted;
+    enqueue(l_pool, &l_pool->m_submitted, &l_task);
+}
+
+void ATP_threadPoolFor(ATP_ThreadPool *p_pool, unsigned int p_begin, unsigned int p_end, unsigned int p_grain,
+                       ATP_ThreadPoolRange p_body, void *p_context)
+{
+    struct ATP_TaskGroupImpl l_group;
+    PoolTask l_task;
+    unsigned int l_length = (p_end > p_begin ? p_end - p_begin : 0);
+    unsigned int l_threads = ATP_threadPoolSize(p_pool);
+    unsigned int l_grain = p_grain;
+    unsigned int i;
+
+    if (l_length == 0)
+    {
+        return;
+    }
+    if (l_grain == 0)
+    {
+        l_grain = l_length / (l_threads * c_partsPerThread);
+    }
+    if (l_grain == 0)
+    {
+        l_grain = 1;
+    }
+    if (l_threads == 1 || l_grain >= l_length)
+    {
+        p_body(p_begin, p_end, p_context);
+        return;
+    }
+
+    l_group.m_pool = *p_pool;
+    l_group.m_pending = 0;
+    memset(&l_task, 0, sizeof(l_task));
+    l_task.m_range = p_body;
+    l_task.m_context = p_context;
+    l_task.m_group = &l_group;
+    for (i = p_begin; i < p_end; i += (p_end - i > l_grain ? l_grain : p_end - i))
+    {
+        l_task.m_begin = i;
+        l_task.m_end = (p_end - i > l_grain ? i + l_grain : p_end);
+        enqueue(l_group.m_pool, &l_group, &l_task);
+    }
+    work(l_group.m_pool, &l_group);
+}
+
+void ATP_taskGroupInit(ATP_TaskGroup *p_group, ATP_ThreadPool *p_pool)
+{
+    *p_group = calloc(1, sizeof(struct ATP_TaskGroupImpl));
+    if (*p_group == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    (*p_group)->m_pool = (p_pool != NULL ? *p_pool : NULL);
+}
+
+void ATP_taskGroupRun(ATP_TaskGroup *p_group, ATP_ThreadPoolTask p_task, void *p_context)
+{
+    PoolTask l_task;
+
+    memset(&l_task, 0, sizeof(l_task));
+    l_task.m_task = p_task;
+    l_task.m_context = p_context;
+    l_task.m_group = *p_group;
+    enqueue((*p_group)->m_pool, *p_group, &l_task);
+}
+
+void ATP_taskGroupWait(ATP_TaskGroup *p_group)
+{
+    if ((*p_group)->m_pool != NULL)
+    {
+        work((*p_group)->m_pool, *p_group);
+    }
+}
+
+void ATP_taskGroupDestroy(ATP_TaskGroup *p_group)
+{
+    if (*p_group != NULL)
+    {
+        ATP_taskGroupWait(p_group);
+        free(*p_group);
+        *p_group = NULL;
+    }
+}
@@ -0,0 +1,158 @@
+/* File: ThreadPool.h
+A pool of worker threads for processors that split their work into parallel tasks.
+
+Each worker keeps its own double ended queue of tasks.  A worker takes the tasks it queued itself newest first, and once it runs
+out it steals the oldest tasks queued by the others, so that work spreads between the workers without them contending on a
+single queue.  Tasks submitted from threads outside the pool are dealt out between the workers in turn.
+
+A thread waiting for tasks to finish, through <ATP_taskGroupWait> or <ATP_threadPoolFor>, runs queued tasks itself in the
+meantime.  Tasks may therefore start and wait for tasks of their own without tying up the workers, and a pool of N threads has
+N - 1 workers, the calling thread making up the last.
+
+The atp executable creates a pool sized by its --threads option for each run, and shares it between every processor through
+<ATP_threadPoolShared>, so that processors running in parallel do not start more threads than the machine has cores.  Every
+function accepting a pool also accepts NULL, or an empty handle, and then runs the tasks on the calling thread.
+*/
+#ifndef _ATP_LIBRARY_THREADPOOL_H_
+#define _ATP_LIBRARY_THREADPOOL_H_
+
+#include "Export.h"
+
+// forward declarations
+struct ATP_ThreadPoolImpl;
+struct ATP_TaskGroupImpl;
+
+/* Type: ATP_ThreadPool
+Reference to a thread pool.
+*/
+typedef struct ATP_ThreadPoolImpl *ATP_ThreadPool;
+/* Type: ATP_TaskGroup
+Reference to a group of tasks that can be waited for together.
+*/
+typedef struct ATP_TaskGroupImpl *ATP_TaskGroup;
+
+/* Type: ATP_ThreadPoolTask
+Function run as a task.
+
+Parameters:
+    p_context - The context pointer given along with the function.
+*/
+typedef void (*ATP_ThreadPoolTask)(void *p_context);
+/* Type: ATP_ThreadPoolRange
+Function run by <ATP_threadPoolFor> on part of a range of indices.
+
+Parameters:
+    p_begin   - The first index of the part.
+    p_end     - One past the last index of the part.
+    p_context - The context pointer given to <ATP_threadPoolFor>.
+*/
+typedef void (*ATP_ThreadPoolRange)(unsigned int p_begin, unsigned int p_end, void *p_context);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_threadPoolInit
+Start a thread pool.
+
+Parameters:
+    p_pool    - The pool handle to initialize.
+    p_threads - The number of threads to run tasks on, counting the thread waiting for them, or 0 for one per processor core.
+                1 starts no workers, so that every task runs on the thread that waits for it.
+*/
+EXPORT void ATP_threadPoolInit(ATP_ThreadPool *p_pool, unsigned int p_threads);
+/* Function: ATP_threadPoolDestroy
+Wait for every task submitted to a pool to finish, then stop its workers.
+
+Parameters:
+    p_pool - The pool handle.
+*/
+EXPORT void ATP_threadPoolDestroy(ATP_ThreadPool *p_pool);
+/* Function: ATP_threadPoolSize
+Get the number of threads a pool runs tasks on, counting the thread waiting for them.
+
+Parameters:
+    p_pool - The pool handle, or NULL.
+
+Returns:
+    The number of threads, which is 1 without a pool.
+*/
+EXPORT unsigned int ATP_threadPoolSize(const ATP_ThreadPool *p_pool);
+
+/* Function: ATP_threadPoolSetShared
+Set the pool returned by <ATP_threadPoolShared>.
+
+Parameters:
+    p_pool - The pool handle, or NULL to share no pool.
+*/
+EXPORT void ATP_threadPoolSetShared(const ATP_ThreadPool *p_pool);
+/* Function: ATP_threadPoolShared
+Get the pool shared by every processor in the current run.
+
+Returns:
+    The pool handle, which is empty if no pool is shared.
+*/
+EXPORT ATP_ThreadPool *ATP_threadPoolShared(void);
+
+/* Function: ATP_threadPoolSubmit
+Queue a task that nothing waits for.  <ATP_threadPoolDestroy> waits for it to finish.
+
+Parameters:
+    p_pool    - The pool handle, or NULL to run the task at once.
+    p_task    - The function to run.
+    p_context - A pointer to pass on to the function.
+*/
+EXPORT void ATP_threadPoolSubmit(ATP_ThreadPool *p_pool, ATP_ThreadPoolTask p_task, void *p_context);
+/* Function: ATP_threadPoolFor
+Run a function over a range of indices, split into parts that run in parallel, and wait for every part to finish.
+
+Parameters:
+    p_pool    - The pool handle, or NULL to run the whole range at once.
+    p_begin   - The first index of the range.
+    p_end     - One past the last index of the range.
+    p_grain   - The smallest number of indices worth running as a part of their own, or 0 to split the range into a few parts
+                for each thread.
+    p_body    - The function to run on each part.
+    p_context - A pointer to pass on to the function.
+*/
+EXPORT void ATP_threadPoolFor(ATP_ThreadPool *p_pool, unsigned int p_begin, unsigned int p_end, unsigned int p_grain,
+                              ATP_ThreadPoolRange p_body, void *p_context);
+
+/* Function: ATP_taskGroupInit
+Initialize an empty group of tasks.
+
+Parameters:
+    p_group - The group handle to initialize.
+    p_pool  - The pool to run the tasks of the group in, or NULL to run them at once.
+*/
+EXPORT void ATP_taskGroupInit(ATP_TaskGroup *p_group, ATP_ThreadPool *p_pool);
+/* Function: ATP_taskGroupRun
+Queue a task as part of a group.
+
+Parameters:
+    p_group   - The group handle.
+    p_task    - The function to run.
+    p_context - A pointer to pass on to the function.
+*/
+EXPORT void ATP_taskGroupRun(ATP_TaskGroup *p_group, ATP_ThreadPoolTask p_task, void *p_context);
+/* Function: ATP_taskGroupWait
+Wait for every task queued as part of a group so far to finish, running queued tasks in the meantime.
+
+Parameters:
+    p_group - The group handle.
+*/
+EXPORT void ATP_taskGroupWait(ATP_TaskGroup *p_group);
+/* Function: ATP_taskGroupDestroy
+Wait for the tasks of a group to finish, then destroy it.
+
+Parameters:
+    p_group - The group handle.
+*/
+EXPORT void ATP_taskGroupDestroy(ATP_TaskGroup *p_group);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_THREADPOOL_H_ */
@@ -0,0 +1,223 @@
+#include "Trace.h"
+#include "Atomic.inc"
+#include "Thread.inc"
+#include "Exit.h"
+#include "Log.h"
+
+#include "ATP/ThirdParty/UT/utlist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !_WIN32
+    #include <time.h>
+#endif
+
+#define c_nameLength    64
+#define c_maxDepth      32
+
+typedef struct TraceSpan
+{
+    char m_name[c_nameLength];
+    // in microseconds since tracing started
+    double m_start;
+    double m_duration;
+} TraceSpan;
+
+typedef struct TraceBuffer
+{
+    unsigned int m_thread;
+    // the spans are written round the ring, overwriting the oldest once it is full
+    TraceSpan m_spans[c_ATP_Trace_bufferSize];
+    unsigned long long m_written;
+    // the spans still open, innermost last; spans nested deeper than these are not recorded
+    TraceSpan m_open[c_maxDepth];
+    unsigned int m_depth;
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+static int gs_enabled = 0;
+static double gs_origin = 0.0;
+
+// every buffer handed out since tracing started, guarded by the lock; each thread finds its own through thread local storage,
+// and a buffer from an earlier trace is recognized by its generation
+static AtomicCount gs_lock = 0;
+static TraceBuffer *gs_buffers = NULL;
+static unsigned int gs_bufferCount = 0;
+static unsigned int gs_generation = 0;
+static THREAD_LOCAL TraceBuffer *gs_buffer = NULL;
+static THREAD_LOCAL unsigned int gs_bufferGeneration = 0;
+
+static double now(void)
+{
+#if _WIN32
+    LARGE_INTEGER l_counter;
+    LARGE_INTEGER l_frequency;
+    QueryPerformanceCounter(&l_counter);
+    QueryPerformanceFrequency(&l_frequency);
+    return (double) l_counter.QuadPart * 1e6 / (double) l_frequency.QuadPart;
+#else // NOTE: assume POSIX for now
+    struct timespec l_time;
+    clock_gettime(CLOCK_MONOTONIC, &l_time);
+    return (double) l_time.tv_sec * 1e6 + (double) l_time.tv_nsec / 1e3;
+#endif
+}
+
+static void releaseBuffers(void)
+{
+    TraceBuffer *it = NULL;
+    TraceBuffer *l_tmp = NULL;
+
+    SPIN_LOCK(gs_lock);
+    LL_FOREACH_SAFE(gs_buffers, it, l_tmp)
+    {
+        LL_DELETE(gs_buffers, it);
+        free(it);
+    }
+    gs_bufferCount = 0;
+    ++gs_generation;
+    SPIN_UNLOCK(gs_lock);
+}
+
+static TraceBuffer *threadBuffer(void)
+{
+    if (gs_buffer == NULL || gs_bufferGeneration != gs_generation)
+    {
+        TraceBuffer *l_buffer = malloc(sizeof(TraceBuffer));
+        if (l_buffer == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        l_buffer->m_written = 0;
+        l_buffer->m_depth = 0;
+
+        SPIN_LOCK(gs_lock);
+        l_buffer->m_thread = gs_bufferCount++;
+        LL_APPEND(gs_buffers, l_buffer);
+        gs_bufferGeneration = gs_generation;
+        SPIN_UNLOCK(gs_lock);
+
+        gs_buffer = l_buffer;
+    }
+
+    return gs_buffer;
+}
+
+void ATP_traceStart(void)
+{
+    releaseBuffers();
+    gs_origin = now();
+    gs_enabled = 1;
+}
+
+int ATP_traceEnabled(void)
+{
+    return gs_enabled;
+}
+
+void ATP_traceBegin(const char *p_name, const char *p_detail)
+{
+    TraceBuffer *l_buffer;
+
+    if (!gs_enabled)
+    {
+        return;
+    }
+
+    l_buffer = threadBuffer();
+    if (l_buffer->m_depth < c_maxDepth)
+    {
+        TraceSpan *l_span = &l_buffer->m_open[l_buffer->m_depth];
+        snprintf(l_span->m_name, sizeof(l_span->m_name), "%s%s%s", p_name, (p_detail != NULL ? " " : ""),
+                 (p_detail != NULL ? p_detail : ""));
+        l_span->m_start = now() - gs_origin;
+    }
+    ++l_buffer->m_depth;
+}
+
+void ATP_traceEnd(void)
+{
+    TraceBuffer *l_buffer;
+
+    if (!gs_enabled)
+    {
+        return;
+    }
+
+    l_buffer = threadBuffer();
+    if (l_buffer->m_depth == 0)
+    {
+        return;
+    }
+
+    --l_buffer->m_depth;
+    if (l_buffer->m_depth < c_maxDepth)
+    {
+        TraceSpan *l_span = &l_buffer->m_spans[l_buffer->m_written++ % c_ATP_Trace_bufferSize];
+        *l_span = l_buffer->m_open[l_buffer->m_depth];
+        l_span->m_duration = now() - gs_origin - l_span->m_start;
+    }
+}
+
+static void writeName(FILE *p_file, const char *p_name)
+{
+    for (; *p_name != '\0'; ++p_name)
+    {
+        if (*p_name == '"' || *p_name == '\\')
+        {
+            fputc('\\', p_file);
+            fputc(*p_name, p_file);
+        }
+        else if ((unsigned char) *p_name >= 0x20)
+        {
+            fputc(*p_name, p_file);
+        }
+    }
+}
+
+int ATP_traceStop(const char *p_file)
+{
+    TraceBuffer *it;
+    FILE *l_file;
+    int l_first = 1;
+    int l_result;
+
+    gs_enabled = 0;
+    l_file = fopen(p_file, "w");
+    if (l_file == NULL)
+    {
+        ERR("Unable to write trace to '%s': %s\n", p_file, strerror(errno));
+        releaseBuffers();
+        return 0;
+    }
+
+    fprintf(l_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    LL_FOREACH(gs_buffers, it)
+    {
+        unsigned long long i;
+        unsigned long long l_oldest = (it->m_written > c_ATP_Trace_bufferSize ? it->m_written - c_ATP_Trace_bufferSize : 0);
+
+        // threads are numbered in the order they first recorded a span
+        fprintf(l_file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,", (l_first ? "" : ","), it->m_thread);
+        fprintf(l_file, "\"args\":{\"name\":\"thread %u\"}}", it->m_thread);
+        l_first = 0;
+        for (i = l_oldest; i < it->m_written; ++i)
+        {
+            const TraceSpan *l_span = &it->m_spans[i % c_ATP_Trace_bufferSize];
+            fprintf(l_file, ",\n{\"name\":\"");
+            writeName(l_file, l_span->m_name);
+            fprintf(l_file, "\",\"cat\":\"atp\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", l_span->m_start,
+                    l_span->m_duration, it->m_thread);
+        }
+    }
+    fprintf(l_file, "\n]}\n");
+
+    l_result = (fclose(l_file) == 0);
+    if (!l_result)
+    {
+        ERR("Unable to write trace to '%s': %s\n", p_file, strerror(errno));
+    }
+    releaseBuffers();
+    return l_result;
+}
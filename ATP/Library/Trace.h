@@ -0,0 +1,65 @@
+/* File: Trace.h
+Timeline tracing, written as Chrome trace events that can be opened in Perfetto or chrome://tracing.
+
+A span is opened with <ATP_traceBegin> and closed with <ATP_traceEnd> on the same thread, and spans may nest.  While tracing is
+off both calls return at once.  While it is on, each thread records its completed spans in a ring buffer of its own, so that
+threads never wait on each other; once a buffer is full, the oldest spans on that thread are dropped.
+
+The library traces loading each processor, each call into a processor, and the threads of a pipeline.  Processors may add
+spans of their own for the work they do.
+*/
+#ifndef _ATP_LIBRARY_TRACE_H_
+#define _ATP_LIBRARY_TRACE_H_
+
+#include "Export.h"
+
+/* Constant: c_ATP_Trace_bufferSize
+The number of spans kept for each thread.
+*/
+#define c_ATP_Trace_bufferSize  16384
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_traceStart
+Start recording spans, discarding any recorded before.
+*/
+EXPORT void ATP_traceStart(void);
+/* Function: ATP_traceStop
+Stop recording spans, and write those recorded to a file.  No other thread may be recording spans at the time.
+
+Parameters:
+    p_file - The path of the trace file to write.
+
+Returns:
+    1 on success, 0 (after printing an error) if the file could not be written.
+*/
+EXPORT int ATP_traceStop(const char *p_file);
+/* Function: ATP_traceEnabled
+Determine whether spans are being recorded, for callers that need to prepare the name of a span.
+
+Returns:
+    1 if spans are being recorded, 0 if they are not.
+*/
+EXPORT int ATP_traceEnabled(void);
+
+/* Function: ATP_traceBegin
+Open a span on the calling thread.
+
+Parameters:
+    p_name   - The name of the span, which is copied.
+    p_detail - Text to append to the name, such as the name of the processor involved, or NULL.
+*/
+EXPORT void ATP_traceBegin(const char *p_name, const char *p_detail);
+/* Function: ATP_traceEnd
+Close the span most recently opened on the calling thread.
+*/
+EXPORT void ATP_traceEnd(void);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_TRACE_H_ */
@@ -1,19 +1,51 @@
 #include "Value.inc"
 
-void Value_changeType(Value *p_value, ATP_ValueType p_newType)
+#include "Exit.h"
+#include "Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the value layout relies on the union following the inline characters directly, without any padding
+typedef char ValueLayoutCheck[(sizeof(Value) == 16 && offsetof(Value, m_value) == 8) ? 1 : -1];
+// the public value type has to be able to hold the internal one
+typedef char PublicValueCheck[(sizeof(((ATP_Value *) NULL)->m_data) >= sizeof(Value)) ? 1 : -1];
+
+// inline strings span m_inline and the union that follows it
+#define INLINE(value)   (((char *) (value)) + offsetof(Value, m_inline))
+
+const char *Value_getString(const Value *p_value)
+{
+    if (p_value->m_storage == e_ValueStorage_inline)
+    {
+        return INLINE(p_value);
+    }
+
+    return p_value->m_value.m_string;
+}
+
+static void freeString(Value *p_value)
+{
+    if (p_value->m_storage == e_ValueStorage_heap)
+    {
+        free(p_value->m_value.m_string);
+    }
+}
+
+void Value_changeType(Value *p_value, ATP_ValueType p_newType, ATP_Arena *p_arena)
 {
     if (p_value->m_type != p_newType)
     {
         switch (p_value->m_type)
         {
             case e_ATP_ValueType_string:
-                utstring_done(&p_value->m_value.m_string);
+                freeString(p_value);
                 break;
             case e_ATP_ValueType_dict:
-                ATP_dictionaryDestroy(&p_value->m_value.m_dict);
+                Value_releaseDict(p_value->m_value.m_dict, p_arena);
                 break;
             case e_ATP_ValueType_array:
-                ATP_arrayDestroy(&p_value->m_value.m_array);
+                Value_releaseArray(p_value->m_value.m_array, p_arena);
                 break;
             default:
                 break;
@@ -23,13 +55,14 @@ void Value_changeType(Value *p_value, ATP_ValueType p_newType)
         switch (p_value->m_type)
         {
             case e_ATP_ValueType_string:
-                utstring_init(&p_value->m_value.m_string);
+                p_value->m_storage = e_ValueStorage_inline;
+                INLINE(p_value)[0] = '\0';
                 break;
             case e_ATP_ValueType_dict:
-                ATP_dictionaryInit(&p_value->m_value.m_dict);
+                p_value->m_value.m_dict = Value_adoptDict(NULL, p_arena);
                 break;
             case e_ATP_ValueType_array:
-                ATP_arrayInit(&p_value->m_value.m_array);
+                p_value->m_value.m_array = Value_adoptArray(NULL, p_arena);
                 break;
             default:
                 break;
@@ -37,14 +70,78 @@ void Value_changeType(Value *p_value, ATP_ValueType p_newType)
     }
 }
 
-void Value_copy(Value *p_dest, const Value *p_source)
+void Value_setString(Value *p_value, const char *p_string, ATP_Arena *p_arena)
+{
+    size_t l_length = strlen(p_string);
+    Value l_new;
+
+    // build the new value separately, in case the string being set belongs to the value itself
+    l_new.m_type = e_ATP_ValueType_string;
+    if (l_length < c_Value_inlineSize)
+    {
+        l_new.m_storage = e_ValueStorage_inline;
+        memcpy(INLINE(&l_new), p_string, l_length + 1);
+    }
+    else if (p_arena != NULL)
+    {
+        l_new.m_storage = e_ValueStorage_arena;
+        l_new.m_value.m_string = ATP_arenaStrndup(p_arena, p_string, l_length);
+    }
+    else
+    {
+        l_new.m_storage = e_ValueStorage_heap;
+        l_new.m_value.m_string = malloc(l_length + 1);
+        if (l_new.m_value.m_string == NULL)
+        {
+            PERR();
+            exit(EX_OSERR);
+        }
+        memcpy(l_new.m_value.m_string, p_string, l_length + 1);
+    }
+
+    Value_changeType(p_value, e_ATP_ValueType_none, p_arena);
+    *p_value = l_new;
+}
+
+void Value_setDict(Value *p_value, ATP_Dictionary p_dict, ATP_Arena *p_arena)
+{
+    if (p_value->m_type == e_ATP_ValueType_dict && p_value->m_value.m_dict == p_dict)
+    {
+        // the value already holds a reference of its own, so the one handed over is dropped
+        ATP_dictionaryDestroy(&p_dict);
+        return;
+    }
+
+    Value_changeType(p_value, e_ATP_ValueType_none, p_arena);
+    p_value->m_type = e_ATP_ValueType_dict;
+    p_value->m_value.m_dict = Value_adoptDict(p_dict, p_arena);
+}
+
+void Value_setArray(Value *p_value, ATP_Array p_array, ATP_Arena *p_arena)
+{
+    if (p_value->m_type == e_ATP_ValueType_array && p_value->m_value.m_array == p_array)
+    {
+        ATP_arrayDestroy(&p_array);
+        return;
+    }
+
+    Value_changeType(p_value, e_ATP_ValueType_none, p_arena);
+    p_value->m_type = e_ATP_ValueType_array;
+    p_value->m_value.m_array = Value_adoptArray(p_array, p_arena);
+}
+
+void Value_copy(Value *p_dest, const Value *p_source, ATP_Arena *p_arena)
 {
-    Value_changeType(p_dest, p_source->m_type);
+    if (p_source->m_type == e_ATP_ValueType_string)
+    {
+        Value_setString(p_dest, Value_getString(p_source), p_arena);
+        return;
+    }
+
+    Value_changeType(p_dest, e_ATP_ValueType_none, p_arena);
+    p_dest->m_type = p_source->m_type;
     switch (p_dest->m_type)
     {
-        case e_ATP_ValueType_string:
-            utstring_concat(&p_dest->m_value.m_string, &p_source->m_value.m_string);
-            break;
         case e_ATP_ValueType_uint:
             p_dest->m_value.m_uint = p_source->m_value.m_uint;
             break;
@@ -58,16 +155,448 @@ void Value_copy(Value *p_dest, const Value *p_source)
             p_dest->m_value.m_bool = p_source->m_value.m_bool;
             break;
         case e_ATP_ValueType_dict:
-            p_dest->m_value.m_dict = ATP_dictionaryDuplicate(&p_source->m_value.m_dict);
+            p_dest->m_value.m_dict = Value_shareDict(p_source->m_value.m_dict, p_arena);
             break;
         case e_ATP_ValueType_array:
-            p_dest->m_value.m_array = ATP_arrayDuplicate(&p_source->m_value.m_array);
+            p_dest->m_value.m_array = Value_shareArray(p_source->m_value.m_array, p_arena);
             break;
         default:
             break;
     }
 }
 
+void Value_move(Value *p_dest, ATP_Arena *p_destArena, Value *p_source, ATP_Arena *p_sourceArena)
+{
+    Value_changeType(p_dest, e_ATP_ValueType_none, p_destArena);
+    if (p_destArena == p_sourceArena
+        || (p_source->m_type != e_ATP_ValueType_string && p_source->m_type != e_ATP_ValueType_dict
+            && p_source->m_type != e_ATP_ValueType_array)
+        || (p_source->m_type == e_ATP_ValueType_string && p_source->m_storage == e_ValueStorage_inline))
+    {
+        // nothing refers to the storage of either container, so the value can just be relinked
+        *p_dest = *p_source;
+    }
+    else if (p_source->m_type == e_ATP_ValueType_string)
+    {
+        Value_setString(p_dest, Value_getString(p_source), p_destArena);
+        Value_changeType(p_source, e_ATP_ValueType_none, p_sourceArena);
+    }
+    else
+    {
+        // a reference from inside an arena does not hold the arena, but one that is being handed over from outside does
+        if (p_sourceArena != NULL)
+        {
+            ATP_arenaRetain(p_sourceArena);
+        }
+
+        if (p_source->m_type == e_ATP_ValueType_dict)
+        {
+            Value_setDict(p_dest, p_source->m_value.m_dict, p_destArena);
+        }
+        else
+        {
+            Value_setArray(p_dest, p_source->m_value.m_array, p_destArena);
+        }
+    }
+
+    p_source->m_type = e_ATP_ValueType_none;
+}
+
+void Value_take(ATP_Value *p_dest, Value *p_source, ATP_Arena *p_sourceArena)
+{
+    ATP_valueDestroy(p_dest);
+
+    // hold on to the arena if the value refers to memory in it, which lets the value be relinked without being copied
+    if (p_sourceArena != NULL
+        && ((p_source->m_type == e_ATP_ValueType_string && p_source->m_storage == e_ValueStorage_arena)
+            || p_source->m_type == e_ATP_ValueType_dict || p_source->m_type == e_ATP_ValueType_array))
+    {
+        p_dest->m_arena = ATP_arenaRetain(p_sourceArena);
+    }
+
+    Value_move(VALUE(p_dest), p_dest->m_arena, p_source, p_sourceArena);
+}
+
+void Value_put(Value *p_dest, ATP_Arena *p_destArena, ATP_Value *p_source)
+{
+    Value_move(p_dest, p_destArena, VALUE(p_source), p_source->m_arena);
+    ATP_arenaRelease(p_source->m_arena);
+    p_source->m_arena = NULL;
+}
+
+size_t Value_measure(const Value *p_value)
+{
+    switch (p_value->m_type)
+    {
+        case e_ATP_ValueType_string:
+            return (p_value->m_storage == e_ValueStorage_inline ? 0 : ARENASIZE(strlen(p_value->m_value.m_string) + 1));
+        case e_ATP_ValueType_dict:
+            return Value_measureDict(p_value->m_value.m_dict);
+        case e_ATP_ValueType_array:
+            return Value_measureArray(p_value->m_value.m_array);
+        default:
+            return 0;
+    }
+}
+
+void Value_freeze(Value *p_dest, const Value *p_source, ATP_Arena *p_arena)
+{
+    switch (p_source->m_type)
+    {
+        case e_ATP_ValueType_dict:
+            p_dest->m_type = e_ATP_ValueType_dict;
+            p_dest->m_value.m_dict = Value_freezeDict(p_source->m_value.m_dict, p_arena);
+            break;
+        case e_ATP_ValueType_array:
+            p_dest->m_type = e_ATP_ValueType_array;
+            p_dest->m_value.m_array = Value_freezeArray(p_source->m_value.m_array, p_arena);
+            break;
+        default:
+            Value_copy(p_dest, p_source, p_arena);
+            break;
+    }
+}
+
+void Value_imagePointer(ValueImage *p_image, void *p_field)
+{
+    char *l_target;
+
+    // the field may be of any pointer type, so it is only ever accessed as bytes
+    memcpy(&l_target, p_field, sizeof(char *));
+    if (l_target != NULL)
+    {
+        size_t l_offset = (size_t) (l_target - p_image->m_base);
+        memcpy(p_field, &l_offset, sizeof(size_t));
+        SETIMAGEBIT(p_image->m_pointers, (size_t) ((char *) p_field - p_image->m_base));
+    }
+}
+
+void Value_imageArena(ValueImage *p_image, ATP_Arena **p_field)
+{
+    // an offset of zero never points into the tree, which starts after the image header
+    *p_field = NULL;
+    SETIMAGEBIT(p_image->m_pointers, (size_t) ((char *) p_field - p_image->m_base));
+}
+
+void Value_image(ValueImage *p_image, Value *p_value)
+{
+    switch (p_value->m_type)
+    {
+        case e_ATP_ValueType_string:
+            if (p_value->m_storage == e_ValueStorage_arena)
+            {
+                Value_imagePointer(p_image, &p_value->m_value.m_string);
+            }
+            break;
+        case e_ATP_ValueType_dict:
+            Value_imageDict(p_image, p_value->m_value.m_dict);
+            Value_imagePointer(p_image, &p_value->m_value.m_dict);
+            break;
+        case e_ATP_ValueType_array:
+            Value_imageArray(p_image, p_value->m_value.m_array);
+            Value_imagePointer(p_image, &p_value->m_value.m_array);
+            break;
+        default:
+            break;
+    }
+}
+
+// the smallest page size of any platform, so that writing to every byte this far apart writes to every page
+#define c_imagePage         4096
+// dictionaries and arrays are checked recursively, so the nesting of an image is limited to keep the stack bounded
+#define c_imageMaxDepth     1024
+
+int Value_checkImageFail(void)
+{
+    ERR("The dictionary image is truncated or corrupt\n");
+    return 0;
+}
+
+static void touchImage(char *p_start, size_t p_size)
+{
+    volatile char *l_byte;
+    size_t i;
+
+    for (i = 0; i < p_size; i += c_imagePage)
+    {
+        l_byte = p_start + i;
+        *l_byte = *l_byte;
+    }
+    l_byte = p_start + p_size - 1;
+    *l_byte = *l_byte;
+}
+
+int Value_checkImageClaim(ValueImageCheck *p_check, size_t p_offset, size_t p_size, int p_read)
+{
+    size_t i;
+    size_t l_end;
+
+    if (p_size == 0 || p_offset % sizeof(char *) != 0 || p_size > p_check->m_size || p_offset > p_check->m_size - p_size)
+    {
+        return Value_checkImageFail();
+    }
+
+    l_end = p_offset + p_size;
+    for (i = p_offset; i < l_end; i += sizeof(char *))
+    {
+        if (IMAGEBIT(p_check->m_claimed, i))
+        {
+            return Value_checkImageFail();
+        }
+        SETIMAGEBIT(p_check->m_claimed, i);
+    }
+
+    // the bytes of long strings and packed arrays are never written to, so that they stay shared; their contents can do no
+    // harm, and the end of each string is checked again once its page has been copied
+    if (p_read)
+    {
+        touchImage(p_check->m_base + p_offset, p_size);
+    }
+    return 1;
+}
+
+int Value_checkImagePointer(ValueImageCheck *p_check, const void *p_field, size_t p_size, int p_optional, void *p_target)
+{
+    size_t l_offset;
+    char *l_target = NULL;
+
+    // the field may be of any pointer type, so it is only ever accessed as bytes
+    memcpy(&l_offset, p_field, sizeof(size_t));
+    if (l_offset != 0)
+    {
+        if (l_offset >= p_check->m_size)
+        {
+            return Value_checkImageFail();
+        }
+        else if (p_size > 0 && !Value_checkImageClaim(p_check, l_offset, p_size, 1))
+        {
+            return 0;
+        }
+        SETIMAGEBIT(p_check->m_pointers, (size_t) ((const char *) p_field - p_check->m_base));
+        l_target = p_check->m_base + l_offset;
+    }
+    else if (!p_optional)
+    {
+        return Value_checkImageFail();
+    }
+
+    memcpy(p_target, &l_target, sizeof(char *));
+    return 1;
+}
+
+int Value_checkImageArena(ValueImageCheck *p_check, ATP_Arena *const *p_field)
+{
+    size_t l_offset;
+
+    memcpy(&l_offset, p_field, sizeof(size_t));
+    if (l_offset != 0)
+    {
+        return Value_checkImageFail();
+    }
+    SETIMAGEBIT(p_check->m_pointers, (size_t) ((const char *) p_field - p_check->m_base));
+    return 1;
+}
+
+static int checkImageString(ValueImageCheck *p_check, const Value *p_value)
+{
+    size_t l_offset;
+    const char *l_end;
+
+    if (p_value->m_storage == e_ValueStorage_inline)
+    {
+        return (memchr(INLINE(p_value), '\0', c_Value_inlineSize) != NULL ? 1 : Value_checkImageFail());
+    }
+    else if (p_value->m_storage != e_ValueStorage_arena)
+    {
+        return Value_checkImageFail();
+    }
+
+    // the string is only as long as its first null character, which is looked for before the string is claimed
+    memcpy(&l_offset, &p_value->m_value.m_string, sizeof(size_t));
+    if (l_offset == 0 || l_offset >= p_check->m_size)
+    {
+        return Value_checkImageFail();
+    }
+    l_end = memchr(p_check->m_base + l_offset, '\0', p_check->m_size - l_offset);
+    if (l_end == NULL)
+    {
+        return Value_checkImageFail();
+    }
+    else if (!Value_checkImageClaim(p_check, l_offset, (size_t) (l_end - p_check->m_base) - l_offset + 1, 0))
+    {
+        return 0;
+    }
+    touchImage((char *) l_end, 1);
+    if (*l_end != '\0')
+    {
+        return Value_checkImageFail();
+    }
+
+    SETIMAGEBIT(p_check->m_pointers, (size_t) ((const char *) &p_value->m_value.m_string - p_check->m_base));
+    return 1;
+}
+
+int Value_checkImage(ValueImageCheck *p_check, const Value *p_value)
+{
+    char *l_target;
+    int l_result;
+
+    switch (p_value->m_type)
+    {
+        case e_ATP_ValueType_none:
+        case e_ATP_ValueType_uint:
+        case e_ATP_ValueType_int:
+        case e_ATP_ValueType_double:
+        case e_ATP_ValueType_bool:
+            return 1;
+        case e_ATP_ValueType_string:
+            return checkImageString(p_check, p_value);
+        case e_ATP_ValueType_dict:
+        case e_ATP_ValueType_array:
+            if (p_check->m_depth >= c_imageMaxDepth)
+            {
+                ERR("The dictionary image is nested more than %u deep\n", c_imageMaxDepth);
+                return 0;
+            }
+            else if (!Value_checkImagePointer(p_check, &p_value->m_value, 0, 0, &l_target))
+            {
+                return 0;
+            }
+
+            ++p_check->m_depth;
+            l_result = (p_value->m_type == e_ATP_ValueType_dict
+                        ? Value_checkImageDict(p_check, (size_t) (l_target - p_check->m_base))
+                        : Value_checkImageArray(p_check, (size_t) (l_target - p_check->m_base)));
+            --p_check->m_depth;
+            return l_result;
+        default:
+            return Value_checkImageFail();
+    }
+}
+
+void ATP_valueInit(ATP_Value *p_value)
+{
+    VALUE(p_value)->m_type = e_ATP_ValueType_none;
+    p_value->m_arena = NULL;
+}
+
+void ATP_valueDestroy(ATP_Value *p_value)
+{
+    Value_changeType(VALUE(p_value), e_ATP_ValueType_none, p_value->m_arena);
+    ATP_arenaRelease(p_value->m_arena);
+    p_value->m_arena = NULL;
+}
+
+ATP_ValueType ATP_valueGetType(const ATP_Value *p_value)
+{
+    return VALUE(p_value)->m_type;
+}
+
+int ATP_valueGetString(const ATP_Value *p_value, const char **p_string)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_string)
+    {
+        *p_string = Value_getString(VALUE(p_value));
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetUint(const ATP_Value *p_value, unsigned long long *p_uint)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_uint)
+    {
+        *p_uint = VALUE(p_value)->m_value.m_uint;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetInt(const ATP_Value *p_value, signed long long *p_int)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_int)
+    {
+        *p_int = VALUE(p_value)->m_value.m_int;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetDouble(const ATP_Value *p_value, double *p_double)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_double)
+    {
+        *p_double = VALUE(p_value)->m_value.m_double;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetBool(const ATP_Value *p_value, int *p_bool)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_bool)
+    {
+        *p_bool = VALUE(p_value)->m_value.m_bool;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueTakeDict(ATP_Value *p_value, ATP_Dictionary *p_dict)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_dict)
+    {
+        // the value's reference on the arena (if any) is handed over along with the dictionary
+        *p_dict = VALUE(p_value)->m_value.m_dict;
+        VALUE(p_value)->m_type = e_ATP_ValueType_none;
+        p_value->m_arena = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueTakeArray(ATP_Value *p_value, ATP_Array *p_array)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_array)
+    {
+        // the value's reference on the arena (if any) is handed over along with the array
+        *p_array = VALUE(p_value)->m_value.m_array;
+        VALUE(p_value)->m_type = e_ATP_ValueType_none;
+        p_value->m_arena = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetDictConst(const ATP_Value *p_value, const ATP_Dictionary **p_dict)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_dict)
+    {
+        *p_dict = &VALUE(p_value)->m_value.m_dict;
+        return 1;
+    }
+
+    return 0;
+}
+
+int ATP_valueGetArrayConst(const ATP_Value *p_value, const ATP_Array **p_array)
+{
+    if (VALUE(p_value)->m_type == e_ATP_ValueType_array)
+    {
+        *p_array = &VALUE(p_value)->m_value.m_array;
+        return 1;
+    }
+
+    return 0;
+}
+
 const char *ATP_valueTypeToString(ATP_ValueType p_type)
 {
     switch (p_type)
@@ -6,6 +6,9 @@ External interface to the internal value type used by the dictionary and array i
 
 #include "Export.h"
 
+// forward declaration
+struct ATP_Arena;
+
 /* Enumeration: ATP_ValueType
 The data types that a dictionary or array entry may hold.
 
@@ -31,6 +34,27 @@ typedef enum ATP_ValueType
     e_ATP_ValueType_array
 } ATP_ValueType;
 
+/* Structure: ATP_Value
+A value that has been moved out of a dictionary or array, see <ATP_dictionaryTake> and <ATP_arrayPopBack>.  An instance must
+be initialized with <ATP_valueInit> before it is first used, and its members must not be accessed directly.
+*/
+typedef struct ATP_Value
+{
+    /* Variable: m_data
+    Storage for the internal representation of the value.
+    */
+    union
+    {
+        unsigned char m_bytes[16];
+        unsigned long long m_align;
+        void *m_pointer;
+    } m_data;
+    /* Variable: m_arena
+    The arena that the value was taken from, which a reference is held to while the value refers to memory in it.
+    */
+    struct ATP_Arena *m_arena;
+} ATP_Value;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -47,6 +71,87 @@ Returns:
 */
 EXPORT const char *ATP_valueTypeToString(ATP_ValueType p_type);
 
+/* Function: ATP_valueInit
+Initialize a value instance, which starts out with no type.
+
+Parameters:
+    p_value - The value instance.
+*/
+EXPORT void ATP_valueInit(ATP_Value *p_value);
+/* Function: ATP_valueDestroy
+Destroy a value instance, releasing anything it holds.  The value is left initialized with no type.
+
+Parameters:
+    p_value - The value instance.
+*/
+EXPORT void ATP_valueDestroy(ATP_Value *p_value);
+/* Function: ATP_valueGetType
+Get the type of a value.
+
+Parameters:
+    p_value - The value instance.
+
+Returns:
+    The type of the value.
+*/
+EXPORT ATP_ValueType ATP_valueGetType(const ATP_Value *p_value);
+
+/* Function: ATP_valueGetString
+Get the contents of a string value.
+
+Parameters:
+    p_value  - The value instance.
+    p_string - The location to store the string in.  The string is only valid while the value remains unchanged.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetString(const ATP_Value *p_value, const char **p_string);
+/* Function: ATP_valueGetUint
+Get the contents of an unsigned integer value.
+
+Parameters:
+    p_value - The value instance.
+    p_uint  - The location to store the integer in.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetUint(const ATP_Value *p_value, unsigned long long *p_uint);
+/* Function: ATP_valueGetInt
+Get the contents of a signed integer value.
+
+Parameters:
+    p_value - The value instance.
+    p_int   - The location to store the integer in.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetInt(const ATP_Value *p_value, signed long long *p_int);
+/* Function: ATP_valueGetDouble
+Get the contents of a floating point value.
+
+Parameters:
+    p_value  - The value instance.
+    p_double - The location to store the number in.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetDouble(const ATP_Value *p_value, double *p_double);
+/* Function: ATP_valueGetBool
+Get the contents of a boolean value.
+
+Parameters:
+    p_value - The value instance.
+    p_bool  - The location to store the boolean in.
+
+Returns:
+    1 on success, 0 if the value is of the wrong type.
+*/
+EXPORT int ATP_valueGetBool(const ATP_Value *p_value, int *p_bool);
+
 #ifdef __cplusplus
 }   /* extern "C" */
 #endif
@@ -0,0 +1,434 @@
+#include "Watch.h"
+#include "Exit.h"
+#include "Log.h"
+
+#include "ATP/ThirdParty/UT/utlist.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #undef WIN32_LEAN_AND_MEAN
+#else // NOTE: assume POSIX for now
+    #include <errno.h>
+    #include <unistd.h>
+    #if defined(__linux__)
+        #include <poll.h>
+        #include <sys/inotify.h>
+    #endif
+#endif
+
+// how often files are checked for changes where inotify is not available, in milliseconds
+#define c_pollInterval  250
+#define c_noChange      UINT_MAX
+
+// a whole dictionary processor wrapped to remember its last output
+typedef struct WatchStage
+{
+    ATP_Processor *m_proc;
+    unsigned int m_index;
+    int m_replay;
+    int m_hasOutput;
+    ATP_Dictionary m_output;
+} WatchStage;
+
+typedef struct WatchFile
+{
+    char m_path[1024];
+    // changes are reported for the entries of a directory, so the file is followed as a name in its directory
+    char m_dir[1024];
+    const char *m_name;
+    // the index of the first processor reading the file
+    unsigned int m_first;
+    int m_watch;
+    time_t m_modified;
+    long long m_size;
+    struct WatchFile *next;
+} WatchFile;
+
+struct ATP_WatchImpl
+{
+    // the wrapped processors, which belong to the pipeline and free their own state when unloaded
+    WatchStage **m_stages;
+    unsigned int m_stageCount;
+    unsigned int m_processorCount;
+    WatchFile *m_files;
+    // the index of the first processor reading a file that changed since the last wait
+    unsigned int m_changed;
+    int m_fd;
+};
+
+static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    WatchStage *l_stage = p_token;
+    int l_result;
+
+    if (l_stage->m_replay && l_stage->m_hasOutput)
+    {
+        DBG("replaying the output of %s\n", l_stage->m_proc->m_interface.m_name);
+        *p_output = ATP_dictionaryDuplicate(&l_stage->m_output);
+        return 1;
+    }
+
+    // the output is shared with the processors after this one until either side modifies it
+    l_result = ATP_processorRun(l_stage->m_proc, p_count, p_input, p_output);
+    ATP_dictionaryDestroy(&l_stage->m_output);
+    l_stage->m_hasOutput = l_result;
+    if (l_result)
+    {
+        l_stage->m_output = ATP_dictionaryDuplicate(p_output);
+    }
+    return l_result;
+}
+
+static void files(ATP_Array *p_files, void *p_token)
+{
+    WatchStage *l_stage = p_token;
+    ATP_processorFiles(l_stage->m_proc, p_files);
+}
+
+static void unload(void *p_token)
+{
+    WatchStage *l_stage = p_token;
+
+    ATP_dictionaryDestroy(&l_stage->m_output);
+    ATP_processorUnload(l_stage->m_proc);
+    free(l_stage);
+}
+
+static void addFile(struct ATP_WatchImpl *p_watch, const char *p_path, unsigned int p_index)
+{
+    WatchFile *it;
+    char *l_slash;
+
+    LL_FOREACH(p_watch->m_files, it)
+    {
+        if (strcmp(it->m_path, p_path) == 0)
+        {
+            // processors are added in order, so the first one reading the file is already known
+            return;
+        }
+    }
+
+    it = calloc(1, sizeof(WatchFile));
+    if (it == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    strncpy(it->m_path, p_path, sizeof(it->m_path) - 1);
+    l_slash = strrchr(it->m_path, '/');
+    if (l_slash == NULL)
+    {
+        strcpy(it->m_dir, ".");
+        it->m_name = it->m_path;
+    }
+    else
+    {
+        size_t l_length = (l_slash > it->m_path ? (size_t) (l_slash - it->m_path) : 1);
+        memcpy(it->m_dir, it->m_path, l_length);
+        it->m_name = l_slash + 1;
+    }
+    it->m_first = p_index;
+    it->m_watch = -1;
+    LL_APPEND(p_watch->m_files, it);
+}
+
+static void noteChange(struct ATP_WatchImpl *p_watch, const WatchFile *p_file)
+{
+    DBG("%s changed\n", p_file->m_path);
+    if (p_file->m_first < p_watch->m_changed)
+    {
+        p_watch->m_changed = p_file->m_first;
+    }
+}
+
+void ATP_watchInit(ATP_Watch *p_watch)
+{
+    *p_watch = calloc(1, sizeof(struct ATP_WatchImpl));
+    if (*p_watch == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    (*p_watch)->m_changed = c_noChange;
+    (*p_watch)->m_fd = -1;
+}
+
+ATP_Processor *ATP_watchAdd(ATP_Watch *p_watch, ATP_Processor *p_proc)
+{
+    unsigned int i;
+    ATP_Array l_files;
+    ATP_Processor *l_wrapper;
+    WatchStage *l_stage;
+    struct ATP_WatchImpl *l_watch = *p_watch;
+    unsigned int l_index = l_watch->m_processorCount++;
+
+    ATP_arrayInit(&l_files);
+    ATP_processorFiles(p_proc, &l_files);
+    for (i = 0; i < ATP_arrayLength(&l_files); ++i)
+    {
+        const char *l_path = NULL;
+        if (ATP_arrayGetString(&l_files, i, &l_path))
+        {
+            addFile(l_watch, l_path, l_index);
+        }
+    }
+    ATP_arrayDestroy(&l_files);
+
+    if (ATP_processorIsStreaming(p_proc))
+    {
+        return p_proc;
+    }
+
+    l_stage = calloc(1, sizeof(WatchStage));
+    l_wrapper = calloc(1, sizeof(ATP_Processor));
+    l_watch->m_stages = realloc(l_watch->m_stages, (l_watch->m_stageCount + 1) * sizeof(WatchStage *));
+    if (l_stage == NULL || l_wrapper == NULL || l_watch->m_stages == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    l_stage->m_proc = p_proc;
+    l_stage->m_index = l_index;
+    ATP_dictionaryInit(&l_stage->m_output);
+    l_watch->m_stages[l_watch->m_stageCount++] = l_stage;
+
+    // the wrapper describes itself as the processor does, except that the processor does its own caching
+    strcpy(l_wrapper->m_interface.m_name, p_proc->m_interface.m_name);
+    l_wrapper->m_interface.m_version = c_ATP_ProcessorInterface_version;
+    l_wrapper->m_interface.m_token = l_stage;
+    l_wrapper->m_interface.run = &run;
+    l_wrapper->m_interface.unload = &unload;
+    l_wrapper->m_interface.files = &files;
+    l_wrapper->m_interface.m_flags = ATP_processorFlags(p_proc) & ~(c_ATP_ProcessorFlag_cacheable | c_ATP_ProcessorFlag_pure);
+    l_wrapper->m_interface.m_reads = ATP_processorReads(p_proc);
+    l_wrapper->m_interface.m_writes = ATP_processorWrites(p_proc);
+    l_wrapper->m_parameters = ATP_arrayDuplicate(&p_proc->m_parameters);
+    l_wrapper->m_context = p_proc->m_context;
+    return l_wrapper;
+}
+
+unsigned int ATP_watchFileCount(const ATP_Watch *p_watch)
+{
+    unsigned int l_count = 0;
+    WatchFile *it;
+
+    LL_FOREACH((*p_watch)->m_files, it)
+    {
+        ++l_count;
+    }
+    return l_count;
+}
+
+// set up the processors to replay their outputs up to the first one reading a changed file
+static void prepareRun(struct ATP_WatchImpl *p_watch)
+{
+    unsigned int i;
+
+    for (i = 0; i < p_watch->m_stageCount; ++i)
+    {
+        p_watch->m_stages[i]->m_replay = (p_watch->m_stages[i]->m_index < p_watch->m_changed);
+    }
+    p_watch->m_changed = c_noChange;
+}
+
+#if defined(__linux__)
+int ATP_watchStart(ATP_Watch *p_watch)
+{
+    WatchFile *it;
+    struct ATP_WatchImpl *l_watch = *p_watch;
+
+    l_watch->m_fd = inotify_init();
+    if (l_watch->m_fd < 0)
+    {
+        PERR();
+        return 0;
+    }
+
+    // watching a directory again gives the same watch descriptor
+    LL_FOREACH(l_watch->m_files, it)
+    {
+        it->m_watch = inotify_add_watch(l_watch->m_fd, it->m_dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+        if (it->m_watch < 0)
+        {
+            ERR("Unable to watch '%s' for changes to '%s'\n", it->m_dir, it->m_name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// read the events waiting, or wait for some if there are none
+static int readEvents(struct ATP_WatchImpl *p_watch)
+{
+    // the buffer is aligned for the events read into it
+    unsigned long long l_buffer[512];
+    const char *l_bytes = (const char *) l_buffer;
+    ssize_t l_length = read(p_watch->m_fd, l_buffer, sizeof(l_buffer));
+    ssize_t l_offset = 0;
+
+    if (l_length < 0)
+    {
+        return (errno == EINTR);
+    }
+
+    while (l_offset < l_length)
+    {
+        const struct inotify_event *l_event = (const struct inotify_event *) &l_bytes[l_offset];
+        WatchFile *it;
+
+        if (l_event->len > 0)
+        {
+            LL_FOREACH(p_watch->m_files, it)
+            {
+                if (it->m_watch == l_event->wd && strcmp(it->m_name, l_event->name) == 0)
+                {
+                    noteChange(p_watch, it);
+                }
+            }
+        }
+        l_offset += sizeof(struct inotify_event) + l_event->len;
+    }
+    return 1;
+}
+
+int ATP_watchWait(ATP_Watch *p_watch, unsigned int p_delay)
+{
+    struct ATP_WatchImpl *l_watch = *p_watch;
+
+    // other files in the same directories are ignored
+    while (l_watch->m_changed == c_noChange)
+    {
+        if (!readEvents(l_watch))
+        {
+            PERR();
+            return 0;
+        }
+    }
+
+    // then wait for the changes to settle, as a file is often written several times in quick succession
+    for (;;)
+    {
+        struct pollfd l_poll;
+        int l_ready;
+
+        l_poll.fd = l_watch->m_fd;
+        l_poll.events = POLLIN;
+        l_ready = poll(&l_poll, 1, (int) p_delay);
+        if (l_ready == 0)
+        {
+            break;
+        }
+        else if ((l_ready < 0 && errno != EINTR) || (l_ready > 0 && !readEvents(l_watch)))
+        {
+            PERR();
+            return 0;
+        }
+    }
+
+    prepareRun(l_watch);
+    return 1;
+}
+
+static void stopWatching(struct ATP_WatchImpl *p_watch)
+{
+    if (p_watch->m_fd >= 0)
+    {
+        close(p_watch->m_fd);
+    }
+}
+#else
+static void sleepFor(unsigned int p_milliseconds)
+{
+#if _WIN32
+    Sleep(p_milliseconds);
+#else // NOTE: assume POSIX for now
+    usleep(p_milliseconds * 1000);
+#endif
+}
+
+// check every file, noting those that changed since they were last checked, and returning whether any did
+static int checkFiles(struct ATP_WatchImpl *p_watch, int p_note)
+{
+    WatchFile *it;
+    int l_changed = 0;
+
+    LL_FOREACH(p_watch->m_files, it)
+    {
+        struct stat l_stat;
+        time_t l_modified = 0;
+        long long l_size = -1;
+
+        if (stat(it->m_path, &l_stat) == 0)
+        {
+            l_modified = l_stat.st_mtime;
+            l_size = (long long) l_stat.st_size;
+        }
+        if (l_modified != it->m_modified || l_size != it->m_size)
+        {
+            it->m_modified = l_modified;
+            it->m_size = l_size;
+            if (p_note)
+            {
+                noteChange(p_watch, it);
+                l_changed = 1;
+            }
+        }
+    }
+    return l_changed;
+}
+
+int ATP_watchStart(ATP_Watch *p_watch)
+{
+    checkFiles(*p_watch, 0);
+    return 1;
+}
+
+int ATP_watchWait(ATP_Watch *p_watch, unsigned int p_delay)
+{
+    struct ATP_WatchImpl *l_watch = *p_watch;
+
+    while (!checkFiles(l_watch, 1))
+    {
+        sleepFor(c_pollInterval);
+    }
+    do
+    {
+        sleepFor(p_delay);
+    } while (checkFiles(l_watch, 1));
+
+    prepareRun(l_watch);
+    return 1;
+}
+
+static void stopWatching(struct ATP_WatchImpl *p_watch)
+{
+    // nothing to release
+}
+#endif
+
+void ATP_watchDestroy(ATP_Watch *p_watch)
+{
+    WatchFile *it;
+    WatchFile *l_temp;
+
+    if (*p_watch == NULL)
+    {
+        return;
+    }
+
+    stopWatching(*p_watch);
+    LL_FOREACH_SAFE((*p_watch)->m_files, it, l_temp)
+    {
+        LL_DELETE((*p_watch)->m_files, it);
+        free(it);
+    }
+    free((*p_watch)->m_stages);
+    free(*p_watch);
+    *p_watch = NULL;
+}
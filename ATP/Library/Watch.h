@@ -0,0 +1,100 @@
+/* File: Watch.h
+Running a pipeline again whenever a file that its processors read changes.
+
+Each processor is added to a watch as it is loaded, and the watch follows the files it lists through
+<ATP_ProcessorInterface.files>.  Whole dictionary processors are wrapped so that they remember the output of their last
+successful run.  Once a file changes, every processor loaded before the first one reading that file replays its remembered
+output instead of running, so executing the pipeline again only runs the processors from that one on.  Streaming processors
+cannot be replayed, and run again every time.
+
+Changes are noticed through inotify on Linux, watching the directory of each file so that files replaced by renaming another
+over them are followed, and by checking the modification time and size of each file a few times a second elsewhere.
+*/
+#ifndef _ATP_LIBRARY_WATCH_H_
+#define _ATP_LIBRARY_WATCH_H_
+
+#include "Export.h"
+#include "Processor.h"
+
+/* Constant: c_ATP_Watch_defaultDelay
+The number of milliseconds without further changes to wait for after a change before running again, when none is given.
+*/
+#define c_ATP_Watch_defaultDelay    100
+
+// forward declaration
+struct ATP_WatchImpl;
+
+/* Type: ATP_Watch
+Reference to a watch.
+*/
+typedef struct ATP_WatchImpl *ATP_Watch;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Function: ATP_watchInit
+Initialize a watch without any processors.
+
+Parameters:
+    p_watch - The watch handle to initialize.
+*/
+EXPORT void ATP_watchInit(ATP_Watch *p_watch);
+/* Function: ATP_watchDestroy
+Stop watching and destroy a watch.  The processors added to it are left to whatever they were added to.
+
+Parameters:
+    p_watch - The watch handle.
+*/
+EXPORT void ATP_watchDestroy(ATP_Watch *p_watch);
+/* Function: ATP_watchAdd
+Add the next processor of a pipeline to a watch.  Processors must be added in the order they were loaded in.
+
+Parameters:
+    p_watch - The watch handle.
+    p_proc  - The processor instance.
+
+Returns:
+    The processor to put in the pipeline in its place, which wraps it if it runs on whole dictionaries, and unloads it when
+    unloaded itself.
+*/
+EXPORT ATP_Processor *ATP_watchAdd(ATP_Watch *p_watch, ATP_Processor *p_proc);
+/* Function: ATP_watchFileCount
+Get the number of files followed by a watch.
+
+Parameters:
+    p_watch - The watch handle.
+
+Returns:
+    The number of distinct files read by the processors added so far.
+*/
+EXPORT unsigned int ATP_watchFileCount(const ATP_Watch *p_watch);
+/* Function: ATP_watchStart
+Start following the files of the processors added to a watch.  Changes made from then on are reported by <ATP_watchWait>.
+
+Parameters:
+    p_watch - The watch handle.
+
+Returns:
+    1 on success, 0 (after printing an error) if the files cannot be followed.
+*/
+EXPORT int ATP_watchStart(ATP_Watch *p_watch);
+/* Function: ATP_watchWait
+Wait for any of the files followed by a watch to change, then for the given delay to pass without further changes, and set up
+the processors to replay or run as described above.
+
+Parameters:
+    p_watch - The watch handle.
+    p_delay - The delay in milliseconds.
+
+Returns:
+    1 once files have changed, 0 (after printing an error) if waiting failed.
+*/
+EXPORT int ATP_watchWait(ATP_Watch *p_watch, unsigned int p_delay);
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif
+
+#endif /* _ATP_LIBRARY_WATCH_H_ */
@@ -18,7 +18,28 @@ static void usage(void)
     LOG(
 "atp v" VERSION " (" REVISION ") " __DATE__ "\n\n");
     LOG(
-"Usage: atp @<processor> [processor args] [@<processor> [processor args] ...]\n\n");
+"Usage: atp [options] @<processor> [processor args] [@<processor> [processor args] ...]\n\n");
+    LOG(
+"Options:\n"
+"    --threads <N>        Divide the processors between N threads, or one per core if N is 0 (default 1)\n"
+"    --script <file>      Run every pipeline listed in a file, one per line, on --threads threads (default one per core)\n"
+"    --watch[=ms]         Run the pipeline again from the first processor reading a file whenever that file changes\n"
+"    --serve <socket>     Keep the processors loaded and run the pipelines requested on a Unix domain socket\n"
+"    --client <socket>    Have the server listening on a socket run the pipeline, using this process's files\n"
+"    --index <file>       Write the processors found on the search path to a manifest for ATP_PROCESSOR_MANIFEST\n"
+"    --profile[=file]     Print the time and memory used by each processor, and also write them to a JSON file if given\n"
+"    --trace <file>       Write a timeline of the run to a file, to open in Perfetto or chrome://tracing\n"
+"    --cache-dir <dir>    Reuse the outputs of processors such as @json read from earlier runs with the same inputs\n"
+"    --cache-size <MB>    Remove the least recently used outputs once the cache grows beyond this size (default 256)\n\n");
+    LOG(
+"Branching:\n"
+"    @tee <name>              Keep a copy of the data passing this point under a name\n"
+"    @from [name]             Start a new branch from the data kept by a tee, or from nothing\n"
+"    @join <name> [name ...]  Start a new branch from a dictionary holding the data kept by each tee under its name\n\n");
+    LOG(
+"Parallel:\n"
+"    @parallel <key> <N> @<processor> [processor args]\n"
+"                             Run the processor on each dictionary in the array under a key, on up to N threads\n\n");
 
     ATP_processorsList();
 }
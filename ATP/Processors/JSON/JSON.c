@@ -1,4 +1,5 @@
 #include "ATP/Library/Processor.h"
+#include "ATP/Library/Trace.h"
 #include "ATP/Library/Log.h"
 #include "ATP/Library/Exit.h"
 #include "ATP/Library/Export.h"
@@ -10,15 +11,19 @@
 
 #define PROCNAME "json"
 
+// an empty list of keys, for what the processor reads when reading a file and sets when writing one
+static const char *const c_noKeys[] = { NULL };
+
 typedef struct Settings
 {
     int m_fileIsOutput;
+    int m_freeze;
     char *m_filePath;
 } Settings;
 
 // forward references
-static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node);
-static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node);
+static int writeJsonArray(const ATP_Array *p_source, JSONNODE *p_node);
+static int writeJsonDictionary(const ATP_Dictionary *p_source, JSONNODE *p_node);
 static int readJsonArray(JSONNODE *p_node, ATP_Array *p_dest);
 static int readJsonDictionary(JSONNODE *p_node, ATP_Dictionary *p_dest);
 
@@ -30,7 +35,7 @@ static void usage(void)
 "    Reads or writes the working dictionary in JSON format.  When writing to a\n"
 "    file, the dictionary is also passed on to the next pipeline stage, if any.\n\n");
     LOG(
-"    Usage: @" PROCNAME " read stdin|<filename>\n"
+"    Usage: @" PROCNAME " read stdin|<filename> [frozen]\n"
 "           @" PROCNAME " write stdout|<filename>\n\n");
     LOG(
 "             stdin Indicates that the JSON source should be read from stdin\n"
@@ -40,10 +45,13 @@ static void usage(void)
 "                   rather than a file\n");
     LOG(
 "        <filename> The name of a file to read the working dictionary from or\n"
-"                   write it to\n\n");
+"                   write it to\n");
+    LOG(
+"            frozen Indicates that the dictionary that is read should be\n"
+"                   frozen, for pipelines that only read from it\n\n");
 }
 
-static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
+static int writeJsonArray(const ATP_Array *p_source, JSONNODE *p_node)
 {
     unsigned int i;
     DBG("array %p has %u entries\n", *p_source, ATP_arrayLength(p_source));
@@ -91,7 +99,7 @@ static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
                 break;
             case e_ATP_ValueType_dict:
                 {
-                    ATP_Dictionary *l_value = NULL;
+                    const ATP_Dictionary *l_value = NULL;
                     l_child = json_new(JSON_NODE);
                     if (l_child == NULL)
                     {
@@ -99,7 +107,7 @@ static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
                         exit(EX_SOFTWARE);
                     }
 
-                    ATP_arrayGetDict(p_source, i, &l_value);
+                    ATP_arrayGetDictConst(p_source, i, &l_value);
                     if (!writeJsonDictionary(l_value, l_child))
                     {
                         json_free(l_child);
@@ -110,7 +118,7 @@ static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
                 break;
             case e_ATP_ValueType_array:
                 {
-                    ATP_Array *l_value = NULL;
+                    const ATP_Array *l_value = NULL;
                     l_child = json_new(JSON_ARRAY);
                     if (l_child == NULL)
                     {
@@ -118,7 +126,7 @@ static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
                         exit(EX_SOFTWARE);
                     }
 
-                    ATP_arrayGetArray(p_source, i, &l_value);
+                    ATP_arrayGetArrayConst(p_source, i, &l_value);
                     if (!writeJsonArray(l_value, l_child))
                     {
                         json_free(l_child);
@@ -140,11 +148,11 @@ static int writeJsonArray(ATP_Array *p_source, JSONNODE *p_node)
     return 1;
 }
 
-static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node)
+static int writeJsonDictionary(const ATP_Dictionary *p_source, JSONNODE *p_node)
 {
     ATP_DictionaryIterator it;
     DBG("dictionary %p has %u entries\n", *p_source, ATP_dictionaryCount(p_source));
-    for (it = ATP_dictionaryBegin(p_source); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
+    for (it = ATP_dictionaryBeginConst(p_source); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
     {
         JSONNODE *l_child = NULL;
         const char *l_key = ATP_dictionaryGetKey(it);
@@ -189,7 +197,7 @@ static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node)
                 break;
             case e_ATP_ValueType_dict:
                 {
-                    ATP_Dictionary *l_value = NULL;
+                    const ATP_Dictionary *l_value = NULL;
                     l_child = json_new(JSON_NODE);
                     if (l_child == NULL)
                     {
@@ -197,7 +205,7 @@ static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node)
                         exit(EX_SOFTWARE);
                     }
 
-                    ATP_dictionaryItGetDict(it, &l_value);
+                    ATP_dictionaryItGetDictConst(it, &l_value);
                     if (!writeJsonDictionary(l_value, l_child))
                     {
                         json_free(l_child);
@@ -210,7 +218,7 @@ static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node)
                 break;
             case e_ATP_ValueType_array:
                 {
-                    ATP_Array *l_value = NULL;
+                    const ATP_Array *l_value = NULL;
                     l_child = json_new(JSON_ARRAY);
                     if (l_child == NULL)
                     {
@@ -218,7 +226,7 @@ static int writeJsonDictionary(ATP_Dictionary *p_source, JSONNODE *p_node)
                         exit(EX_SOFTWARE);
                     }
 
-                    ATP_dictionaryItGetArray(it, &l_value);
+                    ATP_dictionaryItGetArrayConst(it, &l_value);
                     if (!writeJsonArray(l_value, l_child))
                     {
                         json_free(l_child);
@@ -246,6 +254,7 @@ static int writeJson(ATP_Dictionary *p_source, const char *p_filename)
 {
     FILE *l_file = NULL;
     JSONNODE *l_node = NULL;
+    int l_converted;
 
     if (strcmp("stdout", p_filename) == 0)
     {
@@ -273,10 +282,16 @@ static int writeJson(ATP_Dictionary *p_source, const char *p_filename)
     }
 
     // convert the dictionary to a json structure
-    if (writeJsonDictionary(p_source, l_node))
+    ATP_traceBegin("json convert", NULL);
+    l_converted = writeJsonDictionary(p_source, l_node);
+    ATP_traceEnd();
+    if (l_converted)
     {
         // write out the json string
-        json_char *l_json = json_write_formatted(l_node);
+        json_char *l_json;
+        ATP_traceBegin("json serialize", NULL);
+        l_json = json_write_formatted(l_node);
+        ATP_traceEnd();
         if (l_json == NULL)
         {
             ERR(PROCNAME ": could not format JSON\n");
@@ -309,17 +324,97 @@ static int writeJson(ATP_Dictionary *p_source, const char *p_filename)
     }
 }
 
+static ATP_ValueType packedArrayType(JSONNODE *p_node)
+{
+    JSONNODE_ITERATOR it;
+    ATP_ValueType l_type = e_ATP_ValueType_none;
+
+    for (it = json_begin(p_node); it != json_end(p_node); ++it)
+    {
+        ATP_ValueType l_entryType;
+        if (json_type(*it) == JSON_NUMBER)
+        {
+            double l_integer = 0.0;
+            l_entryType = (modf(json_as_float(*it), &l_integer) == 0.0f ? e_ATP_ValueType_int : e_ATP_ValueType_double);
+        }
+        else if (json_type(*it) == JSON_BOOL)
+        {
+            l_entryType = e_ATP_ValueType_bool;
+        }
+        else
+        {
+            return e_ATP_ValueType_none;
+        }
+
+        // a mix of integers and fractions is left unpacked, so that each entry keeps the type it would have on its own
+        if (l_type != e_ATP_ValueType_none && l_type != l_entryType)
+        {
+            return e_ATP_ValueType_none;
+        }
+        l_type = l_entryType;
+    }
+
+    return l_type;
+}
+
+static void readJsonPackedArray(JSONNODE *p_node, ATP_Array *p_dest, ATP_ValueType p_type)
+{
+    JSONNODE_ITERATOR it;
+    unsigned int i = 0;
+    unsigned int l_length;
+    signed long long *l_ints = NULL;
+    double *l_doubles = NULL;
+    unsigned char *l_bools = NULL;
+
+    // the entries are written straight into the packed storage, which is allocated just once
+    ATP_arrayPack(p_dest, p_type);
+    ATP_arrayResize(p_dest, json_size(p_node));
+    // only the span matching the packed type is filled in
+    ATP_arrayGetIntSpan(p_dest, &l_ints, &l_length);
+    ATP_arrayGetDoubleSpan(p_dest, &l_doubles, &l_length);
+    ATP_arrayGetBoolSpan(p_dest, &l_bools, &l_length);
+
+    for (it = json_begin(p_node); it != json_end(p_node); ++it)
+    {
+        switch (p_type)
+        {
+            case e_ATP_ValueType_int:
+                l_ints[i] = (signed long long) json_as_float(*it);
+                break;
+            case e_ATP_ValueType_double:
+                l_doubles[i] = json_as_float(*it);
+                break;
+            case e_ATP_ValueType_bool:
+                l_bools[i] = (json_as_bool(*it) != 0);
+                break;
+            default:
+                break;
+        }
+
+        ++i;
+    }
+}
+
 static int readJsonArray(JSONNODE *p_node, ATP_Array *p_dest)
 {
     JSONNODE_ITERATOR it;
     unsigned int i = 0;
 
+    // arrays of plain numbers or booleans are stored packed
+    ATP_ValueType l_packed = packedArrayType(p_node);
+    if (l_packed != e_ATP_ValueType_none)
+    {
+        readJsonPackedArray(p_node, p_dest, l_packed);
+        return 1;
+    }
+
+    ATP_arrayReserve(p_dest, json_size(p_node));
     for (it = json_begin(p_node); it != json_end(p_node); ++it)
     {
         if (json_type(*it) == JSON_NODE)
         {
             ATP_Dictionary l_subDict;
-            ATP_dictionaryInit(&l_subDict);
+            ATP_dictionaryInitInArena(&l_subDict, ATP_arrayGetArena(p_dest));
             if (!readJsonDictionary(*it, &l_subDict))
             {
                 ATP_dictionaryDestroy(&l_subDict);
@@ -334,7 +429,7 @@ static int readJsonArray(JSONNODE *p_node, ATP_Array *p_dest)
         else if (json_type(*it) == JSON_ARRAY)
         {
             ATP_Array l_subArray;
-            ATP_arrayInit(&l_subArray);
+            ATP_arrayInitInArena(&l_subArray, ATP_arrayGetArena(p_dest));
             if (!readJsonArray(*it, &l_subArray))
             {
                 ATP_arrayDestroy(&l_subArray);
@@ -350,7 +445,7 @@ static int readJsonArray(JSONNODE *p_node, ATP_Array *p_dest)
         {
             double l_number = json_as_float(*it);
             double l_integer = 0.0;
-            // if the number is integral, create the dictionary entry as an integer, otherwise create it as a double
+            // if the number is integral, create the array entry as an integer, otherwise create it as a double
             if (modf(l_number, &l_integer) == 0.0f)
             {
                 if (!ATP_arraySetInt(p_dest, i, (signed long long) l_integer))
@@ -400,7 +495,7 @@ static int readJsonDictionary(JSONNODE *p_node, ATP_Dictionary *p_dest)
         if (json_type(*it) == JSON_NODE)
         {
             ATP_Dictionary l_subDict;
-            ATP_dictionaryInit(&l_subDict);
+            ATP_dictionaryInitInArena(&l_subDict, ATP_dictionaryGetArena(p_dest));
             if (!readJsonDictionary(*it, &l_subDict))
             {
                 ATP_dictionaryDestroy(&l_subDict);
@@ -417,7 +512,7 @@ static int readJsonDictionary(JSONNODE *p_node, ATP_Dictionary *p_dest)
         else if (json_type(*it) == JSON_ARRAY)
         {
             ATP_Array l_array;
-            ATP_arrayInit(&l_array);
+            ATP_arrayInitInArena(&l_array, ATP_dictionaryGetArena(p_dest));
             if (!readJsonArray(*it, &l_array))
             {
                 ATP_arrayDestroy(&l_array);
@@ -524,7 +619,9 @@ static int readJson(const char *p_filename, ATP_Dictionary *p_dest)
     DBG("raw JSON: %s\n", l_json);
 
     // parse the json
+    ATP_traceBegin("json parse", NULL);
     l_node = json_parse(l_json);
+    ATP_traceEnd();
     if (json_type(l_node) != JSON_NODE)
     {
         ERR(PROCNAME ": Invalid JSON file: %s (type %d is not JSON_NODE)\n", p_filename, json_type(l_node));
@@ -533,8 +630,12 @@ static int readJson(const char *p_filename, ATP_Dictionary *p_dest)
         return 0;
     }
 
-    // convert the json structure to a dictionary
+    // convert the json structure to a dictionary, allocating the whole tree from a single arena
+    ATP_dictionaryDestroy(p_dest);
+    ATP_dictionaryInitInArena(p_dest, NULL);
+    ATP_traceBegin("json convert", NULL);
     l_return = readJsonDictionary(l_node, p_dest);
+    ATP_traceEnd();
     json_delete(l_node);
     free(l_json);
 
@@ -552,17 +653,38 @@ static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_
     }
     else if (l_settings->m_fileIsOutput)
     {
-        *p_output = *p_input;
+        int l_result;
+
         DBG("writing JSON to %s...\n", l_settings->m_filePath);
-        return writeJson(p_input, l_settings->m_filePath);
+        l_result = writeJson(p_input, l_settings->m_filePath);
+
+        // pass the input through unchanged
+        ATP_processorForward(p_input, p_output);
+        return l_result;
     }
     else
     {
-        return readJson(l_settings->m_filePath, p_output);
+        if (!readJson(l_settings->m_filePath, p_output))
+        {
+            return 0;
+        }
+        if (l_settings->m_freeze)
+        {
+            ATP_dictionaryFreeze(p_output);
+        }
     }
     return 1;
 }
 
+static void files(ATP_Array *p_files, void *p_token)
+{
+    Settings *l_settings = p_token;
+    if (!l_settings->m_fileIsOutput && l_settings->m_filePath != NULL && strcmp("stdin", l_settings->m_filePath) != 0)
+    {
+        ATP_arraySetString(p_files, ATP_arrayLength(p_files), l_settings->m_filePath);
+    }
+}
+
 static void unload(void *p_token)
 {
     Settings *l_settings = p_token;
@@ -580,7 +702,7 @@ EXPORT int load(unsigned int p_index, const ATP_Array *p_parameters, struct ATP_
     Settings *l_settings;
 
     unsigned int l_count = ATP_arrayLength(p_parameters);
-    if (!ATP_processorHelpRequested() && l_count != 2)
+    if (!ATP_processorHelpRequested() && (l_count < 2 || l_count > 3))
     {
         ERR(PROCNAME ": wrong number of parameters\n");
         usage();
@@ -630,11 +752,42 @@ EXPORT int load(unsigned int p_index, const ATP_Array *p_parameters, struct ATP_
             case 1:
                 l_settings->m_filePath = strdup(l_parameter);
                 break;
+            case 2:
+                if (!l_settings->m_fileIsOutput && strcmp("frozen", l_parameter) == 0)
+                {
+                    l_settings->m_freeze = 1;
+                }
+                else
+                {
+                    free(l_settings->m_filePath);
+                    free(l_settings);
+                    ERR(PROCNAME ": '%s' is not a valid parameter\n", l_parameter);
+                    usage();
+                    return 0;
+                }
+                break;
         }
     }
 
     p_interface->m_token = l_settings;
     p_interface->run = &run;
     p_interface->unload = &unload;
+    p_interface->files = &files;
+    if (l_settings->m_fileIsOutput)
+    {
+        // writing passes the input on as it is, so whatever follows does not have to wait for the file to be written
+        p_interface->m_flags = c_ATP_ProcessorFlag_passThrough;
+        p_interface->m_writes = c_noKeys;
+    }
+    else
+    {
+        // reading ignores the input entirely
+        p_interface->m_reads = c_noKeys;
+        if (l_settings->m_filePath != NULL && strcmp("stdin", l_settings->m_filePath) != 0)
+        {
+            // reading a file depends on nothing else, so the result may be reused for as long as the file is unchanged
+            p_interface->m_flags = c_ATP_ProcessorFlag_cacheable;
+        }
+    }
     return 1;
 }
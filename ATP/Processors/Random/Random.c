@@ -9,6 +9,12 @@
 
 #define PROCNAME "random"
 
+// the input is not read at all
+static const char *const c_noKeys[] = { NULL };
+
+// the maximum length of generated keys and strings
+#define c_maxStringLength   127
+
 typedef struct Settings
 {
     unsigned int m_minEntries;
@@ -42,7 +48,8 @@ static void usage(void)
 "          <max_depth> The maximum nested dictionary/array depth to use\n\n");
 }
 
-static void getRandomBytes(void *p_buffer, unsigned int p_count)
+// opened while loading, so that instances running on different threads only ever read from it
+static void openRandomSource(void)
 {
 #ifdef _WIN32
     // TODO: Windows implementation
@@ -56,7 +63,14 @@ static void getRandomBytes(void *p_buffer, unsigned int p_count)
             exit(EX_OSFILE);
         }
     }
+#endif
+}
 
+static void getRandomBytes(void *p_buffer, unsigned int p_count)
+{
+#ifdef _WIN32
+    // TODO: Windows implementation
+#else   // NOTE: assume something with /dev/urandom for now
     fread(p_buffer, 1, p_count, gs_randFile);
 #endif
 }
@@ -96,12 +110,12 @@ static signed long long randomInt(signed long long p_lower, signed long long p_u
     return l_rand;
 }
 
-static void randomString(char p_buffer[c_ATP_Dictionary_keySize + 1])
+static void randomString(char p_buffer[c_maxStringLength + 1])
 {
     unsigned int i;
-    unsigned int l_count = randomUint(1, c_ATP_Dictionary_keySize);
+    unsigned int l_count = randomUint(1, c_maxStringLength);
 
-    memset(p_buffer, 0, c_ATP_Dictionary_keySize + 1);
+    memset(p_buffer, 0, c_maxStringLength + 1);
     for (i = 0; i < l_count; ++i)
     {
         unsigned int c = randomUint(0, strlen(cs_characters));
@@ -114,9 +128,11 @@ static int randomArray(ATP_Array *p_array, const Settings *p_settings, unsigned
     unsigned int i;
     ATP_ValueType l_type = randomUint(e_ATP_ValueType_string, e_ATP_ValueType_array);
     unsigned int l_entries = randomUint(p_settings->m_minEntries, p_settings->m_maxEntries + 1);
+
+    ATP_arrayReserve(p_array, l_entries);
     for (i = 0; i < l_entries; ++i)
     {
-        char l_randStr[c_ATP_Dictionary_keySize + 1];
+        char l_randStr[c_maxStringLength + 1];
         ATP_Dictionary l_randDict;
         ATP_Array l_randArray;
 
@@ -154,7 +170,7 @@ static int randomArray(ATP_Array *p_array, const Settings *p_settings, unsigned
                 }
                 break;
             case e_ATP_ValueType_dict:
-                ATP_dictionaryInit(&l_randDict);
+                ATP_dictionaryInitInArena(&l_randDict, ATP_arrayGetArena(p_array));
                 if (p_depth + 1 < p_settings->m_maxDepth)
                 {
                     if (!randomDictionary(&l_randDict, p_settings, p_depth + 1))
@@ -170,7 +186,7 @@ static int randomArray(ATP_Array *p_array, const Settings *p_settings, unsigned
                 }
                 break;
             case e_ATP_ValueType_array:
-                ATP_arrayInit(&l_randArray);
+                ATP_arrayInitInArena(&l_randArray, ATP_arrayGetArena(p_array));
                 if (p_depth + 1 < p_settings->m_maxDepth)
                 {
                     if (!randomArray(&l_randArray, p_settings, p_depth + 1))
@@ -199,8 +215,8 @@ static int randomDictionary(ATP_Dictionary *p_dict, const Settings *p_settings,
     unsigned int l_entries = randomUint(p_settings->m_minEntries, p_settings->m_maxEntries + 1);
     while (l_entries-- > 0)
     {
-        char l_key[c_ATP_Dictionary_keySize + 1];
-        char l_randStr[c_ATP_Dictionary_keySize + 1];
+        char l_key[c_maxStringLength + 1];
+        char l_randStr[c_maxStringLength + 1];
         ATP_Dictionary l_randDict;
         ATP_Array l_randArray;
         randomString(l_key);
@@ -239,7 +255,7 @@ static int randomDictionary(ATP_Dictionary *p_dict, const Settings *p_settings,
                 }
                 break;
             case e_ATP_ValueType_dict:
-                ATP_dictionaryInit(&l_randDict);
+                ATP_dictionaryInitInArena(&l_randDict, ATP_dictionaryGetArena(p_dict));
                 if (p_depth + 1 < p_settings->m_maxDepth)
                 {
                     if (!randomDictionary(&l_randDict, p_settings, p_depth + 1))
@@ -255,7 +271,7 @@ static int randomDictionary(ATP_Dictionary *p_dict, const Settings *p_settings,
                 }
                 break;
             case e_ATP_ValueType_array:
-                ATP_arrayInit(&l_randArray);
+                ATP_arrayInitInArena(&l_randArray, ATP_dictionaryGetArena(p_dict));
                 if (p_depth + 1 < p_settings->m_maxDepth)
                 {
                     if (!randomArray(&l_randArray, p_settings, p_depth + 1))
@@ -288,6 +304,8 @@ static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_
     }
     else
     {
+        // the whole tree is allocated from a single arena
+        ATP_dictionaryInitInArena(p_output, NULL);
         return randomDictionary(p_output, l_settings, 0);
     }
 
@@ -373,8 +391,11 @@ EXPORT int load(unsigned int p_index, const ATP_Array *p_parameters, struct ATP_
         }
     }
 
+    openRandomSource();
     p_interface->m_token = l_settings;
     p_interface->run = &run;
     p_interface->unload = &unload;
+    p_interface->m_flags = c_ATP_ProcessorFlag_threadSafe;
+    p_interface->m_reads = c_noKeys;
     return 1;
 }
@@ -0,0 +1,321 @@
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/Image.h"
+#include "ATP/Library/Trace.h"
+#include "ATP/Library/Log.h"
+#include "ATP/Library/Exit.h"
+#include "ATP/Library/Export.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if _WIN32
+    // shared memory objects are not supported yet
+#else // NOTE: assume POSIX for now
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#define PROCNAME "shm"
+
+// an empty list of keys, for what the processor reads when reading an image and sets when writing one
+static const char *const c_noKeys[] = { NULL };
+
+typedef struct Settings
+{
+    int m_isOutput;
+    // the name of the shared memory object, starting with a slash, or NULL if a descriptor is used instead
+    char *m_name;
+    int m_fd;
+    unsigned long m_mode;
+} Settings;
+
+static void usage(void)
+{
+    LOG(
+"Processor: " PROCNAME "\n");
+    LOG(
+"    Hands the working dictionary to another process through shared memory, as\n"
+"    an image that the other process maps in place rather than parsing it.\n"
+"    When writing, the dictionary is also passed on to the next pipeline stage,\n"
+"    if any.\n\n");
+    LOG(
+"    Usage: @" PROCNAME " write <name>|fd:<n> [<mode>]\n"
+"           @" PROCNAME " read <name>|fd:<n>\n\n");
+    LOG(
+"            <name> The name of the POSIX shared memory object to write the\n"
+"                   dictionary to or read it from, which is replaced when\n"
+"                   writing\n");
+    LOG(
+"            fd:<n> An open file descriptor to use instead, such as a memfd\n"
+"                   inherited from the process that started atp\n");
+    LOG(
+"            <mode> The octal permissions of a new shared memory object, such\n"
+"                   as 0640 to let the group read it (default 0600)\n\n");
+    LOG(
+"    The dictionary that is read is frozen, and must have been written by the\n"
+"    same build of atp.  It is checked in full before it is used, so it may be\n"
+"    written by a process that is not trusted.\n\n");
+}
+
+#if _WIN32
+static int writeImage(const ATP_Dictionary *p_dict, const Settings *p_settings)
+{
+    ERR(PROCNAME ": shared memory is not supported on this platform yet\n");
+    return 0;
+}
+
+static int readImage(const Settings *p_settings, ATP_Dictionary *p_dict)
+{
+    ERR(PROCNAME ": shared memory is not supported on this platform yet\n");
+    return 0;
+}
+#else // NOTE: assume POSIX for now
+static int writeImage(const ATP_Dictionary *p_dict, const Settings *p_settings)
+{
+    int l_fd = p_settings->m_fd;
+    size_t l_size;
+    void *l_block;
+
+    if (p_settings->m_name != NULL)
+    {
+        // a new object is created each time, so that a process still mapping the old one is not cut short by truncating it
+        if (shm_unlink(p_settings->m_name) != 0 && errno != ENOENT)
+        {
+            ERR(PROCNAME ": unable to replace '%s'\n", p_settings->m_name);
+            return 0;
+        }
+        l_fd = shm_open(p_settings->m_name, O_RDWR | O_CREAT | O_EXCL, (mode_t) p_settings->m_mode);
+        if (l_fd < 0 || fchmod(l_fd, (mode_t) p_settings->m_mode) != 0)
+        {
+            ERR(PROCNAME ": unable to create '%s'\n", p_settings->m_name);
+            if (l_fd >= 0)
+            {
+                close(l_fd);
+            }
+            return 0;
+        }
+    }
+
+    ATP_traceBegin("shm write", p_settings->m_name);
+    l_size = ATP_imageSize(p_dict);
+    l_block = MAP_FAILED;
+    if (ftruncate(l_fd, (off_t) l_size) == 0)
+    {
+        l_block = mmap(NULL, l_size, PROT_READ | PROT_WRITE, MAP_SHARED, l_fd, 0);
+    }
+    if (l_block != MAP_FAILED)
+    {
+        ATP_imageWrite(p_dict, l_block);
+        munmap(l_block, l_size);
+    }
+    else
+    {
+        PERR();
+    }
+    ATP_traceEnd();
+
+    if (p_settings->m_name != NULL)
+    {
+        close(l_fd);
+    }
+    return (l_block != MAP_FAILED);
+}
+
+static void unmapImage(void *p_block, size_t p_size, void *p_token)
+{
+    munmap(p_block, p_size);
+}
+
+static int readImage(const Settings *p_settings, ATP_Dictionary *p_dict)
+{
+    int l_fd = p_settings->m_fd;
+    int l_result = 0;
+    struct stat l_stat;
+    void *l_block = MAP_FAILED;
+
+    if (p_settings->m_name != NULL)
+    {
+        l_fd = shm_open(p_settings->m_name, O_RDONLY, 0);
+        if (l_fd < 0)
+        {
+            ERR(PROCNAME ": unable to open '%s'\n", p_settings->m_name);
+            return 0;
+        }
+    }
+
+    // the mapping is private, so that the pointers in it can be updated without writing to the shared pages
+    ATP_traceBegin("shm read", p_settings->m_name);
+    if (fstat(l_fd, &l_stat) == 0 && l_stat.st_size > 0)
+    {
+        l_block = mmap(NULL, (size_t) l_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, l_fd, 0);
+    }
+    if (l_block == MAP_FAILED)
+    {
+        ERR(PROCNAME ": unable to map the dictionary image\n");
+    }
+    else
+    {
+        l_result = ATP_imageOpen(l_block, (size_t) l_stat.st_size, &unmapImage, NULL, p_dict);
+        if (!l_result)
+        {
+            munmap(l_block, (size_t) l_stat.st_size);
+        }
+    }
+    ATP_traceEnd();
+
+    // the mapping stays valid without the descriptor
+    if (p_settings->m_name != NULL)
+    {
+        close(l_fd);
+    }
+    return l_result;
+}
+#endif
+
+static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    Settings *l_settings = p_token;
+
+    if (ATP_processorHelpRequested())
+    {
+        usage();
+    }
+    else if (l_settings->m_isOutput)
+    {
+        int l_result = writeImage(p_input, l_settings);
+
+        // pass the input through unchanged
+        ATP_processorForward(p_input, p_output);
+        return l_result;
+    }
+    else
+    {
+        ATP_dictionaryDestroy(p_output);
+        return readImage(l_settings, p_output);
+    }
+    return 1;
+}
+
+static void unload(void *p_token)
+{
+    Settings *l_settings = p_token;
+    free(l_settings->m_name);
+    free(l_settings);
+}
+
+// parse the name of a shared memory object or a descriptor into the settings
+static int parseTarget(const char *p_target, Settings *p_settings)
+{
+    if (strncmp(p_target, "fd:", 3) == 0)
+    {
+        char *l_end = NULL;
+        long l_fd = strtol(&p_target[3], &l_end, 10);
+        if (p_target[3] == '\0' || *l_end != '\0' || l_fd < 0 || l_fd > 65535)
+        {
+            return 0;
+        }
+        p_settings->m_fd = (int) l_fd;
+        return 1;
+    }
+    else if (p_target[0] == '\0' || strchr(&p_target[1], '/') != NULL)
+    {
+        return 0;
+    }
+
+    // shared memory object names are portable only when they start with a slash and have no other
+    p_settings->m_name = malloc(strlen(p_target) + 2);
+    if (p_settings->m_name == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    strcpy(p_settings->m_name, (p_target[0] == '/' ? "" : "/"));
+    strcat(p_settings->m_name, p_target);
+    return 1;
+}
+
+#ifdef ATTR_STATIC_PROCESSORS
+int shm_load(unsigned int p_index, const ATP_Array *p_parameters, struct ATP_ProcessorInterface *p_interface)
+#else
+EXPORT int load(unsigned int p_index, const ATP_Array *p_parameters, struct ATP_ProcessorInterface *p_interface)
+#endif
+{
+    unsigned int i;
+    Settings *l_settings;
+
+    unsigned int l_count = ATP_arrayLength(p_parameters);
+    if (!ATP_processorHelpRequested() && (l_count < 2 || l_count > 3))
+    {
+        ERR(PROCNAME ": wrong number of parameters\n");
+        usage();
+        return 0;
+    }
+
+    l_settings = malloc(sizeof(Settings));
+    if (l_settings == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    memset(l_settings, 0, sizeof(Settings));
+    l_settings->m_fd = -1;
+    l_settings->m_mode = 0600;
+
+    for (i = 0; i < l_count; ++i)
+    {
+        int l_valid = 1;
+        const char *l_parameter = NULL;
+        if (!ATP_arrayGetString(p_parameters, i, &l_parameter))
+        {
+            unload(l_settings);
+            usage();
+            return 0;
+        }
+        DBG(PROCNAME ": parameter %u is '%s'\n", i, l_parameter);
+
+        switch (i)
+        {
+            case 0:
+                l_settings->m_isOutput = (strcmp("write", l_parameter) == 0);
+                l_valid = (l_settings->m_isOutput || strcmp("read", l_parameter) == 0);
+                break;
+            case 1:
+                l_valid = parseTarget(l_parameter, l_settings);
+                break;
+            case 2:
+                {
+                    char *l_end = NULL;
+                    l_settings->m_mode = strtoul(l_parameter, &l_end, 8);
+                    l_valid = (l_settings->m_isOutput && l_settings->m_name != NULL && *l_parameter != '\0'
+                               && *l_end == '\0' && l_settings->m_mode <= 0777);
+                }
+                break;
+        }
+
+        if (!l_valid)
+        {
+            unload(l_settings);
+            ERR(PROCNAME ": '%s' is not a valid parameter\n", l_parameter);
+            usage();
+            return 0;
+        }
+    }
+
+    p_interface->m_token = l_settings;
+    p_interface->run = &run;
+    p_interface->unload = &unload;
+    if (l_settings->m_isOutput)
+    {
+        // writing passes the input on as it is, so whatever follows does not have to wait for the image to be written
+        p_interface->m_flags = c_ATP_ProcessorFlag_passThrough;
+        p_interface->m_writes = c_noKeys;
+    }
+    else
+    {
+        // reading ignores the input entirely
+        p_interface->m_reads = c_noKeys;
+    }
+    return 1;
+}
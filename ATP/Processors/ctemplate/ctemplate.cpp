@@ -1,4 +1,5 @@
 #include "ATP/Library/Processor.h"
+#include "ATP/Library/Trace.h"
 #include "ATP/Library/Log.h"
 #include "ATP/Library/Exit.h"
 #include "ATP/Library/Export.h"
@@ -11,6 +12,9 @@
 
 #define PROCNAME "ctemplate"
 
+// the input is passed on as it is, without setting anything
+static const char *const c_noKeys[] = { NULL };
+
 struct Settings
 {
     std::string m_template;
@@ -25,8 +29,8 @@ struct Settings
 };
 
 // forward references
-static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, ATP_Array *p_atpArray, const std::string &p_key);
-static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, ATP_Dictionary *p_atpDict);
+static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, const ATP_Array *p_atpArray, const std::string &p_key);
+static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, const ATP_Dictionary *p_atpDict);
 
 static void usage(void)
 {
@@ -58,7 +62,7 @@ static std::string toString(const T &p_item)
     return l_stream.str();
 }
 
-static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, ATP_Array *p_atpArray, const std::string &p_key)
+static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, const ATP_Array *p_atpArray, const std::string &p_key)
 {
     unsigned int i;
     DBG("array %p has %u entries\n", *p_atpArray, ATP_arrayLength(p_atpArray));
@@ -69,10 +73,10 @@ static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, A
         {
             case e_ATP_ValueType_dict:
                 {
-                    ATP_Dictionary *l_value = NULL;
+                    const ATP_Dictionary *l_value = NULL;
                     ctemplate::TemplateDictionary *l_subDict = p_tplDict.AddSectionDictionary(p_key);
 
-                    ATP_arrayGetDict(p_atpArray, i, &l_value);
+                    ATP_arrayGetDictConst(p_atpArray, i, &l_value);
                     if (!atpDictToCtemplateDict(*l_subDict, l_value))
                     {
                         return false;
@@ -90,11 +94,11 @@ static bool atpArrayToCtemplateDicts(ctemplate::TemplateDictionary &p_tplDict, A
     return 1;
 }
 
-static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, ATP_Dictionary *p_atpDict)
+static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, const ATP_Dictionary *p_atpDict)
 {
     ATP_DictionaryIterator it;
     DBG("dictionary %p has %u entries\n", *p_atpDict, ATP_dictionaryCount(p_atpDict));
-    for (it = ATP_dictionaryBegin(p_atpDict); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
+    for (it = ATP_dictionaryBeginConst(p_atpDict); ATP_dictionaryHasNext(it); it = ATP_dictionaryNext(it))
     {
         std::string l_key = ATP_dictionaryGetKey(it);
 
@@ -138,10 +142,10 @@ static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, ATP
                 break;
             case e_ATP_ValueType_dict:
                 {
-                    ATP_Dictionary *l_value = NULL;
+                    const ATP_Dictionary *l_value = NULL;
                     ctemplate::TemplateDictionary *l_subDict = p_tplDict.AddSectionDictionary(l_key);
 
-                    ATP_dictionaryItGetDict(it, &l_value);
+                    ATP_dictionaryItGetDictConst(it, &l_value);
                     if (!atpDictToCtemplateDict(*l_subDict, l_value))
                     {
                         return false;
@@ -151,8 +155,8 @@ static bool atpDictToCtemplateDict(ctemplate::TemplateDictionary &p_tplDict, ATP
                 break;
             case e_ATP_ValueType_array:
                 {
-                    ATP_Array *l_value = NULL;
-                    ATP_dictionaryItGetArray(it, &l_value);
+                    const ATP_Array *l_value = NULL;
+                    ATP_dictionaryItGetArrayConst(it, &l_value);
                     if (!atpArrayToCtemplateDicts(p_tplDict, l_value, l_key))
                     {
                         return false;
@@ -178,29 +182,36 @@ static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_
     else
     {
         ctemplate::TemplateDictionary l_dict("atp");
-        if (!atpDictToCtemplateDict(l_dict, p_input))
+        ATP_traceBegin("ctemplate convert", NULL);
+        bool l_converted = atpDictToCtemplateDict(l_dict, p_input);
+        ATP_traceEnd();
+        if (!l_converted)
         {
             return 0;
         }
 
+        // parsed templates stay cached between runs of a long-lived process, such as atp --watch, and are only parsed
+        // again once their files have changed
+        ctemplate::Template::ReloadAllIfChanged();
+
         std::string l_result;
+        bool l_expanded;
+        ATP_traceBegin("ctemplate expand", l_settings->m_template.c_str());
         if (l_settings->m_annotate)
         {
             ctemplate::PerExpandData l_data;
             l_data.SetAnnotateOutput("");
-            if (!ctemplate::ExpandWithData(l_settings->m_template, l_settings->m_strip, &l_dict, &l_data, &l_result))
-            {
-                ERR(PROCNAME ": Template expansion failed\n");
-                return 0;
-            }
+            l_expanded = ctemplate::ExpandWithData(l_settings->m_template, l_settings->m_strip, &l_dict, &l_data, &l_result);
         }
         else
         {
-            if (!ctemplate::ExpandTemplate(l_settings->m_template, l_settings->m_strip, &l_dict, &l_result))
-            {
-                ERR(PROCNAME ": Template expansion failed\n");
-                return 0;
-            }
+            l_expanded = ctemplate::ExpandTemplate(l_settings->m_template, l_settings->m_strip, &l_dict, &l_result);
+        }
+        ATP_traceEnd();
+        if (!l_expanded)
+        {
+            ERR(PROCNAME ": Template expansion failed\n");
+            return 0;
         }
 
         std::ofstream l_outfile(l_settings->m_output.c_str(), std::ofstream::out|std::ofstream::binary);
@@ -213,12 +224,22 @@ static int run(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_
         l_outfile << l_result;
         l_outfile.close();
 
-        *p_output = *p_input;
+        // pass the input through unchanged
+        ATP_processorForward(p_input, p_output);
     }
 
     return 1;
 }
 
+static void files(ATP_Array *p_files, void *p_token)
+{
+    Settings *l_settings = (Settings *) p_token;
+    if (!l_settings->m_template.empty())
+    {
+        ATP_arraySetString(p_files, ATP_arrayLength(p_files), l_settings->m_template.c_str());
+    }
+}
+
 static void unload(void *p_token)
 {
     Settings *l_settings = (Settings *) p_token;
@@ -279,5 +300,9 @@ extern "C" EXPORT int load(unsigned int p_index, const ATP_Array *p_parameters,
     p_interface->m_token = l_settings;
     p_interface->run = &run;
     p_interface->unload = &unload;
+    p_interface->files = &files;
+    // the template is applied to a file of its own, so nothing after this processor has to wait for it
+    p_interface->m_flags = c_ATP_ProcessorFlag_passThrough;
+    p_interface->m_writes = c_noKeys;
     return 1;
 }
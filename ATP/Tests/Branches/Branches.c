@@ -0,0 +1,234 @@
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/Pipeline.h"
+#include "ATP/Library/Log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// the most check stages a pipeline holds, and the most threads it is run on
+#define c_maxChecks     4
+#define c_maxThreads    4
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+// the input each check stage received, in the order the stages were added, or NULL if it did not run
+static ATP_Dictionary gs_seen[c_maxChecks];
+static unsigned int gs_checkCount = 0;
+
+static int runCount(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    unsigned long long l_count = 0;
+    ATP_dictionaryGetUint(p_input, "n", &l_count);
+    return ATP_dictionarySetUint(p_output, "n", l_count + 1);
+}
+
+static int runCheck(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    gs_seen[(uintptr_t) p_token] = ATP_dictionaryDuplicate(p_input);
+    return 1;
+}
+
+static int runFail(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    return 0;
+}
+
+static void unload(void *p_token)
+{
+}
+
+static int loadCount(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runCount;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static int loadCheck(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->m_token = (void *) (uintptr_t) gs_checkCount++;
+    p_interface->run = &runCheck;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static int loadFail(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runFail;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static ATP_StaticProcessor gs_processors[] =
+{
+    { "count", &loadCount },
+    { "check", &loadCheck },
+    { "fail", &loadFail },
+};
+
+/*
+Build a pipeline from a list of words: "tee:x" adds a tee named x, "from:x" branches from it, "join:x,y" joins the tees named,
+and any other word appends the processor of that name.  Returns 0 if the pipeline cannot be built.
+*/
+static int build(ATP_Pipeline *p_pipeline, const char *p_words)
+{
+    char l_words[256];
+    char *l_word;
+    unsigned int l_index = 0;
+    int l_result = 1;
+
+    ATP_pipelineInit(p_pipeline);
+    strcpy(l_words, p_words);
+    for (l_word = strtok(l_words, " "); l_word != NULL && l_result; l_word = strtok(NULL, " "))
+    {
+        if (strncmp(l_word, "tee:", 4) == 0)
+        {
+            l_result = ATP_pipelineTee(p_pipeline, l_word + 4);
+        }
+        else if (strncmp(l_word, "from:", 5) == 0)
+        {
+            l_result = ATP_pipelineBranch(p_pipeline, l_word + 5);
+        }
+        else if (strncmp(l_word, "join:", 5) == 0)
+        {
+            ATP_Array l_sources;
+            char *l_name = l_word + 5;
+            char *l_comma;
+
+            ATP_arrayInit(&l_sources);
+            while ((l_comma = strchr(l_name, ',')) != NULL)
+            {
+                *l_comma = '\0';
+                ATP_arraySetString(&l_sources, ATP_arrayLength(&l_sources), l_name);
+                l_name = l_comma + 1;
+            }
+            ATP_arraySetString(&l_sources, ATP_arrayLength(&l_sources), l_name);
+            l_result = ATP_pipelineJoin(p_pipeline, &l_sources);
+            ATP_arrayDestroy(&l_sources);
+        }
+        else
+        {
+            ATP_pipelineAppend(p_pipeline, ATP_processorLoad(l_index++, l_word, NULL));
+        }
+    }
+
+    return l_result;
+}
+
+// run a pipeline on a given number of threads, starting the check stages from scratch
+static int run(const char *p_words, unsigned int p_threads)
+{
+    ATP_Pipeline l_pipeline;
+    unsigned int i;
+    int l_result;
+
+    for (i = 0; i < c_maxChecks; ++i)
+    {
+        ATP_dictionaryDestroy(&gs_seen[i]);
+    }
+    gs_checkCount = 0;
+
+    l_result = build(&l_pipeline, p_words);
+    CHECK(l_result);
+    l_result = l_result && ATP_pipelineExecute(&l_pipeline, p_threads);
+    ATP_pipelineDestroy(&l_pipeline);
+    return l_result;
+}
+
+// the count held in a tee's entry of a check stage's input, or in the input itself if p_tee is NULL
+static unsigned long long seenCount(unsigned int p_check, const char *p_tee)
+{
+    unsigned long long l_count = 0;
+    ATP_Dictionary *l_dict = &gs_seen[p_check];
+
+    if (*l_dict == NULL || (p_tee != NULL && !ATP_dictionaryGetDict(l_dict, p_tee, &l_dict)))
+    {
+        return 0;
+    }
+    ATP_dictionaryGetUint(l_dict, "n", &l_count);
+    return l_count;
+}
+
+static void testBranches(unsigned int p_threads)
+{
+    // a branch starts from what passed its tee, whatever the branch before it did afterwards
+    CHECK(run("count tee:a count count check from:a count check", p_threads));
+    CHECK(seenCount(0, NULL) == 3 && seenCount(1, NULL) == 2);
+
+    // several branches from the same tee each get its records to themselves
+    CHECK(run("count tee:a from:a count check from:a count count check", p_threads));
+    CHECK(seenCount(0, NULL) == 2 && seenCount(1, NULL) == 3);
+}
+
+static void testJoins(unsigned int p_threads)
+{
+    // a join gets the records of each tee under its name
+    CHECK(run("count tee:a count tee:b join:a,b check", p_threads));
+    CHECK(seenCount(0, "a") == 1 && seenCount(0, "b") == 2);
+    CHECK(gs_seen[0] != NULL && ATP_dictionaryCount(&gs_seen[0]) == 2);
+
+    // the same tees may be joined repeatedly, and branched from as well
+    CHECK(run("count tee:a count tee:b join:a,b check join:b,a check from:a check", p_threads));
+    CHECK(seenCount(0, "a") == 1 && seenCount(0, "b") == 2);
+    CHECK(seenCount(1, "a") == 1 && seenCount(1, "b") == 2);
+    CHECK(seenCount(2, NULL) == 1);
+
+    // a joined branch may itself be teed and joined again
+    CHECK(run("count tee:a join:a count tee:b join:a,b check", p_threads));
+    CHECK(seenCount(0, "a") == 1 && seenCount(0, "b") == 1);
+}
+
+static void testFailures(unsigned int p_threads)
+{
+    ATP_Pipeline l_pipeline;
+
+    // names must be unique among tees, given once in a join, and name a tee added earlier
+    CHECK(!build(&l_pipeline, "count tee:a tee:a"));
+    ATP_pipelineDestroy(&l_pipeline);
+    CHECK(!build(&l_pipeline, "count tee:a join:a,a"));
+    ATP_pipelineDestroy(&l_pipeline);
+    CHECK(!build(&l_pipeline, "count tee:a tee:b join:a,b,a"));
+    ATP_pipelineDestroy(&l_pipeline);
+    CHECK(!build(&l_pipeline, "count join:a"));
+    ATP_pipelineDestroy(&l_pipeline);
+    CHECK(!build(&l_pipeline, "count from:a"));
+    ATP_pipelineDestroy(&l_pipeline);
+
+    // a branch or join whose tee is never passed does not run
+    CHECK(!run("fail tee:a from:a check join:a check", p_threads));
+    CHECK(gs_seen[0] == NULL && gs_seen[1] == NULL);
+
+    // while the branches that do not depend on a failed one still run
+    CHECK(!run("count tee:a from:a fail tee:b from:a check join:b check", p_threads));
+    CHECK(seenCount(0, NULL) == 1 && gs_seen[1] == NULL);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    unsigned int t;
+    unsigned int i;
+
+    ATP_processorsSetStatic(gs_processors, sizeof(gs_processors) / sizeof(gs_processors[0]));
+    for (t = 1; t <= c_maxThreads; ++t)
+    {
+        testBranches(t);
+        testJoins(t);
+        testFailures(t);
+    }
+    for (i = 0; i < c_maxChecks; ++i)
+    {
+        ATP_dictionaryDestroy(&gs_seen[i]);
+    }
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All branch checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,394 @@
+#include "ATP/Library/Cache.h"
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/Dictionary.h"
+#include "ATP/Library/Array.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #undef WIN32_LEAN_AND_MEAN
+#else // NOTE: assume POSIX for now
+    #include <dirent.h>
+    #include <unistd.h>
+#endif
+
+// the cache goes in a scratch directory of the current one, next to the file the cacheable processor reads
+#define c_scratch       "CacheScratch"
+#define c_inputFile     "CacheInput"
+
+// outputs large enough that only two fit in a cache of a megabyte
+#define c_bulkyLength   (48 * 1024)
+#define c_bulkyCount    5
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+// the number of times the cacheable processor has actually run
+static unsigned int gs_runs = 0;
+
+static int sameKey(const ATP_CacheKey *p_first, const ATP_CacheKey *p_second)
+{
+    return (memcmp(p_first, p_second, sizeof(ATP_CacheKey)) == 0);
+}
+
+// dictionaries are compared through their keys, which cover everything nested in them
+static int sameContents(const ATP_Dictionary *p_first, const ATP_Dictionary *p_second)
+{
+    ATP_CacheKey l_first;
+    ATP_CacheKey l_second;
+
+    ATP_cacheKeyInit(&l_first);
+    ATP_cacheKeyAddDictionary(&l_first, p_first);
+    ATP_cacheKeyInit(&l_second);
+    ATP_cacheKeyAddDictionary(&l_second, p_second);
+    return sameKey(&l_first, &l_second);
+}
+
+static int writeFile(const char *p_file, const char *p_contents)
+{
+    FILE *l_file = fopen(p_file, "w");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+    fputs(p_contents, l_file);
+    return (fclose(l_file) == 0);
+}
+
+// remove the scratch directory along with every file in it
+static void removeScratch(void)
+{
+    char l_path[1024];
+#if _WIN32
+    WIN32_FIND_DATA l_data;
+    HANDLE l_find = FindFirstFile(c_scratch "\\*", &l_data);
+    if (l_find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            snprintf(l_path, sizeof(l_path), c_scratch "\\%s", l_data.cFileName);
+            DeleteFile(l_path);
+        }
+        while (FindNextFile(l_find, &l_data) != 0);
+        FindClose(l_find);
+    }
+    RemoveDirectory(c_scratch);
+#else // NOTE: assume POSIX for now
+    struct dirent *l_entry;
+    DIR *l_dir = opendir(c_scratch);
+    if (l_dir != NULL)
+    {
+        while ((l_entry = readdir(l_dir)) != NULL)
+        {
+            if (strcmp(l_entry->d_name, ".") != 0 && strcmp(l_entry->d_name, "..") != 0)
+            {
+                snprintf(l_path, sizeof(l_path), c_scratch "/%s", l_entry->d_name);
+                remove(l_path);
+            }
+        }
+        closedir(l_dir);
+    }
+    rmdir(c_scratch);
+#endif
+}
+
+static void fillSample(ATP_Dictionary *p_dict)
+{
+    static const unsigned long long c_values[] = { 1, 2, 3, 5, 8, 13 };
+    ATP_Dictionary l_nested;
+    ATP_Array l_packed;
+    ATP_Array l_mixed;
+
+    ATP_dictionaryInit(p_dict);
+    ATP_dictionarySetString(p_dict, "string", "a string long enough not to be stored inline");
+    ATP_dictionarySetUint(p_dict, "uint", 42);
+    ATP_dictionarySetInt(p_dict, "int", -42);
+    ATP_dictionarySetDouble(p_dict, "double", 0.25);
+    ATP_dictionarySetBool(p_dict, "bool", 1);
+
+    ATP_dictionaryInit(&l_nested);
+    ATP_dictionarySetString(&l_nested, "inner", "value");
+    ATP_arrayInit(&l_packed);
+    ATP_arrayAppendUintN(&l_packed, c_values, sizeof(c_values) / sizeof(c_values[0]));
+    ATP_arrayPack(&l_packed, e_ATP_ValueType_uint);
+    ATP_dictionarySetArray(&l_nested, "packed", l_packed);
+    ATP_dictionarySetDict(p_dict, "nested", l_nested);
+
+    ATP_arrayInit(&l_mixed);
+    ATP_arraySetString(&l_mixed, 0, "first");
+    ATP_arraySetDouble(&l_mixed, 1, 1.5);
+    ATP_dictionarySetArray(p_dict, "mixed", l_mixed);
+}
+
+static void testKeys(void)
+{
+    ATP_CacheKey l_first;
+    ATP_CacheKey l_second;
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_other;
+    static const char *const c_listed[] = { "uint", "absent", NULL };
+
+    // strings added one after another are kept apart
+    ATP_cacheKeyInit(&l_first);
+    ATP_cacheKeyAddString(&l_first, "ab");
+    ATP_cacheKeyAddString(&l_first, "c");
+    ATP_cacheKeyInit(&l_second);
+    ATP_cacheKeyAddString(&l_second, "a");
+    ATP_cacheKeyAddString(&l_second, "bc");
+    CHECK(!sameKey(&l_first, &l_second));
+    ATP_cacheKeyInit(&l_second);
+    ATP_cacheKeyAddString(&l_second, "ab");
+    ATP_cacheKeyAddString(&l_second, "c");
+    CHECK(sameKey(&l_first, &l_second));
+
+    // the order entries were set in does not matter, but their values and types do
+    ATP_dictionaryInit(&l_dict);
+    ATP_dictionarySetUint(&l_dict, "a", 1);
+    ATP_dictionarySetUint(&l_dict, "b", 2);
+    ATP_dictionaryInit(&l_other);
+    ATP_dictionarySetUint(&l_other, "b", 2);
+    ATP_dictionarySetUint(&l_other, "a", 1);
+    CHECK(sameContents(&l_dict, &l_other));
+    ATP_dictionarySetInt(&l_other, "a", 1);
+    CHECK(!sameContents(&l_dict, &l_other));
+    ATP_dictionarySetString(&l_other, "a", "1");
+    CHECK(!sameContents(&l_dict, &l_other));
+    ATP_dictionaryDestroy(&l_other);
+    ATP_dictionaryDestroy(&l_dict);
+
+    // so do values nested deep inside
+    fillSample(&l_dict);
+    fillSample(&l_other);
+    CHECK(sameContents(&l_dict, &l_other));
+    {
+        ATP_Dictionary *l_nested;
+        ATP_Array *l_packed;
+        CHECK(ATP_dictionaryGetDict(&l_other, "nested", &l_nested) && ATP_dictionaryGetArray(l_nested, "packed", &l_packed));
+        ATP_arraySetUint(l_packed, 5, 14);
+    }
+    CHECK(!sameContents(&l_dict, &l_other));
+
+    // only the listed entries count when they are listed, and a listed entry being absent does as well
+    ATP_cacheKeyInit(&l_first);
+    ATP_cacheKeyAddDictionaryKeys(&l_first, &l_dict, c_listed);
+    ATP_cacheKeyInit(&l_second);
+    ATP_cacheKeyAddDictionaryKeys(&l_second, &l_other, c_listed);
+    CHECK(sameKey(&l_first, &l_second));
+    ATP_dictionarySetUint(&l_other, "absent", 0);
+    ATP_cacheKeyInit(&l_second);
+    ATP_cacheKeyAddDictionaryKeys(&l_second, &l_other, c_listed);
+    CHECK(!sameKey(&l_first, &l_second));
+    ATP_dictionaryDestroy(&l_other);
+    ATP_dictionaryDestroy(&l_dict);
+
+    // files count by their contents
+    CHECK(writeFile(c_inputFile, "first contents"));
+    ATP_cacheKeyInit(&l_first);
+    CHECK(ATP_cacheKeyAddFile(&l_first, c_inputFile));
+    ATP_cacheKeyInit(&l_second);
+    CHECK(ATP_cacheKeyAddFile(&l_second, c_inputFile));
+    CHECK(sameKey(&l_first, &l_second));
+    CHECK(writeFile(c_inputFile, "other contents"));
+    ATP_cacheKeyInit(&l_second);
+    CHECK(ATP_cacheKeyAddFile(&l_second, c_inputFile));
+    CHECK(!sameKey(&l_first, &l_second));
+    CHECK(!ATP_cacheKeyAddFile(&l_second, c_inputFile ".missing"));
+    remove(c_inputFile);
+}
+
+static void testStore(void)
+{
+    ATP_CacheKey l_key;
+    ATP_CacheKey l_other;
+    ATP_Dictionary l_output;
+    ATP_Dictionary l_loaded;
+
+    fillSample(&l_output);
+    ATP_cacheKeyInit(&l_key);
+    ATP_cacheKeyAddString(&l_key, "stored");
+    ATP_cacheKeyInit(&l_other);
+    ATP_cacheKeyAddString(&l_other, "never stored");
+
+    // nothing is stored or found while no directory is set
+    CHECK(!ATP_cacheEnabled());
+    ATP_cacheStore(&l_key, &l_output);
+    ATP_dictionaryInit(&l_loaded);
+    CHECK(!ATP_cacheLoad(&l_key, &l_loaded));
+    ATP_dictionaryDestroy(&l_loaded);
+
+    // an output stored comes back whole, and only under its own key
+    CHECK(ATP_cacheSetDirectory(c_scratch, c_ATP_Cache_defaultLimit));
+    CHECK(ATP_cacheEnabled());
+    ATP_cacheStore(&l_key, &l_output);
+    ATP_dictionaryInit(&l_loaded);
+    CHECK(ATP_cacheLoad(&l_key, &l_loaded) && sameContents(&l_loaded, &l_output));
+    ATP_dictionaryDestroy(&l_loaded);
+    ATP_dictionaryInit(&l_loaded);
+    CHECK(!ATP_cacheLoad(&l_other, &l_loaded) && ATP_dictionaryCount(&l_loaded) == 0);
+    ATP_dictionaryDestroy(&l_loaded);
+
+    ATP_dictionaryDestroy(&l_output);
+}
+
+static void testLimit(void)
+{
+    ATP_CacheKey l_keys[c_bulkyCount];
+    ATP_Dictionary l_output;
+    ATP_Array l_bulk;
+    unsigned int l_found = 0;
+    unsigned int i;
+    char l_name[32];
+
+    // outputs beyond the size limit are removed as new ones are stored, until they fit again
+    CHECK(ATP_cacheSetDirectory(c_scratch, 1));
+    ATP_dictionaryInit(&l_output);
+    ATP_arrayInit(&l_bulk);
+    for (i = 0; i < c_bulkyLength; ++i)
+    {
+        ATP_arraySetUint(&l_bulk, i, i);
+    }
+    CHECK(ATP_arrayPack(&l_bulk, e_ATP_ValueType_uint));
+    ATP_dictionarySetArray(&l_output, "bulk", l_bulk);
+    for (i = 0; i < c_bulkyCount; ++i)
+    {
+        sprintf(l_name, "bulky %u", i);
+        ATP_cacheKeyInit(&l_keys[i]);
+        ATP_cacheKeyAddString(&l_keys[i], l_name);
+        ATP_cacheStore(&l_keys[i], &l_output);
+    }
+    for (i = 0; i < c_bulkyCount; ++i)
+    {
+        ATP_Dictionary l_loaded;
+        ATP_dictionaryInit(&l_loaded);
+        l_found += ATP_cacheLoad(&l_keys[i], &l_loaded);
+        ATP_dictionaryDestroy(&l_loaded);
+    }
+    CHECK(l_found >= 1 && l_found <= 2);
+    ATP_dictionaryDestroy(&l_output);
+}
+
+static int runCacheable(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    unsigned long long l_value = 0;
+
+    ++gs_runs;
+    ATP_dictionaryGetUint(p_input, "value", &l_value);
+    return ATP_dictionarySetUint(p_output, "doubled", l_value * 2);
+}
+
+static void files(ATP_Array *p_files, void *p_token)
+{
+    ATP_arraySetString(p_files, ATP_arrayLength(p_files), c_inputFile);
+}
+
+static void unload(void *p_token)
+{
+}
+
+static int loadCacheable(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runCacheable;
+    p_interface->unload = &unload;
+    p_interface->files = &files;
+    p_interface->m_flags = c_ATP_ProcessorFlag_cacheable;
+    return 1;
+}
+
+static int loadUncached(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runCacheable;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static ATP_StaticProcessor gs_processors[] =
+{
+    { "cacheable", &loadCacheable },
+    { "uncached", &loadUncached },
+};
+
+// run a processor on an input holding a single value, returning what it output for it
+static unsigned long long runWith(const char *p_name, const char *p_parameter, unsigned long long p_value)
+{
+    ATP_Processor *l_proc;
+    ATP_Array l_parameters;
+    ATP_Dictionary l_input;
+    ATP_Dictionary l_output;
+    unsigned long long l_doubled = 0;
+
+    ATP_arrayInit(&l_parameters);
+    ATP_arraySetString(&l_parameters, 0, p_parameter);
+    l_proc = ATP_processorLoad(0, p_name, &l_parameters);
+    ATP_arrayDestroy(&l_parameters);
+    CHECK(l_proc != NULL);
+    if (l_proc == NULL)
+    {
+        return 0;
+    }
+
+    ATP_dictionaryInit(&l_input);
+    ATP_dictionaryInit(&l_output);
+    ATP_dictionarySetUint(&l_input, "value", p_value);
+    CHECK(ATP_processorRun(l_proc, 0, &l_input, &l_output));
+    CHECK(ATP_dictionaryGetUint(&l_output, "doubled", &l_doubled));
+    ATP_dictionaryDestroy(&l_output);
+    ATP_dictionaryDestroy(&l_input);
+    ATP_processorUnload(l_proc);
+    return l_doubled;
+}
+
+static void testProcessors(void)
+{
+    CHECK(ATP_cacheSetDirectory(c_scratch, c_ATP_Cache_defaultLimit));
+    CHECK(writeFile(c_inputFile, "first contents"));
+    ATP_processorsSetStatic(gs_processors, sizeof(gs_processors) / sizeof(gs_processors[0]));
+
+    // a cacheable processor runs once for the same name, parameters, input and files
+    gs_runs = 0;
+    CHECK(runWith("cacheable", "x", 1) == 2 && gs_runs == 1);
+    CHECK(runWith("cacheable", "x", 1) == 2 && gs_runs == 1);
+
+    // and again whenever any of them changes
+    CHECK(runWith("cacheable", "x", 2) == 4 && gs_runs == 2);
+    CHECK(runWith("cacheable", "y", 2) == 4 && gs_runs == 3);
+    CHECK(writeFile(c_inputFile, "other contents"));
+    CHECK(runWith("cacheable", "y", 2) == 4 && gs_runs == 4);
+    CHECK(runWith("cacheable", "y", 2) == 4 && gs_runs == 4);
+
+    // while a processor that does not declare itself cacheable runs every time
+    CHECK(runWith("uncached", "x", 1) == 2 && gs_runs == 5);
+    CHECK(runWith("uncached", "x", 1) == 2 && gs_runs == 6);
+
+    // as does one whose files cannot be read
+    remove(c_inputFile);
+    CHECK(runWith("cacheable", "z", 1) == 2 && gs_runs == 7);
+    CHECK(runWith("cacheable", "z", 1) == 2 && gs_runs == 8);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    removeScratch();
+
+    testKeys();
+    testStore();
+    testLimit();
+    testProcessors();
+
+    ATP_cacheSetDirectory(NULL, 0);
+    removeScratch();
+    remove(c_inputFile);
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All cache checks passed\n");
+    return EXIT_SUCCESS;
+}
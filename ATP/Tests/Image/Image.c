@@ -0,0 +1,308 @@
+#include "ATP/Library/Image.h"
+#include "ATP/Library/Cache.h"
+#include "ATP/Library/Dictionary.h"
+#include "ATP/Library/Array.h"
+#include "ATP/Library/Exit.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the number of images opened after changing a few random bytes of a valid one
+#define c_corruptions   2000
+// the length of the packed array, chosen to be easy to find in the image
+#define c_packedLength  1234
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+// a block aligned for an image, and the allocation it was taken from
+typedef struct Block
+{
+    char *m_data;
+    void *m_allocation;
+    size_t m_size;
+} Block;
+
+static void blockInit(Block *p_block, size_t p_size)
+{
+    p_block->m_allocation = malloc(p_size + c_ATP_Arena_alignment);
+    if (p_block->m_allocation == NULL)
+    {
+        PERR();
+        exit(EX_OSERR);
+    }
+    p_block->m_data = (char *) p_block->m_allocation
+                      + (c_ATP_Arena_alignment - (size_t) p_block->m_allocation % c_ATP_Arena_alignment) % c_ATP_Arena_alignment;
+    p_block->m_size = p_size;
+}
+
+static void releaseBlock(void *p_block, size_t p_size, void *p_token)
+{
+    unsigned int *l_releases = p_token;
+
+    // anything still pointing into the block is caught reading garbage
+    memset(p_block, 0xab, p_size);
+    ++*l_releases;
+}
+
+static void keyOf(const ATP_Dictionary *p_dict, ATP_CacheKey *p_key)
+{
+    ATP_cacheKeyInit(p_key);
+    ATP_cacheKeyAddDictionary(p_key, p_dict);
+}
+
+static void buildDictionary(ATP_Dictionary *p_dict)
+{
+    ATP_Dictionary l_nested;
+    ATP_Array l_packed;
+    ATP_Array l_objects;
+    unsigned int i;
+    char l_buffer[64];
+
+    ATP_dictionaryInit(p_dict);
+    ATP_dictionarySetString(p_dict, "short", "hi");
+    ATP_dictionarySetString(p_dict, "long", "a string that is much too long to be stored inline");
+    ATP_dictionarySetDouble(p_dict, "double", 3.25);
+    ATP_dictionarySetInt(p_dict, "int", -5);
+    ATP_dictionarySetBool(p_dict, "bool", 1);
+
+    ATP_dictionaryInit(&l_nested);
+    ATP_dictionarySetString(&l_nested, "inner", "a string long enough to live in the arena");
+    ATP_dictionarySetDict(p_dict, "nested", l_nested);
+    ATP_dictionaryInit(&l_nested);
+    ATP_dictionarySetDict(p_dict, "empty", l_nested);
+
+    ATP_arrayInit(&l_packed);
+    for (i = 0; i < c_packedLength; ++i)
+    {
+        ATP_arraySetUint(&l_packed, i, i * 7);
+    }
+    ATP_arrayPack(&l_packed, e_ATP_ValueType_uint);
+    ATP_dictionarySetArray(p_dict, "packed", l_packed);
+
+    ATP_arrayInit(&l_objects);
+    for (i = 0; i < 8; ++i)
+    {
+        ATP_dictionaryInit(&l_nested);
+        sprintf(l_buffer, "entry number %u, with a long name", i);
+        ATP_dictionarySetString(&l_nested, "name", l_buffer);
+        ATP_arraySetDict(&l_objects, i, l_nested);
+    }
+    ATP_arraySetString(&l_objects, 8, "last");
+    ATP_dictionarySetArray(p_dict, "objects", l_objects);
+
+    for (i = 0; i < 100; ++i)
+    {
+        sprintf(l_buffer, "key%u", i);
+        ATP_dictionarySetUint(p_dict, l_buffer, i);
+    }
+}
+
+// read everything in an opened image, so that anything the check let through is caught by a sanitizer
+static unsigned long long walkArray(const ATP_Array *p_array);
+
+static unsigned long long walkDictionary(const ATP_Dictionary *p_dict)
+{
+    ATP_DictionaryIterator l_iterator;
+    unsigned long long l_sum = 0;
+    unsigned long long l_absent = 0;
+
+    for (l_iterator = ATP_dictionaryBeginConst(p_dict); ATP_dictionaryHasNext(l_iterator);
+         l_iterator = ATP_dictionaryNext(l_iterator))
+    {
+        const char *l_key = ATP_dictionaryGetKey(l_iterator);
+        const ATP_Dictionary *l_dict = NULL;
+        const ATP_Array *l_array = NULL;
+        const char *l_string = NULL;
+        unsigned long long l_value = 0;
+
+        l_sum += strlen(l_key) + (ATP_dictionaryGetUint(p_dict, l_key, &l_value) ? l_value : 0);
+        if (ATP_dictionaryGetString(p_dict, l_key, &l_string))
+        {
+            l_sum += strlen(l_string);
+        }
+        if (ATP_dictionaryGetDictConst(p_dict, l_key, &l_dict))
+        {
+            l_sum += walkDictionary(l_dict);
+        }
+        if (ATP_dictionaryGetArrayConst(p_dict, l_key, &l_array))
+        {
+            l_sum += walkArray(l_array);
+        }
+    }
+    // looking up a key that is not there still reads the index
+    return l_sum + (ATP_dictionaryGetUint(p_dict, "absent", &l_absent) ? l_absent : 0);
+}
+
+static unsigned long long walkArray(const ATP_Array *p_array)
+{
+    unsigned long long l_sum = 0;
+    unsigned int i;
+
+    for (i = 0; i < ATP_arrayLength(p_array); ++i)
+    {
+        const ATP_Dictionary *l_dict = NULL;
+        const ATP_Array *l_array = NULL;
+        const char *l_string = NULL;
+        unsigned long long l_value = 0;
+
+        l_sum += ATP_arrayGetType(p_array, i) + (ATP_arrayGetUint(p_array, i, &l_value) ? l_value : 0);
+        if (ATP_arrayGetString(p_array, i, &l_string))
+        {
+            l_sum += strlen(l_string);
+        }
+        if (ATP_arrayGetDictConst(p_array, i, &l_dict))
+        {
+            l_sum += walkDictionary(l_dict);
+        }
+        if (ATP_arrayGetArrayConst(p_array, i, &l_array))
+        {
+            l_sum += walkArray(l_array);
+        }
+    }
+    return l_sum;
+}
+
+static void testRoundTrip(const ATP_Dictionary *p_dict)
+{
+    ATP_CacheKey l_expected;
+    ATP_CacheKey l_actual;
+    ATP_Dictionary l_opened;
+    ATP_Dictionary l_kept;
+    const ATP_Dictionary *l_nested = NULL;
+    const ATP_Array *l_packed = NULL;
+    unsigned long long l_value = 0;
+    unsigned int l_releases = 0;
+    Block l_block;
+
+    blockInit(&l_block, ATP_imageSize(p_dict));
+    ATP_imageWrite(p_dict, l_block.m_data);
+    CHECK(ATP_imageOpen(l_block.m_data, l_block.m_size, &releaseBlock, &l_releases, &l_opened));
+    CHECK(ATP_dictionaryIsFrozen(&l_opened));
+
+    keyOf(p_dict, &l_expected);
+    keyOf(&l_opened, &l_actual);
+    CHECK(memcmp(&l_expected, &l_actual, sizeof(ATP_CacheKey)) == 0);
+    CHECK(ATP_dictionaryCount(&l_opened) == ATP_dictionaryCount(p_dict));
+    CHECK(ATP_dictionaryCount(p_dict) == 0
+          || (ATP_dictionaryGetArrayConst(&l_opened, "packed", &l_packed)
+              && ATP_arrayGetPackedType(l_packed) == e_ATP_ValueType_uint && ATP_arrayLength(l_packed) == c_packedLength
+              && ATP_arrayGetUint(l_packed, c_packedLength - 1, &l_value) && l_value == (c_packedLength - 1) * 7));
+    CHECK(!ATP_dictionarySetUint(&l_opened, "added", 1));
+
+    // the block is given back only once nothing taken from the image is left
+    if (ATP_dictionaryGetDictConst(&l_opened, "nested", &l_nested))
+    {
+        l_kept = ATP_dictionaryDuplicate(l_nested);
+        ATP_dictionaryDestroy(&l_opened);
+        CHECK(l_releases == 0);
+        ATP_dictionaryDestroy(&l_kept);
+    }
+    else
+    {
+        ATP_dictionaryDestroy(&l_opened);
+    }
+    CHECK(l_releases == 1);
+    free(l_block.m_allocation);
+}
+
+static void testRejected(const ATP_Dictionary *p_dict)
+{
+    ATP_Dictionary l_opened;
+    Block l_image;
+    Block l_block;
+    size_t l_offset;
+    unsigned int l_found = 0;
+    unsigned int l_opens = 0;
+    unsigned int i;
+
+    blockInit(&l_image, ATP_imageSize(p_dict));
+    blockInit(&l_block, l_image.m_size);
+    ATP_imageWrite(p_dict, l_image.m_data);
+
+    LOG("The following errors about images are expected\n");
+    memcpy(l_block.m_data, l_image.m_data, l_image.m_size);
+    l_block.m_data[0] = 'X';
+    CHECK(!ATP_imageOpen(l_block.m_data, l_block.m_size, NULL, NULL, &l_opened));
+    memcpy(l_block.m_data, l_image.m_data, l_image.m_size);
+    CHECK(!ATP_imageOpen(l_block.m_data, l_block.m_size - 1, NULL, NULL, &l_opened));
+    CHECK(!ATP_imageOpen(l_block.m_data, 16, NULL, NULL, &l_opened));
+    CHECK(memcmp(l_block.m_data, l_image.m_data, l_image.m_size) == 0);
+
+    // a packed array whose length, with or without its capacity, runs far past the end of the image
+    for (l_offset = 0; l_offset + 2 * sizeof(unsigned int) <= l_image.m_size; l_offset += sizeof(unsigned int))
+    {
+        static const unsigned int c_huge = 100000000;
+        unsigned int l_length;
+        unsigned int l_capacity;
+
+        memcpy(&l_length, l_image.m_data + l_offset, sizeof(unsigned int));
+        memcpy(&l_capacity, l_image.m_data + l_offset + sizeof(unsigned int), sizeof(unsigned int));
+        if (l_length != c_packedLength || l_capacity != c_packedLength)
+        {
+            continue;
+        }
+
+        ++l_found;
+        memcpy(l_block.m_data, l_image.m_data, l_image.m_size);
+        memcpy(l_block.m_data + l_offset, &c_huge, sizeof(unsigned int));
+        CHECK(!ATP_imageOpen(l_block.m_data, l_block.m_size, NULL, NULL, &l_opened));
+        memcpy(l_block.m_data + l_offset + sizeof(unsigned int), &c_huge, sizeof(unsigned int));
+        CHECK(!ATP_imageOpen(l_block.m_data, l_block.m_size, NULL, NULL, &l_opened));
+    }
+    CHECK(l_found > 0);
+
+    // whatever a few changed bytes do, an image is either rejected or safe to read in full
+    srand(1);
+    for (i = 0; i < c_corruptions; ++i)
+    {
+        unsigned int l_changes = 1 + (unsigned int) rand() % 4;
+
+        memcpy(l_block.m_data, l_image.m_data, l_image.m_size);
+        while (l_changes-- > 0)
+        {
+            l_offset = (size_t) rand() % l_image.m_size;
+            l_block.m_data[l_offset] = (rand() % 2 == 0 ? (char) rand() : (char) (l_block.m_data[l_offset] ^ 1));
+        }
+        if (ATP_imageOpen(l_block.m_data, l_block.m_size, NULL, NULL, &l_opened))
+        {
+            walkDictionary(&l_opened);
+            ATP_dictionaryDestroy(&l_opened);
+            ++l_opens;
+        }
+    }
+    LOG("%u of %u changed images were opened and read\n", l_opens, c_corruptions);
+
+    free(l_image.m_allocation);
+    free(l_block.m_allocation);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_empty;
+
+    buildDictionary(&l_dict);
+    testRoundTrip(&l_dict);
+    ATP_dictionaryInit(&l_empty);
+    testRoundTrip(&l_empty);
+    ATP_dictionaryDestroy(&l_empty);
+
+    // an image of a tree that is already frozen is written from the tree as it is
+    ATP_dictionaryFreeze(&l_dict);
+    testRoundTrip(&l_dict);
+    testRejected(&l_dict);
+    ATP_dictionaryDestroy(&l_dict);
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All image checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+#include "ATP/Library/Parallel.h"
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/ThreadPool.h"
+#include "ATP/Library/Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// enough entries for every chunk to hold many of them
+#define c_entryCount    1000
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+// the instances loaded of each processor, and the entries the one that is not thread-safe has run on so far
+static unsigned int gs_squareLoads = 0;
+static unsigned int gs_sequenceLoads = 0;
+static unsigned long long gs_sequence = 0;
+
+static int runSquare(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    unsigned long long l_value;
+    int l_fail = 0;
+
+    ATP_dictionaryGetBool(p_input, "fail", &l_fail);
+    if (l_fail || !ATP_dictionaryGetUint(p_input, "x", &l_value))
+    {
+        return 0;
+    }
+    return ATP_dictionarySetUint(p_output, "x", l_value) && ATP_dictionarySetUint(p_output, "y", l_value * l_value);
+}
+
+// numbers the entries in the order it runs on them, which is only meaningful if it runs on one at a time
+static int runSequence(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    return ATP_dictionarySetUint(p_output, "sequence", gs_sequence++);
+}
+
+static int consumeStream(ATP_Dictionary *p_record, ATP_ProcessorSink *p_sink, void *p_token)
+{
+    return ATP_processorForwardRecord(p_sink, p_record);
+}
+
+static void unload(void *p_token)
+{
+}
+
+static int loadSquare(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    ++gs_squareLoads;
+    p_interface->run = &runSquare;
+    p_interface->unload = &unload;
+    p_interface->m_flags = c_ATP_ProcessorFlag_threadSafe;
+    return 1;
+}
+
+static int loadSequence(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    ++gs_sequenceLoads;
+    p_interface->run = &runSequence;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static int loadStream(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->consume = &consumeStream;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static ATP_StaticProcessor gs_processors[] =
+{
+    { "square", &loadSquare },
+    { "sequence", &loadSequence },
+    { "stream", &loadStream },
+};
+
+// build an input holding an array of entries numbered in order under "items", and another key for the processor to pass on
+static ATP_Dictionary makeInput(unsigned int p_count)
+{
+    ATP_Dictionary l_input;
+    ATP_Array l_items;
+    unsigned int i;
+
+    ATP_dictionaryInit(&l_input);
+    ATP_arrayInit(&l_items);
+    for (i = 0; i < p_count; ++i)
+    {
+        ATP_Dictionary l_entry;
+        ATP_dictionaryInit(&l_entry);
+        ATP_dictionarySetUint(&l_entry, "x", i);
+        ATP_arraySetDict(&l_items, i, l_entry);
+    }
+    ATP_dictionarySetArray(&l_input, "items", l_items);
+    ATP_dictionarySetString(&l_input, "other", "passed on");
+    return l_input;
+}
+
+// run a processor over a whole dictionary, returning whether it succeeded and keeping its output
+static int runOn(ATP_Processor *p_proc, ATP_Dictionary *p_input, ATP_Dictionary *p_output)
+{
+    ATP_dictionaryInit(p_output);
+    return ATP_processorRun(p_proc, 0, p_input, p_output);
+}
+
+static void testOrder(unsigned int p_threads, unsigned int p_instances)
+{
+    ATP_Processor *l_proc;
+    ATP_Dictionary l_input = makeInput(c_entryCount);
+    ATP_Dictionary l_output;
+    const ATP_Array *l_items = NULL;
+    const char *l_other = NULL;
+    unsigned int l_ordered = 0;
+    unsigned int i;
+
+    // a processor that is thread-safe gets an instance for each chunk
+    gs_squareLoads = 0;
+    l_proc = ATP_processorLoadParallel(0, "items", p_instances, "square", NULL);
+    CHECK(l_proc != NULL && gs_squareLoads == p_instances);
+    if (l_proc == NULL)
+    {
+        ATP_dictionaryDestroy(&l_input);
+        return;
+    }
+
+    // the outputs replace the entries in the same order, whatever the threads they ran on
+    CHECK(runOn(l_proc, &l_input, &l_output));
+    CHECK(ATP_dictionaryGetArrayConst(&l_output, "items", &l_items) && ATP_arrayLength(l_items) == c_entryCount);
+    for (i = 0; l_items != NULL && i < ATP_arrayLength(l_items); ++i)
+    {
+        const ATP_Dictionary *l_entry;
+        unsigned long long l_x = 0;
+        unsigned long long l_y = 0;
+        if (ATP_arrayGetDictConst(l_items, i, &l_entry) && ATP_dictionaryGetUint(l_entry, "x", &l_x)
+            && ATP_dictionaryGetUint(l_entry, "y", &l_y) && l_x == i && l_y == (unsigned long long) i * i)
+        {
+            ++l_ordered;
+        }
+    }
+    CHECK(l_ordered == c_entryCount);
+    CHECK(ATP_dictionaryGetString(&l_output, "other", &l_other) && strcmp(l_other, "passed on") == 0);
+    ATP_dictionaryDestroy(&l_output);
+    ATP_processorUnload(l_proc);
+
+    // one that is not gets a single instance, which runs on the entries one at a time and in order
+    gs_sequenceLoads = 0;
+    gs_sequence = 0;
+    l_proc = ATP_processorLoadParallel(0, "items", p_instances, "sequence", NULL);
+    CHECK(l_proc != NULL && gs_sequenceLoads == 1);
+    if (l_proc != NULL)
+    {
+        // the input is passed on to the output, so the first run has left nothing of it
+        ATP_dictionaryDestroy(&l_input);
+        l_input = makeInput(c_entryCount);
+        l_items = NULL;
+        l_ordered = 0;
+        CHECK(runOn(l_proc, &l_input, &l_output));
+        CHECK(ATP_dictionaryGetArrayConst(&l_output, "items", &l_items) && ATP_arrayLength(l_items) == c_entryCount);
+        for (i = 0; l_items != NULL && i < ATP_arrayLength(l_items); ++i)
+        {
+            const ATP_Dictionary *l_entry;
+            unsigned long long l_sequence = c_entryCount;
+            if (ATP_arrayGetDictConst(l_items, i, &l_entry) && ATP_dictionaryGetUint(l_entry, "sequence", &l_sequence)
+                && l_sequence == i)
+            {
+                ++l_ordered;
+            }
+        }
+        CHECK(l_ordered == c_entryCount);
+        ATP_dictionaryDestroy(&l_output);
+        ATP_processorUnload(l_proc);
+    }
+
+    ATP_dictionaryDestroy(&l_input);
+}
+
+static void testFailures(unsigned int p_instances)
+{
+    ATP_Processor *l_proc = ATP_processorLoadParallel(0, "items", p_instances, "square", NULL);
+    ATP_Dictionary l_input;
+    ATP_Dictionary l_output;
+    ATP_Dictionary *l_entry;
+    ATP_Array *l_items;
+    const ATP_Array *l_constItems;
+
+    CHECK(l_proc != NULL);
+    if (l_proc == NULL)
+    {
+        return;
+    }
+
+    // a single entry failing fails the whole run, in whichever chunk it is
+    l_input = makeInput(c_entryCount);
+    CHECK(ATP_dictionaryGetArray(&l_input, "items", &l_items) && ATP_arrayGetDict(l_items, c_entryCount - 1, &l_entry));
+    ATP_dictionarySetBool(l_entry, "fail", 1);
+    CHECK(!runOn(l_proc, &l_input, &l_output));
+    ATP_dictionaryDestroy(&l_output);
+    ATP_dictionaryDestroy(&l_input);
+
+    // as do an array that is missing or holds anything other than dictionaries
+    ATP_dictionaryInit(&l_input);
+    CHECK(!runOn(l_proc, &l_input, &l_output));
+    ATP_dictionaryDestroy(&l_output);
+    CHECK(ATP_dictionarySetString(&l_input, "items", "not an array"));
+    CHECK(!runOn(l_proc, &l_input, &l_output));
+    ATP_dictionaryDestroy(&l_output);
+    ATP_dictionaryDestroy(&l_input);
+
+    l_input = makeInput(4);
+    CHECK(ATP_dictionaryGetArray(&l_input, "items", &l_items) && ATP_arraySetUint(l_items, 2, 2));
+    CHECK(!runOn(l_proc, &l_input, &l_output));
+    ATP_dictionaryDestroy(&l_output);
+    ATP_dictionaryDestroy(&l_input);
+
+    // while an empty array is simply passed on
+    l_input = makeInput(0);
+    CHECK(runOn(l_proc, &l_input, &l_output));
+    CHECK(ATP_dictionaryGetArrayConst(&l_output, "items", &l_constItems) && ATP_arrayLength(l_constItems) == 0);
+    ATP_dictionaryDestroy(&l_output);
+    ATP_dictionaryDestroy(&l_input);
+
+    ATP_processorUnload(l_proc);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    static const unsigned int c_threads[] = { 1, 2, 4 };
+    static const unsigned int c_instances[] = { 1, 3, 8 };
+    unsigned int t;
+    unsigned int i;
+
+    ATP_processorsSetStatic(gs_processors, sizeof(gs_processors) / sizeof(gs_processors[0]));
+
+    // only processors that run on whole dictionaries can be wrapped
+    CHECK(ATP_processorLoadParallel(0, "items", 2, "stream", NULL) == NULL);
+    CHECK(ATP_processorLoadParallel(0, "items", 2, "missing", NULL) == NULL);
+
+    for (t = 0; t < sizeof(c_threads) / sizeof(c_threads[0]); ++t)
+    {
+        ATP_ThreadPool l_pool;
+        ATP_threadPoolInit(&l_pool, c_threads[t]);
+        ATP_threadPoolSetShared(&l_pool);
+        for (i = 0; i < sizeof(c_instances) / sizeof(c_instances[0]); ++i)
+        {
+            testOrder(c_threads[t], c_instances[i]);
+            testFailures(c_instances[i]);
+        }
+        ATP_threadPoolSetShared(NULL);
+        ATP_threadPoolDestroy(&l_pool);
+    }
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All parallel processor checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+#include "ATP/Library/Path.h"
+#include "ATP/Library/Dictionary.h"
+#include "ATP/Library/Array.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+static int compiles(const char *p_expression)
+{
+    ATP_Path l_path;
+    if (!ATP_pathCompile(&l_path, p_expression))
+    {
+        return 0;
+    }
+    ATP_pathDestroy(&l_path);
+    return 1;
+}
+
+static void testCompile(void)
+{
+    ATP_Path l_path;
+
+    CHECK(compiles("a"));
+    CHECK(compiles("a.b[3].c"));
+    CHECK(compiles("[0]") == 0);
+    CHECK(compiles("a\\.b\\[c"));
+    CHECK(compiles("") == 0);
+    CHECK(compiles("a..b") == 0);
+    CHECK(compiles("a[") == 0);
+    CHECK(compiles("a[x]") == 0);
+    CHECK(compiles("a]") == 0);
+    CHECK(compiles("a\\") == 0);
+
+    CHECK(ATP_pathCompile(&l_path, "a.*[*]"));
+    CHECK(ATP_pathIsWildcard(&l_path));
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.b[1]"));
+    CHECK(!ATP_pathIsWildcard(&l_path));
+    ATP_pathDestroy(&l_path);
+}
+
+static void testGetSet(void)
+{
+    ATP_Dictionary l_dict;
+    ATP_Path l_path;
+    ATP_Path l_escaped;
+    ATP_Path l_wildcard;
+    const char *l_string = NULL;
+    unsigned long long l_uint = 0;
+    const ATP_Array *l_array = NULL;
+
+    ATP_dictionaryInit(&l_dict);
+
+    // missing containers are created along the way, as dictionaries or arrays according to the segment that follows them
+    CHECK(ATP_pathCompile(&l_path, "a.b[0].c"));
+    CHECK(ATP_pathSetString(&l_path, &l_dict, "deep"));
+    CHECK(ATP_pathGetString(&l_path, &l_dict, &l_string) && strcmp(l_string, "deep") == 0);
+    CHECK(ATP_pathGetType(&l_path, &l_dict) == e_ATP_ValueType_string);
+    CHECK(!ATP_pathGetUint(&l_path, &l_dict, &l_uint));
+
+    // setting again replaces the value, whatever its type was
+    CHECK(ATP_pathSetUint(&l_path, &l_dict, 42));
+    CHECK(ATP_pathGetUint(&l_path, &l_dict, &l_uint) && l_uint == 42);
+    ATP_pathDestroy(&l_path);
+
+    // an index may append to an existing array
+    CHECK(ATP_pathCompile(&l_path, "a.b[1]"));
+    CHECK(ATP_pathSetUint(&l_path, &l_dict, 7));
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.b"));
+    CHECK(ATP_pathGetArrayConst(&l_path, &l_dict, &l_array) && ATP_arrayLength(l_array) == 2);
+    ATP_pathDestroy(&l_path);
+
+    // keys with escaped characters name entries as is
+    CHECK(ATP_pathCompile(&l_escaped, "x\\.y"));
+    CHECK(ATP_pathSetString(&l_escaped, &l_dict, "dotted"));
+    CHECK(ATP_dictionaryGetString(&l_dict, "x.y", &l_string) && strcmp(l_string, "dotted") == 0);
+    ATP_pathDestroy(&l_escaped);
+
+    // missing values are reported as such
+    CHECK(ATP_pathCompile(&l_path, "a.missing.c"));
+    CHECK(ATP_pathGetType(&l_path, &l_dict) == e_ATP_ValueType_none);
+    CHECK(!ATP_pathGetString(&l_path, &l_dict, &l_string));
+    ATP_pathDestroy(&l_path);
+
+    // wildcards can only be evaluated with ATP_pathForEach
+    CHECK(ATP_pathCompile(&l_wildcard, "a.b[*]"));
+    CHECK(ATP_pathGetType(&l_wildcard, &l_dict) == e_ATP_ValueType_none);
+    CHECK(!ATP_pathSetUint(&l_wildcard, &l_dict, 1));
+    ATP_pathDestroy(&l_wildcard);
+
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static int sumUints(const ATP_Value *p_value, void *p_context)
+{
+    unsigned long long l_value;
+    if (ATP_valueGetUint(p_value, &l_value))
+    {
+        *(unsigned long long *) p_context += l_value;
+    }
+    return 1;
+}
+
+static int stopAtFirst(const ATP_Value *p_value, void *p_context)
+{
+    return 0;
+}
+
+static void testForEach(void)
+{
+    ATP_Dictionary l_dict;
+    ATP_Path l_path;
+    ATP_Path l_set;
+    unsigned long long l_sum = 0;
+    unsigned int i;
+    char l_expression[32];
+
+    ATP_dictionaryInit(&l_dict);
+    for (i = 0; i < 3; ++i)
+    {
+        sprintf(l_expression, "k%u.v[%u]", i, 0);
+        CHECK(ATP_pathCompile(&l_set, l_expression));
+        CHECK(ATP_pathSetUint(&l_set, &l_dict, i + 1));
+        ATP_pathDestroy(&l_set);
+        sprintf(l_expression, "k%u.v[%u]", i, 1);
+        CHECK(ATP_pathCompile(&l_set, l_expression));
+        CHECK(ATP_pathSetUint(&l_set, &l_dict, 10 * (i + 1)));
+        ATP_pathDestroy(&l_set);
+    }
+    CHECK(ATP_dictionarySetString(&l_dict, "other", "not a dictionary"));
+
+    // every entry of every array under every key, skipping what does not match the shape of the path
+    CHECK(ATP_pathCompile(&l_path, "*.v[*]"));
+    CHECK(ATP_pathForEach(&l_path, &l_dict, sumUints, &l_sum) == 6);
+    CHECK(l_sum == 66);
+    CHECK(ATP_pathForEach(&l_path, &l_dict, stopAtFirst, NULL) == 1);
+    ATP_pathDestroy(&l_path);
+
+    // a path without wildcards visits at most one value
+    l_sum = 0;
+    CHECK(ATP_pathCompile(&l_path, "k1.v[1]"));
+    CHECK(ATP_pathForEach(&l_path, &l_dict, sumUints, &l_sum) == 1 && l_sum == 20);
+    ATP_pathDestroy(&l_path);
+
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static void testFailedSet(void)
+{
+    ATP_Dictionary l_dict;
+    ATP_Path l_path;
+    ATP_Dictionary l_value;
+
+    // an index past the end of an array that would be created fails without creating anything
+    ATP_dictionaryInit(&l_dict);
+    CHECK(ATP_pathCompile(&l_path, "a.b[2].c"));
+    CHECK(!ATP_pathSetString(&l_path, &l_dict, "never"));
+    CHECK(ATP_dictionaryCount(&l_dict) == 0);
+    ATP_pathDestroy(&l_path);
+
+    CHECK(ATP_pathCompile(&l_path, "a.b[2]"));
+    CHECK(!ATP_pathSetUint(&l_path, &l_dict, 1));
+    CHECK(ATP_dictionaryCount(&l_dict) == 0);
+    ATP_pathDestroy(&l_path);
+
+    // nor past the end of an existing one, or through a value of the wrong type
+    CHECK(ATP_pathCompile(&l_path, "a.b[0]"));
+    CHECK(ATP_pathSetUint(&l_path, &l_dict, 1));
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.b[5].c.d"));
+    CHECK(!ATP_pathSetUint(&l_path, &l_dict, 2));
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.b[0].c.d"));
+    CHECK(!ATP_pathSetUint(&l_path, &l_dict, 2));
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.new.b.c"));
+    CHECK(ATP_pathGetType(&l_path, &l_dict) == e_ATP_ValueType_none);
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_pathCompile(&l_path, "a.b[1]"));
+    CHECK(ATP_pathGetType(&l_path, &l_dict) == e_ATP_ValueType_none);
+    ATP_pathDestroy(&l_path);
+    CHECK(ATP_dictionaryCount(&l_dict) == 1);
+
+    // a frozen dictionary is never changed
+    ATP_dictionaryFreeze(&l_dict);
+    CHECK(ATP_pathCompile(&l_path, "z.y"));
+    CHECK(!ATP_pathSetUint(&l_path, &l_dict, 3));
+    CHECK(ATP_pathGetType(&l_path, &l_dict) == e_ATP_ValueType_none);
+    ATP_pathDestroy(&l_path);
+    ATP_dictionaryDestroy(&l_dict);
+
+    // setting a dictionary where it already is keeps a single reference to it
+    ATP_dictionaryInit(&l_dict);
+    ATP_dictionaryInit(&l_value);
+    CHECK(ATP_dictionarySetUint(&l_value, "n", 1));
+    CHECK(ATP_pathCompile(&l_path, "a.d"));
+    CHECK(ATP_pathSetDict(&l_path, &l_dict, ATP_dictionaryDuplicate(&l_value)));
+    CHECK(ATP_pathSetDict(&l_path, &l_dict, ATP_dictionaryDuplicate(&l_value)));
+    ATP_pathDestroy(&l_path);
+    ATP_dictionaryDestroy(&l_value);
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    testCompile();
+    testGetSet();
+    testForEach();
+    testFailedSet();
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All path checks passed\n");
+    return EXIT_SUCCESS;
+}
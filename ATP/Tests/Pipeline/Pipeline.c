@@ -0,0 +1,198 @@
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/Pipeline.h"
+#include "ATP/Library/ThreadPool.h"
+#include "ATP/Library/Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#if _WIN32
+    #include <windows.h>
+#else // NOTE: assume POSIX for now
+    #include <unistd.h>
+#endif
+
+// long enough that a stage which does not wait for the writer runs before it is done
+#define c_writeDelay    200
+#define c_maxThreads    4
+
+// set by the writer once its effect is complete, which every later stage that is not pure must see
+static volatile int gs_written = 0;
+static volatile int gs_early = 0;
+
+static void sleepFor(unsigned int p_milliseconds)
+{
+#if _WIN32
+    Sleep(p_milliseconds);
+#else // NOTE: assume POSIX for now
+    usleep(p_milliseconds * 1000);
+#endif
+}
+
+static void noteRead(const char *p_stage)
+{
+    if (!gs_written)
+    {
+        ERR("%s ran before the pass-through stage finished\n", p_stage);
+        gs_early = 1;
+    }
+}
+
+static int runSource(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    return ATP_dictionarySetUint(p_output, "value", 1);
+}
+
+static int runWriter(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    sleepFor(c_writeDelay);
+    gs_written = 1;
+    ATP_processorForward(p_input, p_output);
+    return 1;
+}
+
+static int runReader(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    noteRead("reader");
+    ATP_processorForward(p_input, p_output);
+    return 1;
+}
+
+static int runPure(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    ATP_processorForward(p_input, p_output);
+    return 1;
+}
+
+static int consumeStream(ATP_Dictionary *p_record, ATP_ProcessorSink *p_sink, void *p_token)
+{
+    noteRead("stream");
+    return ATP_processorForwardRecord(p_sink, p_record);
+}
+
+static void unload(void *p_token)
+{
+}
+
+static int loadSource(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runSource;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static int loadWriter(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runWriter;
+    p_interface->unload = &unload;
+    p_interface->m_flags = c_ATP_ProcessorFlag_passThrough;
+    return 1;
+}
+
+static int loadReader(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runReader;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static int loadPure(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runPure;
+    p_interface->unload = &unload;
+    p_interface->m_flags = c_ATP_ProcessorFlag_pure;
+    return 1;
+}
+
+static int loadStream(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->consume = &consumeStream;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static ATP_StaticProcessor gs_processors[] =
+{
+    { "source", &loadSource },
+    { "writer", &loadWriter },
+    { "reader", &loadReader },
+    { "pure", &loadPure },
+    { "stream", &loadStream },
+};
+
+// run a pipeline given as a list of stage names, in which "tee" and "from" tee off and branch from a stream named "copy"
+static int runPipeline(const char *p_stages, unsigned int p_threads)
+{
+    ATP_ThreadPool l_pool;
+    ATP_Pipeline l_pipeline;
+    char l_stages[128];
+    char *l_name;
+    unsigned int l_index = 0;
+    int l_result;
+
+    ATP_pipelineInit(&l_pipeline);
+    strcpy(l_stages, p_stages);
+    for (l_name = strtok(l_stages, " "); l_name != NULL; l_name = strtok(NULL, " "))
+    {
+        if (strcmp(l_name, "tee") == 0)
+        {
+            ATP_pipelineTee(&l_pipeline, "copy");
+        }
+        else if (strcmp(l_name, "from") == 0)
+        {
+            ATP_pipelineBranch(&l_pipeline, "copy");
+        }
+        else
+        {
+            ATP_pipelineAppend(&l_pipeline, ATP_processorLoad(l_index++, l_name, NULL));
+        }
+    }
+
+    gs_written = 0;
+    gs_early = 0;
+    ATP_threadPoolInit(&l_pool, p_threads);
+    ATP_threadPoolSetShared(&l_pool);
+    l_result = ATP_pipelineExecute(&l_pipeline, p_threads);
+    ATP_threadPoolSetShared(NULL);
+    ATP_threadPoolDestroy(&l_pool);
+    ATP_pipelineDestroy(&l_pipeline);
+
+    if (!l_result || gs_early || !gs_written)
+    {
+        ERR("'%s' failed on %u threads\n", p_stages, p_threads);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int p_argc, char **p_argv)
+{
+    static const char *const c_pipelines[] =
+    {
+        "source writer reader",
+        "source writer pure reader",
+        "source writer stream",
+        "source writer stream reader",
+        "source writer tee from reader",
+        "source pure writer pure writer reader",
+    };
+    unsigned int l_failures = 0;
+    unsigned int i;
+    unsigned int t;
+
+    ATP_processorsSetStatic(gs_processors, sizeof(gs_processors) / sizeof(gs_processors[0]));
+    for (i = 0; i < sizeof(c_pipelines) / sizeof(c_pipelines[0]); ++i)
+    {
+        for (t = 1; t <= c_maxThreads; ++t)
+        {
+            l_failures += !runPipeline(c_pipelines[i], t);
+        }
+    }
+
+    if (l_failures > 0)
+    {
+        ERR("%u pipelines failed\n", l_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All pass-through ordering checks passed\n");
+    return EXIT_SUCCESS;
+}
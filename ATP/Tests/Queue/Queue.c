@@ -0,0 +1,144 @@
+#include "ATP/Library/Queue.inc"
+#include "ATP/Library/Log.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// enough items for both threads to wrap around a small queue many times, blocking on it as they go
+#define c_itemCount     100000
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+// items are counted from 1, so that none of them is a null pointer
+#define ITEM(index)     ((void *) (uintptr_t) ((index) + 1))
+
+static unsigned int gs_failures = 0;
+
+static void testSingleThread(void)
+{
+    Queue l_queue;
+    void *l_item = NULL;
+    unsigned int i;
+
+    // the capacity is rounded up to 4, so that many items are taken without a consumer
+    Queue_init(&l_queue, 3);
+    for (i = 0; i < 4; ++i)
+    {
+        CHECK(Queue_push(&l_queue, ITEM(i)));
+    }
+    for (i = 0; i < 4; ++i)
+    {
+        CHECK(Queue_pop(&l_queue, &l_item) && l_item == ITEM(i));
+    }
+
+    // items pushed before the queue is closed can still be popped, but no more can be pushed
+    CHECK(Queue_push(&l_queue, ITEM(10)));
+    CHECK(Queue_push(&l_queue, ITEM(11)));
+    Queue_close(&l_queue);
+    Queue_close(&l_queue);
+    CHECK(!Queue_push(&l_queue, ITEM(12)));
+    CHECK(Queue_pop(&l_queue, &l_item) && l_item == ITEM(10));
+    CHECK(Queue_pop(&l_queue, &l_item) && l_item == ITEM(11));
+    CHECK(!Queue_pop(&l_queue, &l_item));
+    Queue_destroy(&l_queue);
+}
+
+typedef struct Transfer
+{
+    Queue *m_queue;
+    unsigned int m_count;
+    unsigned int m_result;
+} Transfer;
+
+static void produce(void *p_context)
+{
+    Transfer *l_transfer = p_context;
+    unsigned int i;
+
+    for (i = 0; i < l_transfer->m_count && Queue_push(l_transfer->m_queue, ITEM(i)); ++i)
+    {
+    }
+    l_transfer->m_result = i;
+    Queue_close(l_transfer->m_queue);
+}
+
+static void consume(void *p_context)
+{
+    Transfer *l_transfer = p_context;
+    unsigned int l_count = 0;
+    void *l_item;
+
+    // counts only the items that arrive in the order they were pushed
+    while (Queue_pop(l_transfer->m_queue, &l_item))
+    {
+        if (l_item == ITEM(l_count))
+        {
+            ++l_count;
+        }
+    }
+    l_transfer->m_result = l_count;
+}
+
+static void testTwoThreads(void)
+{
+    Queue l_queue;
+    Transfer l_producer = { &l_queue, c_itemCount, 0 };
+    Transfer l_consumer = { &l_queue, 0, 0 };
+    Thread l_threads[2];
+
+    // every item arrives once and in order, with both threads waiting on the other through a queue of two
+    Queue_init(&l_queue, 2);
+    Thread_start(&l_threads[0], consume, &l_consumer);
+    Thread_start(&l_threads[1], produce, &l_producer);
+    Thread_join(&l_threads[1]);
+    Thread_join(&l_threads[0]);
+    CHECK(l_producer.m_result == c_itemCount);
+    CHECK(l_consumer.m_result == c_itemCount);
+    Queue_destroy(&l_queue);
+}
+
+static void testCloseWakes(void)
+{
+    Queue l_queue;
+    Transfer l_transfer = { &l_queue, 0, 1 };
+    Thread l_thread;
+    void *l_item;
+
+    // a consumer waiting on an empty queue gives up once it is closed
+    Queue_init(&l_queue, 2);
+    Thread_start(&l_thread, consume, &l_transfer);
+    Queue_close(&l_queue);
+    Thread_join(&l_thread);
+    CHECK(l_transfer.m_result == 0);
+    Queue_destroy(&l_queue);
+
+    // as does a producer waiting on a full one, and the items it had pushed are left for the consumer
+    Queue_init(&l_queue, 2);
+    l_transfer.m_count = 10;
+    l_transfer.m_result = 0;
+    Thread_start(&l_thread, produce, &l_transfer);
+    CHECK(Queue_pop(&l_queue, &l_item) && l_item == ITEM(0));
+    Queue_close(&l_queue);
+    Thread_join(&l_thread);
+    CHECK(l_transfer.m_result >= 1 && l_transfer.m_result < 10);
+    while (Queue_pop(&l_queue, &l_item))
+    {
+    }
+    Queue_destroy(&l_queue);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    testSingleThread();
+    testTwoThreads();
+    testCloseWakes();
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All queue checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,2 @@
+// the queue is internal to the library, so the test is built with a copy of its own
+#include "ATP/Library/Queue.c"
@@ -0,0 +1,2 @@
+// as are the threads the queue is built on
+#include "ATP/Library/Thread.c"
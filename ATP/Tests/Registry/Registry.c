@@ -0,0 +1,304 @@
+#include "ATP/Library/Processor.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if _WIN32
+    #include <direct.h>
+    #include <io.h>
+#else // NOTE: assume POSIX for now
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// the registry functions are only declared for the executable
+extern int ATP_processorsWriteIndex(const char *p_file);
+extern void ATP_processorsRelease(void);
+extern void ATP_processorsList(void);
+
+// the processors are empty files, which are found on the search path but cannot be opened, in a scratch directory of the
+// current one
+#define c_scratch       "RegistryScratch"
+#define c_listing       c_scratch "/listing"
+#define c_manifest      c_scratch "/manifest"
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+static const char *const c_files[] =
+{
+    c_scratch "/first/alpha.processor",
+    c_scratch "/first/beta.processor",
+    c_scratch "/first/notes.txt",
+    c_scratch "/second/alpha.processor",
+    c_scratch "/second/gamma.processor",
+};
+
+static const char *const c_dirs[] =
+{
+    c_scratch,
+    c_scratch "/first",
+    c_scratch "/second",
+};
+
+static int runBuiltin(unsigned int p_count, ATP_Dictionary *p_input, ATP_Dictionary *p_output, void *p_token)
+{
+    return 1;
+}
+
+static void unload(void *p_token)
+{
+}
+
+static int loadBuiltin(unsigned int p_index, const ATP_Array *p_parameters, ATP_ProcessorInterface *p_interface)
+{
+    p_interface->run = &runBuiltin;
+    p_interface->unload = &unload;
+    return 1;
+}
+
+static ATP_StaticProcessor gs_processors[] =
+{
+    { "builtin", &loadBuiltin },
+    { "alpha", &loadBuiltin },
+};
+
+static void setVariable(const char *p_name, const char *p_value)
+{
+#if _WIN32
+    _putenv_s(p_name, (p_value != NULL ? p_value : ""));
+#else // NOTE: assume POSIX for now
+    if (p_value != NULL)
+    {
+        setenv(p_name, p_value, 1);
+    }
+    else
+    {
+        unsetenv(p_name);
+    }
+#endif
+}
+
+static int writeFile(const char *p_file, const char *p_contents)
+{
+    FILE *l_file = fopen(p_file, "w");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+    fputs(p_contents, l_file);
+    return (fclose(l_file) == 0);
+}
+
+// read a file into a buffer, as a string
+static int readFile(const char *p_file, char *p_buffer, size_t p_size)
+{
+    size_t l_length;
+    FILE *l_file = fopen(p_file, "r");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+    l_length = fread(p_buffer, 1, p_size - 1, l_file);
+    p_buffer[l_length] = '\0';
+    fclose(l_file);
+    return 1;
+}
+
+// list the processors in the registry into a buffer, by sending the output of the listing to a file for the time being
+static void listProcessors(char *p_buffer, size_t p_size)
+{
+    FILE *l_listing;
+    int l_stdout;
+
+    fflush(stdout);
+#if _WIN32
+    l_stdout = _dup(_fileno(stdout));
+#else // NOTE: assume POSIX for now
+    l_stdout = dup(fileno(stdout));
+#endif
+    l_listing = fopen(c_listing, "w");
+    CHECK(l_stdout >= 0 && l_listing != NULL);
+    if (l_stdout < 0 || l_listing == NULL)
+    {
+        p_buffer[0] = '\0';
+        return;
+    }
+
+#if _WIN32
+    _dup2(_fileno(l_listing), _fileno(stdout));
+    ATP_processorsList();
+    fflush(stdout);
+    _dup2(l_stdout, _fileno(stdout));
+    _close(l_stdout);
+#else // NOTE: assume POSIX for now
+    dup2(fileno(l_listing), fileno(stdout));
+    ATP_processorsList();
+    fflush(stdout);
+    dup2(l_stdout, fileno(stdout));
+    close(l_stdout);
+#endif
+    fclose(l_listing);
+
+    CHECK(readFile(c_listing, p_buffer, p_size));
+}
+
+// count the lines of a buffer that end with the given text, after any indentation
+static unsigned int countLines(const char *p_buffer, const char *p_text)
+{
+    unsigned int l_count = 0;
+    size_t l_length = strlen(p_text);
+    const char *l_line = p_buffer;
+
+    while (*l_line != '\0')
+    {
+        const char *l_end = strchr(l_line, '\n');
+        size_t l_lineLength = (l_end != NULL ? (size_t) (l_end - l_line) : strlen(l_line));
+        if (l_lineLength >= l_length && strncmp(l_line + l_lineLength - l_length, p_text, l_length) == 0)
+        {
+            ++l_count;
+        }
+        l_line += l_lineLength + (l_end != NULL ? 1 : 0);
+    }
+
+    return l_count;
+}
+
+static void testIndex(void)
+{
+    char l_buffer[4096];
+
+    // every processor on the search path is indexed once, as found in the first directory that has it
+    CHECK(ATP_processorsWriteIndex(c_manifest));
+    CHECK(readFile(c_manifest, l_buffer, sizeof(l_buffer)));
+    CHECK(countLines(l_buffer, "\t" c_scratch "/first/alpha.processor") == 1);
+    CHECK(countLines(l_buffer, "\t" c_scratch "/second/alpha.processor") == 0);
+    CHECK(countLines(l_buffer, "\t" c_scratch "/first/beta.processor") == 1);
+    CHECK(countLines(l_buffer, "\t" c_scratch "/second/gamma.processor") == 1);
+    CHECK(strstr(l_buffer, "notes") == NULL);
+    CHECK(strncmp(l_buffer, "alpha\t", 6) == 0 || strstr(l_buffer, "\nalpha\t") != NULL);
+
+    CHECK(!ATP_processorsWriteIndex(c_scratch "/missing/manifest"));
+}
+
+static void testSearch(void)
+{
+    char l_buffer[4096];
+    ATP_Processor *l_proc;
+
+    // without a manifest the search path is scanned, and a processor shadowed by an earlier directory is not listed
+    listProcessors(l_buffer, sizeof(l_buffer));
+    CHECK(countLines(l_buffer, "    " c_scratch "/first:") == 1);
+    CHECK(countLines(l_buffer, "    " c_scratch "/second:") == 1);
+    CHECK(countLines(l_buffer, "        alpha") == 1);
+    CHECK(countLines(l_buffer, "        gamma") == 1);
+    CHECK(countLines(l_buffer, "    builtin") == 1);
+
+    // a library that cannot be opened gives way to a built-in processor of the same name, time and again
+    l_proc = ATP_processorLoad(0, "alpha", NULL);
+    CHECK(l_proc != NULL);
+    ATP_processorUnload(l_proc);
+    l_proc = ATP_processorLoad(0, "alpha", NULL);
+    CHECK(l_proc != NULL);
+    ATP_processorUnload(l_proc);
+    CHECK(ATP_processorLoad(0, "beta", NULL) == NULL);
+
+    ATP_processorsRelease();
+}
+
+static void testManifest(void)
+{
+    char l_buffer[4096];
+    ATP_Processor *l_proc;
+
+    // a manifest replaces the search path entirely
+    CHECK(writeFile(c_manifest, "delta\t" c_scratch "/elsewhere/delta.processor\n"
+                                "\n"
+                                "malformed line\n"
+                                "\tnameless.processor\n"));
+    setVariable("ATP_PROCESSOR_MANIFEST", c_manifest);
+    listProcessors(l_buffer, sizeof(l_buffer));
+    CHECK(countLines(l_buffer, "    " c_scratch "/elsewhere:") == 1);
+    CHECK(countLines(l_buffer, "        delta") == 1);
+    CHECK(countLines(l_buffer, "        alpha") == 0);
+    CHECK(strstr(l_buffer, "malformed") == NULL && strstr(l_buffer, "nameless") == NULL);
+
+    // it is read once, until the registry is released
+    CHECK(remove(c_manifest) == 0);
+    listProcessors(l_buffer, sizeof(l_buffer));
+    CHECK(countLines(l_buffer, "        delta") == 1);
+
+    l_proc = ATP_processorLoad(0, "builtin", NULL);
+    CHECK(l_proc != NULL);
+    ATP_processorUnload(l_proc);
+    ATP_processorsRelease();
+
+    // and a manifest that cannot be read falls back to the search path
+    listProcessors(l_buffer, sizeof(l_buffer));
+    CHECK(countLines(l_buffer, "        delta") == 0);
+    CHECK(countLines(l_buffer, "        alpha") == 1);
+    ATP_processorsRelease();
+
+    setVariable("ATP_PROCESSOR_MANIFEST", NULL);
+}
+
+static int makeDirectory(const char *p_dir)
+{
+#if _WIN32
+    return (_mkdir(p_dir) == 0);
+#else // NOTE: assume POSIX for now
+    return (mkdir(p_dir, 0755) == 0);
+#endif
+}
+
+static void removeDirectory(const char *p_dir)
+{
+#if _WIN32
+    _rmdir(p_dir);
+#else // NOTE: assume POSIX for now
+    rmdir(p_dir);
+#endif
+}
+
+int main(int p_argc, char **p_argv)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(c_dirs) / sizeof(c_dirs[0]); ++i)
+    {
+        CHECK(makeDirectory(c_dirs[i]));
+    }
+    for (i = 0; i < sizeof(c_files) / sizeof(c_files[0]); ++i)
+    {
+        CHECK(writeFile(c_files[i], ""));
+    }
+    setVariable("ATP_PROCESSOR_PATH", c_scratch "/first:" c_scratch "/second");
+    setVariable("ATP_PROCESSOR_MANIFEST", NULL);
+    ATP_processorsSetStatic(gs_processors, sizeof(gs_processors) / sizeof(gs_processors[0]));
+
+    testIndex();
+    testSearch();
+    testManifest();
+
+    for (i = 0; i < sizeof(c_files) / sizeof(c_files[0]); ++i)
+    {
+        remove(c_files[i]);
+    }
+    remove(c_listing);
+    remove(c_manifest);
+    for (i = sizeof(c_dirs) / sizeof(c_dirs[0]); i > 0; --i)
+    {
+        removeDirectory(c_dirs[i - 1]);
+    }
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All processor registry checks passed\n");
+    return EXIT_SUCCESS;
+}
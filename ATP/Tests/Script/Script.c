@@ -0,0 +1,207 @@
+#include "ATP/Executable/Script.h"
+#include "ATP/Library/ThreadPool.h"
+#include "ATP/Library/Exit.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if _WIN32
+    #include <io.h>
+#else // NOTE: assume POSIX for now
+    #include <unistd.h>
+#endif
+
+// scripts and the errors printed while running them go in files of the current directory
+#define c_script        "ScriptTest.atp"
+#define c_errors        "ScriptTest.err"
+#define c_maxJobs       8
+#define c_maxThreads    4
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+// the command line each pipeline was run with, in the slot given by its first parameter
+static char gs_commands[c_maxJobs][256];
+
+static int writeFile(const char *p_file, const char *p_contents)
+{
+    FILE *l_file = fopen(p_file, "wb");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+    fputs(p_contents, l_file);
+    return (fclose(l_file) == 0);
+}
+
+static int readFile(const char *p_file, char *p_buffer, size_t p_size)
+{
+    size_t l_length;
+    FILE *l_file = fopen(p_file, "r");
+    if (l_file == NULL)
+    {
+        return 0;
+    }
+    l_length = fread(p_buffer, 1, p_size - 1, l_file);
+    p_buffer[l_length] = '\0';
+    fclose(l_file);
+    return 1;
+}
+
+/*
+Record the parameters of a pipeline as a single string, each enclosed in brackets, in the slot named by its first parameter.
+Pipelines of a processor named @fail fail with a status given by their second parameter.
+*/
+static int record(int argc, char **argv)
+{
+    int i;
+    unsigned int l_slot = (argc > 2 ? (unsigned int) atoi(argv[2]) : 0);
+    char *l_command;
+
+    if (l_slot >= c_maxJobs || strcmp(argv[0], c_script) != 0)
+    {
+        return EX_SOFTWARE;
+    }
+
+    l_command = gs_commands[l_slot];
+    l_command[0] = '\0';
+    for (i = 1; i < argc; ++i)
+    {
+        strcat(l_command, "[");
+        strcat(l_command, argv[i]);
+        strcat(l_command, "]");
+    }
+
+    return (strcmp(argv[1], "@fail") == 0 && argc > 3 ? atoi(argv[3]) : EX_OK);
+}
+
+// run a script, keeping what it printed to stderr
+static int runScript(const char *p_contents, ATP_ThreadPool *p_pool, char *p_errors, size_t p_size)
+{
+    FILE *l_errors;
+    int l_stderr;
+    int l_status;
+
+    memset(gs_commands, 0, sizeof(gs_commands));
+    CHECK(writeFile(c_script, p_contents));
+
+    fflush(stderr);
+#if _WIN32
+    l_stderr = _dup(_fileno(stderr));
+#else // NOTE: assume POSIX for now
+    l_stderr = dup(fileno(stderr));
+#endif
+    l_errors = fopen(c_errors, "w");
+    if (l_stderr < 0 || l_errors == NULL)
+    {
+        CHECK(!"stderr can be redirected");
+        return -1;
+    }
+
+#if _WIN32
+    _dup2(_fileno(l_errors), _fileno(stderr));
+    l_status = scriptRun(c_script, p_pool, &record);
+    fflush(stderr);
+    _dup2(l_stderr, _fileno(stderr));
+    _close(l_stderr);
+#else // NOTE: assume POSIX for now
+    dup2(fileno(l_errors), fileno(stderr));
+    l_status = scriptRun(c_script, p_pool, &record);
+    fflush(stderr);
+    dup2(l_stderr, fileno(stderr));
+    close(l_stderr);
+#endif
+    fclose(l_errors);
+
+    CHECK(readFile(c_errors, p_errors, p_size));
+    return l_status;
+}
+
+static void testParsing(ATP_ThreadPool *p_pool)
+{
+    char l_errors[4096];
+
+    // comments and blank lines are skipped, and quotes and escapes are taken apart as on the command line
+    CHECK(runScript("# a comment\n"
+                    "\n"
+                    "   \t\n"
+                    "@job 0 plain\n"
+                    "  @job 1 'single \"quoted\" \\n' \"double \\\"quoted\\\"\" split\\ word\r\n"
+                    "@job 2 ''\n"
+                    "@job 3", p_pool, l_errors, sizeof(l_errors)) == EX_OK);
+    CHECK(strcmp(gs_commands[0], "[@job][0][plain]") == 0);
+    CHECK(strcmp(gs_commands[1], "[@job][1][single \"quoted\" \\n][double \"quoted\"][split word]") == 0);
+    CHECK(strcmp(gs_commands[2], "[@job][2][]") == 0);
+    CHECK(strcmp(gs_commands[3], "[@job][3]") == 0);
+    CHECK(l_errors[0] == '\0');
+}
+
+static void testLineErrors(ATP_ThreadPool *p_pool)
+{
+    char l_errors[4096];
+
+    // an error in any line is reported with its number, and nothing in the script is run
+    CHECK(runScript("@job 0\n"
+                    "# a comment\n"
+                    "\n"
+                    "@job 1 'unterminated\n"
+                    "@job 2\n", p_pool, l_errors, sizeof(l_errors)) == EX_DATAERR);
+    CHECK(strstr(l_errors, c_script ":4: unterminated quote") != NULL);
+    CHECK(gs_commands[0][0] == '\0' && gs_commands[2][0] == '\0');
+
+    CHECK(runScript("@job 0\n"
+                    "job 1\n", p_pool, l_errors, sizeof(l_errors)) == EX_DATAERR);
+    CHECK(strstr(l_errors, c_script ":2: a pipeline must start with a processor, not 'job'") != NULL);
+    CHECK(gs_commands[0][0] == '\0');
+
+    // a script that cannot be read is reported as missing
+    remove(c_script);
+    CHECK(scriptRun(c_script, p_pool, &record) == EX_NOINPUT);
+}
+
+static void testFailures(ATP_ThreadPool *p_pool)
+{
+    char l_errors[4096];
+    const char *l_first;
+    const char *l_second;
+
+    // every pipeline runs, and those that fail are reported in the order of the script, with the status of the first
+    CHECK(runScript("@job 0\n"
+                    "\n"
+                    "@fail 1 70\n"
+                    "@job 2\n"
+                    "@fail 3 65\n", p_pool, l_errors, sizeof(l_errors)) == 70);
+    CHECK(gs_commands[0][0] != '\0' && gs_commands[1][0] != '\0' && gs_commands[2][0] != '\0' && gs_commands[3][0] != '\0');
+    l_first = strstr(l_errors, c_script ":3: pipeline failed");
+    l_second = strstr(l_errors, c_script ":5: pipeline failed");
+    CHECK(l_first != NULL && l_second != NULL && l_first < l_second);
+    CHECK(strstr(l_errors, c_script ":1:") == NULL && strstr(l_errors, c_script ":4:") == NULL);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    unsigned int t;
+
+    for (t = 1; t <= c_maxThreads; ++t)
+    {
+        ATP_ThreadPool l_pool;
+        ATP_threadPoolInit(&l_pool, t);
+        testParsing(&l_pool);
+        testLineErrors(&l_pool);
+        testFailures(&l_pool);
+        ATP_threadPoolDestroy(&l_pool);
+    }
+    remove(c_script);
+    remove(c_errors);
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All script checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,2 @@
+// scripts are read by the executable rather than the library, so the test is built with its own copy of the reader
+#include "ATP/Executable/Script.c"
@@ -0,0 +1,194 @@
+#include "ATP/Library/ThreadPool.h"
+#include "ATP/Library/Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// tasks and indices are counted in slots of their own, so that no two threads ever write to the same one
+#define c_rangeBegin    3
+#define c_rangeEnd      10003
+#define c_taskCount     200
+#define c_subtaskCount  16
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+static unsigned char gs_hits[c_rangeEnd + 1];
+static unsigned char gs_tasks[c_taskCount];
+static unsigned char gs_subtasks[c_taskCount][c_subtaskCount];
+
+typedef struct Subtask
+{
+    unsigned char *m_slot;
+} Subtask;
+
+static void countRange(unsigned int p_begin, unsigned int p_end, void *p_context)
+{
+    unsigned int i;
+    for (i = p_begin; i < p_end; ++i)
+    {
+        ++gs_hits[i];
+    }
+}
+
+static void countTask(void *p_context)
+{
+    ++*(unsigned char *) p_context;
+}
+
+// a task that waits for tasks of its own, which must not tie up the workers the tasks need
+static void nestedTask(void *p_context)
+{
+    ATP_TaskGroup l_group;
+    unsigned char *l_slots = p_context;
+    unsigned int i;
+
+    ATP_taskGroupInit(&l_group, ATP_threadPoolShared());
+    for (i = 0; i < c_subtaskCount; ++i)
+    {
+        ATP_taskGroupRun(&l_group, countTask, &l_slots[i]);
+    }
+    ATP_taskGroupWait(&l_group);
+    for (i = 0; i < c_subtaskCount; ++i)
+    {
+        CHECK(l_slots[i] == 1);
+    }
+    ATP_taskGroupDestroy(&l_group);
+}
+
+static int countedOnce(const unsigned char *p_slots, unsigned int p_count)
+{
+    unsigned int i;
+    for (i = 0; i < p_count; ++i)
+    {
+        if (p_slots[i] != 1)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void testFor(ATP_ThreadPool *p_pool)
+{
+    static const unsigned int c_grains[] = { 0, 1, 7, 1000, c_rangeEnd };
+    unsigned int g;
+
+    // every index of the range is visited once whatever the size of the parts, and none outside it
+    for (g = 0; g < sizeof(c_grains) / sizeof(c_grains[0]); ++g)
+    {
+        memset(gs_hits, 0, sizeof(gs_hits));
+        ATP_threadPoolFor(p_pool, c_rangeBegin, c_rangeEnd, c_grains[g], countRange, NULL);
+        CHECK(gs_hits[c_rangeBegin - 1] == 0 && gs_hits[c_rangeEnd] == 0);
+        CHECK(countedOnce(gs_hits + c_rangeBegin, c_rangeEnd - c_rangeBegin));
+    }
+
+    // an empty range runs nothing
+    memset(gs_hits, 0, sizeof(gs_hits));
+    ATP_threadPoolFor(p_pool, c_rangeBegin, c_rangeBegin, 0, countRange, NULL);
+    CHECK(gs_hits[c_rangeBegin] == 0);
+}
+
+static void testGroups(ATP_ThreadPool *p_pool)
+{
+    ATP_TaskGroup l_group;
+    unsigned int i;
+
+    // every task queued so far is done once the group is waited for, and the group can be used again afterwards
+    memset(gs_tasks, 0, sizeof(gs_tasks));
+    ATP_taskGroupInit(&l_group, p_pool);
+    for (i = 0; i < c_taskCount / 2; ++i)
+    {
+        ATP_taskGroupRun(&l_group, countTask, &gs_tasks[i]);
+    }
+    ATP_taskGroupWait(&l_group);
+    CHECK(countedOnce(gs_tasks, c_taskCount / 2));
+    for (i = c_taskCount / 2; i < c_taskCount; ++i)
+    {
+        ATP_taskGroupRun(&l_group, countTask, &gs_tasks[i]);
+    }
+    ATP_taskGroupWait(&l_group);
+    CHECK(countedOnce(gs_tasks, c_taskCount));
+
+    // waiting for a group with nothing left in it returns at once
+    ATP_taskGroupWait(&l_group);
+    ATP_taskGroupDestroy(&l_group);
+
+    // tasks may wait for tasks of their own, with far more of them than there are threads
+    memset(gs_subtasks, 0, sizeof(gs_subtasks));
+    ATP_threadPoolSetShared(p_pool);
+    ATP_taskGroupInit(&l_group, p_pool);
+    for (i = 0; i < c_taskCount; ++i)
+    {
+        ATP_taskGroupRun(&l_group, nestedTask, gs_subtasks[i]);
+    }
+    ATP_taskGroupDestroy(&l_group);
+    ATP_threadPoolSetShared(NULL);
+    CHECK(countedOnce(&gs_subtasks[0][0], c_taskCount * c_subtaskCount));
+}
+
+static void testPool(unsigned int p_threads)
+{
+    ATP_ThreadPool l_pool;
+    unsigned int i;
+
+    ATP_threadPoolInit(&l_pool, p_threads);
+    CHECK(ATP_threadPoolSize(&l_pool) == p_threads || (p_threads == 0 && ATP_threadPoolSize(&l_pool) >= 1));
+
+    ATP_threadPoolSetShared(&l_pool);
+    CHECK(ATP_threadPoolShared() != NULL && *ATP_threadPoolShared() == l_pool);
+    ATP_threadPoolSetShared(NULL);
+    CHECK(ATP_threadPoolShared() != NULL && *ATP_threadPoolShared() == NULL);
+
+    testFor(&l_pool);
+    testGroups(&l_pool);
+
+    // destroying the pool waits for the tasks that nothing else waits for
+    memset(gs_tasks, 0, sizeof(gs_tasks));
+    for (i = 0; i < c_taskCount; ++i)
+    {
+        ATP_threadPoolSubmit(&l_pool, countTask, &gs_tasks[i]);
+    }
+    ATP_threadPoolDestroy(&l_pool);
+    CHECK(countedOnce(gs_tasks, c_taskCount));
+}
+
+static void testNoPool(void)
+{
+    ATP_TaskGroup l_group;
+    unsigned char l_slot = 0;
+
+    // without a pool everything runs on the calling thread, as soon as it is queued
+    CHECK(ATP_threadPoolSize(NULL) == 1);
+    ATP_threadPoolSubmit(NULL, countTask, &l_slot);
+    CHECK(l_slot == 1);
+    ATP_taskGroupInit(&l_group, NULL);
+    ATP_taskGroupRun(&l_group, countTask, &l_slot);
+    CHECK(l_slot == 2);
+    ATP_taskGroupDestroy(&l_group);
+
+    testFor(NULL);
+    testGroups(NULL);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    static const unsigned int c_threads[] = { 1, 2, 4, 0 };
+    unsigned int i;
+
+    testNoPool();
+    for (i = 0; i < sizeof(c_threads) / sizeof(c_threads[0]); ++i)
+    {
+        testPool(c_threads[i]);
+    }
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All thread pool checks passed\n");
+    return EXIT_SUCCESS;
+}
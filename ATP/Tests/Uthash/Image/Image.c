@@ -0,0 +1 @@
+#include "ATP/Tests/Image/Image.c"
@@ -0,0 +1 @@
+#include "ATP/Library/Arena.c"
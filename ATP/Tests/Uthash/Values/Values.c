@@ -0,0 +1 @@
+#include "ATP/Tests/Values/Values.c"
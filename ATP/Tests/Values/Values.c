@@ -0,0 +1,524 @@
+#include "ATP/Library/Dictionary.h"
+#include "ATP/Library/Array.h"
+#include "ATP/Library/Arena.h"
+#include "ATP/Library/Log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// enough keys for the tables to grow several times, and for the perfect hash to need more than a few seeds
+#define c_manyKeys  5000
+
+// a failed check is reported with its location, and the remaining checks still run
+#define CHECK(condition)    do { if (!(condition)) { ERR("check failed: %s\n", #condition); ++gs_failures; } } while (0)
+
+static unsigned int gs_failures = 0;
+
+static void testArena(void)
+{
+    ATP_Arena *l_arena = ATP_arenaCreate(256);
+    ATP_Arena *l_other = ATP_arenaCreate(256);
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_copy;
+    const char *l_string = NULL;
+    unsigned int i;
+    char l_key[32];
+    char l_value[64];
+
+    // more than fits in one chunk, so the arena has to chain several
+    ATP_dictionaryInitInArena(&l_dict, l_arena);
+    CHECK(ATP_dictionaryGetArena(&l_dict) == l_arena);
+    for (i = 0; i < 200; ++i)
+    {
+        sprintf(l_key, "key%u", i);
+        sprintf(l_value, "a value long enough to be allocated, number %u", i);
+        CHECK(ATP_dictionarySetString(&l_dict, l_key, l_value));
+    }
+
+    // a copy made in another arena keeps the contents after the first arena is gone
+    l_copy = ATP_dictionaryDuplicateInArena(&l_dict, l_other);
+    ATP_dictionaryDestroy(&l_dict);
+    ATP_arenaRelease(l_arena);
+    CHECK(ATP_dictionaryGetArena(&l_copy) == l_other);
+    CHECK(ATP_dictionaryGetString(&l_copy, "key199", &l_string)
+          && strcmp(l_string, "a value long enough to be allocated, number 199") == 0);
+    ATP_dictionaryDestroy(&l_copy);
+    ATP_arenaRelease(l_other);
+}
+
+static void testArenaTree(void)
+{
+    ATP_Arena *l_arena = ATP_arenaCreate(0);
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_nested;
+    ATP_Dictionary *l_child = NULL;
+    ATP_Array l_array;
+    const ATP_Array *l_constArray = NULL;
+    const char *l_string = NULL;
+    char *l_block;
+    unsigned int i;
+
+    // containers created in the arena and then stored stay in it, however deep they are
+    ATP_dictionaryInitInArena(&l_dict, l_arena);
+    ATP_dictionaryInitInArena(&l_nested, l_arena);
+    ATP_dictionarySetString(&l_nested, "name", "a name long enough to be allocated from the arena");
+    CHECK(ATP_dictionarySetDict(&l_dict, "nested", l_nested));
+    ATP_arrayInitInArena(&l_array, l_arena);
+    CHECK(ATP_arrayGetArena(&l_array) == l_arena);
+    for (i = 0; i < 100; ++i)
+    {
+        CHECK(ATP_arraySetString(&l_array, i, "an entry long enough to be allocated from the arena"));
+    }
+    CHECK(ATP_dictionarySetArray(&l_dict, "array", l_array));
+
+    CHECK(ATP_dictionaryGetDict(&l_dict, "nested", &l_child) && ATP_dictionaryGetArena(l_child) == l_arena);
+    CHECK(ATP_dictionaryGetString(l_child, "name", &l_string)
+          && strcmp(l_string, "a name long enough to be allocated from the arena") == 0);
+    CHECK(ATP_dictionaryGetArrayConst(&l_dict, "array", &l_constArray) && ATP_arrayGetArena(l_constArray) == l_arena
+          && ATP_arrayLength(l_constArray) == 100);
+
+    // a block is extended in place while it is the latest one, and keeps its contents when it has to move
+    l_block = ATP_arenaAlloc(l_arena, 8);
+    CHECK((size_t) l_block % c_ATP_Arena_alignment == 0);
+    memcpy(l_block, "1234567", 8);
+    CHECK(ATP_arenaRealloc(l_arena, l_block, 8, 64) == l_block);
+    ATP_arenaAlloc(l_arena, 1);
+    l_block = ATP_arenaRealloc(l_arena, l_block, 64, 128);
+    CHECK(strcmp(l_block, "1234567") == 0);
+    CHECK(strcmp(ATP_arenaStrndup(l_arena, "truncated", 5), "trunc") == 0);
+
+    // the tree keeps the arena alive after the creator's reference is gone, and everything goes with the last handle
+    ATP_arenaRelease(l_arena);
+    CHECK(ATP_dictionaryCount(&l_dict) == 2);
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static void testKeys(void)
+{
+    static const size_t c_lengths[] = { 0, 1, 15, 16, 127, 128, 129, 1000, 4000 };
+    ATP_Dictionary l_dict;
+    ATP_DictionaryIterator l_iterator;
+    unsigned long long l_value = 0;
+    char l_key[4001];
+    unsigned int i;
+
+    // keys are kept at their own length, with no limit, and ones that differ only in their last character stay apart
+    ATP_dictionaryInit(&l_dict);
+    for (i = 0; i < sizeof(c_lengths) / sizeof(c_lengths[0]); ++i)
+    {
+        memset(l_key, 'k', c_lengths[i]);
+        l_key[c_lengths[i]] = '\0';
+        CHECK(ATP_dictionarySetUint(&l_dict, l_key, i));
+        if (c_lengths[i] > 0)
+        {
+            l_key[c_lengths[i] - 1] = 'x';
+            CHECK(ATP_dictionarySetUint(&l_dict, l_key, i + 100));
+        }
+    }
+    CHECK(ATP_dictionaryCount(&l_dict) == 2 * sizeof(c_lengths) / sizeof(c_lengths[0]) - 1);
+
+    for (i = 0; i < sizeof(c_lengths) / sizeof(c_lengths[0]); ++i)
+    {
+        memset(l_key, 'k', c_lengths[i]);
+        l_key[c_lengths[i]] = '\0';
+        CHECK(ATP_dictionaryGetUint(&l_dict, l_key, &l_value) && l_value == i);
+        if (c_lengths[i] > 0)
+        {
+            l_key[c_lengths[i] - 1] = 'x';
+            CHECK(ATP_dictionaryGetUint(&l_dict, l_key, &l_value) && l_value == i + 100);
+        }
+    }
+    CHECK(!ATP_dictionaryGetUint(&l_dict, "kk", &l_value));
+
+    for (l_iterator = ATP_dictionaryBeginConst(&l_dict); ATP_dictionaryHasNext(l_iterator);
+         l_iterator = ATP_dictionaryNext(l_iterator))
+    {
+        CHECK(ATP_dictionaryItGetUint(l_iterator, &l_value)
+              && strlen(ATP_dictionaryGetKey(l_iterator)) == c_lengths[l_value % 100]);
+    }
+
+    memset(l_key, 'k', 4000);
+    l_key[4000] = '\0';
+    ATP_dictionaryRemove(&l_dict, l_key);
+    CHECK(!ATP_dictionaryGetUint(&l_dict, l_key, &l_value));
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static void testScalars(void)
+{
+    ATP_Dictionary l_dict;
+    const char *l_string = NULL;
+    unsigned long long l_uint = 0;
+    signed long long l_int = 0;
+    double l_double = 0.0;
+    int l_bool = 0;
+    char l_buffer[64];
+    unsigned int i;
+
+    ATP_dictionaryInit(&l_dict);
+    CHECK(ATP_dictionarySetString(&l_dict, "short", "hi"));
+    CHECK(ATP_dictionarySetString(&l_dict, "long", "a string that is much too long to be stored inline"));
+    CHECK(ATP_dictionarySetUint(&l_dict, "uint", 18446744073709551615ull));
+    CHECK(ATP_dictionarySetInt(&l_dict, "int", -42));
+    CHECK(ATP_dictionarySetDouble(&l_dict, "double", 0.5));
+    CHECK(ATP_dictionarySetBool(&l_dict, "bool", 1));
+    CHECK(ATP_dictionaryCount(&l_dict) == 6);
+
+    CHECK(ATP_dictionaryGetString(&l_dict, "short", &l_string) && strcmp(l_string, "hi") == 0);
+    CHECK(ATP_dictionaryGetString(&l_dict, "long", &l_string)
+          && strcmp(l_string, "a string that is much too long to be stored inline") == 0);
+    CHECK(ATP_dictionaryGetUint(&l_dict, "uint", &l_uint) && l_uint == 18446744073709551615ull);
+    CHECK(ATP_dictionaryGetInt(&l_dict, "int", &l_int) && l_int == -42);
+    CHECK(ATP_dictionaryGetDouble(&l_dict, "double", &l_double) && l_double == 0.5);
+    CHECK(ATP_dictionaryGetBool(&l_dict, "bool", &l_bool) && l_bool == 1);
+
+    // a lookup fails for a missing key or the wrong type, and replacing an entry changes its type
+    CHECK(!ATP_dictionaryGetUint(&l_dict, "missing", &l_uint));
+    CHECK(!ATP_dictionaryGetUint(&l_dict, "int", &l_uint));
+    CHECK(ATP_dictionarySetString(&l_dict, "int", "now a string"));
+    CHECK(!ATP_dictionaryGetInt(&l_dict, "int", &l_int));
+    CHECK(ATP_dictionaryGetString(&l_dict, "int", &l_string) && strcmp(l_string, "now a string") == 0);
+    CHECK(ATP_dictionaryCount(&l_dict) == 6);
+
+    // strings of every length around the inline limit, replacing each other, and one set from its own storage
+    for (i = 0; i < 40; ++i)
+    {
+        memset(l_buffer, 'a' + (char) (i % 26), i);
+        l_buffer[i] = '\0';
+        CHECK(ATP_dictionarySetString(&l_dict, "long", l_buffer));
+        CHECK(ATP_dictionaryGetString(&l_dict, "long", &l_string) && strcmp(l_string, l_buffer) == 0);
+        CHECK(ATP_dictionaryGetString(&l_dict, "long", &l_string) && ATP_dictionarySetString(&l_dict, "long", l_string));
+        CHECK(ATP_dictionaryGetString(&l_dict, "long", &l_string) && strcmp(l_string, l_buffer) == 0);
+    }
+
+    ATP_dictionaryRemove(&l_dict, "short");
+    ATP_dictionaryRemove(&l_dict, "missing");
+    CHECK(!ATP_dictionaryGetString(&l_dict, "short", &l_string));
+    CHECK(ATP_dictionaryCount(&l_dict) == 5);
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static void testGrowth(void)
+{
+    ATP_Dictionary l_dict;
+    ATP_DictionaryIterator l_iterator;
+    unsigned long long l_value = 0;
+    unsigned int i;
+    char l_key[32];
+
+    ATP_dictionaryInit(&l_dict);
+    for (i = 0; i < c_manyKeys; ++i)
+    {
+        sprintf(l_key, "key%u", i);
+        CHECK(ATP_dictionarySetUint(&l_dict, l_key, i));
+    }
+    CHECK(ATP_dictionaryCount(&l_dict) == c_manyKeys);
+
+    // removing entries leaves the rest in the order they were added
+    for (i = 0; i < c_manyKeys; i += 2)
+    {
+        sprintf(l_key, "key%u", i);
+        ATP_dictionaryRemove(&l_dict, l_key);
+    }
+    CHECK(ATP_dictionaryCount(&l_dict) == c_manyKeys / 2);
+    i = 1;
+    for (l_iterator = ATP_dictionaryBegin(&l_dict); ATP_dictionaryHasNext(l_iterator);
+         l_iterator = ATP_dictionaryNext(l_iterator))
+    {
+        sprintf(l_key, "key%u", i);
+        CHECK(strcmp(ATP_dictionaryGetKey(l_iterator), l_key) == 0);
+        CHECK(ATP_dictionaryItGetUint(l_iterator, &l_value) && l_value == i);
+        i += 2;
+    }
+    CHECK(i == c_manyKeys + 1);
+
+    // the slots left by removed entries are reused
+    for (i = 0; i < c_manyKeys; ++i)
+    {
+        sprintf(l_key, "key%u", i);
+        if (i % 2 == 0)
+        {
+            CHECK(!ATP_dictionaryGetUint(&l_dict, l_key, &l_value));
+            CHECK(ATP_dictionarySetUint(&l_dict, l_key, i * 2));
+        }
+        CHECK(ATP_dictionaryGetUint(&l_dict, l_key, &l_value) && l_value == (i % 2 == 0 ? i * 2 : i));
+    }
+    CHECK(ATP_dictionaryCount(&l_dict) == c_manyKeys);
+
+    // erasing through an iterator moves on to the next entry
+    l_iterator = ATP_dictionaryBegin(&l_dict);
+    while (ATP_dictionaryHasNext(l_iterator))
+    {
+        CHECK(ATP_dictionaryItGetUint(l_iterator, &l_value));
+        if (l_value % 3 == 0)
+        {
+            l_iterator = ATP_dictionaryErase(&l_dict, l_iterator);
+        }
+        else
+        {
+            CHECK(ATP_dictionaryItSetUint(l_iterator, l_value + 3));
+            l_iterator = ATP_dictionaryNext(l_iterator);
+        }
+    }
+    for (l_iterator = ATP_dictionaryBeginConst(&l_dict); ATP_dictionaryHasNext(l_iterator);
+         l_iterator = ATP_dictionaryNext(l_iterator))
+    {
+        CHECK(ATP_dictionaryItGetUint(l_iterator, &l_value) && l_value % 3 != 0);
+    }
+    ATP_dictionaryDestroy(&l_dict);
+}
+
+static void testSharing(void)
+{
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_nested;
+    ATP_Dictionary l_copy;
+    ATP_Dictionary *l_inner = NULL;
+    ATP_Array l_array;
+    ATP_Array *l_entries = NULL;
+    const ATP_Dictionary *l_constInner = NULL;
+    const ATP_Array *l_constEntries = NULL;
+    const char *l_string = NULL;
+    unsigned long long l_value = 0;
+
+    ATP_dictionaryInit(&l_dict);
+    ATP_dictionaryInit(&l_nested);
+    ATP_dictionarySetString(&l_nested, "name", "original");
+    ATP_dictionarySetDict(&l_dict, "nested", l_nested);
+    ATP_arrayInit(&l_array);
+    ATP_arraySetUint(&l_array, 0, 1);
+    ATP_arraySetString(&l_array, 1, "one");
+    ATP_dictionarySetArray(&l_dict, "array", l_array);
+
+    // changing a copy, however deep the change, leaves the original as it was
+    l_copy = ATP_dictionaryDuplicate(&l_dict);
+    CHECK(ATP_dictionaryGetDict(&l_copy, "nested", &l_inner) && ATP_dictionarySetString(l_inner, "name", "changed"));
+    CHECK(ATP_dictionaryGetArray(&l_copy, "array", &l_entries) && ATP_arraySetUint(l_entries, 0, 2));
+    CHECK(ATP_dictionarySetBool(&l_copy, "added", 1));
+
+    CHECK(ATP_dictionaryGetDictConst(&l_dict, "nested", &l_constInner)
+          && ATP_dictionaryGetString(l_constInner, "name", &l_string) && strcmp(l_string, "original") == 0);
+    CHECK(ATP_dictionaryGetArrayConst(&l_dict, "array", &l_constEntries)
+          && ATP_arrayGetUint(l_constEntries, 0, &l_value) && l_value == 1);
+    CHECK(ATP_dictionaryCount(&l_dict) == 2);
+    CHECK(ATP_dictionaryGetDictConst(&l_copy, "nested", &l_constInner)
+          && ATP_dictionaryGetString(l_constInner, "name", &l_string) && strcmp(l_string, "changed") == 0);
+    CHECK(ATP_dictionaryGetArrayConst(&l_copy, "array", &l_constEntries)
+          && ATP_arrayGetUint(l_constEntries, 0, &l_value) && l_value == 2);
+    CHECK(ATP_dictionaryCount(&l_copy) == 3);
+
+    // the original outlives nothing it shared with the copy
+    ATP_dictionaryDestroy(&l_dict);
+    CHECK(ATP_dictionaryGetArrayConst(&l_copy, "array", &l_constEntries)
+          && ATP_arrayGetString(l_constEntries, 1, &l_string) && strcmp(l_string, "one") == 0);
+    ATP_dictionaryDestroy(&l_copy);
+}
+
+static void testResetShared(void)
+{
+    ATP_Arena *l_arena = ATP_arenaCreate(0);
+    ATP_Dictionary l_holder;
+    ATP_Dictionary l_inArena;
+    ATP_Dictionary l_heapDict;
+    ATP_Dictionary l_arenaDict;
+    ATP_Array l_array;
+    ATP_Array l_list;
+    ATP_Dictionary *l_held = NULL;
+    unsigned int i;
+
+    ATP_dictionaryInit(&l_holder);
+    ATP_dictionaryInitInArena(&l_inArena, l_arena);
+    ATP_dictionaryInit(&l_heapDict);
+    ATP_dictionarySetString(&l_heapDict, "name", "a string long enough to be allocated on its own");
+    ATP_dictionaryInitInArena(&l_arenaDict, l_arena);
+    ATP_dictionarySetString(&l_arenaDict, "name", "a string long enough to be allocated on its own");
+    ATP_arrayInit(&l_array);
+    ATP_arraySetString(&l_array, 0, "a string long enough to be allocated on its own");
+    ATP_arrayInit(&l_list);
+
+    // setting a slot to what it already holds gives up the reference handed over, which the sanitizers would report
+    for (i = 0; i < 2; ++i)
+    {
+        CHECK(ATP_dictionarySetDict(&l_holder, "heap", ATP_dictionaryDuplicate(&l_heapDict)));
+        CHECK(ATP_dictionarySetDict(&l_holder, "arena", ATP_dictionaryDuplicate(&l_arenaDict)));
+        CHECK(ATP_dictionarySetArray(&l_holder, "array", ATP_arrayDuplicate(&l_array)));
+        CHECK(ATP_dictionarySetDict(&l_inArena, "arena", ATP_dictionaryDuplicate(&l_arenaDict)));
+        CHECK(ATP_arraySetDict(&l_list, 0, ATP_dictionaryDuplicate(&l_heapDict)));
+        CHECK(ATP_arraySetArray(&l_list, 1, ATP_arrayDuplicate(&l_array)));
+    }
+    CHECK(ATP_dictionaryCount(&l_holder) == 3 && ATP_arrayLength(&l_list) == 2);
+
+    // the slot still holds a reference of its own once the caller's handles are gone
+    ATP_dictionaryDestroy(&l_heapDict);
+    ATP_dictionaryDestroy(&l_arenaDict);
+    ATP_arrayDestroy(&l_array);
+    ATP_arenaRelease(l_arena);
+    CHECK(ATP_dictionaryGetDict(&l_holder, "arena", &l_held) && ATP_dictionaryCount(l_held) == 1);
+    CHECK(ATP_dictionaryGetDict(&l_inArena, "arena", &l_held) && ATP_dictionarySetBool(l_held, "changed", 1));
+    ATP_dictionaryDestroy(&l_holder);
+    ATP_dictionaryDestroy(&l_inArena);
+    ATP_arrayDestroy(&l_list);
+}
+
+static void testPacked(void)
+{
+    static const unsigned long long c_values[] = { 1, 2, 3, 4, 5 };
+    ATP_Array l_array;
+    ATP_Array l_copy;
+    ATP_Array l_doubles;
+    unsigned long long *l_span = NULL;
+    const unsigned long long *l_constSpan = NULL;
+    unsigned long long l_value = 0;
+    signed long long l_int = 0;
+    const char *l_string = NULL;
+    unsigned int l_length = 0;
+    unsigned int i;
+
+    ATP_arrayInit(&l_array);
+    CHECK(ATP_arrayPack(&l_array, e_ATP_ValueType_uint));
+    ATP_arrayAppendUintN(&l_array, c_values, 5);
+    for (i = 5; i < 1000; ++i)
+    {
+        CHECK(ATP_arraySetUint(&l_array, i, i + 1));
+    }
+    CHECK(ATP_arrayGetPackedType(&l_array) == e_ATP_ValueType_uint);
+    CHECK(ATP_arrayGetUintSpanConst(&l_array, &l_constSpan, &l_length) && l_length == 1000 && l_constSpan[999] == 1000);
+    CHECK(!ATP_arrayGetInt(&l_array, 0, &l_int));
+    CHECK(!ATP_arrayPack(&l_array, e_ATP_ValueType_double));
+
+    // writing through the span of a copy leaves the original alone
+    l_copy = ATP_arrayDuplicate(&l_array);
+    CHECK(ATP_arrayGetUintSpan(&l_copy, &l_span, &l_length) && l_length == 1000);
+    l_span[0] = 100;
+    CHECK(ATP_arrayGetUint(&l_array, 0, &l_value) && l_value == 1);
+    CHECK(ATP_arrayGetUint(&l_copy, 0, &l_value) && l_value == 100);
+
+    // an entry of another type switches to tagged storage, keeping what was there
+    CHECK(ATP_arraySetString(&l_copy, 1000, "last"));
+    CHECK(ATP_arrayGetPackedType(&l_copy) == e_ATP_ValueType_none);
+    CHECK(!ATP_arrayGetUintSpan(&l_copy, &l_span, &l_length));
+    CHECK(ATP_arrayGetUint(&l_copy, 999, &l_value) && l_value == 1000);
+    CHECK(ATP_arrayGetString(&l_copy, 1000, &l_string) && strcmp(l_string, "last") == 0);
+    CHECK(ATP_arrayErase(&l_copy, 0) && ATP_arrayLength(&l_copy) == 1000);
+    CHECK(ATP_arrayGetUint(&l_copy, 0, &l_value) && l_value == 2);
+    CHECK(!ATP_arrayPack(&l_copy, e_ATP_ValueType_uint));
+    ATP_arrayDestroy(&l_copy);
+
+    // a tagged array of a single type can be packed afterwards
+    ATP_arrayInit(&l_doubles);
+    for (i = 0; i < 10; ++i)
+    {
+        CHECK(ATP_arraySetDouble(&l_doubles, i, i * 0.25));
+    }
+    CHECK(ATP_arrayPack(&l_doubles, e_ATP_ValueType_double));
+    CHECK(ATP_arrayGetPackedType(&l_doubles) == e_ATP_ValueType_double);
+    ATP_arrayDestroy(&l_doubles);
+
+    // an array with entries of more than one type cannot be packed
+    ATP_arrayInit(&l_doubles);
+    CHECK(ATP_arraySetInt(&l_doubles, 0, -1) && ATP_arraySetDouble(&l_doubles, 1, 0.5));
+    CHECK(!ATP_arrayPack(&l_doubles, e_ATP_ValueType_int) && !ATP_arrayPack(&l_doubles, e_ATP_ValueType_double));
+    CHECK(ATP_arrayGetInt(&l_doubles, 0, &l_int) && l_int == -1);
+    ATP_arrayDestroy(&l_doubles);
+    ATP_arrayDestroy(&l_array);
+}
+
+static void testFrozen(void)
+{
+    static const unsigned long long c_values[] = { 1, 2, 3 };
+    unsigned long long *l_span = NULL;
+    const unsigned long long *l_constSpan = NULL;
+    unsigned int l_length = 0;
+    ATP_Dictionary l_dict;
+    ATP_Dictionary l_nested;
+    ATP_Dictionary l_copy;
+    ATP_Dictionary l_empty;
+    ATP_Array l_array;
+    const ATP_Dictionary *l_constInner = NULL;
+    const ATP_Array *l_constEntries = NULL;
+    unsigned long long l_value = 0;
+    const char *l_string = NULL;
+    unsigned int i;
+    char l_key[32];
+
+    ATP_dictionaryInit(&l_dict);
+    for (i = 0; i < c_manyKeys; ++i)
+    {
+        sprintf(l_key, "key%u", i);
+        ATP_dictionarySetUint(&l_dict, l_key, i);
+    }
+    ATP_dictionaryInit(&l_nested);
+    ATP_dictionarySetString(&l_nested, "inner", "a string long enough to be copied into the arena");
+    ATP_dictionarySetDict(&l_dict, "nested", l_nested);
+    ATP_arrayInit(&l_array);
+    ATP_arraySetString(&l_array, 0, "entry");
+    ATP_dictionarySetArray(&l_dict, "array", l_array);
+
+    ATP_dictionaryFreeze(&l_dict);
+    CHECK(ATP_dictionaryIsFrozen(&l_dict));
+    CHECK(ATP_dictionaryGetArena(&l_dict) != NULL);
+    CHECK(ATP_dictionaryCount(&l_dict) == c_manyKeys + 2);
+    for (i = 0; i < c_manyKeys; ++i)
+    {
+        sprintf(l_key, "key%u", i);
+        CHECK(ATP_dictionaryGetUint(&l_dict, l_key, &l_value) && l_value == i);
+        sprintf(l_key, "absent%u", i);
+        CHECK(!ATP_dictionaryGetUint(&l_dict, l_key, &l_value));
+    }
+    CHECK(ATP_dictionaryGetDictConst(&l_dict, "nested", &l_constInner) && ATP_dictionaryIsFrozen(l_constInner)
+          && ATP_dictionaryGetString(l_constInner, "inner", &l_string)
+          && strcmp(l_string, "a string long enough to be copied into the arena") == 0);
+    CHECK(ATP_dictionaryGetArrayConst(&l_dict, "array", &l_constEntries) && ATP_arrayIsFrozen(l_constEntries));
+
+    // nothing in a frozen tree changes, and freezing it again keeps the tree its copies share
+    CHECK(!ATP_dictionarySetUint(&l_dict, "key0", 1));
+    CHECK(!ATP_dictionarySetUint(&l_dict, "new", 1));
+    ATP_dictionaryRemove(&l_dict, "key1");
+    CHECK(ATP_dictionaryGetUint(&l_dict, "key1", &l_value) && l_value == 1);
+    l_copy = ATP_dictionaryDuplicate(&l_dict);
+    ATP_dictionaryFreeze(&l_dict);
+    CHECK(ATP_dictionaryGetUint(&l_dict, "key2", &l_value) && l_value == 2);
+    ATP_dictionaryDestroy(&l_dict);
+    CHECK(ATP_dictionaryIsFrozen(&l_copy));
+    CHECK(ATP_dictionaryGetUint(&l_copy, "key3", &l_value) && l_value == 3);
+    ATP_dictionaryDestroy(&l_copy);
+
+    // a frozen packed array is read in place, and refuses writes through its span as well
+    ATP_arrayInit(&l_array);
+    ATP_arrayAppendUintN(&l_array, c_values, 3);
+    CHECK(ATP_arrayPack(&l_array, e_ATP_ValueType_uint));
+    ATP_arrayFreeze(&l_array);
+    CHECK(ATP_arrayIsFrozen(&l_array));
+    CHECK(!ATP_arraySetUint(&l_array, 0, 7));
+    CHECK(!ATP_arrayGetUintSpan(&l_array, &l_span, &l_length));
+    CHECK(ATP_arrayGetUintSpanConst(&l_array, &l_constSpan, &l_length) && l_length == 3 && l_constSpan[2] == 3);
+    ATP_arrayDestroy(&l_array);
+
+    ATP_dictionaryInit(&l_empty);
+    ATP_dictionaryFreeze(&l_empty);
+    CHECK(ATP_dictionaryIsFrozen(&l_empty) && ATP_dictionaryCount(&l_empty) == 0);
+    CHECK(!ATP_dictionaryGetUint(&l_empty, "key0", &l_value));
+    ATP_dictionaryDestroy(&l_empty);
+}
+
+int main(int p_argc, char **p_argv)
+{
+    testArena();
+    testArenaTree();
+    testKeys();
+    testScalars();
+    testGrowth();
+    testSharing();
+    testResetShared();
+    testPacked();
+    testFrozen();
+
+    if (gs_failures > 0)
+    {
+        ERR("%u checks failed\n", gs_failures);
+        return EXIT_FAILURE;
+    }
+    LOG("All dictionary and array checks passed\n");
+    return EXIT_SUCCESS;
+}